@@ -0,0 +1,237 @@
+// Scaling benchmark for sclp: generates sources that each stress one
+// dimension of the input, compiles them at doubling sizes, and reports the
+// wall time and peak RSS of each compile with the growth exponent between
+// successive sizes, near 1 for linear and near 2 for quadratic paths. The
+// time of compiling an empty program is taken off first, so that process
+// start-up does not flatten the curve. Exits 1 if a dimension's time grows
+// faster than LIMIT over its last doubling.
+//
+// usage: bench SCLP [DIR]   sources and outputs go to DIR, by default .,
+//                           and the results, tab-separated, to DIR/bench.tsv
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+    // of time against size over the last doubling, beyond which a path is
+    // taken to be superlinear
+    constexpr double LIMIT = 1.5;
+    // compiles of each source, the fastest of which counts
+    constexpr int RUNS = 3;
+    constexpr int DOUBLINGS = 4;
+
+    struct Dimension {
+        char const* name;
+        // the smallest size
+        size_t base;
+        std::function<std::string(size_t)> gen;
+    };
+
+    std::string n(size_t k)
+    {
+        return std::to_string(k);
+    }
+
+    // count small functions, each called from main
+    std::string many_funcs(size_t count)
+    {
+        std::string s;
+        for (size_t k = 0; k < count; ++k)
+            s += "int f" + n(k) + "(int a)\n{\n    int b;\n    b = a * " + n(k) + " + 1;\n    if (b > " + n(k) + ")\n        b = b - a;\n    return b;\n}\n";
+        s += "void main()\n{\n    int r;\n    r = 0;\n";
+        for (size_t k = 0; k < count; ++k)
+            s += "    r = f" + n(k) + "(r);\n";
+        s += "    print r;\n}\n";
+        return s;
+    }
+
+    // blocks and loops nested depth deep; the parser runs out of stack by
+    // 800
+    std::string deep_nesting(size_t depth)
+    {
+        std::string s = "void main()\n{\n";
+        for (size_t k = 0; k < depth; ++k)
+            s += "int v" + n(k) + ";\nv" + n(k) + " = 0;\nwhile (v" + n(k) + " < 2) {\nv" + n(k) + " = v" + n(k) + " + 1;\nif (v" + n(k) + " > 0) {\n";
+        s += "print 0;\n";
+        for (size_t k = 0; k < depth; ++k)
+            s += "}\n}\n";
+        s += "}\n";
+        return s;
+    }
+
+    // one expression of terms terms
+    std::string long_expr(size_t terms)
+    {
+        static char const* const ops[] = { " + ", " - ", " * ", " + " };
+        std::string s = "void main()\n{\n    int a, b, x;\n    a = 3;\n    b = 5;\n    x = a";
+        for (size_t k = 1; k < terms; ++k)
+            s += std::string(ops[k % 4]) + (k % 3 == 0 ? "b" : k % 3 == 1 ? "a" : n(k));
+        s += ";\n    print x;\n}\n";
+        return s;
+    }
+
+    // count distinct string literals
+    std::string many_strings(size_t count)
+    {
+        std::string s = "void main()\n{\n";
+        for (size_t k = 0; k < count; ++k)
+            s += "    print \"string " + n(k) + "\";\n";
+        s += "}\n";
+        return s;
+    }
+
+    // an array type, a pointer type and a function type for each of count
+    // sizes, as globals
+    std::string many_types(size_t count)
+    {
+        std::string s;
+        for (size_t k = 1; k <= count; ++k) {
+            s += "int a" + n(k) + "[" + n(k) + "];\n";
+            s += "int (*p" + n(k) + ")[" + n(k) + "];\n";
+            s += "float (*h" + n(k) + ")(int (*x)[" + n(k) + "]);\n";
+        }
+        s += "void main()\n{\n    p1 = &a1;\n    print a1[0];\n}\n";
+        return s;
+    }
+
+    // count globals, int and float
+    std::string many_globals(size_t count)
+    {
+        std::string s;
+        for (size_t k = 0; k < count; ++k)
+            s += (k % 2 == 0 ? "int g" : "float g") + n(k) + ";\n";
+        s += "void main()\n{\n    g0 = 1;\n    print g0;\n}\n";
+        return s;
+    }
+
+    struct Result {
+        double ms;
+        double rss_mib;
+        bool ok;
+    };
+
+    // sclp on path, the fastest of RUNS, with the RSS of that run
+    Result compile(std::string const& sclp, std::string const& path)
+    {
+        Result best{ 0, 0, false };
+        for (int r = 0; r < RUNS; ++r) {
+            auto start = std::chrono::steady_clock::now();
+            pid_t c = fork();
+            if (c == 0) {
+                execl(sclp.c_str(), sclp.c_str(), path.c_str(), (char*)NULL);
+                _exit(127);
+            }
+            int status;
+            struct rusage ru;
+            if (c < 0 || wait4(c, &status, 0, &ru) != c)
+                return best;
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                return Result{ ms, ru.ru_maxrss / 1024.0, false };
+            if (!best.ok || ms < best.ms)
+                best = Result{ ms, ru.ru_maxrss / 1024.0, true };
+        }
+        return best;
+    }
+
+    bool write(std::string const& path, std::string const& src)
+    {
+        std::ofstream f(path);
+        f << src;
+        return bool(f);
+    }
+
+    // d log b / d log a
+    double exponent(double a0, double a1, double b0, double b1)
+    {
+        return std::log(std::max(b1, 1e-3) / std::max(b0, 1e-3)) / std::log(a1 / a0);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || argc > 3) {
+        std::cerr << "usage: " << argv[0] << " SCLP [DIR]\n";
+        return 2;
+    }
+    std::string sclp = argv[1];
+    std::string dir = (argc == 3 ? argv[2] : ".");
+
+    Dimension const dims[] = {
+        { "funcs", 500, many_funcs },
+        { "nesting", 40, deep_nesting },
+        { "expr", 1000, long_expr },
+        { "strings", 1000, many_strings },
+        { "types", 500, many_types },
+        { "globals", 2000, many_globals },
+    };
+
+    std::string empty = dir + "/bench_empty.c";
+    if (!write(empty, "void main()\n{\n}\n")) {
+        std::cerr << "bench: Unable to write " << empty << "\n";
+        return 2;
+    }
+    std::ofstream tsv(dir + "/bench.tsv");
+    tsv << "dimension\tsize\tms\trss_mib\n";
+    Result base = compile(sclp, empty);
+    if (!base.ok) {
+        std::cerr << "bench: " << sclp << " failed on an empty program\n";
+        return 2;
+    }
+
+    std::cout << std::fixed;
+    std::cout << "start-up " << std::setprecision(1) << base.ms << " ms, " << base.rss_mib << " MiB, taken off below\n";
+    std::cout << std::left << std::setw(10) << "dimension" << std::right << std::setw(10) << "size" << std::setw(12) << "ms" << std::setw(12) << "RSS MiB" << std::setw(10) << "time exp" << std::setw(10) << "RSS exp" << "\n";
+
+    std::vector<std::string> superlinear;
+    for (Dimension const& d : dims) {
+        std::vector<Result> rs;
+        std::vector<size_t> sizes;
+        for (int k = 0; k <= DOUBLINGS; ++k) {
+            size_t size = d.base << k;
+            std::string path = dir + "/bench_" + d.name + "_" + std::to_string(size) + ".c";
+            if (!write(path, d.gen(size))) {
+                std::cerr << "bench: Unable to write " << path << "\n";
+                return 2;
+            }
+            Result r = compile(sclp, path);
+            if (!r.ok) {
+                std::cerr << "bench: " << sclp << " failed on " << path << "\n";
+                return 2;
+            }
+            r.ms = std::max(r.ms - base.ms, 0.0);
+            r.rss_mib = std::max(r.rss_mib - base.rss_mib, 0.0);
+            sizes.push_back(size);
+            rs.push_back(r);
+            tsv << d.name << "\t" << size << "\t" << r.ms << "\t" << r.rss_mib << "\n";
+
+            std::cout << std::left << std::setw(10) << d.name << std::right << std::setw(10) << size << std::setprecision(1) << std::setw(12) << r.ms << std::setw(12) << r.rss_mib;
+            if (k > 0)
+                std::cout << std::setprecision(2) << std::setw(10) << exponent(sizes[k - 1], size, rs[k - 1].ms, r.ms) << std::setw(10) << exponent(sizes[k - 1], size, rs[k - 1].rss_mib, r.rss_mib);
+            std::cout << "\n";
+        }
+        if (exponent(sizes[DOUBLINGS - 1], sizes[DOUBLINGS], rs[DOUBLINGS - 1].ms, rs[DOUBLINGS].ms) > LIMIT)
+            superlinear.push_back(d.name);
+    }
+
+    if (!superlinear.empty()) {
+        std::cout << "superlinear:";
+        for (std::string const& s : superlinear)
+            std::cout << " " << s;
+        std::cout << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,146 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Fixed-size view of an array of node pointers living inside an Arena
+template <typename T>
+class ArenaList {
+private:
+    T* const* d;
+    size_t n;
+
+public:
+    ArenaList()
+        : d(nullptr), n(0) {}
+    ArenaList(T* const* d, size_t n)
+        : d(d), n(n) {}
+    T* const* begin() const
+    {
+        return d;
+    }
+    T* const* end() const
+    {
+        return d + n;
+    }
+    size_t size() const
+    {
+        return n;
+    }
+    T* operator[](size_t i) const
+    {
+        return d[i];
+    }
+};
+
+// Bump allocator owning every object made through it; everything is
+// destroyed and released together when the arena goes out of scope, or
+// destroyed by reset(), which keeps the blocks for the next round of use.
+// Handles into the arena are plain non-owning pointers.
+class Arena {
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    struct Dtor {
+        void (*fn)(void*);
+        void* obj;
+    };
+
+    struct Block {
+        char* mem;
+        size_t size;
+    };
+    // the first nr_used hold objects; the rest are kept from before a reset
+    std::vector<Block> blocks;
+    size_t nr_used;
+    char* curr;
+    size_t left;
+
+    // objects which need their destructor run, in construction order
+    std::vector<Dtor> dtors;
+    // objects made since the last reset
+    size_t nr_objects;
+
+    void* alloc(size_t size, size_t align)
+    {
+        size_t pad = (align - reinterpret_cast<size_t>(curr) % align) % align;
+        if (curr == nullptr || pad + size > left) {
+            if (nr_used == blocks.size() || blocks[nr_used].size < size + align) {
+                size_t bs = (size + align > BLOCK_SIZE ? size + align : BLOCK_SIZE);
+                char* mem = static_cast<char*>(::operator new(bs));
+                blocks.insert(blocks.begin() + nr_used, { mem, bs });
+            }
+            curr = blocks[nr_used].mem;
+            left = blocks[nr_used].size;
+            ++nr_used;
+            pad = (align - reinterpret_cast<size_t>(curr) % align) % align;
+        }
+        void* p = curr + pad;
+        curr += pad + size;
+        left -= pad + size;
+        return p;
+    }
+
+public:
+    Arena()
+        : nr_used(0), curr(nullptr), left(0), nr_objects(0) {}
+    Arena(Arena const&) = delete;
+    Arena& operator=(Arena const&) = delete;
+    ~Arena()
+    {
+        reset();
+        for (Block const& b : blocks)
+            ::operator delete(b.mem);
+    }
+
+    void reset()
+    {
+        for (auto it = dtors.rbegin(); it != dtors.rend(); ++it)
+            it->fn(it->obj);
+        dtors.clear();
+        nr_used = 0;
+        curr = nullptr;
+        left = 0;
+        nr_objects = 0;
+    }
+
+    size_t get_nr_objects() const
+    {
+        return nr_objects;
+    }
+    // the blocks in use since the last reset
+    size_t get_size() const
+    {
+        size_t n = 0;
+        for (size_t i = 0; i < nr_used; ++i)
+            n += blocks[i].size;
+        return n;
+    }
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args)
+    {
+        T* p = new (alloc(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value)
+            dtors.push_back({ [](void* o) { static_cast<T*>(o)->~T(); }, p });
+        ++nr_objects;
+        return p;
+    }
+
+    template <typename T>
+    ArenaList<T> make_list(std::vector<T*> const& v)
+    {
+        if (v.size() == 0)
+            return ArenaList<T>();
+        T** d = static_cast<T**>(alloc(v.size() * sizeof(T*), alignof(T*)));
+        for (size_t i = 0; i < v.size(); ++i)
+            d[i] = v[i];
+        return ArenaList<T>(d, v.size());
+    }
+};
+
+#endif // ARENA_H
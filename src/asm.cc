@@ -0,0 +1,70 @@
+#include <asm.h>
+#include <cassert>
+#include <iostream>
+
+using namespace ASM;
+
+void Code::print(std::ostream& o, Instr const& i) const
+{
+    OpDesc const& d = desc(i.op);
+    switch (d.form) {
+    case Form::SYM_DEF:
+        o << d.mn << i.sym << ":\n";
+        return;
+    case Form::LABEL_DEF:
+        o << i.label << ":\n";
+        return;
+    default:
+        break;
+    }
+
+    o << d.mn;
+    switch (d.form) {
+    case Form::NONE:
+        break;
+    case Form::R:
+        o << "$" << i.r[0];
+        break;
+    case Form::RR:
+        o << "$" << i.r[0] << ", $" << i.r[1];
+        break;
+    case Form::RRR:
+        o << "$" << i.r[0] << ", $" << i.r[1] << ", $" << i.r[2];
+        break;
+    case Form::RRI:
+        o << "$" << i.r[0] << ", $" << i.r[1] << ", " << i.imm;
+        break;
+    case Form::RM:
+        o << "$" << i.r[0] << ", ";
+        if (!i.sym.empty())
+            o << i.sym;
+        else
+            o << i.imm << "($" << i.r[1] << ")";
+        break;
+    case Form::RLIT:
+        o << "$" << i.r[0] << ", " << i.lit;
+        break;
+    case Form::RFLIT:
+        o << "$" << i.r[0] << ", " << i.flit;
+        break;
+    case Form::SYM:
+        o << i.sym;
+        break;
+    case Form::LABEL:
+        o << i.label;
+        break;
+    case Form::RLABEL:
+        o << "$" << i.r[0] << ", " << i.label;
+        break;
+    default:
+        assert(false);
+    }
+    o << "\n";
+}
+
+void Code::renumber_labels(LabelMap const& map)
+{
+    for (Instr& i : instrs)
+        if (i.op == Op::LABEL || i.op == Op::J || i.op == Op::BGTZ)
+            i.label = map(i.label);
+}
@@ -1,692 +1,203 @@
 #ifndef ASM_H
 #define ASM_H
 
+#include <cstdint>
+#include <ident.h>
+#include <names.h>
+#include <reg.h>
 #include <iostream>
-#include <memory>
+#include <string>
+#include <vector>
 
+// A function's assembly is a flat array of fixed-size Instrs. The .spim
+// text is rendered from it through op_descs, and the assembler encodes it
+// straight into MIPS32 words.
 namespace ASM {
-    struct Base{
-        virtual void print(std::ostream&) const = 0;
-    };
-
-    struct Val: public Base {
-    };
-    struct Register: public Val {
-        std::string name;
-        Register(std::string n) : name(n) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "$" << name;
-        }
-    };
-
-    struct Mem: public Val {
-        std::string name;
-        Mem(std::string n) : name(n) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << name;
-        }
-    };
-    struct IntLit: public Val {
-        size_t val;
-        IntLit(size_t v) : val(v) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << val;
-        }
-    };
-    struct FloatLit: public Val {
-        double val;
-        FloatLit(double v) : val(v) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << val;
-        }
-    };
-
-    struct Stmt : public Base {
-    };
-
-    struct LabelStmt : public Stmt{
-        std::string label;
-        LabelStmt(std::string label) : label(label) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << label << ":\n";
-        }
-    };
-
-    struct SyscallStmt : public Stmt{
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tsyscall\n";
-        }
-    };
-
-    struct JRStmt : public Stmt{
-        std::shared_ptr<Register> reg;
-        JRStmt(std::shared_ptr<Register> reg) : reg(reg) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tjr ";
-            reg->print(o);
-            o << "\n";
-        }
-    };
-    struct JStmt : public Stmt{
-        std::string label;
-        JStmt(std::string label) : label(label) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tj " << label << "\n";
-        }
-    };
-    struct JalStmt : public Stmt{
-        std::string func_name;
-        JalStmt(std::string func_name) : func_name(func_name) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tjal " << func_name << "\n";
-        }
-    };
-    struct JalrStmt : public Stmt{
-        std::shared_ptr<Register> func_ptr;
-        JalrStmt(std::shared_ptr<Register> func_ptr) : func_ptr(func_ptr) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tjalr ";
-            func_ptr->print(o);
-            o << "\n";
-        }
-    };
-
-    struct BGTZStmt : public Stmt{
-        std::shared_ptr<Register> reg;
-        std::string label;
-        BGTZStmt(std::shared_ptr<Register> reg, std::string label) : reg(reg), label(label) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tbgtz ";
-            reg->print(o);
-            o << ", " << label << "\n";
-        }
-    };
-    struct NegStmt : public Stmt{
-        std::shared_ptr<Register> reg1, reg2;
-        NegStmt(std::shared_ptr<Register> reg1, std::shared_ptr<Register> reg2) : reg1(reg1), reg2(reg2) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tneg ";
-            reg1->print(o);
-            o << ", ";
-            reg2->print(o);
-            o << "\n";
-        }
-    };
-    struct NegDStmt : public Stmt{
-        std::shared_ptr<Register> reg1, reg2;
-        NegDStmt(std::shared_ptr<Register> reg1, std::shared_ptr<Register> reg2) : reg1(reg1), reg2(reg2) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tneg.d ";
-            reg1->print(o);
-            o << ", ";
-            reg2->print(o);
-            o << "\n";
-        }
-    };
-
-    struct MovStmt : public Stmt{
-        std::shared_ptr<Register> reg1, reg2;
-        MovStmt(std::shared_ptr<Register> reg1, std::shared_ptr<Register> reg2) : reg1(reg1), reg2(reg2) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tmove ";
-            reg1->print(o);
-            o << ", ";
-            reg2->print(o);
-            o << "\n";
-        }
-    };
-    struct MovDStmt : public Stmt{
-        std::shared_ptr<Register> reg1, reg2;
-        MovDStmt(std::shared_ptr<Register> reg1, std::shared_ptr<Register> reg2) : reg1(reg1), reg2(reg2) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tmov.d ";
-            reg1->print(o);
-            o << ", ";
-            reg2->print(o);
-            o << "\n";
-        }
-    };
-
-
-    struct SWStmt : public Stmt{
+    enum class Op : uint8_t {
+        // directives and labels, which take up no words
+        TEXT, GLOBL, FUNC_LABEL, LABEL, EPILOGUE_LABEL,
+        SYSCALL, JR, J, J_EPILOGUE, JAL, JALR, BGTZ,
+        NEG, NEG_D, MOVE, MOV_D,
+        SW, S_D, LW, L_D, LI, LI_D, LA,
+        ADD, ADD_D, SUB, SUB_D, MUL, MUL_D, DIV, DIV_D,
+        // add and sub with an immediate right operand
+        ADDI, SUBI,
+        SLT, SLE, SGT, SGE, SNE, SEQ, OR, AND, XORI,
+        C_LT_D, C_LE_D, C_EQ_D, MOVT, MOVF,
+        Nr
+    };
+
+    // how an Instr's fields are printed
+    enum class Form : uint8_t {
+        NONE,       // mn
+        SYM_DEF,    // sym:
+        LABEL_DEF,  // label:
+        R,          // mn $r0
+        RR,         // mn $r0, $r1
+        RRR,        // mn $r0, $r1, $r2
+        RRI,        // mn $r0, $r1, imm
+        RM,         // mn $r0, sym  or  mn $r0, imm($r1)
+        RLIT,       // mn $r0, lit
+        RFLIT,      // mn $r0, flit
+        SYM,        // mn sym
+        LABEL,      // mn label
+        RLABEL      // mn $r0, label
+    };
+
+    struct OpDesc {
+        // printed before the operands; for SYM_DEF a prefix of the symbol
+        char const* mn;
+        Form form;
+        // an assembler pseudo-instruction: expanded into other machine
+        // instructions, or more than one
+        bool pseudo;
+    };
+
+    constexpr OpDesc op_descs[(size_t)Op::Nr] = {
+        { "\t.text",        Form::NONE,      false },
+        { "\t.globl ",      Form::SYM,       false },
+        { "",               Form::SYM_DEF,   false },
+        { "",               Form::LABEL_DEF, false },
+        { "epilogue_",      Form::SYM_DEF,   false },
+        { "\tsyscall",      Form::NONE,      false },
+        { "\tjr ",          Form::R,         false },
+        { "\tj ",           Form::LABEL,     false },
+        { "\tj epilogue_",  Form::SYM,       false },
+        { "\tjal ",         Form::SYM,       false },
+        { "\tjalr ",        Form::R,         false },
+        { "\tbgtz ",        Form::RLABEL,    false },
+        { "\tneg ",         Form::RR,        true },
+        { "\tneg.d ",       Form::RR,        false },
+        { "\tmove ",        Form::RR,        true },
+        { "\tmov.d ",       Form::RR,        false },
+        { "\tsw ",          Form::RM,        false },
+        { "\ts.d ",         Form::RM,        true },
+        { "\tlw ",          Form::RM,        false },
+        { "\tl.d ",         Form::RM,        true },
+        { "\tli ",          Form::RLIT,      true },
+        { "\tli.d ",        Form::RFLIT,     true },
+        { "\tla ",          Form::RM,        true },
+        { "\tadd ",         Form::RRR,       false },
+        { "\tadd.d ",       Form::RRR,       false },
+        { "\tsub ",         Form::RRR,       false },
+        { "\tsub.d ",       Form::RRR,       false },
+        { "\tmul ",         Form::RRR,       false },
+        { "\tmul.d ",       Form::RRR,       false },
+        { "\tdiv ",         Form::RRR,       true },
+        { "\tdiv.d ",       Form::RRR,       false },
+        { "\tadd ",         Form::RRI,       true },
+        { "\tsub ",         Form::RRI,       true },
+        { "\tslt ",         Form::RRR,       false },
+        { "\tsle ",         Form::RRR,       true },
+        { "\tsgt ",         Form::RRR,       true },
+        { "\tsge ",         Form::RRR,       true },
+        { "\tsne ",         Form::RRR,       true },
+        { "\tseq ",         Form::RRR,       true },
+        { "\tor ",          Form::RRR,       false },
+        { "\tand ",         Form::RRR,       false },
+        { "\txori ",        Form::RRI,       false },
+        { "\tc.lt.d ",      Form::RR,        false },
+        { "\tc.le.d ",      Form::RR,        false },
+        { "\tc.eq.d ",      Form::RR,        false },
+        { "\tmovt ",        Form::RRI,       false },
+        { "\tmovf ",        Form::RRI,       false },
+    };
+    constexpr OpDesc const& desc(Op op)
+    {
+        return op_descs[(size_t)op];
+    }
+
+    struct Instr {
+        Op op;
+        // in printed order; for RM the value register, then the base
+        RegId r[3];
+        // immediate, or the offset off the base of RM
+        int32_t imm;
+        // Which member is live is given by the form of op; an RM operand is
+        // a global by name when sym is not none.
+        union {
+            size_t lit;
+            double flit;
+            Ident sym;
+            LabelId label;
+        };
+    };
+    static_assert(sizeof(Instr) == 16, "Instr should stay two words");
+
+    // not a directive or a label
+    inline bool is_machine(Instr const& i)
+    {
+        return i.op >= Op::SYSCALL;
+    }
+    // a global by name takes a lui before the load or store
+    inline bool is_pseudo(Instr const& i)
+    {
+        return desc(i.op).pseudo || (desc(i.op).form == Form::RM && !i.sym.empty());
+    }
+
+    class Code {
     public:
-        std::shared_ptr<Register> reg1;
-        std::shared_ptr<Val> v;
-        int offset;
-        SWStmt(std::shared_ptr<Register> reg1, std::shared_ptr<Val> v, int offset) : reg1(reg1), v(v), offset(offset) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tsw ";
-            reg1->print(o);
-            o << ", ";
-            if(offset == -1)
-                v->print(o);
-            else{
-                o << offset << "(";
-                v->print(o);
-                o << ")";
-            }
-            o << "\n";
-        } 
-    };
-    struct SDStmt : public Stmt{
-    public:
-        std::shared_ptr<Register> reg1;
-        std::shared_ptr<Val> v;
-        int offset;
-        SDStmt(std::shared_ptr<Register> reg1, std::shared_ptr<Val> v, int offset) : reg1(reg1), v(v), offset(offset) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\ts.d ";
-            reg1->print(o);
-            o << ", ";
-            if(offset == -1)
-                v->print(o);
-            else{
-                o << offset << "(";
-                v->print(o);
-                o << ")";
-            }
-            o << "\n";
-        } 
-    };
-    struct LWStmt : public Stmt{
-    public:
-        std::shared_ptr<Register> reg1;
-        std::shared_ptr<Val> v;
-        int offset;
-        LWStmt(std::shared_ptr<Register> reg1, std::shared_ptr<Val> v, int offset) : reg1(reg1), v(v), offset(offset) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tlw ";
-            reg1->print(o);
-            o << ", ";
-            if(offset == -1)
-                v->print(o);
-            else{
-                o << offset << "(";
-                v->print(o);
-                o << ")";
-            }
-            o << "\n";
-        } 
-    };
-    struct LDStmt : public Stmt{
-    public:
-        std::shared_ptr<Register> reg1;
-        std::shared_ptr<Val> v;
-        int offset;
-        LDStmt(std::shared_ptr<Register> reg1, std::shared_ptr<Val> v, int offset) : reg1(reg1), v(v), offset(offset) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tl.d ";
-            reg1->print(o);
-            o << ", ";
-            if(offset == -1)
-                v->print(o);
-            else{
-                o << offset << "(";
-                v->print(o);
-                o << ")";
-            }
-            o << "\n";
-        } 
-    };
+        std::vector<Instr> instrs;
 
-    struct LIStmt : public Stmt{
-    public:
-        std::shared_ptr<Register> reg;
-        size_t val;
-        LIStmt(std::shared_ptr<Register> reg, size_t val) : reg(reg), val(val) {}
-        virtual void print(std::ostream& o) const override
+        void emit(Op op, RegId r0 = RegId::NONE, RegId r1 = RegId::NONE, RegId r2 = RegId::NONE, int32_t imm = 0)
         {
-            o << "\tli ";
-            reg->print(o);
-            o << ", " << val;
-            o << "\n";
-        } 
-    };
-    struct LIDStmt : public Stmt{
-    public:
-        std::shared_ptr<Register> reg;
-        double val;
-        LIDStmt(std::shared_ptr<Register> reg, double val) : reg(reg), val(val) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tli.d ";
-            reg->print(o);
-            o << ", " << val;
-            o << "\n";
-        } 
-    };
-    struct LAStmt : public Stmt{
-    public:
-        std::shared_ptr<Register> reg;
-        std::shared_ptr<Mem> mem;
-        LAStmt(std::shared_ptr<Register> reg, std::shared_ptr<Mem> mem) : reg(reg), mem(mem) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tla ";
-            reg->print(o);
-            o << ", ";
-            mem->print(o);
-            o << "\n";
-        } 
-    };
-
-    struct AddStmt : public Stmt{
-        std::shared_ptr<Register> reg;
-        std::shared_ptr<Val> val1, val2;
-        AddStmt(std::shared_ptr<Register> reg, std::shared_ptr<Val> val1, std::shared_ptr<Val> val2) : reg(reg), val1(val1), val2(val2) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tadd ";
-            reg->print(o);
-            o << ", ";
-            val1->print(o);
-            o << ", ";
-            val2->print(o);
-            o << "\n";
-        }
-    };
-    struct AddDStmt : public Stmt{
-        std::shared_ptr<Register> reg;
-        std::shared_ptr<Val> val1, val2;
-        AddDStmt(std::shared_ptr<Register> reg, std::shared_ptr<Val> val1, std::shared_ptr<Val> val2) : reg(reg), val1(val1), val2(val2) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tadd.d ";
-            reg->print(o);
-            o << ", ";
-            val1->print(o);
-            o << ", ";
-            val2->print(o);
-            o << "\n";
-        }
-    };
-    struct SubStmt : public Stmt{
-        std::shared_ptr<Register> reg;
-        std::shared_ptr<Val> val1, val2;
-        SubStmt(std::shared_ptr<Register> reg, std::shared_ptr<Val> val1, std::shared_ptr<Val> val2) : reg(reg), val1(val1), val2(val2) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tsub ";
-            reg->print(o);
-            o << ", ";
-            val1->print(o);
-            o << ", ";
-            val2->print(o);
-            o << "\n";
+            Instr i{ op, { r0, r1, r2 }, imm, {} };
+            instrs.push_back(i);
         }
-    };
-    struct SubDStmt : public Stmt{
-        std::shared_ptr<Register> reg;
-        std::shared_ptr<Val> val1, val2;
-        SubDStmt(std::shared_ptr<Register> reg, std::shared_ptr<Val> val1, std::shared_ptr<Val> val2) : reg(reg), val1(val1), val2(val2) {}
-        virtual void print(std::ostream& o) const override
+        void emit_sym(Op op, Ident sym, RegId r0 = RegId::NONE)
         {
-            o << "\tsub.d ";
-            reg->print(o);
-            o << ", ";
-            val1->print(o);
-            o << ", ";
-            val2->print(o);
-            o << "\n";
+            Instr i{ op, { r0, RegId::NONE, RegId::NONE }, 0, {} };
+            i.sym = sym;
+            instrs.push_back(i);
         }
-    };
-    struct MulStmt : public Stmt{
-        std::shared_ptr<Register> reg;
-        std::shared_ptr<Val> val1, val2;
-        MulStmt(std::shared_ptr<Register> reg, std::shared_ptr<Val> val1, std::shared_ptr<Val> val2) : reg(reg), val1(val1), val2(val2) {}
-        virtual void print(std::ostream& o) const override
+        void emit_label(Op op, LabelId label, RegId r0 = RegId::NONE)
         {
-            o << "\tmul ";
-            reg->print(o);
-            o << ", ";
-            val1->print(o);
-            o << ", ";
-            val2->print(o);
-            o << "\n";
+            Instr i{ op, { r0, RegId::NONE, RegId::NONE }, 0, {} };
+            i.label = label;
+            instrs.push_back(i);
         }
-    };
-    struct MulDStmt : public Stmt{
-        std::shared_ptr<Register> reg;
-        std::shared_ptr<Val> val1, val2;
-        MulDStmt(std::shared_ptr<Register> reg, std::shared_ptr<Val> val1, std::shared_ptr<Val> val2) : reg(reg), val1(val1), val2(val2) {}
-        virtual void print(std::ostream& o) const override
+        // r <- imm(base)
+        void emit_mem(Op op, RegId r, RegId base, int32_t imm)
         {
-            o << "\tmul.d ";
-            reg->print(o);
-            o << ", ";
-            val1->print(o);
-            o << ", ";
-            val2->print(o);
-            o << "\n";
+            Instr i{ op, { r, base, RegId::NONE }, imm, {} };
+            instrs.push_back(i);
         }
-    };
-    struct DivStmt : public Stmt{
-        std::shared_ptr<Register> reg;
-        std::shared_ptr<Val> val1, val2;
-        DivStmt(std::shared_ptr<Register> reg, std::shared_ptr<Val> val1, std::shared_ptr<Val> val2) : reg(reg), val1(val1), val2(val2) {}
-        virtual void print(std::ostream& o) const override
+        void emit_li(RegId r, size_t v)
         {
-            o << "\tdiv ";
-            reg->print(o);
-            o << ", ";
-            val1->print(o);
-            o << ", ";
-            val2->print(o);
-            o << "\n";
+            Instr i{ Op::LI, { r, RegId::NONE, RegId::NONE }, 0, {} };
+            i.lit = v;
+            instrs.push_back(i);
         }
-    };
-    struct DivDStmt : public Stmt{
-        std::shared_ptr<Register> reg;
-        std::shared_ptr<Val> val1, val2;
-        DivDStmt(std::shared_ptr<Register> reg, std::shared_ptr<Val> val1, std::shared_ptr<Val> val2) : reg(reg), val1(val1), val2(val2) {}
-        virtual void print(std::ostream& o) const override
+        void emit_li_d(RegId r, double v)
         {
-            o << "\tdiv.d ";
-            reg->print(o);
-            o << ", ";
-            val1->print(o);
-            o << ", ";
-            val2->print(o);
-            o << "\n";
+            Instr i{ Op::LI_D, { r, RegId::NONE, RegId::NONE }, 0, {} };
+            i.flit = v;
+            instrs.push_back(i);
         }
-    };
 
-    struct SLTStmt : public Stmt{
-        std::shared_ptr<Register> reg;
-        std::shared_ptr<Val> val1, val2;
-        SLTStmt(std::shared_ptr<Register> reg, std::shared_ptr<Val> val1, std::shared_ptr<Val> val2) : reg(reg), val1(val1), val2(val2) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tslt ";
-            reg->print(o);
-            o << ", ";
-            val1->print(o);
-            o << ", ";
-            val2->print(o);
-            o << "\n";
-        }
-    };
-    struct SLEStmt : public Stmt{
-        std::shared_ptr<Register> reg;
-        std::shared_ptr<Val> val1, val2;
-        SLEStmt(std::shared_ptr<Register> reg, std::shared_ptr<Val> val1, std::shared_ptr<Val> val2) : reg(reg), val1(val1), val2(val2) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tsle ";
-            reg->print(o);
-            o << ", ";
-            val1->print(o);
-            o << ", ";
-            val2->print(o);
-            o << "\n";
-        }
-    };
-    struct SGTStmt : public Stmt{
-        std::shared_ptr<Register> reg;
-        std::shared_ptr<Val> val1, val2;
-        SGTStmt(std::shared_ptr<Register> reg, std::shared_ptr<Val> val1, std::shared_ptr<Val> val2) : reg(reg), val1(val1), val2(val2) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tsgt ";
-            reg->print(o);
-            o << ", ";
-            val1->print(o);
-            o << ", ";
-            val2->print(o);
-            o << "\n";
-        }
-    };
-    struct SGEStmt : public Stmt{
-        std::shared_ptr<Register> reg;
-        std::shared_ptr<Val> val1, val2;
-        SGEStmt(std::shared_ptr<Register> reg, std::shared_ptr<Val> val1, std::shared_ptr<Val> val2) : reg(reg), val1(val1), val2(val2) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tsge ";
-            reg->print(o);
-            o << ", ";
-            val1->print(o);
-            o << ", ";
-            val2->print(o);
-            o << "\n";
-        }
-    };
-    struct SNEStmt : public Stmt{
-        std::shared_ptr<Register> reg;
-        std::shared_ptr<Val> val1, val2;
-        SNEStmt(std::shared_ptr<Register> reg, std::shared_ptr<Val> val1, std::shared_ptr<Val> val2) : reg(reg), val1(val1), val2(val2) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tsne ";
-            reg->print(o);
-            o << ", ";
-            val1->print(o);
-            o << ", ";
-            val2->print(o);
-            o << "\n";
-        }
-    };
-    struct SEQStmt : public Stmt{
-        std::shared_ptr<Register> reg;
-        std::shared_ptr<Val> val1, val2;
-        SEQStmt(std::shared_ptr<Register> reg, std::shared_ptr<Val> val1, std::shared_ptr<Val> val2) : reg(reg), val1(val1), val2(val2) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tseq ";
-            reg->print(o);
-            o << ", ";
-            val1->print(o);
-            o << ", ";
-            val2->print(o);
-            o << "\n";
-        }
+        void print(std::ostream&, Instr const&) const;
+        void renumber_labels(LabelMap const& map);
     };
 
-    struct OrStmt : public Stmt{
-        std::shared_ptr<Register> reg;
-        std::shared_ptr<Val> val1, val2;
-        OrStmt(std::shared_ptr<Register> reg, std::shared_ptr<Val> val1, std::shared_ptr<Val> val2) : reg(reg), val1(val1), val2(val2) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tor ";
-            reg->print(o);
-            o << ", ";
-            val1->print(o);
-            o << ", ";
-            val2->print(o);
-            o << "\n";
-        }
-    };
-    struct AndStmt : public Stmt{
-        std::shared_ptr<Register> reg;
-        std::shared_ptr<Val> val1, val2;
-        AndStmt(std::shared_ptr<Register> reg, std::shared_ptr<Val> val1, std::shared_ptr<Val> val2) : reg(reg), val1(val1), val2(val2) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tand ";
-            reg->print(o);
-            o << ", ";
-            val1->print(o);
-            o << ", ";
-            val2->print(o);
-            o << "\n";
-        }
-    };
-    struct XorIStmt : public Stmt{
-        std::shared_ptr<Register> reg;
-        std::shared_ptr<Val> val1, val2;
-        XorIStmt(std::shared_ptr<Register> reg, std::shared_ptr<Val> val1, std::shared_ptr<Val> val2) : reg(reg), val1(val1), val2(val2) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\txori ";
-            reg->print(o);
-            o << ", ";
-            val1->print(o);
-            o << ", ";
-            val2->print(o);
-            o << "\n";
-        }
-    };
+    // Assembles whole programs into a MIPS32 little-endian ELF executable
+    // laid out as SPIM does: text at 0x00400000, data at 0x10010000. A
+    // start stub calls main and exits through syscall 10.
+    class Assembler {
+        struct Datum {
+            Ident name;
+            size_t align;
+            std::string bytes;
+        };
+        std::vector<Datum> data;
+        std::vector<std::pair<Ident, Code>> funcs;
 
-    struct CLTDStmt : public Stmt{
-        std::shared_ptr<Register> reg1, reg2;
-        CLTDStmt(std::shared_ptr<Register> reg1, std::shared_ptr<Register> reg2) : reg1(reg1), reg2(reg2) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tc.lt.d ";
-            reg1->print(o);
-            o << ", ";
-            reg2->print(o);
-            o << "\n";
-        }
-    };
-    struct CLEDStmt : public Stmt{
-        std::shared_ptr<Register> reg1, reg2;
-        CLEDStmt(std::shared_ptr<Register> reg1, std::shared_ptr<Register> reg2) : reg1(reg1), reg2(reg2) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tc.le.d ";
-            reg1->print(o);
-            o << ", ";
-            reg2->print(o);
-            o << "\n";
-        }
-    };
-    struct CEQDStmt : public Stmt{
-        std::shared_ptr<Register> reg1, reg2;
-        CEQDStmt(std::shared_ptr<Register> reg1, std::shared_ptr<Register> reg2) : reg1(reg1), reg2(reg2) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tc.eq.d ";
-            reg1->print(o);
-            o << ", ";
-            reg2->print(o);
-            o << "\n";
-        }
-    };
-
-    struct MovTStmt : public Stmt{
-        std::shared_ptr<Register> reg1, reg2;
-        std::shared_ptr<IntLit> val;
-        MovTStmt(std::shared_ptr<Register> reg1, std::shared_ptr<Register> reg2, std::shared_ptr<IntLit> val) : reg1(reg1), reg2(reg2), val(val) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tmovt ";
-            reg1->print(o);
-            o << ", ";
-            reg2->print(o);
-            o << ", ";
-            val->print(o);
-            o << "\n";
-        }
-    };
-    struct MovFStmt : public Stmt{
-        std::shared_ptr<Register> reg1, reg2;
-        std::shared_ptr<IntLit> val;
-        MovFStmt(std::shared_ptr<Register> reg1, std::shared_ptr<Register> reg2, std::shared_ptr<IntLit> val) : reg1(reg1), reg2(reg2), val(val) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tmovf ";
-            reg1->print(o);
-            o << ", ";
-            reg2->print(o);
-            o << ", ";
-            val->print(o);
-            o << "\n";
-        }
-    };
-
-    struct LAAddrStmt : public Stmt{
-        std::shared_ptr<Register> reg;
-        std::shared_ptr<Val> v;
-        int offset;
-
-        LAAddrStmt(std::shared_ptr<Register> reg, std::shared_ptr<Val> v, int offset) : reg(reg), v(v), offset(offset) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tla ";
-            reg->print(o);
-            o << ", ";
-            if(offset == -1)
-                v->print(o);
-            else{
-                o << offset << "($fp)";
-            }
-            o << "\n";
-        }
-    };
-
-    struct DerefStmt : public Stmt{
-        std::shared_ptr<Register> reg1, reg2;
-
-        DerefStmt(std::shared_ptr<Register> reg1, std::shared_ptr<Register> reg2) : reg1(reg1), reg2(reg2) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tlw ";
-            reg1->print(o);
-            o << ", 0(";
-            reg2->print(o);
-            o << ")\n";
-        }
-    };
-    struct DerefDStmt : public Stmt{
-        std::shared_ptr<Register> reg1, reg2;
-
-        DerefDStmt(std::shared_ptr<Register> reg1, std::shared_ptr<Register> reg2) : reg1(reg1), reg2(reg2) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tl.d ";
-            reg1->print(o);
-            o << ", 0(";
-            reg2->print(o);
-            o << ")\n";
-        }
-    };
-
-    struct DRFSStmt : public Stmt{
-        std::shared_ptr<Register> reg1, reg2;
-
-        DRFSStmt(std::shared_ptr<Register> reg1, std::shared_ptr<Register> reg2) : reg1(reg1), reg2(reg2) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tsw ";
-            reg2->print(o);
-            o << ", 0(";
-            reg1->print(o);
-            o << ")\n";
-        }
-    };
-    struct DRFSDStmt : public Stmt{
-        std::shared_ptr<Register> reg1, reg2;
+    public:
+        void add_word(Ident name);
+        void add_double(Ident name);
+        void add_string(Ident name, std::string const& val);
+        void add_func(Ident name, Code&& code);
 
-        DRFSDStmt(std::shared_ptr<Register> reg1, std::shared_ptr<Register> reg2) : reg1(reg1), reg2(reg2) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\ts.d ";
-            reg2->print(o);
-            o << ", 0(";
-            reg1->print(o);
-            o << ")\n";
-        }
+        void write(std::ostream&) const;
     };
 }
 
@@ -0,0 +1,469 @@
+#include <asm.h>
+#include <error.h>
+#include <cassert>
+#include <cstring>
+#include <unordered_map>
+
+using namespace ASM;
+
+namespace {
+    constexpr uint32_t TEXT_BASE = 0x00400000;
+    constexpr uint32_t DATA_BASE = 0x10010000;
+    constexpr uint32_t FILE_ALIGN = 0x1000;
+    // the assembler temporary, used to reach globals
+    constexpr uint32_t AT = 1;
+
+    uint32_t n(RegId r)
+    {
+        assert(r != RegId::NONE);
+        return reg_nums[(size_t)r];
+    }
+
+    uint32_t r_type(uint32_t rs, uint32_t rt, uint32_t rd, uint32_t funct)
+    {
+        return (rs << 21) | (rt << 16) | (rd << 11) | funct;
+    }
+    uint32_t i_type(uint32_t op, uint32_t rs, uint32_t rt, int32_t imm)
+    {
+        return (op << 26) | (rs << 21) | (rt << 16) | ((uint32_t)imm & 0xFFFF);
+    }
+    uint32_t j_type(uint32_t op, uint32_t addr)
+    {
+        return (op << 26) | ((addr >> 2) & 0x3FFFFFF);
+    }
+    // double precision coprocessor 1 arithmetic: fd <- fs op ft
+    uint32_t cop1_d(uint32_t fs, uint32_t ft, uint32_t fd, uint32_t funct)
+    {
+        return (0x11u << 26) | (0x11u << 21) | (ft << 16) | (fs << 11) | (fd << 6) | funct;
+    }
+
+    enum : uint32_t {
+        // primary opcodes
+        OP_J = 0x02, OP_JAL = 0x03, OP_BGTZ = 0x07, OP_ADDI = 0x08, OP_ADDIU = 0x09,
+        OP_SLTIU = 0x0B, OP_ORI = 0x0D, OP_XORI = 0x0E, OP_LUI = 0x0F, OP_SPECIAL2 = 0x1C,
+        OP_LW = 0x23, OP_SW = 0x2B, OP_LWC1 = 0x31, OP_SWC1 = 0x39,
+        // SPECIAL functs
+        F_MOVCI = 0x01, F_JR = 0x08, F_JALR = 0x09, F_SYSCALL = 0x0C, F_MFLO = 0x12,
+        F_DIV = 0x1A, F_ADD = 0x20, F_ADDU = 0x21, F_SUB = 0x22, F_AND = 0x24,
+        F_OR = 0x25, F_XOR = 0x26, F_SLT = 0x2A, F_SLTU = 0x2B,
+        // SPECIAL2 functs
+        F_MUL = 0x02,
+        // COP1 functs
+        F_ADD_D = 0x00, F_SUB_D = 0x01, F_MUL_D = 0x02, F_DIV_D = 0x03,
+        F_MOV_D = 0x06, F_NEG_D = 0x07, F_C_EQ_D = 0x32, F_C_LT_D = 0x3C, F_C_LE_D = 0x3E
+    };
+    constexpr uint32_t NOP = 0;
+
+    // hi/lo halves such that lui hi then a signed lo offset reaches addr;
+    // data is 8-aligned where a second word is read, so lo + 4 still fits
+    int32_t lo(uint32_t addr)
+    {
+        return (int16_t)(addr & 0xFFFF);
+    }
+    int32_t hi(uint32_t addr)
+    {
+        return (addr - lo(addr)) >> 16;
+    }
+
+    bool fits_imm(int64_t v)
+    {
+        return v >= INT16_MIN && v <= INT16_MAX;
+    }
+
+    // words the instruction assembles to, delay slots included
+    size_t words(Instr const& i)
+    {
+        switch (i.op) {
+        case Op::TEXT:
+        case Op::GLOBL:
+        case Op::FUNC_LABEL:
+        case Op::LABEL:
+        case Op::EPILOGUE_LABEL:
+            return 0;
+        case Op::JR:
+        case Op::J:
+        case Op::J_EPILOGUE:
+        case Op::JAL:
+        case Op::JALR:
+        case Op::BGTZ:
+            return 2;
+        case Op::SW:
+        case Op::LW:
+            return i.sym.empty() ? 1 : 2;
+        case Op::S_D:
+        case Op::L_D:
+            return i.sym.empty() ? 2 : 3;
+        case Op::LI:
+            {
+                int32_t v = (int32_t)i.lit;
+                return fits_imm(v) || (uint32_t)v <= 0xFFFF ? 1 : 2;
+            }
+        case Op::LI_D:
+            return 3;
+        case Op::LA:
+            return i.sym.empty() ? 1 : 2;
+        case Op::DIV:
+        case Op::SLE:
+        case Op::SGE:
+        case Op::SNE:
+        case Op::SEQ:
+            return 2;
+        default:
+            return 1;
+        }
+    }
+
+    void put16(std::string& s, uint16_t v)
+    {
+        s.push_back(v & 0xFF);
+        s.push_back(v >> 8);
+    }
+    void put32(std::string& s, uint32_t v)
+    {
+        put16(s, v & 0xFFFF);
+        put16(s, v >> 16);
+    }
+    void align(std::string& s, size_t to)
+    {
+        s.resize((s.size() + to - 1) / to * to, '\0');
+    }
+}
+
+void Assembler::add_word(Ident name)
+{
+    data.push_back(Datum{ name, 4, std::string(4, '\0') });
+}
+void Assembler::add_double(Ident name)
+{
+    data.push_back(Datum{ name, 8, std::string(8, '\0') });
+}
+void Assembler::add_string(Ident name, std::string const& val)
+{
+    data.push_back(Datum{ name, 1, val + '\0' });
+}
+void Assembler::add_func(Ident name, Code&& code)
+{
+    funcs.emplace_back(name, std::move(code));
+}
+
+void Assembler::write(std::ostream& o) const
+{
+    // data segment: declared data, then the pool of li.d constants
+    std::string dseg;
+    std::unordered_map<Ident, uint32_t> data_addr;
+    for (Datum const& d : data) {
+        align(dseg, d.align);
+        data_addr[d.name] = DATA_BASE + dseg.size();
+        dseg += d.bytes;
+    }
+    std::unordered_map<uint64_t, uint32_t> pool_addr;
+    for (auto const& f : funcs)
+        for (Instr const& i : f.second.instrs)
+            if (i.op == Op::LI_D) {
+                uint64_t bits;
+                std::memcpy(&bits, &i.flit, sizeof bits);
+                if (pool_addr.count(bits) == 0) {
+                    align(dseg, 8);
+                    pool_addr[bits] = DATA_BASE + dseg.size();
+                    put32(dseg, bits & 0xFFFFFFFF);
+                    put32(dseg, bits >> 32);
+                }
+            }
+
+    // pass 1: addresses of functions, epilogues and labels
+    constexpr uint32_t stub_words = 4;
+    std::unordered_map<Ident, uint32_t> func_addr, epilogue_addr;
+    std::unordered_map<uint32_t, uint32_t> label_addr;
+    uint32_t pc = TEXT_BASE + 4 * stub_words;
+    for (auto const& f : funcs)
+        for (Instr const& i : f.second.instrs) {
+            switch (i.op) {
+            case Op::FUNC_LABEL:
+                func_addr[i.sym] = pc;
+                break;
+            case Op::EPILOGUE_LABEL:
+                epilogue_addr[i.sym] = pc;
+                break;
+            case Op::LABEL:
+                label_addr[i.label.num] = pc;
+                break;
+            default:
+                break;
+            }
+            pc += 4 * words(i);
+        }
+
+    auto lookup = [](std::unordered_map<Ident, uint32_t> const& m, Ident sym, char const* what) {
+        auto it = m.find(sym);
+        if (it == m.end())
+            sclp_error(0, std::string("Undefined ") + what + " " + sym.str());
+        return it->second;
+    };
+    auto label = [&](LabelId l) {
+        auto it = label_addr.find(l.num);
+        if (it == label_addr.end())
+            sclp_error(0, "Undefined label Label" + std::to_string(l.num));
+        return it->second;
+    };
+    // a 16-bit offset or immediate; the code generator keeps to them
+    auto imm16 = [](int64_t v) {
+        if (!fits_imm(v))
+            sclp_error(0, "Immediate " + std::to_string(v) + " out of range");
+        return (int32_t)v;
+    };
+
+    // pass 2: encode
+    std::string tseg;
+    put32(tseg, j_type(OP_JAL, lookup(func_addr, Ident("main"), "function")));
+    put32(tseg, NOP);
+    put32(tseg, i_type(OP_ADDIU, 0, n(RegId::V0), 10));
+    put32(tseg, r_type(0, 0, 0, F_SYSCALL));
+
+    pc = TEXT_BASE + 4 * stub_words;
+    for (auto const& f : funcs)
+        for (Instr const& i : f.second.instrs) {
+            size_t start = tseg.size();
+            uint32_t r0 = i.r[0] == RegId::NONE ? 0 : n(i.r[0]);
+            uint32_t r1 = i.r[1] == RegId::NONE ? 0 : n(i.r[1]);
+            uint32_t r2 = i.r[2] == RegId::NONE ? 0 : n(i.r[2]);
+            // loads and stores; a global goes through $at
+            auto mem_op = [&](uint32_t op, uint32_t rt, int32_t off) {
+                if (i.sym.empty())
+                    put32(tseg, i_type(op, r1, rt, imm16((int64_t)i.imm + off)));
+                else
+                    put32(tseg, i_type(op, AT, rt, imm16(lo(lookup(data_addr, i.sym, "symbol")) + off)));
+            };
+            auto global_hi = [&]() {
+                if (!i.sym.empty())
+                    put32(tseg, i_type(OP_LUI, 0, AT, hi(lookup(data_addr, i.sym, "symbol"))));
+            };
+
+            switch (i.op) {
+            case Op::TEXT:
+            case Op::GLOBL:
+            case Op::FUNC_LABEL:
+            case Op::LABEL:
+            case Op::EPILOGUE_LABEL:
+                break;
+            case Op::SYSCALL:
+                put32(tseg, r_type(0, 0, 0, F_SYSCALL));
+                break;
+            case Op::JR:
+                put32(tseg, r_type(r0, 0, 0, F_JR));
+                put32(tseg, NOP);
+                break;
+            case Op::JALR:
+                put32(tseg, r_type(r0, 0, n(RegId::RA), F_JALR));
+                put32(tseg, NOP);
+                break;
+            case Op::J:
+                put32(tseg, j_type(OP_J, label(i.label)));
+                put32(tseg, NOP);
+                break;
+            case Op::J_EPILOGUE:
+                put32(tseg, j_type(OP_J, lookup(epilogue_addr, i.sym, "function")));
+                put32(tseg, NOP);
+                break;
+            case Op::JAL:
+                put32(tseg, j_type(OP_JAL, lookup(func_addr, i.sym, "function")));
+                put32(tseg, NOP);
+                break;
+            case Op::BGTZ:
+                {
+                    int32_t off = ((int32_t)label(i.label) - (int32_t)(pc + 4)) >> 2;
+                    put32(tseg, i_type(OP_BGTZ, r0, 0, imm16(off)));
+                    put32(tseg, NOP);
+                }
+                break;
+            case Op::NEG:
+                put32(tseg, r_type(0, r1, r0, F_SUB));
+                break;
+            case Op::NEG_D:
+                put32(tseg, cop1_d(r1, 0, r0, F_NEG_D));
+                break;
+            case Op::MOVE:
+                put32(tseg, r_type(r1, 0, r0, F_ADDU));
+                break;
+            case Op::MOV_D:
+                put32(tseg, cop1_d(r1, 0, r0, F_MOV_D));
+                break;
+            case Op::SW:
+                global_hi();
+                mem_op(OP_SW, r0, 0);
+                break;
+            case Op::LW:
+                global_hi();
+                mem_op(OP_LW, r0, 0);
+                break;
+            // the pair of singles making up a double, low word first
+            case Op::S_D:
+                global_hi();
+                mem_op(OP_SWC1, r0, 0);
+                mem_op(OP_SWC1, r0 + 1, 4);
+                break;
+            case Op::L_D:
+                global_hi();
+                mem_op(OP_LWC1, r0, 0);
+                mem_op(OP_LWC1, r0 + 1, 4);
+                break;
+            case Op::LI:
+                {
+                    int32_t v = (int32_t)i.lit;
+                    if (fits_imm(v))
+                        put32(tseg, i_type(OP_ADDIU, 0, r0, v));
+                    else if ((uint32_t)v <= 0xFFFF)
+                        put32(tseg, i_type(OP_ORI, 0, r0, v));
+                    else {
+                        put32(tseg, i_type(OP_LUI, 0, r0, (uint32_t)v >> 16));
+                        put32(tseg, i_type(OP_ORI, r0, r0, v & 0xFFFF));
+                    }
+                }
+                break;
+            case Op::LI_D:
+                {
+                    uint64_t bits;
+                    std::memcpy(&bits, &i.flit, sizeof bits);
+                    uint32_t a = pool_addr.at(bits);
+                    put32(tseg, i_type(OP_LUI, 0, AT, hi(a)));
+                    put32(tseg, i_type(OP_LWC1, AT, r0, lo(a)));
+                    put32(tseg, i_type(OP_LWC1, AT, r0 + 1, lo(a) + 4));
+                }
+                break;
+            case Op::LA:
+                if (i.sym.empty())
+                    put32(tseg, i_type(OP_ADDIU, r1, r0, imm16(i.imm)));
+                else {
+                    // data, or a function whose address is taken
+                    uint32_t a = data_addr.count(i.sym) ? data_addr.at(i.sym) : lookup(func_addr, i.sym, "symbol");
+                    put32(tseg, i_type(OP_LUI, 0, AT, hi(a)));
+                    put32(tseg, i_type(OP_ADDIU, AT, r0, lo(a)));
+                }
+                break;
+            case Op::ADD:
+                put32(tseg, r_type(r1, r2, r0, F_ADD));
+                break;
+            case Op::SUB:
+                put32(tseg, r_type(r1, r2, r0, F_SUB));
+                break;
+            case Op::MUL:
+                put32(tseg, (OP_SPECIAL2 << 26) | r_type(r1, r2, r0, F_MUL));
+                break;
+            case Op::DIV:
+                put32(tseg, r_type(r1, r2, 0, F_DIV));
+                put32(tseg, r_type(0, 0, r0, F_MFLO));
+                break;
+            case Op::ADD_D:
+                put32(tseg, cop1_d(r1, r2, r0, F_ADD_D));
+                break;
+            case Op::SUB_D:
+                put32(tseg, cop1_d(r1, r2, r0, F_SUB_D));
+                break;
+            case Op::MUL_D:
+                put32(tseg, cop1_d(r1, r2, r0, F_MUL_D));
+                break;
+            case Op::DIV_D:
+                put32(tseg, cop1_d(r1, r2, r0, F_DIV_D));
+                break;
+            case Op::ADDI:
+                put32(tseg, i_type(OP_ADDI, r1, r0, imm16(i.imm)));
+                break;
+            case Op::SUBI:
+                put32(tseg, i_type(OP_ADDI, r1, r0, imm16(-(int64_t)i.imm)));
+                break;
+            case Op::SLT:
+                put32(tseg, r_type(r1, r2, r0, F_SLT));
+                break;
+            case Op::SGT:
+                put32(tseg, r_type(r2, r1, r0, F_SLT));
+                break;
+            // a <= b is !(b < a), a >= b is !(a < b)
+            case Op::SLE:
+                put32(tseg, r_type(r2, r1, r0, F_SLT));
+                put32(tseg, i_type(OP_XORI, r0, r0, 1));
+                break;
+            case Op::SGE:
+                put32(tseg, r_type(r1, r2, r0, F_SLT));
+                put32(tseg, i_type(OP_XORI, r0, r0, 1));
+                break;
+            case Op::SEQ:
+                put32(tseg, r_type(r1, r2, r0, F_XOR));
+                put32(tseg, i_type(OP_SLTIU, r0, r0, 1));
+                break;
+            case Op::SNE:
+                put32(tseg, r_type(r1, r2, r0, F_XOR));
+                put32(tseg, r_type(0, r0, r0, F_SLTU));
+                break;
+            case Op::OR:
+                put32(tseg, r_type(r1, r2, r0, F_OR));
+                break;
+            case Op::AND:
+                put32(tseg, r_type(r1, r2, r0, F_AND));
+                break;
+            case Op::XORI:
+                put32(tseg, i_type(OP_XORI, r1, r0, i.imm));
+                break;
+            case Op::C_LT_D:
+                put32(tseg, cop1_d(r0, r1, 0, F_C_LT_D));
+                break;
+            case Op::C_LE_D:
+                put32(tseg, cop1_d(r0, r1, 0, F_C_LE_D));
+                break;
+            case Op::C_EQ_D:
+                put32(tseg, cop1_d(r0, r1, 0, F_C_EQ_D));
+                break;
+            // condition code in rt[4:2], true/false in rt[0]
+            case Op::MOVT:
+                put32(tseg, r_type(r1, (i.imm << 2) | 1, r0, F_MOVCI));
+                break;
+            case Op::MOVF:
+                put32(tseg, r_type(r1, i.imm << 2, r0, F_MOVCI));
+                break;
+            default:
+                assert(false);
+            }
+            // pass 1 placed everything after by words()
+            if (tseg.size() - start != 4 * words(i))
+                sclp_error(0, "Assembler emitted " + std::to_string((tseg.size() - start) / 4) + " words where it laid out " + std::to_string(words(i)) + ", for op " + std::to_string((int)i.op) + " in " + f.first.str());
+            pc += 4 * words(i);
+        }
+
+    // ELF32 header and one PT_LOAD per segment, each page aligned in the file
+    constexpr uint32_t EHDR_SIZE = 52, PHDR_SIZE = 32;
+    uint32_t text_off = FILE_ALIGN;
+    uint32_t data_off = (text_off + tseg.size() + FILE_ALIGN - 1) / FILE_ALIGN * FILE_ALIGN;
+
+    std::string elf("\x7F" "ELF\x01\x01\x01", 7);
+    elf.resize(16, '\0');
+    put16(elf, 2);          // ET_EXEC
+    put16(elf, 8);          // EM_MIPS
+    put32(elf, 1);
+    put32(elf, TEXT_BASE);  // entry, the start stub
+    put32(elf, EHDR_SIZE);
+    put32(elf, 0);
+    put32(elf, 0x50001000); // MIPS32, o32
+    put16(elf, EHDR_SIZE);
+    put16(elf, PHDR_SIZE);
+    put16(elf, 2);
+    put16(elf, 40);
+    put16(elf, 0);
+    put16(elf, 0);
+
+    auto phdr = [&](uint32_t off, uint32_t vaddr, uint32_t size, uint32_t flags) {
+        put32(elf, 1); // PT_LOAD
+        put32(elf, off);
+        put32(elf, vaddr);
+        put32(elf, vaddr);
+        put32(elf, size);
+        put32(elf, size);
+        put32(elf, flags);
+        put32(elf, FILE_ALIGN);
+    };
+    phdr(text_off, TEXT_BASE, tseg.size(), 5); // R X
+    phdr(data_off, DATA_BASE, dseg.size(), 6); // R W
+
+    elf.resize(text_off, '\0');
+    elf += tseg;
+    elf.resize(data_off, '\0');
+    elf += dseg;
+    o.write(elf.data(), elf.size());
+}
@@ -2,26 +2,39 @@
 #define AST_H
 
 #include <error.h>
+#include <json.h>
 #include <types.h>
 #include <sym.h>
+#include <deque>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
-#include <parse.h>
 #include <tac.h>
 #include <asm.h>
+#include <arena.h>
 
+// AST nodes are allocated in the Arena of the Builder driving the parser,
+// which owns them; the pointers between nodes are non-owning. Nodes are
+// never deleted, only dropped with the arena, so have no virtual destructor:
+// all but StrLit are trivially destructible and cost the arena no Dtor.
 namespace AST {
+    // How a JSON dump refers to the parameters and locals of the function
+    // being written: by their position among them, parameters first.
+    // Anything else is referred to by name.
+    using SymIndex = std::unordered_map<Symbol const*, size_t>;
+
     class Base {
     public:
-        virtual ~Base() = default;
         virtual void print(std::ostream&, std::string) const = 0;
+        virtual void json(Json::Writer&, SymIndex const&) const = 0;
     };
 
     class Stmt : public Base {
     public:
-        virtual ~Stmt() = default;
-        virtual void tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const = 0;
+        virtual void tac(std::vector<TAC::Instr>&, TAC::Context&) const = 0;
         virtual size_t break_count() const
         {
             return 0;
@@ -47,27 +60,27 @@ namespace AST {
     public:
         SemType const* const semtype;
         Expr(SemType const* semtype) : semtype(semtype) {}
-        virtual ~Expr() = default;
-        virtual std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const = 0;
+        virtual TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const = 0;
     };
     class LValExpr : public Expr {
     public:
         bool is_sym;
 
         LValExpr(SemType const* semtype) : Expr(semtype), is_sym(false) {}
-        virtual std::shared_ptr<TAC::Val> addr_tac(std::vector<std::shared_ptr<TAC::Stmt>>& stmts, TAC::Context& ctx) const = 0;
+        virtual TAC::Val addr_tac(std::vector<TAC::Instr>& stmts, TAC::Context& ctx) const = 0;
         virtual bool is_const() const = 0;
     };
     class Sym : public LValExpr {
     public:
-        std::shared_ptr<Symbol> const sym;
-        Sym(std::shared_ptr<Symbol> sym) : LValExpr(sym->semtype), sym(sym)
+        Symbol const* const sym;
+        Sym(Symbol const* sym) : LValExpr(sym->semtype), sym(sym)
         {
             is_sym = true;
         }
         void print(std::ostream&, std::string) const override;
-        std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
-        std::shared_ptr<TAC::Val> addr_tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
+        TAC::Val addr_tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
         bool is_const() const
         {
             return sym->is_const;
@@ -78,60 +91,66 @@ namespace AST {
         size_t const val;
         IntLit(size_t v) : Expr(SemType::make_int()), val(v) {}
         void print(std::ostream&, std::string) const override;
-        std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
     };
     class FloatLit : public Expr {
     public:
         double const val;
         FloatLit(double v) : Expr(SemType::make_float()), val(v) {}
         void print(std::ostream&, std::string) const override;
-        std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
     };
     class StrLit : public Expr {
     public:
         std::string const val;
         StrLit(std::string v) : Expr(SemType::make_string()), val(v) {}
         void print(std::ostream&, std::string) const override;
-        std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
     };
 
     // statements
     class AssignStmt : public Stmt {
     public:
-        std::shared_ptr<LValExpr> const lhs;
-        std::shared_ptr<Expr> const rhs;
-        AssignStmt(size_t line, std::shared_ptr<LValExpr> lhs, std::shared_ptr<Expr> rhs)
+        LValExpr* const lhs;
+        Expr* const rhs;
+        AssignStmt(size_t line, LValExpr* lhs, Expr* rhs)
             : lhs(lhs), rhs(rhs)
         {
             if (!SemType::check_assign(lhs->semtype, rhs->semtype))
                 sclp_error(line, "Assignment type mismatch");
         }
         void print(std::ostream&, std::string) const override;
-        void tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        void tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
     };
     class PrintStmt : public Stmt {
     public:
-        std::shared_ptr<Expr> const arg;
-        PrintStmt(size_t line, std::shared_ptr<Expr> arg)
+        Expr* const arg;
+        PrintStmt(size_t line, Expr* arg)
             : arg(arg)
         {
             if (!SemType::check(SemType::StmtUn::Print, arg->semtype))
                 sclp_error(line, "Print type mismatch");
         }
         void print(std::ostream&, std::string) const override;
-        void tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        void tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
     };
     class ReadStmt : public Stmt {
     public:
-        std::shared_ptr<LValExpr> const arg;
-        ReadStmt(size_t line, std::shared_ptr<LValExpr> arg)
+        LValExpr* const arg;
+        ReadStmt(size_t line, LValExpr* arg)
             : arg(arg)
         {
             if (!SemType::check(SemType::StmtUn::Read, arg->semtype))
                 sclp_error(line, "Read type mismatch");
         }
         void print(std::ostream&, std::string) const override;
-        void tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        void tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
     };
     class CompoundStmt : public Stmt {
     private:
@@ -139,8 +158,8 @@ namespace AST {
         size_t cc;
 
     public:
-        std::vector<std::shared_ptr<Stmt>> const stmt_list;
-        CompoundStmt(std::vector<std::shared_ptr<Stmt>> const& stmt_list) : bc(0), cc(0), stmt_list(stmt_list)
+        ArenaList<Stmt> const stmt_list;
+        CompoundStmt(ArenaList<Stmt> stmt_list) : bc(0), cc(0), stmt_list(stmt_list)
         {
             for (auto p : stmt_list) {
                 bc += p->break_count();
@@ -149,7 +168,8 @@ namespace AST {
         }
         ~CompoundStmt() = default;
         void print(std::ostream&, std::string) const override;
-        void tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        void tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
         size_t break_count() const
         {
             return bc;
@@ -168,16 +188,17 @@ namespace AST {
     };
     class IfStmt : public Stmt {
     public:
-        std::shared_ptr<Expr> const cond;
-        std::shared_ptr<Stmt> const body;
-        IfStmt(size_t line, std::shared_ptr<Expr> cond, std::shared_ptr<Stmt> body)
+        Expr* const cond;
+        Stmt* const body;
+        IfStmt(size_t line, Expr* cond, Stmt* body)
             : cond(cond), body(body)
         {
             if (!SemType::check_assign(SemType::make_bool(), cond->semtype))
                 sclp_error(line, "If condition type mismatch");
         }
         virtual void print(std::ostream&, std::string) const override;
-        virtual void tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        virtual void json(Json::Writer&, SymIndex const&) const override;
+        virtual void tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
         virtual bool check_return(size_t line, SemType const* decl_ret) const override
         {
             bool b = body->check_return(line, decl_ret);
@@ -189,10 +210,11 @@ namespace AST {
     };
     class IfElseStmt : public IfStmt {
     public:
-        std::shared_ptr<Stmt> const else_body;
-        IfElseStmt(size_t line, std::shared_ptr<Expr> cond, std::shared_ptr<Stmt> body, std::shared_ptr<Stmt> else_body) : IfStmt(line, cond, body), else_body(else_body) {}
+        Stmt* const else_body;
+        IfElseStmt(size_t line, Expr* cond, Stmt* body, Stmt* else_body) : IfStmt(line, cond, body), else_body(else_body) {}
         void print(std::ostream&, std::string) const override;
-        void tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        void tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
         bool check_return(size_t line, SemType const* decl_ret) const override
         {
             bool true_part = body->check_return(line, decl_ret);
@@ -205,16 +227,17 @@ namespace AST {
     };
     class WhileStmt : public Stmt {
     public:
-        std::shared_ptr<Expr> const cond;
-        std::shared_ptr<Stmt> const body;
-        WhileStmt(size_t line, std::shared_ptr<Expr> cond, std::shared_ptr<Stmt> body)
+        Expr* const cond;
+        Stmt* const body;
+        WhileStmt(size_t line, Expr* cond, Stmt* body)
             : cond(cond), body(body)
         {
             if (!SemType::check_assign(SemType::make_bool(), cond->semtype))
                 sclp_error(line, "While condition type mismatch");
         }
         void print(std::ostream&, std::string) const override;
-        void tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        void tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
         virtual bool check_return(size_t line, SemType const* decl_ret) const override
         {
             if (body != nullptr) {
@@ -227,16 +250,17 @@ namespace AST {
     };
     class DoWhileStmt : public Stmt {
     public:
-        std::shared_ptr<Stmt> const body;
-        std::shared_ptr<Expr> const cond;
-        DoWhileStmt(size_t line, std::shared_ptr<Stmt> body, std::shared_ptr<Expr> cond)
+        Stmt* const body;
+        Expr* const cond;
+        DoWhileStmt(size_t line, Stmt* body, Expr* cond)
             : body(body), cond(cond)
         {
             if (!SemType::check_assign(SemType::make_bool(), cond->semtype))
                 sclp_error(line, "While condition type mismatch");
         }
         void print(std::ostream&, std::string) const override;
-        void tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        void tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
         virtual bool check_return(size_t line, SemType const* decl_ret) const override
         {
             // do-while body executes atleast once
@@ -245,18 +269,19 @@ namespace AST {
     };
     class ForStmt : public Stmt {
     public:
-        std::shared_ptr<AssignStmt> const pre_stmt;
-        std::shared_ptr<Expr> const cond;
-        std::shared_ptr<AssignStmt> const inc_stmt;
-        std::shared_ptr<Stmt> const body;
-        ForStmt(size_t line, std::shared_ptr<AssignStmt> pre_stmt, std::shared_ptr<Expr> cond, std::shared_ptr<AssignStmt> inc_stmt, std::shared_ptr<Stmt> body)
+        AssignStmt* const pre_stmt;
+        Expr* const cond;
+        AssignStmt* const inc_stmt;
+        Stmt* const body;
+        ForStmt(size_t line, AssignStmt* pre_stmt, Expr* cond, AssignStmt* inc_stmt, Stmt* body)
             : pre_stmt(pre_stmt), cond(cond), inc_stmt(inc_stmt), body(body)
         {
             if (cond != nullptr && !SemType::check_assign(SemType::make_bool(), cond->semtype))
                 sclp_error(line, "For condition type mismatch");
         }
         void print(std::ostream&, std::string) const override;
-        void tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        void tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
         virtual bool check_return(size_t line, SemType const* decl_ret) const override
         {
             if (body != nullptr) {
@@ -272,7 +297,8 @@ namespace AST {
         size_t const line;
         BreakStmt(size_t line) : line(line) {}
         void print(std::ostream&, std::string) const override;
-        void tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        void tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
         size_t break_count() const override
         {
             return 1;
@@ -283,7 +309,8 @@ namespace AST {
         size_t const line;
         ContinueStmt(size_t line) : line(line) {}
         void print(std::ostream&, std::string) const override;
-        void tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        void tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
         size_t continue_count() const override
         {
             return 1;
@@ -291,10 +318,11 @@ namespace AST {
     };
     class ReturnStmt : public Stmt {
     public:
-        std::shared_ptr<Expr> const ret;
-        ReturnStmt(std::shared_ptr<Expr> ret) : ret(ret) {}
+        Expr* const ret;
+        ReturnStmt(Expr* ret) : ret(ret) {}
         void print(std::ostream&, std::string) const override;
-        void tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        void tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
         bool check_return(size_t line, SemType const* decl_ret) const override
         {
             if (ret == nullptr) {
@@ -310,35 +338,45 @@ namespace AST {
     };
     class FuncDefn {
     public:
-        std::shared_ptr<Symbol> func;
-        std::vector<std::shared_ptr<Symbol>> params;
-        std::shared_ptr<CompoundStmt> body;
+        Symbol const* func;
+        std::vector<Symbol const*> params;
+        CompoundStmt* body;
 
         TAC::Context ctx;
 
-        std::vector<std::shared_ptr<TAC::Stmt>> tac;
+        // operands index into ctx.vals
+        std::vector<TAC::Instr> tac;
 
-        std::vector<std::shared_ptr<RTL::Stmt>> rtl;
+        RTL::Code rtl;
 
-        std::vector<std::shared_ptr<ASM::Stmt>> mips_asm;
+        ASM::Code mips_asm;
 
         size_t stackframe_size;
 
-        FuncDefn(size_t line, std::shared_ptr<Symbol> func, std::vector<std::shared_ptr<Symbol>> params, std::shared_ptr<CompoundStmt> body)
-            : func(func), params(params), body(body)
+        // program-wide number of the label the parser gave, if it did
+        std::optional<uint32_t> parse_label;
+
+        FuncDefn(size_t line, Symbol const* func, std::vector<Symbol const*> params, CompoundStmt* body, TAC::Context const& ctx)
+            : func(func), params(params), body(body), ctx(ctx)
         {
             SemType const* ret_type = func->semtype->get_ret_type();
             bool check_ret = body->check_return(line, ret_type);
             if (!ret_type->is_void() && !check_ret)
                 sclp_error(line, "Non-void function does not return along one or more paths");
             else if (ret_type->is_void() && check_ret)
-                ctx.return_label = TAC::Context::get_label();
+                this->ctx.return_label = this->ctx.get_label();
+        }
+        // a function taken up from an IR snapshot, with no AST and its
+        // labels numbered already
+        explicit FuncDefn(Symbol const* func)
+            : func(func), body(nullptr), stackframe_size(0)
+        {
         }
         void make_tac()
         {
             SemType const* ret_type = func->semtype->get_ret_type();
             if (!ret_type->is_void()) {
-                ctx.return_label = TAC::Context::get_label();
+                ctx.return_label = ctx.get_label();
                 ctx.return_sym = ctx.get_stemp(ret_type->to_tactype());
             }
 
@@ -347,172 +385,207 @@ namespace AST {
 
             body->tac(tac, ctx);
 
-            if (ctx.return_label != nullptr)
-                tac.push_back(ctx.return_label);
-            if (ctx.return_sym != nullptr)
-                tac.push_back(std::make_shared<TAC::ReturnStmt>(ctx.return_sym));
+            if (ctx.return_label)
+                tac.push_back(TAC::Instr::label(*ctx.return_label));
+            if (!ctx.return_sym.is_none())
+                tac.push_back(ctx.stmt(TAC::Op::RETURN, ctx.return_sym));
 
             stackframe_size = ctx.get_stackframe_size();
         }
+        // Maps the labels of every IR built so far to their program-wide
+        // numbers, the function's own starting at base. Returns how many
+        // that takes.
+        uint32_t number_labels(uint32_t base)
+        {
+            LabelMap map{ base, parse_label.has_value(), parse_label.value_or(0) };
+            TAC::renumber_labels(tac, map);
+            rtl.renumber_labels(map);
+            mips_asm.renumber_labels(map);
+            return ctx.get_nr_labels() - (parse_label ? 1 : 0);
+        }
+        // drops everything lowered from the AST, once it has been written out
+        void release_ir()
+        {
+            ctx = TAC::Context();
+            std::vector<TAC::Instr>().swap(tac);
+            rtl = RTL::Code();
+            mips_asm = ASM::Code();
+        }
         void print(std::ostream&) const;
+        // the function, its parameters and locals and its body, as an object
+        void json(Json::Writer&) const;
     };
 
     // expressions
     class TernaryExpr : public Expr {
     public:
-        std::shared_ptr<Expr> const cond, true_part, false_part;
-        TernaryExpr(size_t line, std::shared_ptr<Expr> cond, std::shared_ptr<Expr> true_part, std::shared_ptr<Expr> false_part)
+        Expr* const cond;
+        Expr* const true_part;
+        Expr* const false_part;
+        TernaryExpr(size_t line, Expr* cond, Expr* true_part, Expr* false_part)
             : Expr(SemType::result(cond->semtype, true_part->semtype, false_part->semtype)), cond(cond), true_part(true_part), false_part(false_part)
         {
             if (semtype == nullptr)
                 sclp_error(line, "Ternary type mismatch");
         }
         void print(std::ostream&, std::string) const override;
-        std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
     };
     class BinExpr : public Expr {
     public:
-        std::shared_ptr<Expr> const lhs, rhs;
-        BinExpr(SemType const* st, std::shared_ptr<Expr> lhs, std::shared_ptr<Expr> rhs) : Expr(st), lhs(lhs), rhs(rhs) {}
-        virtual ~BinExpr() = default;
+        Expr* const lhs;
+        Expr* const rhs;
+        BinExpr(SemType const* st, Expr* lhs, Expr* rhs) : Expr(st), lhs(lhs), rhs(rhs) {}
     };
     class BinOtherArithExpr : public BinExpr {
     public:
-        BinOtherArithExpr(size_t line, std::shared_ptr<Expr> lhs, std::shared_ptr<Expr> rhs)
+        BinOtherArithExpr(size_t line, Expr* lhs, Expr* rhs)
             : BinExpr(SemType::result(SemType::ExprBin::OtherArith, lhs->semtype, rhs->semtype), lhs, rhs)
         {
             if (semtype == nullptr)
                 sclp_error(line, "Arithmetic type mismatch");
         }
-        virtual ~BinOtherArithExpr() = default;
     };
     class AddExpr : public BinExpr {
     public:
-        AddExpr(size_t line, std::shared_ptr<Expr> lhs, std::shared_ptr<Expr> rhs) : BinExpr(SemType::result(SemType::ExprBin::AddSub, lhs->semtype, rhs->semtype), lhs, rhs)
+        AddExpr(size_t line, Expr* lhs, Expr* rhs) : BinExpr(SemType::result(SemType::ExprBin::AddSub, lhs->semtype, rhs->semtype), lhs, rhs)
         {
             if (semtype == nullptr)
                 sclp_error(line, "Arithmetic type mismatch");
         }
         void print(std::ostream&, std::string) const override;
-        std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
     };
     class SubExpr : public BinExpr {
     public:
-        SubExpr(size_t line, std::shared_ptr<Expr> lhs, std::shared_ptr<Expr> rhs) : BinExpr(SemType::result(SemType::ExprBin::AddSub, lhs->semtype, rhs->semtype), lhs, rhs)
+        SubExpr(size_t line, Expr* lhs, Expr* rhs) : BinExpr(SemType::result(SemType::ExprBin::AddSub, lhs->semtype, rhs->semtype), lhs, rhs)
         {
             if (semtype == nullptr)
                 sclp_error(line, "Arithmetic type mismatch");
         }
         void print(std::ostream&, std::string) const override;
-        std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
     };
     class MulExpr : public BinOtherArithExpr {
     public:
-        MulExpr(size_t line, std::shared_ptr<Expr> lhs, std::shared_ptr<Expr> rhs) : BinOtherArithExpr(line, lhs, rhs) {}
+        MulExpr(size_t line, Expr* lhs, Expr* rhs) : BinOtherArithExpr(line, lhs, rhs) {}
         void print(std::ostream&, std::string) const override;
-        std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
     };
     class DivExpr : public BinOtherArithExpr {
     public:
-        DivExpr(size_t line, std::shared_ptr<Expr> lhs, std::shared_ptr<Expr> rhs) : BinOtherArithExpr(line, lhs, rhs) {}
+        DivExpr(size_t line, Expr* lhs, Expr* rhs) : BinOtherArithExpr(line, lhs, rhs) {}
         void print(std::ostream&, std::string) const override;
-        std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
     };
     class BinCompExpr : public BinExpr {
     public:
-        BinCompExpr(size_t line, std::shared_ptr<Expr> lhs, std::shared_ptr<Expr> rhs)
+        BinCompExpr(size_t line, Expr* lhs, Expr* rhs)
             : BinExpr(SemType::result(SemType::ExprBin::Comp, lhs->semtype, rhs->semtype), lhs, rhs)
         {
             if (semtype == nullptr)
                 sclp_error(line, "Comparison type mismatch");
         }
-        virtual ~BinCompExpr() = default;
     };
     class EqualExpr : public BinCompExpr {
     public:
-        EqualExpr(size_t line, std::shared_ptr<Expr> lhs, std::shared_ptr<Expr> rhs) : BinCompExpr(line, lhs, rhs) {}
+        EqualExpr(size_t line, Expr* lhs, Expr* rhs) : BinCompExpr(line, lhs, rhs) {}
         void print(std::ostream&, std::string) const override;
-        std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
     };
     class NotEqualExpr : public BinCompExpr {
     public:
-        NotEqualExpr(size_t line, std::shared_ptr<Expr> lhs, std::shared_ptr<Expr> rhs) : BinCompExpr(line, lhs, rhs) {}
+        NotEqualExpr(size_t line, Expr* lhs, Expr* rhs) : BinCompExpr(line, lhs, rhs) {}
         void print(std::ostream&, std::string) const override;
-        std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
     };
     class LessExpr : public BinCompExpr {
     public:
-        LessExpr(size_t line, std::shared_ptr<Expr> lhs, std::shared_ptr<Expr> rhs) : BinCompExpr(line, lhs, rhs) {}
+        LessExpr(size_t line, Expr* lhs, Expr* rhs) : BinCompExpr(line, lhs, rhs) {}
         void print(std::ostream&, std::string) const override;
-        std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
     };
     class GreaterExpr : public BinCompExpr {
     public:
-        GreaterExpr(size_t line, std::shared_ptr<Expr> lhs, std::shared_ptr<Expr> rhs) : BinCompExpr(line, lhs, rhs) {}
+        GreaterExpr(size_t line, Expr* lhs, Expr* rhs) : BinCompExpr(line, lhs, rhs) {}
         void print(std::ostream&, std::string) const override;
-        std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
     };
     class LessEqualExpr : public BinCompExpr {
     public:
-        LessEqualExpr(size_t line, std::shared_ptr<Expr> lhs, std::shared_ptr<Expr> rhs) : BinCompExpr(line, lhs, rhs) {}
+        LessEqualExpr(size_t line, Expr* lhs, Expr* rhs) : BinCompExpr(line, lhs, rhs) {}
         void print(std::ostream&, std::string) const override;
-        std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
     };
     class GreaterEqualExpr : public BinCompExpr {
     public:
-        GreaterEqualExpr(size_t line, std::shared_ptr<Expr> lhs, std::shared_ptr<Expr> rhs) : BinCompExpr(line, lhs, rhs) {}
+        GreaterEqualExpr(size_t line, Expr* lhs, Expr* rhs) : BinCompExpr(line, lhs, rhs) {}
         void print(std::ostream&, std::string) const override;
-        std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
     };
     class BinLogicExpr : public BinExpr {
     public:
-        BinLogicExpr(size_t line, std::shared_ptr<Expr> lhs, std::shared_ptr<Expr> rhs)
+        BinLogicExpr(size_t line, Expr* lhs, Expr* rhs)
             : BinExpr(SemType::result(SemType::ExprBin::Logic, lhs->semtype, rhs->semtype), lhs, rhs)
         {
             if (semtype == nullptr)
                 sclp_error(line, "Logic type mismatch");
         }
-        virtual ~BinLogicExpr() = default;
     };
     class AndExpr : public BinLogicExpr {
     public:
-        AndExpr(size_t line, std::shared_ptr<Expr> lhs, std::shared_ptr<Expr> rhs) : BinLogicExpr(line, lhs, rhs) {}
+        AndExpr(size_t line, Expr* lhs, Expr* rhs) : BinLogicExpr(line, lhs, rhs) {}
         void print(std::ostream&, std::string) const override;
-        std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
     };
     class OrExpr : public BinLogicExpr {
     public:
-        OrExpr(size_t line, std::shared_ptr<Expr> lhs, std::shared_ptr<Expr> rhs) : BinLogicExpr(line, lhs, rhs) {}
+        OrExpr(size_t line, Expr* lhs, Expr* rhs) : BinLogicExpr(line, lhs, rhs) {}
         void print(std::ostream&, std::string) const override;
-        std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
     };
 
     class UnExpr : public Expr {
     public:
-        std::shared_ptr<Expr> const lhs;
-        UnExpr(SemType const* st, std::shared_ptr<Expr> lhs) : Expr(st), lhs(lhs) {}
+        Expr* const lhs;
+        UnExpr(SemType const* st, Expr* lhs) : Expr(st), lhs(lhs) {}
     };
     class NegExpr : public UnExpr {
     public:
-        NegExpr(size_t line, std::shared_ptr<Expr> lhs)
+        NegExpr(size_t line, Expr* lhs)
             : UnExpr(SemType::result(SemType::ExprUn::Neg, lhs->semtype), lhs)
         {
             if (semtype == nullptr)
                 sclp_error(line, "Arithmetic type mismatch");
         }
         void print(std::ostream&, std::string) const override;
-        std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
     };
     class NotExpr : public UnExpr {
     public:
-        NotExpr(size_t line, std::shared_ptr<Expr> lhs)
+        NotExpr(size_t line, Expr* lhs)
             : UnExpr(SemType::result(SemType::ExprUn::Not, lhs->semtype), lhs)
         {
             if (semtype == nullptr)
                 sclp_error(line, "Logic type mismatch");
         }
         void print(std::ostream&, std::string) const override;
-        std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
     };
 
     class ArrayExpr : public LValExpr {
@@ -520,8 +593,9 @@ namespace AST {
         LValExpr* base_lval;
 
     public:
-        std::shared_ptr<Expr> const base, index;
-        ArrayExpr(size_t line, std::shared_ptr<Expr> base, std::shared_ptr<Expr> index) : LValExpr(SemType::result(SemType::ExprBin::Array, base->semtype, index->semtype)), is_c(true), base_lval(nullptr), base(base), index(index)
+        Expr* const base;
+        Expr* const index;
+        ArrayExpr(size_t line, Expr* base, Expr* index) : LValExpr(SemType::result(SemType::ExprBin::Array, base->semtype, index->semtype)), is_c(true), base_lval(nullptr), base(base), index(index)
         {
             if (semtype == nullptr)
                 sclp_error(line, "Array type mismatch");
@@ -530,14 +604,15 @@ namespace AST {
             else {
                 //  [in this case base must be an LValExpr (infact of semtype ARRAY)]
                 assert(base->semtype->is_array());
-                base_lval = dynamic_cast<LValExpr*>(base.get());
+                base_lval = dynamic_cast<LValExpr*>(base);
                 assert(base_lval != nullptr);
                 is_c = base_lval->is_const();
             }
         }
         void print(std::ostream&, std::string) const override;
-        std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
-        std::shared_ptr<TAC::Val> addr_tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
+        TAC::Val addr_tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
         bool is_const() const override
         {
             return is_c;
@@ -547,8 +622,8 @@ namespace AST {
         bool is_c;
 
     public:
-        std::shared_ptr<Expr> const lhs;
-        DerefExpr(size_t line, std::shared_ptr<Expr> lhs)
+        Expr* const lhs;
+        DerefExpr(size_t line, Expr* lhs)
             : LValExpr(SemType::result(SemType::ExprUn::Deref, lhs->semtype)), lhs(lhs)
         {
             if (semtype == nullptr)
@@ -556,8 +631,9 @@ namespace AST {
             is_c = lhs->semtype->get_points_to_const();
         }
         void print(std::ostream&, std::string) const override;
-        std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
-        std::shared_ptr<TAC::Val> addr_tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
+        TAC::Val addr_tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
         bool is_const() const override
         {
             return is_c;
@@ -565,16 +641,17 @@ namespace AST {
     };
     class AddrExpr : public Expr {
     public:
-        std::shared_ptr<LValExpr> lhs;
-        AddrExpr(std::shared_ptr<LValExpr> lhs) : Expr(SemType::make_ptr(lhs->semtype, lhs->is_const())), lhs(lhs) {}
+        LValExpr* lhs;
+        AddrExpr(LValExpr* lhs) : Expr(SemType::make_ptr(lhs->semtype, lhs->is_const())), lhs(lhs) {}
         void print(std::ostream&, std::string) const override;
-        std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
     };
 
     // functions
     class CallExpr : public Expr {
     private:
-        static std::vector<SemType const*> get_param_types(std::vector<std::shared_ptr<Expr>> const& params)
+        static std::vector<SemType const*> get_param_types(ArenaList<Expr> params)
         {
             std::vector<SemType const*> param_types;
             for (auto const& p : params)
@@ -583,49 +660,159 @@ namespace AST {
         }
 
     public:
-        std::vector<std::shared_ptr<Expr>> params;
-        CallExpr(size_t line, SemType const* func_semtype, std::vector<std::shared_ptr<Expr>> const& params)
+        ArenaList<Expr> const params;
+        CallExpr(size_t line, SemType const* func_semtype, ArenaList<Expr> params)
             : Expr(SemType::result(func_semtype, get_param_types(params))), params(params)
         {
             if (semtype == nullptr)
                 sclp_error(line, "Function type mismatch");
         }
-        virtual ~CallExpr() = default;
     };
     class FuncCallExpr : public CallExpr {
     public:
-        std::shared_ptr<Symbol> const func;
-        FuncCallExpr(size_t line, std::shared_ptr<Symbol> func, std::vector<std::shared_ptr<Expr>> const& params)
+        Symbol const* const func;
+        FuncCallExpr(size_t line, Symbol const* func, ArenaList<Expr> params)
             : CallExpr(line, func->semtype, params), func(func)
         {
         }
         void print(std::ostream&, std::string) const override;
-        std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
     };
     class FuncPtrCallExpr : public CallExpr {
     public:
-        std::shared_ptr<Expr> const func_ptr;
-        FuncPtrCallExpr(size_t line, std::shared_ptr<AST::DerefExpr> func, std::vector<std::shared_ptr<AST::Expr>> const& params)
+        Expr* const func_ptr;
+        FuncPtrCallExpr(size_t line, AST::DerefExpr* func, ArenaList<Expr> params)
             : CallExpr(line, func->semtype, params), func_ptr(func->lhs)
         {
         }
         void print(std::ostream&, std::string) const override;
-        std::shared_ptr<TAC::Val> tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        TAC::Val tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
     };
     class CallStmt : public Stmt {
     public:
-        std::shared_ptr<CallExpr> const fc;
+        CallExpr* const fc;
 
-        CallStmt(size_t line, std::shared_ptr<CallExpr> fc) : fc(fc)
+        CallStmt(size_t line, CallExpr* fc) : fc(fc)
         {
             if (!fc->semtype->is_void())
                 sclp_error(line, "Function return value ignored");
         }
         void print(std::ostream&, std::string) const override;
-        void tac(std::vector<std::shared_ptr<TAC::Stmt>>&, TAC::Context&) const override;
+        void json(Json::Writer&, SymIndex const&) const override;
+        void tac(std::vector<TAC::Instr>&, TAC::Context&) const override;
+    };
+
+    static_assert(std::is_trivially_destructible_v<Sym> && std::is_trivially_destructible_v<FuncCallExpr> && std::is_trivially_destructible_v<CompoundStmt>);
+
+    // declaration as seen by the parser, after its declarator is applied
+    struct Decl {
+        Symbol sym;
+        // parameters of the innermost function declarator, if any
+        std::vector<Decl> const* params;
+        size_t line;
+    };
+
+    // declarator under construction in the parser; ops are the type
+    // modifiers to apply to the primitive type, the last one first
+    struct Declarator {
+        struct Op {
+            enum class Kind {
+                PTR, ARRAY, FUNC
+            } kind;
+            bool points_to_const;
+            size_t size;
+            std::vector<Decl> const* params;
+            size_t line;
+        };
+        Ident name;
+        bool is_const;
+        size_t line;
+        std::vector<Op> ops;
+
+        Declarator(Ident name, bool is_const, size_t line)
+            : name(name), is_const(is_const), line(line)
+        {
+        }
+        // each of these is applied to the primitive type before what is already held
+        void add_ptrs(std::vector<bool> const& points_to_const);
+        void add_dims(std::vector<size_t> const& dims, size_t line);
+        void add_func(std::vector<Decl> const* params, size_t line);
+
+        Symbol apply(SemType const* prim_type, std::vector<Decl> const** func_params = nullptr) const;
+    };
+
+    // state of the parser actions while they build the AST of a translation unit
+    class Builder {
+    private:
+        SymbolTable& symtab;
+        Arena& arena;
+
+        // for the FuncDef currently being processed
+        TAC::Context tacctx;
+        uint32_t nr_parse_labels = 0;
+        Symbol const* func_sym;
+        std::vector<Symbol const*> func_params;
+
+        void add_func(size_t line, CompoundStmt* body);
+
+    public:
+        // a deque, so that a function can be lowered while later ones are
+        // being added
+        std::deque<FuncDefn> funcs;
+        // if set, called with each function once it is complete
+        std::function<void(FuncDefn&)> on_func;
+
+        // labels of other functions are numbered after these
+        uint32_t get_nr_parse_labels() const
+        {
+            return nr_parse_labels;
+        }
+
+        Builder(SymbolTable& symtab, Arena& arena)
+            : symtab(symtab), arena(arena)
+        {
+        }
+
+        template <typename T, typename... Args>
+        T* make(Args&&... args)
+        {
+            return arena.make<T>(std::forward<Args>(args)...);
+        }
+        template <typename T>
+        ArenaList<T> make_list(std::vector<T*> const& v)
+        {
+            return arena.make_list(v);
+        }
+
+        void begin_scope();
+        void end_scope();
+
+        // the parser makes its Declarators, Decls and lists with make(), so
+        // they are freed with the arena even when an error is thrown
+        void multi_decl(SemType const* prim_type, std::vector<Declarator*> const& decls);
+        Decl* single_decl(size_t line, SemType const* prim_type, Declarator* d);
+        std::vector<Decl>* param_list(std::vector<Decl>* params);
+        void begin_func(Decl* d);
+        void end_func(size_t line, std::vector<Stmt*> const& body);
+        // a function read from a JSON dump, its symbols made already; the
+        // locals are given frame slots in the order they come in
+        void begin_func(Symbol const* func, std::vector<Symbol const*> const& params, std::vector<Symbol const*> const& locals);
+        void end_func(CompoundStmt* body);
+
+        Sym* make_sym(Ident name, size_t line);
+        CallExpr* make_call(size_t line, Ident name, size_t name_line, std::vector<Expr*> const& args);
+        CallExpr* make_call(size_t line, LValExpr* func, std::vector<Expr*> const& args);
+        AssignStmt* make_assign(size_t line, LValExpr* lhs, Expr* rhs);
+        ReadStmt* make_read(size_t line, LValExpr* arg);
+        ReturnStmt* make_return(size_t line, Expr* ret);
     };
 
-    std::vector<FuncDefn> from_parse_tree(ParseNode* parse_tree, SymbolTable&);
+    // Reads one function of a JSON dump of the AST into b. The globals and
+    // functions it names are looked up in globals; functions not met before
+    // are added.
+    void read_json_func(Json::Reader& r, Builder& b, std::unordered_map<Ident, Symbol const*>& globals);
 }
 
 #endif // AST_H
@@ -0,0 +1,619 @@
+#include <ast.h>
+#include <json.h>
+#include <string>
+
+using namespace AST;
+
+// Every node is an object whose "node" names its kind; expressions carry
+// their type. Parameters and locals are referred to by their index in the
+// function's "params" followed by its "locals", anything else by name.
+
+static void var_json(Json::Writer& w, Symbol const& s)
+{
+    w.begin_object();
+    w.member("name", s.name.str());
+    w.key("type");
+    s.semtype->json(w);
+    w.member("const", s.is_const);
+    w.end_object();
+}
+
+void FuncDefn::json(Json::Writer& w) const
+{
+    SymIndex index;
+    w.begin_object();
+    w.member("name", func->name.str());
+    w.key("type");
+    func->semtype->json(w);
+    w.key("params");
+    w.begin_array();
+    for (auto const& p : params) {
+        index.emplace(p, index.size());
+        var_json(w, *p);
+    }
+    w.end_array();
+    w.key("locals");
+    w.begin_array();
+    for (auto const& s : ctx.get_symbols())
+        if (!s->is_global && index.emplace(s, index.size()).second)
+            var_json(w, *s);
+    w.end_array();
+    w.key("body");
+    body->json(w, index);
+    w.end_object();
+}
+
+static void begin_node(Json::Writer& w, char const* kind)
+{
+    w.begin_object();
+    w.member("node", kind);
+}
+static void begin_expr(Json::Writer& w, char const* kind, SemType const* semtype)
+{
+    begin_node(w, kind);
+    w.key("type");
+    semtype->json(w);
+}
+static void child(Json::Writer& w, SymIndex const& index, char const* k, Base const* n)
+{
+    if (n != nullptr) {
+        w.key(k);
+        n->json(w, index);
+    }
+}
+
+static void bin_json(Json::Writer& w, SymIndex const& index, char const* kind, BinExpr const& e)
+{
+    begin_expr(w, kind, e.semtype);
+    child(w, index, "lhs", e.lhs);
+    child(w, index, "rhs", e.rhs);
+    w.end_object();
+}
+static void un_json(Json::Writer& w, SymIndex const& index, char const* kind, SemType const* semtype, Expr const* arg)
+{
+    begin_expr(w, kind, semtype);
+    child(w, index, "arg", arg);
+    w.end_object();
+}
+static void args_json(Json::Writer& w, SymIndex const& index, ArenaList<Expr> const& params)
+{
+    w.key("args");
+    w.begin_array();
+    for (auto p : params)
+        p->json(w, index);
+    w.end_array();
+}
+
+static void sym_json(Json::Writer& w, SymIndex const& index, Symbol const& s)
+{
+    begin_expr(w, "name", s.semtype);
+    w.member("name", s.name.str());
+    auto it = index.find(&s);
+    if (it != index.end())
+        w.member("var", (uint64_t)it->second);
+    w.end_object();
+}
+
+void Sym::json(Json::Writer& w, SymIndex const& index) const
+{
+    sym_json(w, index, *sym);
+}
+void IntLit::json(Json::Writer& w, SymIndex const&) const
+{
+    begin_expr(w, "int", semtype);
+    w.member("value", (uint64_t)val);
+    w.end_object();
+}
+void FloatLit::json(Json::Writer& w, SymIndex const&) const
+{
+    begin_expr(w, "float", semtype);
+    w.member("value", val);
+    w.end_object();
+}
+void StrLit::json(Json::Writer& w, SymIndex const&) const
+{
+    begin_expr(w, "string", semtype);
+    w.member("value", val);
+    w.end_object();
+}
+
+void AssignStmt::json(Json::Writer& w, SymIndex const& index) const
+{
+    begin_node(w, "assign");
+    child(w, index, "lhs", lhs);
+    child(w, index, "rhs", rhs);
+    w.end_object();
+}
+void PrintStmt::json(Json::Writer& w, SymIndex const& index) const
+{
+    begin_node(w, "print");
+    child(w, index, "arg", arg);
+    w.end_object();
+}
+void ReadStmt::json(Json::Writer& w, SymIndex const& index) const
+{
+    begin_node(w, "read");
+    child(w, index, "arg", arg);
+    w.end_object();
+}
+void CompoundStmt::json(Json::Writer& w, SymIndex const& index) const
+{
+    begin_node(w, "block");
+    w.key("stmts");
+    w.begin_array();
+    for (auto s : stmt_list)
+        s->json(w, index);
+    w.end_array();
+    w.end_object();
+}
+void IfStmt::json(Json::Writer& w, SymIndex const& index) const
+{
+    begin_node(w, "if");
+    child(w, index, "cond", cond);
+    child(w, index, "then", body);
+    w.end_object();
+}
+void IfElseStmt::json(Json::Writer& w, SymIndex const& index) const
+{
+    begin_node(w, "if");
+    child(w, index, "cond", cond);
+    child(w, index, "then", body);
+    child(w, index, "else", else_body);
+    w.end_object();
+}
+void WhileStmt::json(Json::Writer& w, SymIndex const& index) const
+{
+    begin_node(w, "while");
+    child(w, index, "cond", cond);
+    child(w, index, "body", body);
+    w.end_object();
+}
+void DoWhileStmt::json(Json::Writer& w, SymIndex const& index) const
+{
+    begin_node(w, "do_while");
+    child(w, index, "body", body);
+    child(w, index, "cond", cond);
+    w.end_object();
+}
+void ForStmt::json(Json::Writer& w, SymIndex const& index) const
+{
+    begin_node(w, "for");
+    child(w, index, "pre", pre_stmt);
+    child(w, index, "cond", cond);
+    child(w, index, "inc", inc_stmt);
+    child(w, index, "body", body);
+    w.end_object();
+}
+void BreakStmt::json(Json::Writer& w, SymIndex const&) const
+{
+    begin_node(w, "break");
+    w.member("line", (uint64_t)line);
+    w.end_object();
+}
+void ContinueStmt::json(Json::Writer& w, SymIndex const&) const
+{
+    begin_node(w, "continue");
+    w.member("line", (uint64_t)line);
+    w.end_object();
+}
+void CallStmt::json(Json::Writer& w, SymIndex const& index) const
+{
+    begin_node(w, "call_stmt");
+    child(w, index, "call", fc);
+    w.end_object();
+}
+void ReturnStmt::json(Json::Writer& w, SymIndex const& index) const
+{
+    begin_node(w, "return");
+    child(w, index, "ret", ret);
+    w.end_object();
+}
+
+void TernaryExpr::json(Json::Writer& w, SymIndex const& index) const
+{
+    begin_expr(w, "ternary", semtype);
+    child(w, index, "cond", cond);
+    child(w, index, "true", true_part);
+    child(w, index, "false", false_part);
+    w.end_object();
+}
+void AddExpr::json(Json::Writer& w, SymIndex const& index) const
+{
+    bin_json(w, index, "add", *this);
+}
+void SubExpr::json(Json::Writer& w, SymIndex const& index) const
+{
+    bin_json(w, index, "sub", *this);
+}
+void MulExpr::json(Json::Writer& w, SymIndex const& index) const
+{
+    bin_json(w, index, "mul", *this);
+}
+void DivExpr::json(Json::Writer& w, SymIndex const& index) const
+{
+    bin_json(w, index, "div", *this);
+}
+void EqualExpr::json(Json::Writer& w, SymIndex const& index) const
+{
+    bin_json(w, index, "eq", *this);
+}
+void NotEqualExpr::json(Json::Writer& w, SymIndex const& index) const
+{
+    bin_json(w, index, "ne", *this);
+}
+void LessExpr::json(Json::Writer& w, SymIndex const& index) const
+{
+    bin_json(w, index, "lt", *this);
+}
+void GreaterExpr::json(Json::Writer& w, SymIndex const& index) const
+{
+    bin_json(w, index, "gt", *this);
+}
+void LessEqualExpr::json(Json::Writer& w, SymIndex const& index) const
+{
+    bin_json(w, index, "le", *this);
+}
+void GreaterEqualExpr::json(Json::Writer& w, SymIndex const& index) const
+{
+    bin_json(w, index, "ge", *this);
+}
+void AndExpr::json(Json::Writer& w, SymIndex const& index) const
+{
+    bin_json(w, index, "and", *this);
+}
+void OrExpr::json(Json::Writer& w, SymIndex const& index) const
+{
+    bin_json(w, index, "or", *this);
+}
+void NegExpr::json(Json::Writer& w, SymIndex const& index) const
+{
+    un_json(w, index, "neg", semtype, lhs);
+}
+void NotExpr::json(Json::Writer& w, SymIndex const& index) const
+{
+    un_json(w, index, "not", semtype, lhs);
+}
+void DerefExpr::json(Json::Writer& w, SymIndex const& index) const
+{
+    un_json(w, index, "deref", semtype, lhs);
+}
+void AddrExpr::json(Json::Writer& w, SymIndex const& index) const
+{
+    un_json(w, index, "addr", semtype, lhs);
+}
+void ArrayExpr::json(Json::Writer& w, SymIndex const& index) const
+{
+    begin_expr(w, "array", semtype);
+    child(w, index, "base", base);
+    child(w, index, "index", this->index);
+    w.end_object();
+}
+void FuncCallExpr::json(Json::Writer& w, SymIndex const& index) const
+{
+    begin_expr(w, "call", semtype);
+    w.key("func");
+    sym_json(w, index, *func);
+    args_json(w, index, params);
+    w.end_object();
+}
+void FuncPtrCallExpr::json(Json::Writer& w, SymIndex const& index) const
+{
+    begin_expr(w, "call", semtype);
+    w.key("func_ptr");
+    func_ptr->json(w, index);
+    args_json(w, index, params);
+    w.end_object();
+}
+
+namespace {
+    // One node as read, its parts kept until the object ends, as they may
+    // come in any order
+    struct Node {
+        std::string kind;
+        std::string name;
+        std::string number;
+        std::string str;
+        bool has_var = false;
+        size_t var = 0;
+        size_t line = 0;
+        SemType const* type = nullptr;
+
+        enum { LHS, RHS, COND, ARG, BASE, INDEX, RET, TRUE, FALSE, FUNC, FUNC_PTR, CALL, NR_EXPRS };
+        Expr* exprs[NR_EXPRS] = {};
+        enum { THEN, ELSE, BODY, PRE, INC, NR_STMTS };
+        Stmt* stmts[NR_STMTS] = {};
+        std::vector<Expr*> args;
+        std::vector<Stmt*> list;
+    };
+    char const* const expr_keys[Node::NR_EXPRS] = { "lhs", "rhs", "cond", "arg", "base", "index", "ret", "true", "false", "func", "func_ptr", "call" };
+    char const* const stmt_keys[Node::NR_STMTS] = { "then", "else", "body", "pre", "inc" };
+
+    // Builds the nodes of one function's body through the Builder, as the
+    // parser would, so that they are checked as the parser's are
+    class NodeReader {
+        Json::Reader& r;
+        Builder& b;
+        std::vector<Symbol const*> const& vars;
+        std::unordered_map<Ident, Symbol const*>& globals;
+
+        Node read()
+        {
+            Node n;
+            std::string k;
+            r.begin_object();
+            while (r.next_key(k)) {
+                size_t i;
+                for (i = 0; i < Node::NR_EXPRS && k != expr_keys[i]; ++i);
+                if (i < Node::NR_EXPRS) {
+                    n.exprs[i] = expr();
+                    continue;
+                }
+                for (i = 0; i < Node::NR_STMTS && k != stmt_keys[i]; ++i);
+                if (i < Node::NR_STMTS) {
+                    n.stmts[i] = (r.get_null() ? nullptr : stmt());
+                    continue;
+                }
+                if (k == "node")
+                    n.kind = r.get_string();
+                else if (k == "name")
+                    n.name = r.get_string();
+                else if (k == "type")
+                    n.type = SemType::from_json(r);
+                else if (k == "var") {
+                    n.has_var = true;
+                    n.var = r.get_uint();
+                } else if (k == "line")
+                    n.line = r.get_uint();
+                else if (k == "value") {
+                    if (r.next_type() == Json::Reader::Type::STRING)
+                        n.str = r.get_string();
+                    else
+                        n.number = r.get_number();
+                } else if (k == "args") {
+                    r.begin_array();
+                    while (r.next_elem())
+                        n.args.push_back(expr());
+                } else if (k == "stmts") {
+                    r.begin_array();
+                    while (r.next_elem())
+                        n.list.push_back(stmt());
+                } else
+                    r.skip();
+            }
+            return n;
+        }
+
+        template <typename T>
+        T* need(T* p, char const* what)
+        {
+            if (p == nullptr)
+                r.fail(std::string("node lacks its ") + what);
+            return p;
+        }
+        Expr* need(Node const& n, size_t i)
+        {
+            return need(n.exprs[i], expr_keys[i]);
+        }
+        LValExpr* need_lval(Node const& n, size_t i)
+        {
+            return need(dynamic_cast<LValExpr*>(need(n, i)), "lvalue");
+        }
+        AssignStmt* assign(Node const& n, size_t i)
+        {
+            if (n.stmts[i] == nullptr)
+                return nullptr;
+            return need(dynamic_cast<AssignStmt*>(n.stmts[i]), "assignment");
+        }
+
+        Symbol const* symbol(Node const& n)
+        {
+            if (n.has_var) {
+                if (n.var >= vars.size())
+                    r.fail("no variable " + std::to_string(n.var));
+                return vars[n.var];
+            }
+            Ident name(n.name);
+            auto it = globals.find(name);
+            if (it != globals.end())
+                return it->second;
+            // a function declared but not defined
+            if (n.type == nullptr || !n.type->is_func())
+                r.fail("Symbol " + n.name + " not declared");
+            Symbol* s = b.make<Symbol>(name, n.type);
+            s->is_global = true;
+            return globals[name] = s;
+        }
+
+        Expr* make_expr(Node& n)
+        {
+            static char const* const bin[] = { "add", "sub", "mul", "div", "eq", "ne", "lt", "gt", "le", "ge", "and", "or" };
+            size_t line = n.line;
+            if (n.kind == "name")
+                return b.make<Sym>(symbol(n));
+            if (n.kind == "int") {
+                char* end;
+                size_t v = strtoull(n.number.c_str(), &end, 10);
+                if (n.number.empty() || *end != '\0')
+                    r.fail("bad int literal");
+                return b.make<IntLit>(v);
+            }
+            if (n.kind == "float") {
+                char* end;
+                double v = strtod(n.number.c_str(), &end);
+                if (n.number.empty() || *end != '\0')
+                    r.fail("bad float literal");
+                return b.make<FloatLit>(v);
+            }
+            if (n.kind == "string")
+                return b.make<StrLit>(n.str);
+            if (n.kind == "ternary")
+                return b.make<TernaryExpr>(line, need(n, Node::COND), need(n, Node::TRUE), need(n, Node::FALSE));
+            for (size_t i = 0; i < sizeof(bin) / sizeof(bin[0]); ++i) {
+                if (n.kind != bin[i])
+                    continue;
+                Expr* lhs = need(n, Node::LHS);
+                Expr* rhs = need(n, Node::RHS);
+                switch (i) {
+                case 0:
+                    return b.make<AddExpr>(line, lhs, rhs);
+                case 1:
+                    return b.make<SubExpr>(line, lhs, rhs);
+                case 2:
+                    return b.make<MulExpr>(line, lhs, rhs);
+                case 3:
+                    return b.make<DivExpr>(line, lhs, rhs);
+                case 4:
+                    return b.make<EqualExpr>(line, lhs, rhs);
+                case 5:
+                    return b.make<NotEqualExpr>(line, lhs, rhs);
+                case 6:
+                    return b.make<LessExpr>(line, lhs, rhs);
+                case 7:
+                    return b.make<GreaterExpr>(line, lhs, rhs);
+                case 8:
+                    return b.make<LessEqualExpr>(line, lhs, rhs);
+                case 9:
+                    return b.make<GreaterEqualExpr>(line, lhs, rhs);
+                case 10:
+                    return b.make<AndExpr>(line, lhs, rhs);
+                default:
+                    return b.make<OrExpr>(line, lhs, rhs);
+                }
+            }
+            if (n.kind == "neg")
+                return b.make<NegExpr>(line, need(n, Node::ARG));
+            if (n.kind == "not")
+                return b.make<NotExpr>(line, need(n, Node::ARG));
+            if (n.kind == "deref")
+                return b.make<DerefExpr>(line, need(n, Node::ARG));
+            if (n.kind == "addr")
+                return b.make<AddrExpr>(need_lval(n, Node::ARG));
+            if (n.kind == "array")
+                return b.make<ArrayExpr>(line, need(n, Node::BASE), need(n, Node::INDEX));
+            if (n.kind == "call") {
+                LValExpr* func;
+                if (n.exprs[Node::FUNC_PTR] != nullptr)
+                    func = b.make<DerefExpr>(line, n.exprs[Node::FUNC_PTR]);
+                else
+                    func = need_lval(n, Node::FUNC);
+                return b.make_call(line, func, n.args);
+            }
+            r.fail("unknown expression '" + n.kind + "'");
+        }
+
+        Stmt* make_stmt(Node& n)
+        {
+            size_t line = n.line;
+            if (n.kind == "assign")
+                return b.make_assign(line, need_lval(n, Node::LHS), need(n, Node::RHS));
+            if (n.kind == "print")
+                return b.make<PrintStmt>(line, need(n, Node::ARG));
+            if (n.kind == "read")
+                return b.make_read(line, need_lval(n, Node::ARG));
+            if (n.kind == "block")
+                return b.make<CompoundStmt>(b.make_list(n.list));
+            if (n.kind == "if" && n.stmts[Node::ELSE] != nullptr)
+                return b.make<IfElseStmt>(line, need(n, Node::COND), need(n.stmts[Node::THEN], "then"), n.stmts[Node::ELSE]);
+            if (n.kind == "if")
+                return b.make<IfStmt>(line, need(n, Node::COND), need(n.stmts[Node::THEN], "then"));
+            if (n.kind == "while")
+                return b.make<WhileStmt>(line, need(n, Node::COND), n.stmts[Node::BODY]);
+            if (n.kind == "do_while")
+                return b.make<DoWhileStmt>(line, need(n.stmts[Node::BODY], "body"), need(n, Node::COND));
+            if (n.kind == "for")
+                return b.make<ForStmt>(line, assign(n, Node::PRE), n.exprs[Node::COND], assign(n, Node::INC), n.stmts[Node::BODY]);
+            if (n.kind == "break")
+                return b.make<BreakStmt>(line);
+            if (n.kind == "continue")
+                return b.make<ContinueStmt>(line);
+            if (n.kind == "call_stmt")
+                return b.make<CallStmt>(line, need(dynamic_cast<CallExpr*>(need(n, Node::CALL)), "call"));
+            if (n.kind == "return")
+                return b.make_return(line, n.exprs[Node::RET]);
+            r.fail("unknown statement '" + n.kind + "'");
+        }
+
+    public:
+        NodeReader(Json::Reader& r, Builder& b, std::vector<Symbol const*> const& vars, std::unordered_map<Ident, Symbol const*>& globals)
+            : r(r), b(b), vars(vars), globals(globals)
+        {
+        }
+
+        Expr* expr()
+        {
+            Node n = read();
+            return make_expr(n);
+        }
+        Stmt* stmt()
+        {
+            Node n = read();
+            return make_stmt(n);
+        }
+    };
+
+    Symbol const* read_var(Json::Reader& r, Builder& b)
+    {
+        std::string name, k;
+        SemType const* type = nullptr;
+        bool is_const = false;
+        r.begin_object();
+        while (r.next_key(k)) {
+            if (k == "name")
+                name = r.get_string();
+            else if (k == "type")
+                type = SemType::from_json(r);
+            else if (k == "const")
+                is_const = r.get_bool();
+            else
+                r.skip();
+        }
+        if (type == nullptr || type->is_void() || type->is_func())
+            r.fail("bad variable " + name);
+        Symbol* s = b.make<Symbol>(Ident(name), type, is_const);
+        s->is_global = false;
+        return s;
+    }
+}
+
+// The parameters and locals have to come before the body, which refers to
+// them
+void AST::read_json_func(Json::Reader& r, Builder& b, std::unordered_map<Ident, Symbol const*>& globals)
+{
+    std::string name, k;
+    SemType const* type = nullptr;
+    std::vector<Symbol const*> params, locals, vars;
+    CompoundStmt* body = nullptr;
+    r.begin_object();
+    while (r.next_key(k)) {
+        if (k == "name")
+            name = r.get_string();
+        else if (k == "type")
+            type = SemType::from_json(r);
+        else if (k == "params" || k == "locals") {
+            auto& v = (k == "params" ? params : locals);
+            r.begin_array();
+            while (r.next_elem())
+                v.push_back(read_var(r, b));
+        } else if (k == "body") {
+            if (type == nullptr || !type->is_func())
+                r.fail("function " + name + " lacks its type before its body");
+            auto& f = globals[Ident(name)];
+            if (f == nullptr) {
+                Symbol* s = b.make<Symbol>(Ident(name), type);
+                s->is_global = true;
+                f = s;
+            } else if (f->semtype != type)
+                r.fail("Function signature does not match previous declaration");
+            b.begin_func(f, params, locals);
+            vars = params;
+            vars.insert(vars.end(), locals.begin(), locals.end());
+            body = dynamic_cast<CompoundStmt*>(NodeReader(r, b, vars, globals).stmt());
+            if (body == nullptr)
+                r.fail("function " + name + " has no block for its body");
+        } else
+            r.skip();
+    }
+    if (body == nullptr)
+        r.fail("function " + name + " has no body");
+    b.end_func(body);
+}
@@ -12,7 +12,7 @@ void FuncDefn::print(std::ostream& o) const
     func->semtype->get_ret_type()->print(o);
     o << ">\n";
     o << "	Formal Parameters:\n";
-    for (std::shared_ptr<Symbol> param : params) {
+    for (Symbol const* param : params) {
         o << "		" << param->name << "  Type:<";
         param->semtype->print(o);
         o << ">\n";
@@ -1,13 +1,12 @@
 #include <ast.h>
 #include <tac.h>
 
-using TACVal =  std::shared_ptr<TAC::Val>;
-using TACSym =  std::shared_ptr<TAC::Sym>;
-using TACExpr = std::shared_ptr<TAC::Expr>;
+using TACVal = TAC::Val;
+using TACOp = TAC::Op;
+using TACInstr = TAC::Instr;
 
-using TACLabel = std::shared_ptr<TAC::Label>;
-using TACStmt = std::shared_ptr<TAC::Stmt>;
-using TACStmtList = std::vector<std::shared_ptr<TAC::Stmt>>;
+using TACLabel = std::optional<LabelId>;
+using TACStmtList = std::vector<TAC::Instr>;
 
 using TACType = TAC::Type;
 
@@ -20,50 +19,49 @@ TACVal AST::Sym::addr_tac(TACStmtList& stmts, TAC::Context& ctx) const
 //     if (sym->semtype->is_func()) {
 //         return ctx.get_symbol(sym);
 //     } else {
-        TACSym t = ctx.get_temp(TACType::PTR);
-        TACSym s = ctx.get_symbol(sym);
-        stmts.push_back(std::make_shared<TAC::AssignStmt>(t, std::make_shared<TAC::AddrExpr>(s)));
+        TACVal t = ctx.get_temp(TACType::PTR);
+        TACVal s = ctx.get_symbol(sym);
+        stmts.push_back(ctx.expr(TACOp::ADDR, t, s));
         return t;
 //     }
 }
 TACVal AST::IntLit::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
-    return std::make_shared<TAC::IntLit>(val);
+    return ctx.vals.int_lit(val);
 }
 TACVal AST::FloatLit::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
-    return std::make_shared<TAC::FloatLit>(val);
+    return ctx.vals.float_lit(val);
 }
 TACVal AST::StrLit::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
-    return std::make_shared<TAC::StrLit>(val);
+    return ctx.vals.str_lit(val);
 }
 
 TACVal AST::TernaryExpr::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
     TACVal c = cond->tac(stmts, ctx);
 
-    TACLabel false_label = TAC::Context::get_label();
-    TACLabel exit_label = TAC::Context::get_label();
-    TACSym result = ctx.get_stemp(semtype->to_tactype());
+    LabelId false_label = ctx.get_label();
+    LabelId exit_label = ctx.get_label();
+    TACVal result = ctx.get_stemp(semtype->to_tactype());
 
     TACStmtList true_part_tac;
     TACVal t = true_part->tac(true_part_tac, ctx);
     TACStmtList false_part_tac;
     TACVal f = false_part->tac(false_part_tac, ctx);
 
-    TACSym not_c = ctx.get_temp(TACType::BOOL);
-    std::shared_ptr<TAC::NotExpr> not_c_expr = std::make_shared<TAC::NotExpr>(c);
+    TACVal not_c = ctx.get_temp(TACType::BOOL);
 
-    stmts.push_back(std::make_shared<TAC::AssignStmt>(not_c, not_c_expr));
-    stmts.push_back(std::make_shared<TAC::IfGotoStmt>(not_c, false_label));
+    stmts.push_back(ctx.expr(TACOp::NOT, not_c, c));
+    stmts.push_back(TACInstr::if_goto(not_c, false_label));
     stmts.insert(stmts.end(), true_part_tac.begin(), true_part_tac.end());
-    stmts.push_back(std::make_shared<TAC::AssignStmt>(result, t));
-    stmts.push_back(std::make_shared<TAC::GotoStmt>(exit_label));
-    stmts.push_back(false_label);
+    stmts.push_back(ctx.expr(TACOp::COPY, result, t));
+    stmts.push_back(TACInstr::goto_(exit_label));
+    stmts.push_back(TACInstr::label(false_label));
     stmts.insert(stmts.end(), false_part_tac.begin(), false_part_tac.end());
-    stmts.push_back(std::make_shared<TAC::AssignStmt>(result, f));
-    stmts.push_back(exit_label);
+    stmts.push_back(ctx.expr(TACOp::COPY, result, f));
+    stmts.push_back(TACInstr::label(exit_label));
 
     return result;
 }
@@ -72,15 +70,14 @@ TACVal AST::AddExpr::tac(TACStmtList& stmts, TAC::Context& ctx) const
     TACVal l = lhs->tac(stmts, ctx);
     TACVal r = rhs->tac(stmts, ctx);
     if (lhs->semtype->is_ptr()) {
-        TACSym o = ctx.get_temp(TACType::INT);
-        stmts.push_back(std::make_shared<TAC::AssignStmt>(o, std::make_shared<TAC::MulExpr>(r, std::make_shared<TAC::IntLit>(lhs->semtype->get_points_to_type()->size()))));
-        TACSym s = ctx.get_temp(TACType::PTR);
-        stmts.push_back(std::make_shared<TAC::AssignStmt>(s, std::make_shared<TAC::AddExpr>(l, o)));
+        TACVal o = ctx.get_temp(TACType::INT);
+        stmts.push_back(ctx.expr(TACOp::MUL, o, r, ctx.vals.int_lit(lhs->semtype->get_points_to_type()->size())));
+        TACVal s = ctx.get_temp(TACType::PTR);
+        stmts.push_back(ctx.expr(TACOp::ADD, s, l, o));
         return s;
     } else {
-        TACExpr expr = std::make_shared<TAC::AddExpr>(l, r);
-        TACSym result = ctx.get_temp(semtype->to_tactype());
-        stmts.push_back(std::make_shared<TAC::AssignStmt>(result, expr));
+        TACVal result = ctx.get_temp(semtype->to_tactype());
+        stmts.push_back(ctx.expr(TACOp::ADD, result, l, r));
         return result;
     }
 }
@@ -88,121 +85,108 @@ TACVal AST::SubExpr::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
     TACVal l = lhs->tac(stmts, ctx);
     TACVal r = rhs->tac(stmts, ctx);
-    TACExpr expr = std::make_shared<TAC::SubExpr>(l, r);
-    TACSym result = ctx.get_temp(semtype->to_tactype());
-    stmts.push_back(std::make_shared<TAC::AssignStmt>(result, expr));
+    TACVal result = ctx.get_temp(semtype->to_tactype());
+    stmts.push_back(ctx.expr(TACOp::SUB, result, l, r));
     return result;
 }
 TACVal AST::NegExpr::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
     TACVal l = lhs->tac(stmts, ctx);
-    TACExpr expr = std::make_shared<TAC::NegExpr>(l);
-    TACSym result = ctx.get_temp(semtype->to_tactype());
-    stmts.push_back(std::make_shared<TAC::AssignStmt>(result, expr));
+    TACVal result = ctx.get_temp(semtype->to_tactype());
+    stmts.push_back(ctx.expr(TACOp::NEG, result, l));
     return result;
 }
 TACVal AST::MulExpr::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
     TACVal l = lhs->tac(stmts, ctx);
     TACVal r = rhs->tac(stmts, ctx);
-    TACExpr expr = std::make_shared<TAC::MulExpr>(l, r);
-    TACSym result = ctx.get_temp(semtype->to_tactype());
-    stmts.push_back(std::make_shared<TAC::AssignStmt>(result, expr));
+    TACVal result = ctx.get_temp(semtype->to_tactype());
+    stmts.push_back(ctx.expr(TACOp::MUL, result, l, r));
     return result;
 }
 TACVal AST::DivExpr::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
     TACVal l = lhs->tac(stmts, ctx);
     TACVal r = rhs->tac(stmts, ctx);
-    TACExpr expr = std::make_shared<TAC::DivExpr>(l, r);
-    TACSym result = ctx.get_temp(semtype->to_tactype());
-    stmts.push_back(std::make_shared<TAC::AssignStmt>(result, expr));
+    TACVal result = ctx.get_temp(semtype->to_tactype());
+    stmts.push_back(ctx.expr(TACOp::DIV, result, l, r));
     return result;
 }
 TACVal AST::EqualExpr::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
     TACVal l = lhs->tac(stmts, ctx);
     TACVal r = rhs->tac(stmts, ctx);
-    TACExpr expr = std::make_shared<TAC::EqualExpr>(l, r);
-    TACSym result = ctx.get_temp(TACType::BOOL);
-    stmts.push_back(std::make_shared<TAC::AssignStmt>(result, expr));
+    TACVal result = ctx.get_temp(TACType::BOOL);
+    stmts.push_back(ctx.expr(TACOp::EQ, result, l, r));
     return result;
 }
 TACVal AST::NotEqualExpr::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
     TACVal l = lhs->tac(stmts, ctx);
     TACVal r = rhs->tac(stmts, ctx);
-    TACExpr expr = std::make_shared<TAC::NotEqualExpr>(l, r);
-    TACSym result = ctx.get_temp(TACType::BOOL);
-    stmts.push_back(std::make_shared<TAC::AssignStmt>(result, expr));
+    TACVal result = ctx.get_temp(TACType::BOOL);
+    stmts.push_back(ctx.expr(TACOp::NE, result, l, r));
     return result;
 }
 TACVal AST::GreaterExpr::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
     TACVal l = lhs->tac(stmts, ctx);
     TACVal r = rhs->tac(stmts, ctx);
-    TACExpr expr = std::make_shared<TAC::GreaterExpr>(l, r);
-    TACSym result = ctx.get_temp(TACType::BOOL);
-    stmts.push_back(std::make_shared<TAC::AssignStmt>(result, expr));
+    TACVal result = ctx.get_temp(TACType::BOOL);
+    stmts.push_back(ctx.expr(TACOp::GT, result, l, r));
     return result;
 }
 TACVal AST::LessExpr::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
     TACVal l = lhs->tac(stmts, ctx);
     TACVal r = rhs->tac(stmts, ctx);
-    TACExpr expr = std::make_shared<TAC::LessExpr>(l, r);
-    TACSym result = ctx.get_temp(TACType::BOOL);
-    stmts.push_back(std::make_shared<TAC::AssignStmt>(result, expr));
+    TACVal result = ctx.get_temp(TACType::BOOL);
+    stmts.push_back(ctx.expr(TACOp::LT, result, l, r));
     return result;
 }
 TACVal AST::GreaterEqualExpr::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
     TACVal l = lhs->tac(stmts, ctx);
     TACVal r = rhs->tac(stmts, ctx);
-    TACExpr expr = std::make_shared<TAC::GreaterEqualExpr>(l, r);
-    TACSym result = ctx.get_temp(TACType::BOOL);
-    stmts.push_back(std::make_shared<TAC::AssignStmt>(result, expr));
+    TACVal result = ctx.get_temp(TACType::BOOL);
+    stmts.push_back(ctx.expr(TACOp::GE, result, l, r));
     return result;
 }
 TACVal AST::LessEqualExpr::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
     TACVal l = lhs->tac(stmts, ctx);
     TACVal r = rhs->tac(stmts, ctx);
-    TACExpr expr = std::make_shared<TAC::LessEqualExpr>(l, r);
-    TACSym result = ctx.get_temp(TACType::BOOL);
-    stmts.push_back(std::make_shared<TAC::AssignStmt>(result, expr));
+    TACVal result = ctx.get_temp(TACType::BOOL);
+    stmts.push_back(ctx.expr(TACOp::LE, result, l, r));
     return result;
 }
 TACVal AST::AndExpr::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
     TACVal l = lhs->tac(stmts, ctx);
     TACVal r = rhs->tac(stmts, ctx);
-    TACExpr expr = std::make_shared<TAC::AndExpr>(l, r);
-    TACSym result = ctx.get_temp(TACType::BOOL);
-    stmts.push_back(std::make_shared<TAC::AssignStmt>(result, expr));
+    TACVal result = ctx.get_temp(TACType::BOOL);
+    stmts.push_back(ctx.expr(TACOp::AND, result, l, r));
     return result;
 }
 TACVal AST::OrExpr::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
     TACVal l = lhs->tac(stmts, ctx);
     TACVal r = rhs->tac(stmts, ctx);
-    TACExpr expr = std::make_shared<TAC::OrExpr>(l, r);
-    TACSym result = ctx.get_temp(TACType::BOOL);
-    stmts.push_back(std::make_shared<TAC::AssignStmt>(result, expr));
+    TACVal result = ctx.get_temp(TACType::BOOL);
+    stmts.push_back(ctx.expr(TACOp::OR, result, l, r));
     return result;
 }
 TACVal AST::NotExpr::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
     TACVal l = lhs->tac(stmts, ctx);
-    TACExpr expr = std::make_shared<TAC::NotExpr>(l);
-    TACSym result = ctx.get_temp(TACType::BOOL);
-    stmts.push_back(std::make_shared<TAC::AssignStmt>(result, expr));
+    TACVal result = ctx.get_temp(TACType::BOOL);
+    stmts.push_back(ctx.expr(TACOp::NOT, result, l));
     return result;
 }
 TACVal AST::FuncCallExpr::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
-    TACType ret_tac_type;
-    TACSym r;
+    TACType ret_tac_type = TACType();
+    TACVal r;
     if (!semtype->is_void()) {
         ret_tac_type = semtype->to_tactype();
         r = ctx.get_temp(ret_tac_type);
@@ -212,20 +196,14 @@ TACVal AST::FuncCallExpr::tac(TACStmtList& stmts, TAC::Context& ctx) const
     for (auto p : params)
         tac_params.push_back(p->tac(stmts, ctx));
 
-    if (!semtype->is_void()) {
-        TACExpr call = std::make_shared<TAC::FuncCallExpr>(ret_tac_type, func->name, tac_params);
-        stmts.push_back(std::make_shared<TAC::AssignStmt>(r, call));
-        return r;
-    } else {
-        std::shared_ptr<TAC::CallExpr> call = std::make_shared<TAC::FuncCallExpr>((TAC::Type)-1, func->name, tac_params);
-        stmts.push_back(std::make_shared<TAC::CallStmt>(call));
-        return nullptr;
-    }
+    // r stays none for a void call
+    stmts.push_back(ctx.call(r, ret_tac_type, func->name, tac_params));
+    return r;
 }
 TACVal AST::FuncPtrCallExpr::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
-    TACType ret_tac_type;
-    TACSym r;
+    TACType ret_tac_type = TACType();
+    TACVal r;
     if (!semtype->is_void()) {
         ret_tac_type = semtype->to_tactype();
         r = ctx.get_temp(ret_tac_type);
@@ -237,15 +215,9 @@ TACVal AST::FuncPtrCallExpr::tac(TACStmtList& stmts, TAC::Context& ctx) const
     
     TACVal fp = func_ptr->tac(stmts, ctx);
 
-    if (!semtype->is_void()) {
-        TACExpr call = std::make_shared<TAC::FuncPtrCallExpr>(ret_tac_type, fp, tac_params);
-        stmts.push_back(std::make_shared<TAC::AssignStmt>(r, call));
-        return r;
-    } else {
-        std::shared_ptr<TAC::CallExpr> call = std::make_shared<TAC::FuncPtrCallExpr>((TAC::Type)-1, fp, tac_params);
-        stmts.push_back(std::make_shared<TAC::CallStmt>(call));
-        return nullptr;
-    }
+    // r stays none for a void call
+    stmts.push_back(ctx.call_ptr(r, ret_tac_type, fp, tac_params));
+    return r;
 }
 TACVal AST::AddrExpr::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
@@ -255,8 +227,8 @@ TACVal AST::DerefExpr::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
     TACVal a = lhs->tac(stmts, ctx);
     TACType t = semtype->to_tactype();
-    TACSym r = ctx.get_temp(t);
-    stmts.push_back(std::make_shared<TAC::AssignStmt>(r, std::make_shared<TAC::DerefExpr>(t, a)));
+    TACVal r = ctx.get_temp(t);
+    stmts.push_back(ctx.deref(t, r, a));
     return r;
 }
 TACVal AST::DerefExpr::addr_tac(TACStmtList& stmts, TAC::Context& ctx) const
@@ -268,8 +240,8 @@ TACVal AST::ArrayExpr::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
     TACVal ptr = this->addr_tac(stmts, ctx);
     TACType t = base->semtype->get_element_type()->to_tactype();
-    TACSym r = ctx.get_temp(t);
-    stmts.push_back(std::make_shared<TAC::AssignStmt>(r, std::make_shared<TAC::DerefExpr>(t, ptr)));
+    TACVal r = ctx.get_temp(t);
+    stmts.push_back(ctx.deref(t, r, ptr));
     return r;
 }
 TACVal AST::ArrayExpr::addr_tac(TACStmtList& stmts, TAC::Context& ctx) const
@@ -286,25 +258,25 @@ TACVal AST::ArrayExpr::addr_tac(TACStmtList& stmts, TAC::Context& ctx) const
         b = base_lval->addr_tac(stmts, ctx);
     }
     TACVal i = index->tac(stmts, ctx);
-    TACSym o = ctx.get_temp(TACType::INT);
-    stmts.push_back(std::make_shared<TAC::AssignStmt>(o, std::make_shared<TAC::MulExpr>(std::make_shared<TAC::IntLit>(semtype->size()), i)));
-    TACSym p = ctx.get_temp(TACType::PTR);
-    stmts.push_back(std::make_shared<TAC::AssignStmt>(p, std::make_shared<TAC::AddExpr>(b, o)));
+    TACVal o = ctx.get_temp(TACType::INT);
+    stmts.push_back(ctx.expr(TACOp::MUL, o, ctx.vals.int_lit(semtype->size()), i));
+    TACVal p = ctx.get_temp(TACType::PTR);
+    stmts.push_back(ctx.expr(TACOp::ADD, p, b, o));
     return p;
 }
 
 void AST::PrintStmt::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
     TACVal a = arg->tac(stmts, ctx);
-    stmts.push_back(std::make_shared<TAC::PrintStmt>(a));
+    stmts.push_back(ctx.stmt(TACOp::PRINT, a));
 }
 void AST::ReadStmt::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
     TACVal l = arg->addr_tac(stmts, ctx);
     if (arg->semtype->is_float())
-        stmts.push_back(std::make_shared<TAC::ReadFloatStmt>(l));
+        stmts.push_back(ctx.stmt(TACOp::READ_FLOAT, l));
     else
-        stmts.push_back(std::make_shared<TAC::ReadIntStmt>(l));
+        stmts.push_back(ctx.stmt(TACOp::READ_INT, l));
 }
 void AST::CompoundStmt::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
@@ -315,93 +287,95 @@ void AST::AssignStmt::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
     TACVal r = rhs->tac(stmts, ctx);
     if (lhs->is_sym) {
-        TACSym l = ctx.get_symbol(((AST::Sym*)lhs.get())->sym);
-        stmts.push_back(std::make_shared<TAC::AssignStmt>(l, r));
+        TACVal l = ctx.get_symbol(((AST::Sym*)lhs)->sym);
+        stmts.push_back(ctx.expr(TACOp::COPY, l, r));
     } else {
         TACVal l = lhs->addr_tac(stmts, ctx);
-        stmts.push_back(std::make_shared<TAC::AddrAssignStmt>(l, r));
+        stmts.push_back(ctx.stmt(TACOp::ADDR_ASSIGN, l, r));
     }
 }
 void AST::IfStmt::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
     TACVal c = cond->tac(stmts, ctx);
 
-    TACStmtList body_tac;
-    body->tac(body_tac, ctx);
+    // The test jumps over a body whose temps and labels are numbered before
+    // its own, so the body goes in place and the test is filled in after;
+    // copying the body out of a list of its own would cost the depth of
+    // nesting over again
+    size_t test = stmts.size();
+    stmts.resize(test + 2);
+    body->tac(stmts, ctx);
 
-    TACSym not_c = ctx.get_temp(TACType::BOOL);
-    std::shared_ptr<TAC::NotExpr> not_c_expr = std::make_shared<TAC::NotExpr>(c);
+    TACVal not_c = ctx.get_temp(TACType::BOOL);
 
-    TACLabel false_label = TAC::Context::get_label();
+    LabelId false_label = ctx.get_label();
 
-    stmts.push_back(std::make_shared<TAC::AssignStmt>(not_c, not_c_expr));
-    stmts.push_back(std::make_shared<TAC::IfGotoStmt>(not_c, false_label));
-    stmts.insert(stmts.end(), body_tac.begin(), body_tac.end());
-    stmts.push_back(std::make_shared<TAC::GotoStmt>(false_label));
-    stmts.push_back(false_label);
+    stmts[test] = ctx.expr(TACOp::NOT, not_c, c);
+    stmts[test + 1] = TACInstr::if_goto(not_c, false_label);
+    stmts.push_back(TACInstr::goto_(false_label));
+    stmts.push_back(TACInstr::label(false_label));
 }
 void AST::IfElseStmt::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
     TACVal c = cond->tac(stmts, ctx);
 
-    TACStmtList body_tac;
-    body->tac(body_tac, ctx);
+    // the test is filled in after the body, as for IfStmt
+    size_t test = stmts.size();
+    stmts.resize(test + 2);
+    body->tac(stmts, ctx);
 
-    TACSym not_c = ctx.get_temp(TACType::BOOL);
-    std::shared_ptr<TAC::NotExpr> not_c_expr = std::make_shared<TAC::NotExpr>(c);
+    TACVal not_c = ctx.get_temp(TACType::BOOL);
 
-    TACLabel exit_label = TAC::Context::get_label();
-    TACLabel false_label = TAC::Context::get_label();
+    LabelId exit_label = ctx.get_label();
+    LabelId false_label = ctx.get_label();
 
-    stmts.push_back(std::make_shared<TAC::AssignStmt>(not_c, not_c_expr));
-    stmts.push_back(std::make_shared<TAC::IfGotoStmt>(not_c, false_label));
-    stmts.insert(stmts.end(), body_tac.begin(), body_tac.end());
-    stmts.push_back(std::make_shared<TAC::GotoStmt>(exit_label));
-    stmts.push_back(false_label);
+    stmts[test] = ctx.expr(TACOp::NOT, not_c, c);
+    stmts[test + 1] = TACInstr::if_goto(not_c, false_label);
+    stmts.push_back(TACInstr::goto_(exit_label));
+    stmts.push_back(TACInstr::label(false_label));
     else_body->tac(stmts, ctx);
-    stmts.push_back(exit_label);
+    stmts.push_back(TACInstr::label(exit_label));
 }
 void AST::WhileStmt::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
     TACLabel loopback_label;
     TACLabel exit_label;
 
-    TACStmtList cond_tac;
-    TACVal c = cond->tac(cond_tac, ctx);
+    // the loopback label and the test are filled in after the body, as for
+    // IfStmt
+    size_t loopback = stmts.size();
+    stmts.resize(loopback + 1);
+    TACVal c = cond->tac(stmts, ctx);
+    size_t test = stmts.size();
+    stmts.resize(test + 2);
 
-    TACStmtList body_tac;
     if (body != nullptr) {
         TACLabel old_continue = ctx.continue_label, old_break = ctx.break_label;
         if (body->break_count() > 0 || body->continue_count() > 0) {
-            loopback_label = TAC::Context::get_label();
-            exit_label = TAC::Context::get_label();
+            loopback_label = ctx.get_label();
+            exit_label = ctx.get_label();
             ctx.continue_label = loopback_label, ctx.break_label = exit_label;
-            body->tac(body_tac, ctx);
+            body->tac(stmts, ctx);
         } else {
             ctx.continue_label = loopback_label, ctx.break_label = exit_label;
-            body->tac(body_tac, ctx);
-            loopback_label = TAC::Context::get_label();
-            exit_label = TAC::Context::get_label();
+            body->tac(stmts, ctx);
+            loopback_label = ctx.get_label();
+            exit_label = ctx.get_label();
         }
         ctx.continue_label = old_continue, ctx.break_label = old_break;
     } else {
-        loopback_label = TAC::Context::get_label();
-        exit_label = TAC::Context::get_label();
+        loopback_label = ctx.get_label();
+        exit_label = ctx.get_label();
     }
 
-    TACSym not_c = ctx.get_temp(TACType::BOOL);
-    std::shared_ptr<TAC::NotExpr> not_c_expr = std::make_shared<TAC::NotExpr>(c);
-
-    stmts.push_back(loopback_label);
+    TACVal not_c = ctx.get_temp(TACType::BOOL);
 
-    stmts.insert(stmts.end(), cond_tac.begin(), cond_tac.end());
-    stmts.push_back(std::make_shared<TAC::AssignStmt>(not_c, not_c_expr));
-    stmts.push_back(std::make_shared<TAC::IfGotoStmt>(not_c, exit_label));
+    stmts[loopback] = TACInstr::label(*loopback_label);
+    stmts[test] = ctx.expr(TACOp::NOT, not_c, c);
+    stmts[test + 1] = TACInstr::if_goto(not_c, *exit_label);
 
-    stmts.insert(stmts.end(), body_tac.begin(), body_tac.end());
-
-    stmts.push_back(std::make_shared<TAC::GotoStmt>(loopback_label));
-    stmts.push_back(exit_label);
+    stmts.push_back(TACInstr::goto_(*loopback_label));
+    stmts.push_back(TACInstr::label(*exit_label));
 }
 void AST::DoWhileStmt::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
@@ -410,80 +384,80 @@ void AST::DoWhileStmt::tac(TACStmtList& stmts, TAC::Context& ctx) const
 
     TACLabel old_continue = ctx.continue_label, old_break = ctx.break_label;
 
-    TACStmtList body_tac;
+    // the loopback label is filled in after the body, as for IfStmt
+    size_t loopback = stmts.size();
+    stmts.resize(loopback + 1);
     if (body->break_count() > 0 || body->continue_count() > 0) {
-        loopback_label = TAC::Context::get_label();
-        exit_label = TAC::Context::get_label();
+        loopback_label = ctx.get_label();
+        exit_label = ctx.get_label();
         ctx.continue_label = loopback_label, ctx.break_label = exit_label;
-        body->tac(body_tac, ctx);
+        body->tac(stmts, ctx);
     } else {
         ctx.continue_label = loopback_label, ctx.break_label = exit_label;
-        body->tac(body_tac, ctx);
-        loopback_label = TAC::Context::get_label();
+        body->tac(stmts, ctx);
+        loopback_label = ctx.get_label();
     }
 
     ctx.continue_label = old_continue, ctx.break_label = old_break;
 
-    stmts.push_back(loopback_label);
-    stmts.insert(stmts.end(), body_tac.begin(), body_tac.end());
+    stmts[loopback] = TACInstr::label(*loopback_label);
     TACVal c = cond->tac(stmts, ctx);
-    stmts.push_back(std::make_shared<TAC::IfGotoStmt>(c, loopback_label));
+    stmts.push_back(TACInstr::if_goto(c, *loopback_label));
 
     if (body->break_count() > 0)
-        stmts.push_back(exit_label);
+        stmts.push_back(TACInstr::label(*exit_label));
 }
 void AST::ForStmt::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
     if (pre_stmt != nullptr)
         pre_stmt->tac(stmts, ctx);
 
-    TACLabel loopback_label = TAC::Context::get_label();
+    LabelId loopback_label = ctx.get_label();
     TACLabel exit_label;
 
-    stmts.push_back(loopback_label);
+    stmts.push_back(TACInstr::label(loopback_label));
     if (cond != nullptr) {
-        exit_label = TAC::Context::get_label();
+        exit_label = ctx.get_label();
 
         TACVal c = cond->tac(stmts, ctx);
 
-        TACSym not_c = ctx.get_temp(TACType::BOOL);
-        std::shared_ptr<TAC::NotExpr> not_c_expr = std::make_shared<TAC::NotExpr>(c);
-        stmts.push_back(std::make_shared<TAC::AssignStmt>(not_c, not_c_expr));
-        stmts.push_back(std::make_shared<TAC::IfGotoStmt>(not_c, exit_label));
+        TACVal not_c = ctx.get_temp(TACType::BOOL);
+        stmts.push_back(ctx.expr(TACOp::NOT, not_c, c));
+        stmts.push_back(TACInstr::if_goto(not_c, *exit_label));
     }
 
     if (body != nullptr) {
         TACLabel continue_label;
         if (body->continue_count() > 0)
-            continue_label = TAC::Context::get_label();
-        if (body->break_count() > 0 && exit_label == nullptr)
-            exit_label = TAC::Context::get_label();
+            continue_label = ctx.get_label();
+        if (body->break_count() > 0 && !exit_label)
+            exit_label = ctx.get_label();
 
         TACLabel old_continue = ctx.continue_label, old_break = ctx.break_label;
         ctx.continue_label = continue_label, ctx.break_label = exit_label;
         body->tac(stmts, ctx);
         ctx.continue_label = old_continue, ctx.break_label = old_break;
-        if (continue_label != nullptr)
-            stmts.push_back(continue_label);
+        if (continue_label)
+            stmts.push_back(TACInstr::label(*continue_label));
     }
 
     if (inc_stmt != nullptr)
         inc_stmt->tac(stmts, ctx);
-    stmts.push_back(std::make_shared<TAC::GotoStmt>(loopback_label));
-    if (exit_label != nullptr)
-        stmts.push_back(exit_label);
+    stmts.push_back(TACInstr::goto_(loopback_label));
+    if (exit_label)
+        stmts.push_back(TACInstr::label(*exit_label));
 }
 void AST::BreakStmt::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
-    if (ctx.break_label == nullptr)
+    if (!ctx.break_label)
         sclp_error(line, "Break statement outside loop");
-    stmts.push_back(std::make_shared<TAC::GotoStmt>(ctx.break_label));
+    stmts.push_back(TACInstr::goto_(*ctx.break_label));
 }
 void AST::ContinueStmt::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
-    if (ctx.continue_label == nullptr)
+    if (!ctx.continue_label)
         sclp_error(line, "Continue statement outside loop");
-    stmts.push_back(std::make_shared<TAC::GotoStmt>(ctx.continue_label));
+    stmts.push_back(TACInstr::goto_(*ctx.continue_label));
 }
 void AST::CallStmt::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
@@ -492,12 +466,12 @@ void AST::CallStmt::tac(TACStmtList& stmts, TAC::Context& ctx) const
 void AST::ReturnStmt::tac(TACStmtList& stmts, TAC::Context& ctx) const
 {
     if (ret != nullptr) {
-        assert(ctx.return_sym != nullptr);
+        assert(!ctx.return_sym.is_none());
         TACVal r = ret->tac(stmts, ctx);
-        stmts.push_back(std::make_shared<TAC::AssignStmt>(ctx.return_sym, r));
-        stmts.push_back(std::make_shared<TAC::GotoStmt>(ctx.return_label));
+        stmts.push_back(ctx.expr(TACOp::COPY, ctx.return_sym, r));
+        stmts.push_back(TACInstr::goto_(*ctx.return_label));
     } else {
-        assert(ctx.return_sym == nullptr);
-        stmts.push_back(std::make_shared<TAC::GotoStmt>(ctx.return_label));
+        assert(ctx.return_sym.is_none());
+        stmts.push_back(TACInstr::goto_(*ctx.return_label));
     }
 }
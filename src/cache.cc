@@ -0,0 +1,426 @@
+#include <cache.h>
+#include <hash.h>
+#include <io.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <sys/stat.h>
+#include <thread>
+#include <unordered_map>
+#include <unistd.h>
+
+extern char const* argp_program_version;
+
+namespace {
+    // bump when the layout of entries changes
+    constexpr uint64_t FORMAT = 1;
+
+    // Stands in for a hash of the compiler: its version and the size and
+    // time of its executable, which any rebuild changes
+    std::string const& compiler_id()
+    {
+        static std::string const id = [] {
+            std::string s = argp_program_version;
+            struct stat st;
+            if (stat("/proc/self/exe", &st) == 0)
+                s += " " + std::to_string(st.st_size) + " " + std::to_string(st.st_mtim.tv_sec) + "." + std::to_string(st.st_mtim.tv_nsec);
+            return s;
+        }();
+        return id;
+    }
+
+    bool copy_file(std::string const& from, std::string const& to)
+    {
+        std::ifstream in(from, std::ios::binary);
+        if (!in)
+            return false;
+        std::ofstream out(to, std::ios::binary);
+        out << in.rdbuf();
+        return bool(out);
+    }
+
+    // like mkdir -p
+    bool make_dirs(std::string const& dir)
+    {
+        for (size_t i = 1; i <= dir.size(); ++i)
+            if (i == dir.size() || dir[i] == '/')
+                if (mkdir(dir.substr(0, i).c_str(), 0777) != 0 && errno != EEXIST)
+                    return false;
+        return true;
+    }
+
+    char const* const exts[] = { "toks", "ast", "tac", "rtl", "spim", "bin", "ir", "ast.json", "tac.json", "rtl.json", "stats" };
+
+    // a name under dir for building an entry, unique across builds sharing
+    // the cache
+    std::string tmp_name(std::string const& dir)
+    {
+        static std::atomic<unsigned> nr_made(0);
+        return dir + "/tmp." + std::to_string(getpid()) + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + "." + std::to_string(nr_made++);
+    }
+
+    // Function entries: the number of instrs and of names, the instrs as
+    // Records, then the names, each a tag and either a spelling or an index
+    // into the function's string literals. A record is an Instr with what
+    // its form keeps in the union widened to 64 bits, a symbol standing as
+    // its index among the names.
+    struct Record {
+        ASM::Op op;
+        RegId r[3];
+        int32_t imm;
+        uint64_t payload;
+    };
+    static_assert(sizeof(Record) == 16, "Record should have no padding");
+
+    enum SymTag : uint8_t {
+        NAME, STR_LIT
+    };
+
+    class Writer {
+    public:
+        std::string buf;
+
+        template <typename T>
+        void put(T v)
+        {
+            buf.append(reinterpret_cast<char const*>(&v), sizeof(v));
+        }
+        void put_str(std::string const& s)
+        {
+            put<uint64_t>(s.size());
+            buf += s;
+        }
+    };
+
+    // reads what a Writer wrote, failing rather than running off the end
+    class Reader {
+        std::string const& buf;
+        size_t pos;
+
+    public:
+        bool ok;
+
+        explicit Reader(std::string const& buf)
+            : buf(buf), pos(0), ok(true)
+        {
+        }
+        template <typename T>
+        T get()
+        {
+            T v{};
+            if (!ok || buf.size() - pos < sizeof(v)) {
+                ok = false;
+                return v;
+            }
+            memcpy(&v, buf.data() + pos, sizeof(v));
+            pos += sizeof(v);
+            return v;
+        }
+        std::string get_str()
+        {
+            uint64_t n = get<uint64_t>();
+            if (!ok || buf.size() - pos < n) {
+                ok = false;
+                return "";
+            }
+            pos += n;
+            return buf.substr(pos - n, n);
+        }
+        bool at_end() const
+        {
+            return pos == buf.size();
+        }
+    };
+}
+
+Cache::Cache(std::string const& dir)
+    : dir(dir)
+{
+}
+
+std::string Cache::key(Options const& options, std::string const& path) const
+{
+    IO::Input source;
+    if (!source.open(path))
+        return "";
+
+    // what the outputs depend on; -j and --pipeline do not change them
+    Sha256 h;
+    h.update_u64(FORMAT);
+    h.update_str(compiler_id());
+    h.update_u64((uint64_t)options.stage);
+    for (bool b : { options.show_tokens, options.show_ast, options.show_tac, options.show_rtl, options.show_asm, options.show_json_ast, options.show_json_tac, options.show_json_rtl, options.emit_bin, options.stream, options.demo, options.stats })
+        h.update_u64(b);
+    for (std::optional<Stage> s : { options.dump_ir, options.load_ir, options.read_json })
+        h.update_u64(s ? (uint64_t)*s + 1 : 0);
+    h.update_u64(source.get_size());
+    h.update(source.get_data(), source.get_size());
+    return h.hex();
+}
+
+bool Cache::fetch(std::string const& key, std::string const& path, std::ostream& out) const
+{
+    std::string entry = dir + "/" + key.substr(0, 2) + "/" + key.substr(2);
+    struct stat st;
+    if (stat(entry.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+        return false;
+
+    for (char const* ext : exts)
+        if (stat((entry + "/" + ext).c_str(), &st) == 0)
+            copy_file(entry + "/" + ext, path + "." + ext);
+    std::ifstream demo(entry + "/stdout", std::ios::binary);
+    if (demo)
+        out << demo.rdbuf();
+    return true;
+}
+
+void Cache::store(std::string const& key, std::string const& path, std::vector<std::string> const& written, std::string const& demo) const
+{
+    std::string tmp = tmp_name(dir);
+    std::string fan = dir + "/" + key.substr(0, 2);
+    if (!make_dirs(fan) || mkdir(tmp.c_str(), 0777) != 0)
+        return;
+
+    bool ok = true;
+    for (std::string const& ext : written)
+        ok = ok && copy_file(path + "." + ext, tmp + "/" + ext);
+    if (ok && !demo.empty()) {
+        std::ofstream o(tmp + "/stdout", std::ios::binary);
+        o << demo;
+        ok = bool(o);
+    }
+    // losing the race to another build storing the same entry is fine
+    if (!ok || rename(tmp.c_str(), (fan + "/" + key.substr(2)).c_str()) != 0) {
+        for (std::string const& ext : written)
+            unlink((tmp + "/" + ext).c_str());
+        unlink((tmp + "/stdout").c_str());
+        rmdir(tmp.c_str());
+    }
+}
+
+FuncCache::FuncCache(std::string const& dir)
+    : dir(dir + "/fn")
+{
+}
+
+std::string FuncCache::key(Ident func_name, std::vector<TAC::Instr> const& tac, TAC::Values const& vals, size_t frame_size) const
+{
+    Sha256 h;
+    h.update_u64(FORMAT);
+    h.update_str(compiler_id());
+    h.update_str(func_name.str());
+    h.update_u64(frame_size);
+
+    // the bulk of what is hashed, so packed into words and fed in at once
+    // rather than field by field
+    std::vector<uint32_t> words(4 * tac.size() + vals.params.size());
+    auto val = [](TAC::Val v) { return (uint32_t)v.kind() << 29 | v.index(); };
+    for (size_t n = 0; n < tac.size(); ++n) {
+        TAC::Instr const& i = tac[n];
+        words[4 * n] = (uint32_t)i.op << 8 | (uint32_t)i.type;
+        words[4 * n + 1] = val(i.dst);
+        words[4 * n + 2] = val(i.a);
+        words[4 * n + 3] = val(i.b);
+    }
+    for (size_t n = 0; n < vals.params.size(); ++n)
+        words[4 * tac.size() + n] = val(vals.params[n]);
+    h.update_u64(tac.size());
+    h.update_u64(vals.params.size());
+    h.update(words.data(), words.size() * sizeof(uint32_t));
+
+    // temporaries outnumber the rest, so only symbols add their names
+    std::vector<uint64_t> sym_words(2 * vals.syms.size());
+    std::string sym_names;
+    for (size_t n = 0; n < vals.syms.size(); ++n) {
+        TAC::SymInfo const& s = vals.syms[n];
+        sym_words[2 * n] = (uint64_t)s.name.kind << 56 | (uint64_t)s.type << 48 | (uint64_t)s.in_mem << 40 | (uint64_t)s.is_global << 32 | s.name.num;
+        sym_words[2 * n + 1] = s.fp_offset;
+        if (s.name.kind == VarName::Kind::SYM)
+            sym_names += s.name.sym.str() + '\0';
+    }
+    h.update_u64(vals.syms.size());
+    h.update(sym_words.data(), sym_words.size() * sizeof(uint64_t));
+    h.update_str(sym_names);
+    h.update_u64(vals.ints.size());
+    h.update(vals.ints.data(), vals.ints.size() * sizeof(size_t));
+    h.update_u64(vals.floats.size());
+    h.update(vals.floats.data(), vals.floats.size() * sizeof(double));
+    h.update_u64(vals.strs.size());
+    for (std::string const& v : vals.strs)
+        h.update_str(v);
+    h.update_u64(vals.calls.size());
+    for (TAC::Call const& c : vals.calls) {
+        h.update_str(c.func_name.str());
+        h.update_u64((uint64_t)c.first_param << 32 | c.nr_params);
+    }
+    return h.hex();
+}
+
+bool FuncCache::fetch(std::string const& key, TAC::Values const& vals, RTL::Context const& strings, ASM::Code& out) const
+{
+    std::ifstream in(dir + "/" + key.substr(0, 2) + "/" + key.substr(2), std::ios::binary);
+    if (!in)
+        return false;
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    std::string buf = contents.str();
+
+    Reader r(buf);
+    uint64_t nr_instrs = r.get<uint64_t>();
+    uint64_t nr_names = r.get<uint64_t>();
+    if (!r.ok || nr_instrs > buf.size() / sizeof(Record))
+        return false;
+    std::vector<Record> records(nr_instrs);
+    for (Record& rec : records)
+        rec = r.get<Record>();
+
+    std::vector<Ident> names;
+    for (uint64_t n = 0; n < nr_names && r.ok; ++n)
+        switch (r.get<SymTag>()) {
+        case NAME: {
+            std::string name = r.get_str();
+            names.push_back(name.empty() ? Ident::none() : Ident(name));
+            break;
+        }
+        case STR_LIT: {
+            uint64_t k = r.get<uint64_t>();
+            if (!r.ok || k >= vals.strs.size())
+                return false;
+            names.push_back(strings.string_id(vals.strs[k]));
+            break;
+        }
+        default:
+            return false;
+        }
+    if (!r.ok || !r.at_end())
+        return false;
+
+    std::vector<ASM::Instr> instrs(nr_instrs);
+    for (size_t n = 0; n < nr_instrs; ++n) {
+        Record const& rec = records[n];
+        ASM::Instr& i = instrs[n];
+        if (rec.op >= ASM::Op::Nr)
+            return false;
+        i = ASM::Instr{ rec.op, { rec.r[0], rec.r[1], rec.r[2] }, rec.imm, {} };
+        switch (ASM::desc(i.op).form) {
+        case ASM::Form::SYM_DEF:
+        case ASM::Form::SYM:
+        case ASM::Form::RM:
+            if (rec.payload >= names.size())
+                return false;
+            i.sym = names[rec.payload];
+            break;
+        case ASM::Form::LABEL_DEF:
+        case ASM::Form::LABEL:
+        case ASM::Form::RLABEL:
+            i.label = LabelId{ (uint32_t)rec.payload };
+            break;
+        case ASM::Form::RLIT:
+            i.lit = rec.payload;
+            break;
+        case ASM::Form::RFLIT:
+            memcpy(&i.flit, &rec.payload, sizeof(i.flit));
+            break;
+        default:
+            break;
+        }
+        // the registers the form names must be ones there are, the rest
+        // none
+        size_t nr_regs;
+        switch (ASM::desc(i.op).form) {
+        case ASM::Form::R:
+        case ASM::Form::RLIT:
+        case ASM::Form::RFLIT:
+        case ASM::Form::RLABEL:
+            nr_regs = 1;
+            break;
+        case ASM::Form::RM:
+            nr_regs = (i.sym.empty() ? 2 : 1);
+            break;
+        case ASM::Form::RR:
+        case ASM::Form::RRI:
+            nr_regs = 2;
+            break;
+        case ASM::Form::RRR:
+            nr_regs = 3;
+            break;
+        default:
+            nr_regs = 0;
+        }
+        for (size_t k = 0; k < 3; ++k)
+            if (rec.r[k] > RegId::NONE || (k < nr_regs) == (rec.r[k] == RegId::NONE))
+                return false;
+    }
+    out.instrs = std::move(instrs);
+    return true;
+}
+
+void FuncCache::store(std::string const& key, TAC::Values const& vals, RTL::Context const& strings, ASM::Code const& code) const
+{
+    std::unordered_map<Ident, uint64_t> str_lits;
+    for (size_t k = 0; k < vals.strs.size(); ++k)
+        str_lits.emplace(strings.string_id(vals.strs[k]), k);
+
+    std::vector<Record> records(code.instrs.size());
+    std::unordered_map<Ident, uint64_t> name_index;
+    std::vector<Ident> names;
+    for (size_t n = 0; n < code.instrs.size(); ++n) {
+        ASM::Instr const& i = code.instrs[n];
+        Record& rec = records[n];
+        rec = Record{ i.op, { i.r[0], i.r[1], i.r[2] }, i.imm, 0 };
+        switch (ASM::desc(i.op).form) {
+        case ASM::Form::SYM_DEF:
+        case ASM::Form::SYM:
+        case ASM::Form::RM: {
+            auto it = name_index.emplace(i.sym, names.size()).first;
+            if (it->second == names.size())
+                names.push_back(i.sym);
+            rec.payload = it->second;
+            break;
+        }
+        case ASM::Form::LABEL_DEF:
+        case ASM::Form::LABEL:
+        case ASM::Form::RLABEL:
+            rec.payload = i.label.num;
+            break;
+        case ASM::Form::RLIT:
+            rec.payload = i.lit;
+            break;
+        case ASM::Form::RFLIT:
+            memcpy(&rec.payload, &i.flit, sizeof(rec.payload));
+            break;
+        default:
+            break;
+        }
+    }
+
+    Writer w;
+    w.put<uint64_t>(records.size());
+    w.put<uint64_t>(names.size());
+    w.buf.append(reinterpret_cast<char const*>(records.data()), records.size() * sizeof(Record));
+    for (Ident name : names) {
+        auto it = str_lits.find(name);
+        if (it != str_lits.end()) {
+            w.put(STR_LIT);
+            w.put(it->second);
+        } else {
+            w.put(NAME);
+            w.put_str(name.str());
+        }
+    }
+
+    std::string tmp = tmp_name(dir);
+    std::string fan = dir + "/" + key.substr(0, 2);
+    if (!make_dirs(fan))
+        return;
+    std::ofstream o(tmp, std::ios::binary);
+    o << w.buf;
+    o.close();
+    if (!o || rename(tmp.c_str(), (fan + "/" + key.substr(2)).c_str()) != 0)
+        unlink(tmp.c_str());
+}
@@ -0,0 +1,54 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <asm.h>
+#include <opt.h>
+#include <rtl.h>
+#include <tac.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Compiled files, kept under a directory by a hash of everything their
+// outputs depend on: the source, the options that shape the outputs and the
+// compiler itself. An entry is a directory with one file per output, named
+// by its extension, and "stdout" for -d. Entries are built under a
+// temporary name and renamed into place, so builds sharing a cache never see
+// half of one. Anything going wrong with the cache only costs a recompile.
+class Cache {
+    std::string dir;
+
+public:
+    explicit Cache(std::string const& dir);
+
+    // "" if the source cannot be read
+    std::string key(Options const& options, std::string const& path) const;
+    // Writes the outputs of entry key next to path, and any -d output to
+    // out. Returns whether there was such an entry.
+    bool fetch(std::string const& key, std::string const& path, std::ostream& out) const;
+    // keeps the outputs just written next to path, and the -d output
+    void store(std::string const& key, std::string const& path, std::vector<std::string> const& written, std::string const& demo) const;
+};
+
+// The assembly of single functions, kept under DIR/fn by a hash of their
+// TAC, which already resolves every name to a frame slot or a global and
+// types each call's arguments as the callee takes them, so that the TAC and
+// the frame size are all that the RTL and assembly follow from. Labels are
+// kept numbered within the function and string literals by value, so an
+// entry fits whatever a later build numbers around it.
+class FuncCache {
+    std::string dir;
+
+public:
+    explicit FuncCache(std::string const& dir);
+
+    std::string key(Ident func_name, std::vector<TAC::Instr> const& tac, TAC::Values const& vals, size_t frame_size) const;
+    // Loads entry key into out, taking its string literals from vals.strs
+    // and their names from strings. Returns whether there was such an
+    // entry.
+    bool fetch(std::string const& key, TAC::Values const& vals, RTL::Context const& strings, ASM::Code& out) const;
+    void store(std::string const& key, TAC::Values const& vals, RTL::Context const& strings, ASM::Code const& code) const;
+};
+
+#endif // CACHE_H
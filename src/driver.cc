@@ -0,0 +1,554 @@
+#include <asm.h>
+#include <ast.h>
+#include <cache.h>
+#include <driver.h>
+#include <json_dump.h>
+#include <mem_report.h>
+#include <parser.y.tab.h>
+#include <queue.h>
+#include <snapshot.h>
+#include <stats.h>
+#include <sym.h>
+#include <rtl.h>
+#include <tac.h>
+#include <timing.h>
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <iostream>
+#include <thread>
+
+// One input file with everything its compilation owns besides the AST: its
+// files, and the string literals its scanner numbered; and where its phases
+// are timed, if they are
+struct Unit {
+    Options const& options;
+    Files files;
+    RTL::Context strings;
+    Timing::Recorder* timer;
+
+    Unit(Options const& options, std::string const& input_filename, std::string const& dir, std::ostream& out, Timing::Recorder* timer)
+        : options(options), files(options, input_filename, dir, out), timer(timer)
+    {
+    }
+};
+
+int scan_token(YYSTYPE*, yyscan_t);
+Unit* yyget_extra(yyscan_t);
+int yylex_init_extra(Unit*, yyscan_t*);
+struct yy_buffer_state* yy_scan_buffer(char*, size_t, yyscan_t);
+void yyset_lineno(int, yyscan_t);
+int yylex_destroy(yyscan_t);
+
+// a reentrant scanner over a Unit's input, which it scans in place, freed
+// on any way out
+class Scanner {
+    yyscan_t s;
+
+public:
+    explicit Scanner(Unit& u)
+    {
+        yylex_init_extra(&u, &s);
+        yy_scan_buffer(u.files.input.get_data(), u.files.input.get_size() + 2, s);
+        // yylineno is the new buffer's, which yy_scan_buffer leaves unset
+        yyset_lineno(1, s);
+    }
+    ~Scanner()
+    {
+        yylex_destroy(s);
+    }
+    Scanner(Scanner const&) = delete;
+    Scanner& operator=(Scanner const&) = delete;
+
+    operator yyscan_t() const
+    {
+        return s;
+    }
+};
+
+// the parser's scanner; tokens are too many and too quick to time one span
+// each, so the time they take is summed
+int yylex(YYSTYPE* val, yyscan_t s)
+{
+    Timing::Recorder* timer = yyget_extra(s)->timer;
+    if (timer == nullptr)
+        return scan_token(val, s);
+    uint64_t start = Timing::now();
+    int token = scan_token(val, s);
+    timer->add_scan_time(Timing::now() - start);
+    return token;
+}
+
+void register_strlit(Unit* u, char const* s)
+{
+    u->strings.add_string(std::string(s));
+}
+
+thread_local std::string aux_error_msg;
+void sclp_error(size_t line, std::string s)
+{
+    if (aux_error_msg.length() > 0) {
+        s += ": " + aux_error_msg;
+        aux_error_msg.clear();
+    }
+    throw CompileError{ line, s };
+}
+
+// in one piece, so that files failing side by side do not interleave
+std::string format_error(std::string const& input_filename, CompileError const& e)
+{
+    std::string s = "sclp error:";
+    if (e.line > 0)
+        s += " " + input_filename + ":" + std::to_string(e.line);
+    return s + "\n" + e.msg + "\n";
+}
+
+void token_output(Unit* u, char const* token_name, char const* lexeme, int lineno)
+{
+    if (u->files.token_output != nullptr)
+        (*u->files.token_output) << "\tToken Name: " << token_name << " \tLexeme: " << lexeme << " \t Lineno: " << lineno << "\n";
+}
+
+void print_string_escapes(std::string s, std::ostream& o)
+{
+    for (char c : s) {
+        switch (c) {
+        case '\n':
+            o << "\\n"; break;
+        case '\r':
+            o << "\\r"; break;
+        case '\t':
+            o << "\\t"; break;
+        case '\a':
+            o << "\\a"; break;
+        case '"':
+            o << "\\\""; break;
+        case '\\':
+            o << "\\\\"; break;
+        default:
+            o << c;
+        }
+    }
+}
+
+// Lowers one function through every stage up to the one asked for. Touches
+// no state outside the function besides the cache, so runs on any pool
+// thread. A function whose TAC the cache has seen before takes its assembly
+// from there rather than going through RTL, unless the RTL is wanted (see
+// Options::needs_rtl).
+// Stages up to that of a loaded snapshot or dump are done already.
+static void lower(Unit const& u, AST::FuncDefn& a)
+{
+    Stage done = u.options.input_stage().value_or(Stage::AST);
+    if (u.options.stage >= Stage::TAC && done < Stage::TAC) {
+        Timing::Scope t(u.timer, Timing::Phase::TAC, a.func->name);
+        a.make_tac();
+    }
+
+    std::string key;
+    if (u.options.stage == Stage::ASM && !u.options.cache_dir.empty() && !u.options.needs_rtl() && done < Stage::RTL) {
+        FuncCache cache(u.options.cache_dir);
+        key = cache.key(a.func->name, a.tac, a.ctx.vals, a.stackframe_size);
+        if (cache.fetch(key, a.ctx.vals, u.strings, a.mips_asm))
+            return;
+    }
+
+    if (u.options.stage >= Stage::RTL && done < Stage::RTL) {
+        Timing::Scope t(u.timer, Timing::Phase::RTL, a.func->name);
+        TAC::gen_rtl(a.tac, a.ctx.vals, u.strings, a.rtl);
+    }
+    if (u.options.stage >= Stage::ASM) {
+        Timing::Scope t(u.timer, Timing::Phase::ASM, a.func->name);
+        a.rtl.gen_asm(a.func->name, a.stackframe_size, a.mips_asm);
+    }
+
+    if (!key.empty())
+        FuncCache(u.options.cache_dir).store(key, a.ctx.vals, u.strings, a.mips_asm);
+}
+
+// Lowers ast[first, last) on the pool, or on this thread without one,
+// unless that was done while parsing, then numbers their labels in order,
+// as a serial run would have, unless they came numbered in a snapshot or
+// dump of their TAC or RTL
+static void lower_range(Unit const& u, Pool* pool, std::deque<AST::FuncDefn>& ast, size_t first, size_t last, uint32_t& next_label)
+{
+    if (!u.options.pipeline) {
+        if (pool != nullptr)
+            pool->run(last - first, [&](size_t i) { lower(u, ast[first + i]); });
+        else
+            for (size_t i = first; i < last; ++i)
+                lower(u, ast[i]);
+    }
+    if (u.options.mem_report)
+        for (size_t i = first; i < last; ++i) {
+            MemReport::count(MemReport::Object::TAC_INSTRS, ast[i].tac.size());
+            MemReport::count(MemReport::Object::RTL_STMTS, ast[i].rtl.stmts.size());
+            MemReport::count(MemReport::Object::ASM_INSTRS, ast[i].mips_asm.instrs.size());
+        }
+    if (u.options.input_stage().value_or(Stage::AST) < Stage::TAC)
+        for (size_t i = first; i < last; ++i)
+            next_label += ast[i].number_labels(next_label);
+}
+
+// Parses on this thread while jobs others lower each function as soon as
+// the parser completes it. Functions wait in a bounded queue, so a back end
+// falling behind holds up the parser rather than piling up work. Errors are
+// raised once the workers are done: a syntax error first, as a serial run
+// would find it before lowering anything, else the earliest function's.
+static void parse_pipelined(Unit const& u, yyscan_t scanner, AST::Builder& builder, size_t jobs)
+{
+    BoundedQueue<std::pair<size_t, AST::FuncDefn*>> queue(4 * jobs);
+    std::mutex m;
+    std::exception_ptr lower_error;
+    size_t lower_error_func = 0;
+    std::vector<std::thread> workers;
+    for (size_t k = 0; k < jobs; ++k)
+        workers.emplace_back([&] {
+            std::pair<size_t, AST::FuncDefn*> a;
+            while (queue.pop(a)) {
+                try {
+                    lower(u, *a.second);
+                } catch (...) {
+                    std::lock_guard<std::mutex> l(m);
+                    if (!lower_error || a.first < lower_error_func) {
+                        lower_error = std::current_exception();
+                        lower_error_func = a.first;
+                    }
+                }
+            }
+        });
+
+    std::exception_ptr parse_error;
+    builder.on_func = [&](AST::FuncDefn& a) { queue.push({ builder.funcs.size() - 1, &a }); };
+    try {
+        yyparse(scanner, &builder);
+    } catch (...) {
+        parse_error = std::current_exception();
+    }
+    builder.on_func = nullptr;
+
+    queue.close();
+    for (std::thread& t : workers)
+        t.join();
+
+    if (parse_error)
+        std::rethrow_exception(parse_error);
+    if (lower_error)
+        std::rethrow_exception(lower_error);
+}
+
+static void print_tac(Unit const& u, AST::FuncDefn const& a)
+{
+    if (u.files.tac_output != nullptr && a.tac.size() > 0) {
+        (*u.files.tac_output) << "**PROCEDURE: " << a.func->name << "\n";
+        (*u.files.tac_output) << "**BEGIN: Three Address Code Statements\n";
+        for (auto const& z : a.tac)
+            a.ctx.vals.print(*u.files.tac_output, z);
+        (*u.files.tac_output) << "**END: Three Address Code Statements\n";
+    }
+}
+
+static void print_rtl(Unit const& u, AST::FuncDefn const& a)
+{
+    if (u.files.rtl_output != nullptr && a.rtl.stmts.size() > 0) {
+        (*u.files.rtl_output) << "**PROCEDURE: " << a.func->name << "\n";
+        (*u.files.rtl_output) << "**BEGIN: RTL Statements\n";
+        for (auto const& r : a.rtl.stmts)
+            a.rtl.print(*u.files.rtl_output, r);
+        (*u.files.rtl_output) << "**END: RTL Statements\n";
+    }
+}
+
+static void print_asm(Unit const& u, AST::FuncDefn const& a)
+{
+    if (u.files.asm_output == nullptr)
+        return;
+    for (auto const& i : a.mips_asm.instrs)
+        a.mips_asm.print(*u.files.asm_output, i);
+}
+
+// globals and string literals, in the .spim text and in the binary
+static void print_data(Unit const& u, std::vector<Snapshot::Global> const& gv)
+{
+    if (u.files.asm_output != nullptr && (u.strings.string_store.size() > 0 || gv.size() > 0)) {
+        (*u.files.asm_output) << "\n\t.data\n";
+        for (auto const& g : gv)
+            (*u.files.asm_output) << g.name << ":\t" << (g.type == TAC::Type::FLOAT ? ".double 0.0" : ".word 0") << '\n';
+        for (size_t i = 0; i < u.strings.string_store.size(); ++i) {
+            (*u.files.asm_output) << "_str_" << i << ": .asciiz \"";
+            print_string_escapes(u.strings.string_store[i], *u.files.asm_output);
+            (*u.files.asm_output) << "\"\n";
+        }
+    }
+}
+static void add_data(Unit const& u, ASM::Assembler& as, std::vector<Snapshot::Global> const& gv)
+{
+    for (auto const& g : gv) {
+        if (g.type == TAC::Type::FLOAT)
+            as.add_double(g.name);
+        else
+            as.add_word(g.name);
+    }
+    for (size_t i = 0; i < u.strings.string_store.size(); ++i)
+        as.add_string(Ident("_str_" + std::to_string(i)), u.strings.string_store[i]);
+}
+
+
+std::unique_ptr<Arena> Driver::take_arena()
+{
+    std::lock_guard<std::mutex> l(m);
+    if (arenas.empty())
+        return std::make_unique<Arena>();
+    std::unique_ptr<Arena> a = std::move(arenas.back());
+    arenas.pop_back();
+    return a;
+}
+
+void Driver::give_arena(std::unique_ptr<Arena> a)
+{
+    a->reset();
+    std::lock_guard<std::mutex> l(m);
+    arenas.push_back(std::move(a));
+}
+
+// Compiles one file, or takes its outputs from the cache, timing it with
+// timer if given. Returns the error that stopped it, if any, ready for
+// stderr.
+std::string Driver::compile(Options const& options, std::string const& input_filename, std::string const& dir, std::ostream& out, Pool* pool, Timing::Recorder* timer)
+{
+    // stdin cannot be read twice, once for the key and once to compile it
+    if (options.cache_dir.empty() || input_filename == "-")
+        return build(options, input_filename, dir, out, pool, nullptr, timer);
+
+    Cache cache(Files::resolve(options.cache_dir, dir));
+    std::string path = Files::resolve(input_filename, dir);
+    std::string key = cache.key(options, path);
+    if (!key.empty() && cache.fetch(key, path, out))
+        return "";
+
+    // -d output is held back to be kept as well
+    std::ostringstream demo;
+    std::vector<std::string> written;
+    std::string error = build(options, input_filename, dir, options.demo ? demo : out, pool, &written, timer);
+    if (options.demo)
+        out << demo.str();
+    if (error.empty() && !key.empty())
+        cache.store(key, path, written, demo.str());
+    return error;
+}
+
+// Compiles one file, lowering its functions on pool, if given, and noting
+// in written the outputs that went to files
+std::string Driver::build(Options const& options, std::string const& input_filename, std::string const& dir, std::ostream& out, Pool* pool, std::vector<std::string>* written, Timing::Recorder* timer)
+{
+    Timing::Scope total(timer, Timing::Phase::COMPILE);
+    aux_error_msg.clear();
+    // owns every AST node; outlives everything pointing into it
+    std::unique_ptr<Arena> ast_arena = take_arena();
+    std::string error;
+    try {
+        Unit u(options, input_filename, dir, out, timer);
+        Scanner scanner(u);
+        if (written != nullptr)
+            *written = u.files.written;
+
+        if (options.stage == Stage::TOKEN) {
+            YYSTYPE val;
+            while (yylex(&val, scanner));
+        } else {
+            SymbolTable symtab(*ast_arena);
+            AST::Builder builder(symtab, *ast_arena);
+            // the globals as symbols, with an AST, and as the data section
+            // needs them
+            std::vector<Symbol const*> global_vars;
+            std::vector<Snapshot::Global> globals;
+            size_t jobs = (pool != nullptr ? pool->size() : 1);
+            if (options.load_ir) {
+                Timing::Scope t(timer, Timing::Phase::LOAD);
+                Snapshot::load(u.files.input, u.files.path, *options.load_ir, builder, u.strings, globals);
+            } else if (options.read_json) {
+                Timing::Scope t(timer, Timing::Phase::LOAD);
+                JsonDump::load(u.files.input, u.files.input_filename, *options.read_json, builder, u.strings, global_vars, globals);
+            } else if (options.stage >= Stage::PARSE) {
+                Timing::Scope t(timer, Timing::Phase::PARSE);
+                if (options.pipeline)
+                    parse_pipelined(u, scanner, builder, jobs);
+                else
+                    yyparse(scanner, &builder);
+                global_vars = symtab.get_global_vars();
+            }
+            for (auto s : global_vars)
+                globals.push_back(Snapshot::Global{ s->name, s->semtype->to_tactype() });
+            // a snapshot or dump of TAC or RTL has no AST to print
+            bool has_ast = (options.stage >= Stage::AST && options.input_stage().value_or(Stage::AST) == Stage::AST);
+            bool print_ast = (has_ast && u.files.ast_output != nullptr);
+
+            std::deque<AST::FuncDefn>& ast = builder.funcs;
+            // only fed with --emit=bin
+            ASM::Assembler as;
+            std::optional<Snapshot::Writer> dump;
+            if (options.dump_ir)
+                dump.emplace(*u.files.ir_output, *options.dump_ir);
+            std::optional<JsonDump::Writer> json_ast, json_tac, json_rtl;
+            if (u.files.json_ast_output != nullptr && has_ast)
+                json_ast.emplace(*u.files.json_ast_output, Stage::AST, u.strings, global_vars, globals);
+            if (u.files.json_tac_output != nullptr)
+                json_tac.emplace(*u.files.json_tac_output, Stage::TAC, u.strings, global_vars, globals);
+            if (u.files.json_rtl_output != nullptr)
+                json_rtl.emplace(*u.files.json_rtl_output, Stage::RTL, u.strings, global_vars, globals);
+            std::optional<Stats::Table> stats;
+            if (u.files.stats_output != nullptr)
+                stats.emplace(*u.files.stats_output, options);
+
+            uint32_t next_label = builder.get_nr_parse_labels();
+
+            if (options.stream) {
+                // functions are written out, and their IR dropped, a few per
+                // thread at a time; .data, which needs no IR, goes last
+                size_t batch = 4 * jobs;
+                for (size_t first = 0; first < ast.size(); first += batch) {
+                    size_t last = std::min(first + batch, ast.size());
+                    lower_range(u, pool, ast, first, last, next_label);
+                    for (size_t i = first; i < last; ++i) {
+                        AST::FuncDefn& a = ast[i];
+                        Timing::Scope t(timer, Timing::Phase::EMIT, a.func->name);
+                        if (print_ast)
+                            a.print(*u.files.ast_output);
+                        if (dump)
+                            dump->add_func(a);
+                        for (auto* j : { &json_ast, &json_tac, &json_rtl })
+                            if (*j)
+                                (*j)->add_func(a);
+                        print_tac(u, a);
+                        print_rtl(u, a);
+                        if (stats)
+                            stats->add_func(a);
+                        if (options.stage >= Stage::ASM) {
+                            print_asm(u, a);
+                            if (u.files.bin_output != nullptr)
+                                as.add_func(a.func->name, std::move(a.mips_asm));
+                        }
+                        a.release_ir();
+                    }
+                }
+                if (options.stage >= Stage::ASM) {
+                    Timing::Scope t(timer, Timing::Phase::EMIT);
+                    print_data(u, globals);
+                }
+            } else {
+                lower_range(u, pool, ast, 0, ast.size(), next_label);
+
+                if (print_ast)
+                    for (auto const& a : ast) {
+                        Timing::Scope t(timer, Timing::Phase::EMIT, a.func->name);
+                        a.print(*u.files.ast_output);
+                    }
+                if (dump)
+                    for (auto const& a : ast) {
+                        Timing::Scope t(timer, Timing::Phase::EMIT, a.func->name);
+                        dump->add_func(a);
+                    }
+                for (auto* j : { &json_ast, &json_tac, &json_rtl })
+                    if (*j)
+                        for (auto const& a : ast) {
+                            Timing::Scope t(timer, Timing::Phase::EMIT, a.func->name);
+                            (*j)->add_func(a);
+                        }
+                if (u.files.tac_output != nullptr)
+                    for (auto const& a : ast) {
+                        Timing::Scope t(timer, Timing::Phase::EMIT, a.func->name);
+                        print_tac(u, a);
+                    }
+                if (u.files.rtl_output != nullptr)
+                    for (auto const& a : ast) {
+                        Timing::Scope t(timer, Timing::Phase::EMIT, a.func->name);
+                        print_rtl(u, a);
+                    }
+                if (stats)
+                    for (auto const& a : ast) {
+                        Timing::Scope t(timer, Timing::Phase::EMIT, a.func->name);
+                        stats->add_func(a);
+                    }
+                if (options.stage >= Stage::ASM) {
+                    {
+                        Timing::Scope t(timer, Timing::Phase::EMIT);
+                        print_data(u, globals);
+                    }
+                    for (auto& a : ast) {
+                        Timing::Scope t(timer, Timing::Phase::EMIT, a.func->name);
+                        print_asm(u, a);
+                        if (u.files.bin_output != nullptr)
+                            as.add_func(a.func->name, std::move(a.mips_asm));
+                    }
+                }
+            }
+
+            Timing::Scope t(timer, Timing::Phase::EMIT);
+            if (options.stage >= Stage::ASM && u.files.bin_output != nullptr) {
+                add_data(u, as, globals);
+                as.write(*u.files.bin_output);
+            }
+            if (dump)
+                dump->finish(u.strings, globals);
+            for (auto* j : { &json_ast, &json_tac, &json_rtl })
+                if (*j)
+                    (*j)->finish();
+            if (stats)
+                stats->finish();
+            if (options.mem_report) {
+                MemReport::count(MemReport::Object::AST_OBJECTS, ast_arena->get_nr_objects());
+                MemReport::count(MemReport::Object::AST_ARENA_BYTES, ast_arena->get_size());
+                MemReport::count(MemReport::Object::STRINGS, u.strings.string_store.size());
+            }
+        }
+    } catch (CompileError const& e) {
+        error = format_error(input_filename, e);
+    }
+    give_arena(std::move(ast_arena));
+    return error;
+}
+
+bool Driver::run(Options const& options, std::string const& dir, std::ostream& out, std::ostream& err)
+{
+    // Several files are compiled side by side, each on a thread of its own,
+    // and their errors reported in command line order; a single file spreads
+    // its functions over all the threads instead. With -d every file writes
+    // to out, so they take turns, as they do if one is stdin.
+    std::vector<std::string> const& files = options.input_filenames;
+    std::vector<std::string> errors(files.size());
+    bool to_out = (options.demo || std::count(files.begin(), files.end(), "-") > 0);
+    std::vector<Timing::Recorder> timers(options.timed() ? files.size() : 0);
+    auto timer = [&](size_t i) { return timers.empty() ? nullptr : &timers[i]; };
+    auto report = [&](size_t i) {
+        err << errors[i];
+        if (options.time_report) {
+            if (timers[i].empty())
+                err << "Time report for " << files[i] << ": taken from the cache\n";
+            else
+                timers[i].report(err, files[i]);
+        }
+    };
+    if (files.size() > 1 && !to_out) {
+        pool.run(files.size(), [&](size_t i) { errors[i] = compile(options, files[i], dir, out, nullptr, timer(i)); });
+        for (size_t i = 0; i < files.size(); ++i)
+            report(i);
+    } else
+        for (size_t i = 0; i < files.size(); ++i) {
+            errors[i] = compile(options, files[i], dir, out, &pool, timer(i));
+            report(i);
+        }
+    if (!options.time_trace.empty()) {
+        IO::Output trace(Files::resolve(options.time_trace, dir));
+        Timing::Recorder::trace(trace, files, timers);
+    }
+
+    for (std::string const& e : errors)
+        if (!e.empty())
+            return false;
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef DRIVER_H
+#define DRIVER_H
+
+#include <arena.h>
+#include <error.h>
+#include <opt.h>
+#include <pool.h>
+#include <timing.h>
+
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Compiles batches of files, a batch being the command line of a one-shot
+// run or a request to a server. What is worth keeping warm between batches
+// stays here: the thread pool, and arenas whose blocks are reused rather
+// than freed.
+class Driver {
+    Pool pool;
+
+    std::mutex m;
+    // idle arenas, reset
+    std::vector<std::unique_ptr<Arena>> arenas;
+
+    std::unique_ptr<Arena> take_arena();
+    void give_arena(std::unique_ptr<Arena> a);
+    std::string compile(Options const& options, std::string const& input_filename, std::string const& dir, std::ostream& out, Pool* pool, Timing::Recorder* timer);
+    std::string build(Options const& options, std::string const& input_filename, std::string const& dir, std::ostream& out, Pool* pool, std::vector<std::string>* written, Timing::Recorder* timer);
+
+public:
+    explicit Driver(size_t jobs)
+        : pool(jobs)
+    {
+    }
+
+    // Compiles options.input_filenames, taking relative names from dir if
+    // one is given. -d output goes to out, errors and time reports to err
+    // in command line order. Returns whether every file compiled.
+    bool run(Options const& options, std::string const& dir, std::ostream& out, std::ostream& err);
+};
+
+// sclp's report of e, as written to stderr
+std::string format_error(std::string const& input_filename, CompileError const& e);
+
+#endif // DRIVER_H
@@ -1,13 +1,17 @@
 #ifndef ERROR_H
 #define ERROR_H
 
-#ifdef __cplusplus
+#include <cstddef>
 #include <string>
-void sclp_error(size_t line, std::string s);
-extern std::string aux_error_msg;
-#else
-#include <stddef.h>
-void sclp_error(size_t line, char const* s, ...);
-#endif
+
+// Thrown by sclp_error. Ends the compilation of the file at hand, which the
+// driver reports before going on with any other files.
+struct CompileError {
+    size_t line;
+    std::string msg;
+};
+[[noreturn]] void sclp_error(size_t line, std::string s);
+// detail for the next sclp_error on the same thread
+extern thread_local std::string aux_error_msg;
 
 #endif // ERROR_H
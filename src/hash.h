@@ -0,0 +1,40 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// SHA-256, for naming things by their content
+class Sha256 {
+    uint32_t h[8];
+    unsigned char block[64];
+    size_t fill;
+    uint64_t length;
+
+    void compress();
+
+public:
+    Sha256();
+
+    void update(void const* data, size_t n);
+    void update(std::string const& s)
+    {
+        update(s.data(), s.size());
+    }
+    // fields of fixed size, so that neighbouring ones cannot run together
+    void update_u64(uint64_t v)
+    {
+        update(&v, sizeof(v));
+    }
+    void update_str(std::string const& s)
+    {
+        update_u64(s.size());
+        update(s);
+    }
+
+    // the digest as 64 hex digits; the object is spent afterwards
+    std::string hex();
+};
+
+#endif // HASH_H
@@ -0,0 +1,66 @@
+#include <error.h>
+#include <ident.h>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+    // Names are stored in fixed-size chunks which never move, so str() can
+    // read a name while another thread interns a new one; only interning
+    // takes the lock. The map keys on views into the stored strings.
+    struct NameTable {
+        static constexpr size_t CHUNK_BITS = 12;
+        static constexpr size_t CHUNK_SIZE = size_t(1) << CHUNK_BITS;
+        static constexpr size_t MAX_CHUNKS = size_t(1) << 14;
+
+        std::unique_ptr<std::string[]> chunks[MAX_CHUNKS];
+        uint32_t size;
+        std::unordered_map<std::string_view, uint32_t> ids;
+        std::mutex m;
+
+        NameTable()
+            : size(0)
+        {
+            add(std::string_view());
+        }
+        std::string& at(uint32_t id)
+        {
+            return chunks[id >> CHUNK_BITS][id & (CHUNK_SIZE - 1)];
+        }
+        uint32_t add(std::string_view s)
+        {
+            uint32_t id = size;
+            if ((id >> CHUNK_BITS) == MAX_CHUNKS)
+                sclp_error(0, "More than " + std::to_string(MAX_CHUNKS * CHUNK_SIZE) + " distinct names");
+            if ((id & (CHUNK_SIZE - 1)) == 0)
+                chunks[id >> CHUNK_BITS].reset(new std::string[CHUNK_SIZE]);
+            at(id) = s;
+            ids.emplace(at(id), id);
+            size++;
+            return id;
+        }
+    };
+
+    NameTable& name_table()
+    {
+        static NameTable t;
+        return t;
+    }
+}
+
+Ident::Ident(std::string_view s)
+{
+    NameTable& t = name_table();
+    std::lock_guard<std::mutex> l(t.m);
+    auto it = t.ids.find(s);
+    if (it != t.ids.end()) {
+        id = it->second;
+        return;
+    }
+    id = t.add(s);
+}
+
+std::string const& Ident::str() const
+{
+    return name_table().at(id);
+}
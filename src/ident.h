@@ -0,0 +1,66 @@
+#ifndef IDENT_H
+#define IDENT_H
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+// Handle to an identifier interned in the process-wide name table. Every
+// spelling is stored once; equal names share an id, so comparing and hashing
+// idents is an integer operation. Id 0 is the empty name. Names are never
+// dropped, even by a compile server between requests, and the table holds
+// at most 2^26 of them; interning one more is an sclp_error.
+class Ident {
+private:
+    uint32_t id;
+
+public:
+    // trivial so that Ident can sit in the parser's value union
+    Ident() = default;
+    explicit Ident(std::string_view s);
+
+    static Ident none()
+    {
+        Ident i;
+        i.id = 0;
+        return i;
+    }
+
+    uint32_t get_id() const
+    {
+        return id;
+    }
+    bool empty() const
+    {
+        return id == 0;
+    }
+    std::string const& str() const;
+
+    bool operator==(Ident other) const
+    {
+        return id == other.id;
+    }
+    bool operator!=(Ident other) const
+    {
+        return id != other.id;
+    }
+};
+
+inline std::ostream& operator<<(std::ostream& o, Ident i)
+{
+    return o << i.str();
+}
+
+namespace std {
+    template <>
+    struct hash<Ident> {
+        size_t operator()(Ident i) const
+        {
+            return i.get_id();
+        }
+    };
+}
+
+#endif // IDENT_H
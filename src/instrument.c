@@ -1,9 +1,14 @@
+#define _GNU_SOURCE
 #include <signal.h>
+#include <errno.h>
 #include <execinfo.h>
+#include <link.h>
 #include <unistd.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 #include <sys/wait.h>
 
 #define RED "\x1b[1;31m"
@@ -17,7 +22,10 @@ static void pretty_print_trace_entry(char* start)
     // "<function signature> at /...<path to src>.../<src basename> ..."
     char const* func_name = start;
 
+    // frames addr2line cannot place ("?? ??:0") have no location
     char* loc = strstr(start, " at ");
+    if (loc == NULL)
+        return;
     loc[0] = '\0';
 
     // skip library functions
@@ -126,6 +134,303 @@ static void sighandler(int sig)
     exit(-1);
 }
 
+// Sampling profiler, on when SCLP_PROFILE is set to a rate in Hz. SIGPROF
+// comes every 1/rate seconds of CPU time, taken by whichever thread is
+// running; its handler only takes a backtrace and copies the return
+// addresses into a slot of a ring buffer allocated beforehand, claimed with
+// an atomic increment, so that it neither allocates nor locks. At exit the
+// samples are symbolized with addr2line and written as folded stacks, one
+// "root;...;leaf count" line per distinct stack, for flamegraph.pl and the
+// like, to SCLP_PROFILE_OUT, or sclp.PID.folded. Once the ring is full the
+// oldest samples are overwritten. The kernel may deliver fewer signals than
+// asked for, down to one a tick.
+#define PROF_DEPTH 64
+#define PROF_RING_SZ (1 << 15)
+// the handler's own frame and the signal trampoline's
+#define PROF_SKIP 2
+
+struct sample {
+    int depth;
+    // leaf first; the leaf is where the thread was, the rest return addresses
+    void* pcs[PROF_DEPTH];
+};
+static struct sample* ring;
+static unsigned long nr_samples;
+
+static void profhandler(int sig)
+{
+    (void)sig;
+    int saved_errno = errno;
+    void* trace[PROF_SKIP + PROF_DEPTH];
+    int n = backtrace(trace, PROF_SKIP + PROF_DEPTH) - PROF_SKIP;
+    if (n > 0) {
+        unsigned long k = __atomic_fetch_add(&nr_samples, 1, __ATOMIC_RELAXED);
+        struct sample* s = &ring[k % PROF_RING_SZ];
+        for (int i = 0; i < n; ++i)
+            s->pcs[i] = trace[PROF_SKIP + i];
+        __atomic_store_n(&s->depth, n, __ATOMIC_RELEASE);
+    }
+    errno = saved_errno;
+}
+
+// a loaded object, where its segments span and what to add to its addresses
+struct object {
+    char const* path;
+    uintptr_t base, lo, hi;
+};
+#define MAX_OBJECTS 64
+static struct object objects[MAX_OBJECTS];
+static size_t nr_objects;
+
+static int add_object(struct dl_phdr_info* info, size_t size, void* data)
+{
+    (void)size;
+    (void)data;
+    if (nr_objects == MAX_OBJECTS)
+        return 1;
+    struct object* o = &objects[nr_objects];
+    o->lo = UINTPTR_MAX;
+    o->hi = 0;
+    for (int i = 0; i < info->dlpi_phnum; ++i)
+        if (info->dlpi_phdr[i].p_type == PT_LOAD) {
+            uintptr_t lo = info->dlpi_addr + info->dlpi_phdr[i].p_vaddr;
+            uintptr_t hi = lo + info->dlpi_phdr[i].p_memsz;
+            if (lo < o->lo)
+                o->lo = lo;
+            if (hi > o->hi)
+                o->hi = hi;
+        }
+    if (o->lo >= o->hi)
+        return 0;
+    // the executable itself comes first, with no name; addr2line needs
+    // its path, /proc/self/exe being its own
+    if (info->dlpi_name[0] != '\0')
+        o->path = strdup(info->dlpi_name);
+    else {
+        char exe[4096];
+        ssize_t n = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+        exe[n > 0 ? n : 0] = '\0';
+        o->path = strdup(exe);
+    }
+    o->base = info->dlpi_addr;
+    ++nr_objects;
+    return 0;
+}
+
+static int compare_addrs(void const* a, void const* b)
+{
+    uintptr_t x = *(uintptr_t const*)a, y = *(uintptr_t const*)b;
+    return (x > y) - (x < y);
+}
+static int compare_strs(void const* a, void const* b)
+{
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+// names[i] for addrs[first..last), all in o, as addr2line has them, or the
+// object's basename in brackets where it has none
+static void symbolize(struct object const* o, uintptr_t const* addrs, char** names, size_t first, size_t last)
+{
+    char const* base = strrchr(o->path, '/');
+    base = (base != NULL ? base + 1 : o->path);
+    char unknown[256];
+    snprintf(unknown, sizeof(unknown), "[%s]", base);
+    for (size_t i = first; i < last; ++i)
+        names[i] = NULL;
+
+    // addresses on stdin, from a file so that neither side of a pipe
+    // fills up waiting for the other
+    FILE* in = tmpfile();
+    int f[2];
+    if (in != NULL && pipe(f) == 0) {
+        for (size_t i = first; i < last; ++i)
+            fprintf(in, "%#lx\n", (unsigned long)(addrs[i] - o->base));
+        fflush(in);
+        rewind(in);
+        int c = fork();
+        if (c == 0) {
+            close(f[0]);
+            dup2(fileno(in), STDIN_FILENO);
+            dup2(f[1], STDOUT_FILENO);
+            close(f[1]);
+
+            char const* argv[] = { "/bin/addr2line", "-Cfe", o->path, NULL };
+            char const* envp[] = { NULL };
+
+            execve(argv[0], (void const*)argv, (void const*)envp);
+            _exit(127);
+        }
+        close(f[1]);
+
+        // a line for the function, then one for the file, for each address
+        FILE* out = fdopen(f[0], "r");
+        char* line = NULL;
+        size_t cap = 0;
+        for (size_t i = first; i < last && out != NULL; ++i) {
+            ssize_t n = getline(&line, &cap, out);
+            if (n <= 0)
+                break;
+            if (line[n - 1] == '\n')
+                line[n - 1] = '\0';
+            if (strcmp(line, "??") != 0)
+                names[i] = strdup(line);
+            if (getline(&line, &cap, out) <= 0)
+                break;
+        }
+        free(line);
+        if (out != NULL)
+            fclose(out);
+        else
+            close(f[0]);
+        if (c > 0)
+            waitpid(c, NULL, 0);
+    }
+    if (in != NULL)
+        fclose(in);
+    for (size_t i = first; i < last; ++i)
+        if (names[i] == NULL)
+            names[i] = strdup(unknown);
+}
+
+static void write_profile()
+{
+    struct itimerval stop;
+    memset(&stop, 0, sizeof(stop));
+    setitimer(ITIMER_PROF, &stop, NULL);
+    signal(SIGPROF, SIG_IGN);
+
+    unsigned long taken = __atomic_load_n(&nr_samples, __ATOMIC_ACQUIRE);
+    size_t nr = (taken < PROF_RING_SZ ? taken : PROF_RING_SZ);
+
+    // every return address but the leaf's is taken back into its call
+    // instruction, for addr2line to place it on the line of the call
+    size_t nr_addrs = 0;
+    for (size_t i = 0; i < nr; ++i)
+        for (int j = 1; j < ring[i].depth; ++j)
+            ring[i].pcs[j] = (char*)ring[i].pcs[j] - 1;
+    uintptr_t* addrs = malloc(nr * PROF_DEPTH * sizeof(uintptr_t) + 1);
+    for (size_t i = 0; i < nr; ++i)
+        for (int j = 0; j < ring[i].depth; ++j)
+            addrs[nr_addrs++] = (uintptr_t)ring[i].pcs[j];
+    qsort(addrs, nr_addrs, sizeof(uintptr_t), &compare_addrs);
+    size_t nr_unique = 0;
+    for (size_t i = 0; i < nr_addrs; ++i)
+        if (nr_unique == 0 || addrs[nr_unique - 1] != addrs[i])
+            addrs[nr_unique++] = addrs[i];
+
+    dl_iterate_phdr(&add_object, NULL);
+    char** names = malloc(nr_unique * sizeof(char*) + 1);
+    for (size_t i = 0; i < nr_unique;) {
+        struct object const* o = NULL;
+        for (size_t k = 0; k < nr_objects && o == NULL; ++k)
+            if (objects[k].lo <= addrs[i] && addrs[i] < objects[k].hi)
+                o = &objects[k];
+        if (o == NULL) {
+            names[i++] = strdup("[unknown]");
+            continue;
+        }
+        size_t last = i + 1;
+        while (last < nr_unique && addrs[last] < o->hi)
+            ++last;
+        symbolize(o, addrs, names, i, last);
+        i = last;
+    }
+
+    // each sample as root;...;leaf, sorted to count the distinct ones
+    char** stacks = malloc(nr * sizeof(char*) + 1);
+    size_t nr_stacks = 0;
+    for (size_t i = 0; i < nr; ++i) {
+        size_t len = 1;
+        char const* frames[PROF_DEPTH];
+        for (int j = 0; j < ring[i].depth; ++j) {
+            uintptr_t a = (uintptr_t)ring[i].pcs[j];
+            uintptr_t const* p = bsearch(&a, addrs, nr_unique, sizeof(uintptr_t), &compare_addrs);
+            frames[j] = names[p - addrs];
+            len += strlen(frames[j]) + 1;
+        }
+        if (ring[i].depth == 0)
+            continue;
+        char* s = malloc(len);
+        char* e = s;
+        for (int j = ring[i].depth - 1; j >= 0; --j) {
+            size_t n = strlen(frames[j]);
+            memcpy(e, frames[j], n);
+            e += n;
+            *e++ = (j > 0 ? ';' : '\0');
+        }
+        stacks[nr_stacks++] = s;
+    }
+    qsort(stacks, nr_stacks, sizeof(char*), &compare_strs);
+
+    char const* path = getenv("SCLP_PROFILE_OUT");
+    char default_path[64];
+    if (path == NULL || path[0] == '\0') {
+        snprintf(default_path, sizeof(default_path), "sclp.%d.folded", (int)getpid());
+        path = default_path;
+    }
+    FILE* out = fopen(path, "w");
+    if (out == NULL)
+        fprintf(stderr, RED "[PROFILE] Unable to open %s\n" RESET, path);
+    for (size_t i = 0; i < nr_stacks;) {
+        size_t j = i + 1;
+        while (j < nr_stacks && strcmp(stacks[i], stacks[j]) == 0)
+            ++j;
+        if (out != NULL)
+            fprintf(out, "%s %zu\n", stacks[i], j - i);
+        i = j;
+    }
+    if (out != NULL)
+        fclose(out);
+    if (taken > PROF_RING_SZ)
+        fprintf(stderr, RED "[PROFILE] %lu of %lu samples overwritten; lower SCLP_PROFILE\n" RESET, taken - PROF_RING_SZ, taken);
+
+    for (size_t i = 0; i < nr_stacks; ++i)
+        free(stacks[i]);
+    free(stacks);
+    for (size_t i = 0; i < nr_unique; ++i)
+        free(names[i]);
+    free(names);
+    free(addrs);
+}
+
+static void init_profile(char const* rate)
+{
+    long hz = atol(rate);
+    if (hz <= 0 || hz > 1000000) {
+        fprintf(stderr, RED "[PROFILE] SCLP_PROFILE should be a rate in Hz, not %s\n" RESET, rate);
+        return;
+    }
+    ring = calloc(PROF_RING_SZ, sizeof(struct sample));
+    if (ring == NULL)
+        return;
+    // the first backtrace loads the unwinder, which allocates; not in the
+    // handler
+    void* warm[1];
+    backtrace(warm, 1);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = &profhandler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGPROF, &sa, NULL);
+
+    // tv_usec has to stay below a second, so 1 Hz is all tv_sec
+    long period = 1000000 / hz;
+    struct itimerval every;
+    every.it_interval.tv_sec = period / 1000000;
+    every.it_interval.tv_usec = period % 1000000;
+    every.it_value = every.it_interval;
+    if (setitimer(ITIMER_PROF, &every, NULL) != 0) {
+        fprintf(stderr, RED "[PROFILE] Unable to start the profiling timer: %s\n" RESET, strerror(errno));
+        signal(SIGPROF, SIG_DFL);
+        free(ring);
+        ring = NULL;
+        return;
+    }
+    atexit(&write_profile);
+}
+
 void init_instrument()
 {
     struct sigaction sa;
@@ -134,4 +439,8 @@ void init_instrument()
     sigemptyset(&sa.sa_mask);
     sigaction(SIGSEGV, &sa, NULL);
     sigaction(SIGABRT, &sa, NULL);
+
+    char const* rate = getenv("SCLP_PROFILE");
+    if (rate != NULL && rate[0] != '\0')
+        init_profile(rate);
 }
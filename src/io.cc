@@ -0,0 +1,162 @@
+#include <io.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace IO;
+
+Input::Input()
+    : data(nullptr), size(0), mapped(0)
+{
+}
+Input::Input(Input&& o)
+    : data(o.data), size(o.size), mapped(o.mapped)
+{
+    o.data = nullptr;
+    o.size = o.mapped = 0;
+}
+Input& Input::operator=(Input&& o)
+{
+    clear();
+    data = o.data;
+    size = o.size;
+    mapped = o.mapped;
+    o.data = nullptr;
+    o.size = o.mapped = 0;
+    return *this;
+}
+Input::~Input()
+{
+    clear();
+}
+
+void Input::clear()
+{
+    if (data != nullptr) {
+        if (mapped > 0)
+            munmap(data, mapped);
+        else
+            free(data);
+    }
+    data = nullptr;
+    size = mapped = 0;
+}
+
+// for pipes and the like, which cannot be mapped
+bool Input::read_all(int fd)
+{
+    size_t cap = 1 << 16;
+    data = static_cast<char*>(malloc(cap));
+    for (;;) {
+        if (cap - size == 2) {
+            cap *= 2;
+            data = static_cast<char*>(realloc(data, cap));
+        }
+        ssize_t n = read(fd, data + size, cap - size - 2);
+        if (n == 0)
+            break;
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            clear();
+            return false;
+        }
+        size += n;
+    }
+    data[size] = data[size + 1] = '\0';
+    return true;
+}
+
+// A regular file is mapped over a zeroed anonymous mapping a page or so
+// longer, so that the NULs past its end come for free: the rest of its last
+// page reads as zeros, as does the page after it.
+bool Input::open(std::string const& path)
+{
+    clear();
+    if (path == "-")
+        return read_all(STDIN_FILENO);
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        size_t page = sysconf(_SC_PAGESIZE);
+        size_t len = (st.st_size + 2 + page - 1) / page * page;
+        void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p != MAP_FAILED) {
+            if (mmap(p, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED) {
+                data = static_cast<char*>(p);
+                size = st.st_size;
+                mapped = len;
+                close(fd);
+                return true;
+            }
+            munmap(p, len);
+        }
+    }
+    bool ok = read_all(fd);
+    close(fd);
+    return ok;
+}
+
+Output::Buffer::Buffer(int fd)
+    : fd(fd)
+{
+}
+Output::Buffer::~Buffer()
+{
+    drain();
+    if (fd > STDERR_FILENO)
+        close(fd);
+}
+
+void Output::Buffer::drain()
+{
+    char const* p = pbase();
+    size_t n = pptr() - pbase();
+    while (fd >= 0 && n > 0) {
+        ssize_t k = ::write(fd, p, n);
+        if (k < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        p += k;
+        n -= k;
+    }
+    setp(buf.data(), buf.data() + buf.size());
+}
+
+// grows the buffer until it is LIMIT long, then empties it each time it
+// fills
+int Output::Buffer::overflow(int c)
+{
+    size_t n = pptr() - pbase();
+    if (n == buf.size()) {
+        if (buf.size() >= LIMIT) {
+            drain();
+            n = 0;
+        } else {
+            buf.resize(std::min(std::max<size_t>(2 * buf.size(), 1 << 12), LIMIT));
+            setp(buf.data(), buf.data() + buf.size());
+            pbump(n);
+        }
+    }
+    if (c == traits_type::eof())
+        return traits_type::not_eof(c);
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+    return c;
+}
+
+Output::Output(std::string const& path)
+    : std::ostream(nullptr), b(path == "-" ? STDOUT_FILENO : ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666))
+{
+    rdbuf(&b);
+}
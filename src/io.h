@@ -0,0 +1,73 @@
+#ifndef IO_H
+#define IO_H
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Files read in whole and written in one go; "-" is stdin or stdout
+namespace IO {
+    // The contents of a file, mapped in where it can be and read otherwise,
+    // followed by two NULs that flex needs to scan it in place. The mapping
+    // is private and writable, as flex marks the end of each token in the
+    // buffer itself.
+    class Input {
+        char* data;
+        size_t size;
+        // the length of the mapping; 0 if data was read onto the heap
+        size_t mapped;
+
+        void clear();
+        bool read_all(int fd);
+
+    public:
+        Input();
+        Input(Input const&) = delete;
+        Input(Input&& o);
+        Input& operator=(Input const&) = delete;
+        Input& operator=(Input&& o);
+        ~Input();
+
+        // false if path cannot be opened
+        bool open(std::string const& path);
+
+        char* get_data() const
+        {
+            return data;
+        }
+        // not counting the NULs
+        size_t get_size() const
+        {
+            return size;
+        }
+    };
+
+    // An output file kept in memory and written with a single write once
+    // done, unless it outgrows LIMIT bytes, when it goes out that much at a
+    // time. Flushing does not write. Like an ofstream, one whose file cannot
+    // be created drops what it is given.
+    class Output : public std::ostream {
+        class Buffer : public std::streambuf {
+            int fd;
+            std::vector<char> buf;
+
+            void drain();
+
+        protected:
+            int overflow(int c) override;
+
+        public:
+            explicit Buffer(int fd);
+            ~Buffer();
+        };
+        Buffer b;
+
+    public:
+        static constexpr size_t LIMIT = 4 << 20;
+
+        explicit Output(std::string const& path);
+    };
+}
+
+#endif // IO_H
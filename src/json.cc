@@ -0,0 +1,454 @@
+#include <error.h>
+#include <json.h>
+
+#include <cerrno>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace Json;
+
+Writer::Writer(std::ostream& out)
+    : out(out), after_key(false), break_line(false)
+{
+}
+
+void Writer::begin_value()
+{
+    if (after_key)
+        after_key = false;
+    else if (!nonempty.empty()) {
+        if (nonempty.back())
+            out.put(',');
+        nonempty.back() = true;
+    }
+    if (break_line) {
+        out.put('\n');
+        break_line = false;
+    }
+}
+
+void Writer::begin_object()
+{
+    begin_value();
+    out.put('{');
+    nonempty.push_back(false);
+}
+void Writer::end_object()
+{
+    nonempty.pop_back();
+    out.put('}');
+}
+void Writer::begin_array()
+{
+    begin_value();
+    out.put('[');
+    nonempty.push_back(false);
+}
+void Writer::end_array()
+{
+    nonempty.pop_back();
+    out.put(']');
+}
+
+void Writer::key(char const* k)
+{
+    begin_value();
+    write_string(k, strlen(k));
+    out.put(':');
+    after_key = true;
+}
+
+// Runs of plain characters go out in one write. Bytes from 0x80 up pass
+// through as they are, so a string is read back byte for byte.
+void Writer::write_string(char const* s, size_t n)
+{
+    static char const hex[] = "0123456789abcdef";
+    out.put('"');
+    size_t run = 0;
+    for (size_t i = 0; i < n; ++i) {
+        unsigned char c = s[i];
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+        out.write(s + run, i - run);
+        run = i + 1;
+        switch (c) {
+        case '"':
+            out.write("\\\"", 2);
+            break;
+        case '\\':
+            out.write("\\\\", 2);
+            break;
+        case '\n':
+            out.write("\\n", 2);
+            break;
+        case '\t':
+            out.write("\\t", 2);
+            break;
+        case '\r':
+            out.write("\\r", 2);
+            break;
+        default: {
+            char e[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 15] };
+            out.write(e, sizeof(e));
+        }
+        }
+    }
+    out.write(s + run, n - run);
+    out.put('"');
+}
+
+void Writer::value(char const* v)
+{
+    begin_value();
+    write_string(v, strlen(v));
+}
+void Writer::value(std::string const& v)
+{
+    begin_value();
+    write_string(v.data(), v.size());
+}
+void Writer::value(bool v)
+{
+    begin_value();
+    if (v)
+        out.write("true", 4);
+    else
+        out.write("false", 5);
+}
+void Writer::value(uint64_t v)
+{
+    char b[24];
+    begin_value();
+    out.write(b, snprintf(b, sizeof(b), "%" PRIu64, v));
+}
+void Writer::value(int64_t v)
+{
+    char b[24];
+    begin_value();
+    out.write(b, snprintf(b, sizeof(b), "%" PRId64, v));
+}
+// enough digits to read back the same double; JSON has no infinities,
+// but a number too large for one reads back as one
+void Writer::value(double v)
+{
+    char b[32];
+    begin_value();
+    if (std::isinf(v))
+        out << (v < 0 ? "-1e999" : "1e999");
+    else
+        out.write(b, snprintf(b, sizeof(b), "%.17g", v));
+}
+void Writer::null()
+{
+    begin_value();
+    out.write("null", 4);
+}
+void Writer::newline()
+{
+    break_line = true;
+}
+
+Reader::Reader(char const* data, size_t size, std::string const& name)
+    : buf(data), len(size), name(name), line(1), pos(0)
+{
+}
+
+void Reader::fail(std::string const& what) const
+{
+    sclp_error(line, "Bad JSON in " + name + ": " + what);
+}
+
+int Reader::peek()
+{
+    if (pos == len)
+        return EOF;
+    return (unsigned char)buf[pos];
+}
+int Reader::get()
+{
+    int c = peek();
+    if (c != EOF)
+        ++pos;
+    return c;
+}
+
+void Reader::skip_ws()
+{
+    for (;;) {
+        int c = peek();
+        if (c == '\n')
+            ++line;
+        else if (c != ' ' && c != '\t' && c != '\r')
+            return;
+        ++pos;
+    }
+}
+
+void Reader::expect(char c)
+{
+    skip_ws();
+    if (get() != c)
+        fail(std::string("expected '") + c + "'");
+}
+void Reader::expect_word(char const* w)
+{
+    for (char const* p = w; *p != '\0'; ++p)
+        if (get() != *p)
+            fail(std::string("expected ") + w);
+}
+
+Reader::Type Reader::next_type()
+{
+    skip_ws();
+    switch (peek()) {
+    case '{':
+        return Type::OBJECT;
+    case '[':
+        return Type::ARRAY;
+    case '"':
+        return Type::STRING;
+    case 't':
+    case 'f':
+        return Type::BOOL;
+    case 'n':
+        return Type::NUL;
+    case '-':
+    case '0': case '1': case '2': case '3': case '4':
+    case '5': case '6': case '7': case '8': case '9':
+        return Type::NUMBER;
+    case EOF:
+        fail("unexpected end of file");
+    default:
+        fail("expected a value");
+    }
+}
+
+void Reader::begin_object()
+{
+    expect('{');
+    if (nonempty.size() == MAX_DEPTH)
+        fail("nested more than " + std::to_string(MAX_DEPTH) + " deep");
+    nonempty.push_back(false);
+}
+bool Reader::next_key(std::string& k)
+{
+    skip_ws();
+    if (peek() == '}') {
+        ++pos;
+        nonempty.pop_back();
+        return false;
+    }
+    if (nonempty.back())
+        expect(',');
+    nonempty.back() = true;
+    if (next_type() != Type::STRING)
+        fail("expected a key");
+    k = get_string();
+    expect(':');
+    return true;
+}
+void Reader::begin_array()
+{
+    expect('[');
+    if (nonempty.size() == MAX_DEPTH)
+        fail("nested more than " + std::to_string(MAX_DEPTH) + " deep");
+    nonempty.push_back(false);
+}
+bool Reader::next_elem()
+{
+    skip_ws();
+    if (peek() == ']') {
+        ++pos;
+        nonempty.pop_back();
+        return false;
+    }
+    if (nonempty.back())
+        expect(',');
+    nonempty.back() = true;
+    return true;
+}
+
+static void put_utf8(std::string& s, uint32_t cp)
+{
+    if (cp < 0x80)
+        s += char(cp);
+    else if (cp < 0x800) {
+        s += char(0xc0 | cp >> 6);
+        s += char(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+        s += char(0xe0 | cp >> 12);
+        s += char(0x80 | (cp >> 6 & 0x3f));
+        s += char(0x80 | (cp & 0x3f));
+    } else {
+        s += char(0xf0 | cp >> 18);
+        s += char(0x80 | (cp >> 12 & 0x3f));
+        s += char(0x80 | (cp >> 6 & 0x3f));
+        s += char(0x80 | (cp & 0x3f));
+    }
+}
+
+std::string Reader::get_string()
+{
+    expect('"');
+    std::string s;
+    auto hex4 = [this] {
+        uint32_t v = 0;
+        for (int i = 0; i < 4; ++i) {
+            int c = get();
+            if (c >= '0' && c <= '9')
+                v = v * 16 + (c - '0');
+            else if (c >= 'a' && c <= 'f')
+                v = v * 16 + (c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F')
+                v = v * 16 + (c - 'A' + 10);
+            else
+                fail("bad \\u escape");
+        }
+        return v;
+    };
+    for (;;) {
+        int c = get();
+        if (c == '"')
+            return s;
+        if (c == EOF || c < 0x20)
+            fail("unterminated string");
+        if (c != '\\') {
+            s += char(c);
+            continue;
+        }
+        switch (c = get()) {
+        case '"':
+        case '\\':
+        case '/':
+            s += char(c);
+            break;
+        case 'b':
+            s += '\b';
+            break;
+        case 'f':
+            s += '\f';
+            break;
+        case 'n':
+            s += '\n';
+            break;
+        case 'r':
+            s += '\r';
+            break;
+        case 't':
+            s += '\t';
+            break;
+        case 'u': {
+            uint32_t cp = hex4();
+            if (cp >= 0xd800 && cp < 0xdc00) {
+                expect_word("\\u");
+                uint32_t lo = hex4();
+                if (lo < 0xdc00 || lo >= 0xe000)
+                    fail("bad surrogate pair");
+                cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+            }
+            put_utf8(s, cp);
+            break;
+        }
+        default:
+            fail("bad escape");
+        }
+    }
+}
+
+std::string Reader::get_number()
+{
+    if (next_type() != Type::NUMBER)
+        fail("expected a number");
+    std::string s;
+    for (int c = peek(); c != EOF && (strchr("+-.eE", c) != nullptr || (c >= '0' && c <= '9')); c = peek()) {
+        s += char(c);
+        ++pos;
+    }
+    return s;
+}
+uint64_t Reader::get_uint()
+{
+    std::string s = get_number();
+    char* end;
+    errno = 0;
+    uint64_t v = strtoull(s.c_str(), &end, 10);
+    if (s[0] == '-' || *end != '\0' || errno != 0)
+        fail("expected an unsigned integer");
+    return v;
+}
+int64_t Reader::get_int()
+{
+    std::string s = get_number();
+    char* end;
+    errno = 0;
+    int64_t v = strtoll(s.c_str(), &end, 10);
+    if (*end != '\0' || errno != 0)
+        fail("expected an integer");
+    return v;
+}
+double Reader::get_double()
+{
+    std::string s = get_number();
+    char* end;
+    double v = strtod(s.c_str(), &end);
+    if (*end != '\0')
+        fail("bad number");
+    return v;
+}
+bool Reader::get_bool()
+{
+    if (next_type() != Type::BOOL)
+        fail("expected true or false");
+    if (peek() == 't') {
+        expect_word("true");
+        return true;
+    }
+    expect_word("false");
+    return false;
+}
+bool Reader::get_null()
+{
+    if (next_type() != Type::NUL)
+        return false;
+    expect_word("null");
+    return true;
+}
+
+void Reader::skip()
+{
+    std::string k;
+    switch (next_type()) {
+    case Type::OBJECT:
+        begin_object();
+        while (next_key(k))
+            skip();
+        break;
+    case Type::ARRAY:
+        begin_array();
+        while (next_elem())
+            skip();
+        break;
+    case Type::STRING:
+        get_string();
+        break;
+    case Type::NUMBER:
+        get_number();
+        break;
+    case Type::BOOL:
+        get_bool();
+        break;
+    case Type::NUL:
+        get_null();
+        break;
+    }
+}
+
+void Reader::end()
+{
+    skip_ws();
+    if (peek() != EOF)
+        fail("trailing characters");
+}
@@ -0,0 +1,114 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// JSON written and read a token at a time, with nothing held but the
+// nesting, so that a dump of any size goes through in constant memory
+namespace Json {
+    // Writes one value to out as it is handed over, compact, placing the
+    // commas and colons itself
+    class Writer {
+        std::ostream& out;
+        // per open object or array, whether it has a member yet
+        std::vector<bool> nonempty;
+        bool after_key;
+        // a line break asked for, written after the next comma
+        bool break_line;
+
+        void begin_value();
+        void write_string(char const* s, size_t n);
+
+    public:
+        explicit Writer(std::ostream& out);
+
+        void begin_object();
+        void end_object();
+        void begin_array();
+        void end_array();
+        void key(char const* k);
+
+        void value(char const* v);
+        void value(std::string const& v);
+        void value(bool v);
+        void value(uint64_t v);
+        void value(int64_t v);
+        void value(double v);
+        void null();
+        // starts the next value on a line of its own, to keep dumps
+        // greppable
+        void newline();
+
+        template <typename T>
+        void member(char const* k, T v)
+        {
+            key(k);
+            value(v);
+        }
+    };
+
+    // Pulls the tokens of one JSON value off the contents of a file. The
+    // caller walks the document as it expects it to be; anything else is
+    // reported with the line it was found on.
+    class Reader {
+        // the most objects and arrays open at once; skip() and the readers
+        // built on this recurse once per level
+        static constexpr size_t MAX_DEPTH = 4096;
+
+        char const* buf;
+        size_t len;
+        std::string name;
+        size_t line;
+        size_t pos;
+        // per open object or array, whether it has a member yet
+        std::vector<bool> nonempty;
+
+        int peek();
+        int get();
+        void skip_ws();
+        void expect(char c);
+        void expect_word(char const* w);
+
+    public:
+        enum class Type {
+            OBJECT, ARRAY, STRING, NUMBER, BOOL, NUL
+        };
+
+        // name is that of the file, for errors
+        Reader(char const* data, size_t size, std::string const& name);
+
+        [[noreturn]] void fail(std::string const& what) const;
+
+        // the type of the next value, which is left unread
+        Type next_type();
+
+        void begin_object();
+        // Reads the key of the next member into k. Returns false, having
+        // read the closing brace, if there is none.
+        bool next_key(std::string& k);
+        void begin_array();
+        // whether there is another element; false, having read the closing
+        // bracket, if not
+        bool next_elem();
+
+        std::string get_string();
+        // the spelling of the next number
+        std::string get_number();
+        uint64_t get_uint();
+        int64_t get_int();
+        double get_double();
+        bool get_bool();
+        // reads a null if that is next
+        bool get_null();
+        // reads the next value whatever it is
+        void skip();
+        // there is nothing left but whitespace
+        void end();
+    };
+}
+
+#endif // JSON_H
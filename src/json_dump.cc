@@ -0,0 +1,539 @@
+#include <error.h>
+#include <json_dump.h>
+
+#include <cstring>
+#include <unordered_map>
+
+using namespace JsonDump;
+
+namespace {
+    // bump when the layout of dumps changes
+    constexpr uint64_t VERSION = 1;
+
+    char const* const stage_names[] = { "token", "parse", "ast", "tac", "rtl", "asm" };
+
+    char const* const type_names[] = { "bool", "int", "float", "string", "ptr" };
+
+    char const* const tac_op_names[] = {
+        "copy", "add", "sub", "mul", "div", "neg",
+        "eq", "ne", "gt", "lt", "ge", "le",
+        "not", "and", "or",
+        "addr", "deref",
+        "call", "call_ptr",
+        "addr_assign",
+        "print", "read_int", "read_float",
+        "label", "goto", "if_goto",
+        "return"
+    };
+    static_assert(sizeof(tac_op_names) / sizeof(tac_op_names[0]) == (size_t)TAC::Op::RETURN + 1, "every TAC op should have a name");
+
+    char const* const rtl_op_names[] = {
+        "label", "goto", "bgtz",
+        "write", "read",
+        "call", "assign_call", "call_ptr", "assign_call_ptr", "return",
+        "push", "push_d", "pop", "pop_d",
+        "move", "move_d",
+        "load", "load_d", "iload", "iload_d", "load_addr", "store", "store_d",
+        "uminus", "uminus_d", "not",
+        "add", "add_d", "sub", "sub_d", "mul", "mul_d", "div", "div_d",
+        "slt", "slt_d", "sle", "sle_d", "sgt", "sge", "seq", "seq_d", "sne",
+        "or", "and",
+        "movt", "movf",
+        "get_addr", "deref", "deref_d", "addr_assign", "addr_assign_d"
+    };
+    static_assert(sizeof(rtl_op_names) / sizeof(rtl_op_names[0]) == (size_t)RTL::Op::Nr, "every RTL op should have a name");
+
+    // the index of s among names, or n if it is none of them
+    size_t find_name(char const* const* names, size_t n, std::string const& s)
+    {
+        size_t i = 0;
+        while (i < n && s != names[i])
+            ++i;
+        return i;
+    }
+    template <size_t N>
+    size_t lookup(Json::Reader& r, char const* const (&names)[N], char const* what)
+    {
+        std::string s = r.get_string();
+        size_t i = find_name(names, N, s);
+        if (i == N)
+            r.fail(std::string("unknown ") + what + " '" + s + "'");
+        return i;
+    }
+
+    // {"sym": name}, {"temp": n} or {"stemp": n}, then the slot's members
+    void begin_var(Json::Writer& w, VarName n)
+    {
+        w.begin_object();
+        switch (n.kind) {
+        case VarName::Kind::SYM:
+            w.member("sym", n.sym.str());
+            break;
+        case VarName::Kind::TEMP:
+            w.member("temp", (uint64_t)n.num);
+            break;
+        case VarName::Kind::STEMP:
+            w.member("stemp", (uint64_t)n.num);
+            break;
+        }
+    }
+    // reads the member k of a slot into n, if it names it
+    bool read_var_name(Json::Reader& r, std::string const& k, VarName& n)
+    {
+        if (k == "sym")
+            n = VarName::of_sym(Ident(r.get_string()));
+        else if (k == "temp")
+            n = VarName::temp(r.get_uint());
+        else if (k == "stemp")
+            n = VarName::stemp(r.get_uint());
+        else
+            return false;
+        return true;
+    }
+
+    void tac_operand(Json::Writer& w, TAC::Values const& vals, TAC::Val v)
+    {
+        w.begin_object();
+        switch (v.kind()) {
+        case TAC::Val::Kind::SYM:
+            w.member("var", (uint64_t)v.index());
+            break;
+        case TAC::Val::Kind::INT:
+            w.member("int", (uint64_t)vals.ints[v.index()]);
+            break;
+        case TAC::Val::Kind::FLOAT:
+            w.member("float", vals.floats[v.index()]);
+            break;
+        case TAC::Val::Kind::STR:
+            w.member("str", vals.strs[v.index()]);
+            break;
+        case TAC::Val::Kind::LABEL:
+            w.member("label", (uint64_t)v.index());
+            break;
+        case TAC::Val::Kind::CALL: {
+            TAC::Call const& c = vals.call(v);
+            w.key("call");
+            w.begin_object();
+            w.key("func");
+            if (c.func_name.empty())
+                w.null();
+            else
+                w.value(c.func_name.str());
+            w.key("args");
+            w.begin_array();
+            for (uint32_t k = 0; k < c.nr_params; ++k)
+                tac_operand(w, vals, vals.params[c.first_param + k]);
+            w.end_array();
+            w.end_object();
+            break;
+        }
+        case TAC::Val::Kind::NONE:
+            break;
+        }
+        w.end_object();
+    }
+
+    void tac_json(Json::Writer& w, AST::FuncDefn const& a)
+    {
+        TAC::Values const& vals = a.ctx.vals;
+        w.key("syms");
+        w.begin_array();
+        for (TAC::SymInfo const& s : vals.syms) {
+            begin_var(w, s.name);
+            w.member("type", type_names[(size_t)s.type]);
+            w.member("in_mem", s.in_mem);
+            w.member("global", s.is_global);
+            w.member("fp_offset", (int64_t)s.fp_offset);
+            w.end_object();
+        }
+        w.end_array();
+
+        w.key("code");
+        w.begin_array();
+        for (TAC::Instr const& i : a.tac) {
+            w.newline();
+            w.begin_object();
+            w.member("op", tac_op_names[(size_t)i.op]);
+            w.member("type", type_names[(size_t)i.type]);
+            char const* const keys[] = { "dst", "a", "b" };
+            TAC::Val const ops[] = { i.dst, i.a, i.b };
+            for (size_t k = 0; k < 3; ++k)
+                if (!ops[k].is_none()) {
+                    w.key(keys[k]);
+                    tac_operand(w, vals, ops[k]);
+                }
+            w.end_object();
+        }
+        w.end_array();
+    }
+
+    void rtl_json(Json::Writer& w, AST::FuncDefn const& a)
+    {
+        w.key("code");
+        w.begin_array();
+        for (RTL::Stmt const& s : a.rtl.stmts) {
+            w.newline();
+            // [op, operands...], as many as the op has
+            w.begin_array();
+            w.value(rtl_op_names[(size_t)s.op]);
+            RTL::Operand const* ops[] = { &s.x, &s.y, &s.z };
+            for (size_t k = 0; k < 3; ++k) {
+                RTL::Operand const& o = *ops[k];
+                switch (RTL::desc(s.op).kinds[k]) {
+                case RTL::Kind::NONE:
+                    break;
+                case RTL::Kind::REG:
+                    if (o.reg < RegId::NONE)
+                        w.value(reg_names[(size_t)o.reg]);
+                    else
+                        w.null();
+                    break;
+                case RTL::Kind::MEM: {
+                    RTL::Mem const& m = a.rtl.mems[o.mem];
+                    begin_var(w, m.name);
+                    w.member("global", m.is_global);
+                    w.member("fp_offset", (int64_t)m.fp_offset);
+                    w.end_object();
+                    break;
+                }
+                case RTL::Kind::INT:
+                    w.value((uint64_t)o.int_val);
+                    break;
+                case RTL::Kind::FLOAT:
+                    w.value(o.float_val);
+                    break;
+                case RTL::Kind::LABEL:
+                    w.value((uint64_t)o.label.num);
+                    break;
+                case RTL::Kind::FUNC:
+                    w.value(o.func.str());
+                    break;
+                }
+            }
+            w.end_array();
+        }
+        w.end_array();
+    }
+}
+
+Writer::Writer(std::ostream& out, Stage stage, RTL::Context const& strings, std::vector<Symbol const*> const& global_vars, std::vector<Snapshot::Global> const& globals)
+    : out(out), w(out), stage(stage)
+{
+    w.begin_object();
+    w.member("sclp", stage_names[(size_t)stage]);
+    w.member("version", VERSION);
+    w.key("strings");
+    w.begin_array();
+    for (std::string const& s : strings.string_store)
+        w.value(s);
+    w.end_array();
+
+    w.key("globals");
+    w.begin_array();
+    if (stage == Stage::AST)
+        for (auto const& s : global_vars) {
+            w.begin_object();
+            w.member("name", s->name.str());
+            w.key("type");
+            s->semtype->json(w);
+            w.member("const", s->is_const);
+            w.end_object();
+        }
+    else
+        for (Snapshot::Global const& g : globals) {
+            w.begin_object();
+            w.member("name", g.name.str());
+            w.member("type", type_names[(size_t)g.type]);
+            w.end_object();
+        }
+    w.end_array();
+
+    w.key("functions");
+    w.begin_array();
+}
+
+void Writer::add_func(AST::FuncDefn const& a)
+{
+    w.newline();
+    if (stage == Stage::AST) {
+        a.json(w);
+        return;
+    }
+    w.begin_object();
+    w.member("name", a.func->name.str());
+    w.member("frame_size", (uint64_t)a.stackframe_size);
+    if (stage == Stage::TAC)
+        tac_json(w, a);
+    else
+        rtl_json(w, a);
+    w.end_object();
+}
+
+void Writer::finish()
+{
+    w.end_array();
+    w.end_object();
+    out.put('\n');
+    out.flush();
+}
+
+namespace {
+    TAC::Val read_tac_operand(Json::Reader& r, TAC::Values& vals)
+    {
+        TAC::Val v;
+        std::string k;
+        r.begin_object();
+        while (r.next_key(k)) {
+            if (k == "var") {
+                uint64_t n = r.get_uint();
+                if (n >= (1u << 29))
+                    r.fail("bad var");
+                v = TAC::Val(TAC::Val::Kind::SYM, n);
+            } else if (k == "int")
+                v = vals.int_lit(r.get_uint());
+            else if (k == "float")
+                v = vals.float_lit(r.get_double());
+            else if (k == "str")
+                v = vals.str_lit(r.get_string());
+            else if (k == "label") {
+                uint64_t n = r.get_uint();
+                if (n >= (1u << 29))
+                    r.fail("bad label");
+                v = TAC::Val(TAC::Val::Kind::LABEL, n);
+            } else if (k == "call") {
+                Ident func = Ident::none();
+                std::vector<TAC::Val> args;
+                std::string ck;
+                r.begin_object();
+                while (r.next_key(ck)) {
+                    if (ck == "func")
+                        func = (r.get_null() ? Ident::none() : Ident(r.get_string()));
+                    else if (ck == "args") {
+                        r.begin_array();
+                        while (r.next_elem())
+                            args.push_back(read_tac_operand(r, vals));
+                    } else
+                        r.skip();
+                }
+                v = vals.add_call(func, args);
+            } else
+                r.skip();
+        }
+        return v;
+    }
+
+    void read_tac(Json::Reader& r, std::string const& k, AST::FuncDefn& a)
+    {
+        TAC::Values& vals = a.ctx.vals;
+        if (k == "syms") {
+            r.begin_array();
+            while (r.next_elem()) {
+                TAC::SymInfo s{ VarName::temp(0), TAC::Type::INT, false, false, 0 };
+                std::string sk;
+                r.begin_object();
+                while (r.next_key(sk)) {
+                    if (read_var_name(r, sk, s.name))
+                        continue;
+                    if (sk == "type")
+                        s.type = TAC::Type(lookup(r, type_names, "type"));
+                    else if (sk == "in_mem")
+                        s.in_mem = r.get_bool();
+                    else if (sk == "global")
+                        s.is_global = r.get_bool();
+                    else if (sk == "fp_offset")
+                        s.fp_offset = r.get_int();
+                    else
+                        r.skip();
+                }
+                vals.syms.push_back(s);
+            }
+        } else if (k == "code") {
+            r.begin_array();
+            while (r.next_elem()) {
+                TAC::Instr i{ TAC::Op::COPY, TAC::Type::INT, TAC::Val(), TAC::Val(), TAC::Val() };
+                std::string ik;
+                r.begin_object();
+                while (r.next_key(ik)) {
+                    if (ik == "op")
+                        i.op = TAC::Op(lookup(r, tac_op_names, "TAC op"));
+                    else if (ik == "type")
+                        i.type = TAC::Type(lookup(r, type_names, "type"));
+                    else if (ik == "dst")
+                        i.dst = read_tac_operand(r, vals);
+                    else if (ik == "a")
+                        i.a = read_tac_operand(r, vals);
+                    else if (ik == "b")
+                        i.b = read_tac_operand(r, vals);
+                    else
+                        r.skip();
+                }
+                a.tac.push_back(i);
+            }
+        } else
+            r.skip();
+    }
+
+    // the TAC read fits the values and strings read, as it must to be
+    // lowered
+    void check_tac(Json::Reader& r, AST::FuncDefn const& a, RTL::Context const& strings)
+    {
+        if (!TAC::well_formed(a.tac, a.ctx.vals, strings))
+            r.fail("function " + a.func->name.str() + " has an operand of a kind its slot does not take, or a var, call or string it has not");
+    }
+
+    RTL::Operand read_rtl_operand(Json::Reader& r, RTL::Kind kind, RTL::Code& rtl)
+    {
+        switch (kind) {
+        case RTL::Kind::REG:
+            if (r.get_null())
+                r.fail("expected a register, not null");
+            return RTL::Operand(RegId(lookup(r, reg_names, "register")));
+        case RTL::Kind::MEM: {
+            VarName n = VarName::temp(0);
+            bool is_global = false;
+            ssize_t fp_offset = 0;
+            std::string k;
+            r.begin_object();
+            while (r.next_key(k)) {
+                if (read_var_name(r, k, n))
+                    continue;
+                if (k == "global")
+                    is_global = r.get_bool();
+                else if (k == "fp_offset")
+                    fp_offset = r.get_int();
+                else
+                    r.skip();
+            }
+            return rtl.mem(n, is_global, fp_offset);
+        }
+        case RTL::Kind::INT:
+            return RTL::Operand::of_int(r.get_uint());
+        case RTL::Kind::FLOAT:
+            return RTL::Operand::of_float(r.get_double());
+        case RTL::Kind::LABEL:
+            return RTL::Operand(LabelId{ (uint32_t)r.get_uint() });
+        case RTL::Kind::FUNC:
+            return RTL::Operand(Ident(r.get_string()));
+        default:
+            return RTL::Operand();
+        }
+    }
+
+    void read_rtl(Json::Reader& r, std::string const& k, AST::FuncDefn& a)
+    {
+        if (k != "code") {
+            r.skip();
+            return;
+        }
+        r.begin_array();
+        while (r.next_elem()) {
+            r.begin_array();
+            if (!r.next_elem())
+                r.fail("RTL statement without an op");
+            RTL::Stmt s{ RTL::Op(lookup(r, rtl_op_names, "RTL op")), {}, {}, {} };
+            RTL::Operand* ops[] = { &s.x, &s.y, &s.z };
+            for (size_t n = 0; n < 3 && RTL::desc(s.op).kinds[n] != RTL::Kind::NONE; ++n) {
+                if (!r.next_elem())
+                    r.fail(std::string("too few operands for ") + rtl_op_names[(size_t)s.op]);
+                *ops[n] = read_rtl_operand(r, RTL::desc(s.op).kinds[n], a.rtl);
+            }
+            if (r.next_elem())
+                r.fail(std::string("too many operands for ") + rtl_op_names[(size_t)s.op]);
+            a.rtl.stmts.push_back(s);
+        }
+    }
+
+    void read_global(Json::Reader& r, Stage stage, AST::Builder& b, std::vector<Symbol const*>& global_vars, std::vector<Snapshot::Global>& globals, std::unordered_map<Ident, Symbol const*>& names)
+    {
+        std::string name, k;
+        SemType const* semtype = nullptr;
+        TAC::Type type = TAC::Type::INT;
+        bool is_const = false;
+        r.begin_object();
+        while (r.next_key(k)) {
+            if (k == "name")
+                name = r.get_string();
+            else if (k == "type" && stage == Stage::AST)
+                semtype = SemType::from_json(r);
+            else if (k == "type")
+                type = TAC::Type(lookup(r, type_names, "type"));
+            else if (k == "const")
+                is_const = r.get_bool();
+            else
+                r.skip();
+        }
+        if (name.empty())
+            r.fail("global without a name");
+        if (stage != Stage::AST) {
+            globals.push_back(Snapshot::Global{ Ident(name), type });
+            return;
+        }
+        if (semtype == nullptr || semtype->is_void() || semtype->is_func())
+            r.fail("bad global " + name);
+        Symbol* s = b.make<Symbol>(Ident(name), semtype, is_const);
+        s->is_global = true;
+        if (!names.emplace(s->name, s).second)
+            r.fail("Symbol " + name + " redeclared");
+        global_vars.push_back(s);
+    }
+}
+
+void JsonDump::load(IO::Input const& in, std::string const& name, Stage stage, AST::Builder& b, RTL::Context& strings, std::vector<Symbol const*>& global_vars, std::vector<Snapshot::Global>& globals)
+{
+    Json::Reader r(in.get_data(), in.get_size(), name);
+    // the globals and functions named so far, for the AST
+    std::unordered_map<Ident, Symbol const*> names;
+    bool stage_seen = false;
+    std::string k;
+    r.begin_object();
+    while (r.next_key(k)) {
+        if (k == "sclp") {
+            if (r.get_string() != stage_names[(size_t)stage])
+                sclp_error(0, name + " is not a JSON dump of the stage asked for");
+            stage_seen = true;
+        } else if (k == "version") {
+            uint64_t v = r.get_uint();
+            if (v != VERSION)
+                sclp_error(0, "JSON dump " + name + " is of version " + std::to_string(v) + "; this sclp reads version " + std::to_string(VERSION));
+        } else if (k == "strings") {
+            r.begin_array();
+            while (r.next_elem())
+                strings.add_string(r.get_string());
+        } else if (k == "globals") {
+            r.begin_array();
+            while (r.next_elem())
+                read_global(r, stage, b, global_vars, globals, names);
+        } else if (k == "functions") {
+            // how to read them depends on the stage
+            if (!stage_seen)
+                r.fail("\"sclp\" should come before the functions");
+            r.begin_array();
+            while (r.next_elem()) {
+                if (stage == Stage::AST) {
+                    AST::read_json_func(r, b, names);
+                    continue;
+                }
+                Symbol* f = b.make<Symbol>(Ident::none(), nullptr);
+                AST::FuncDefn& a = b.funcs.emplace_back(f);
+                std::string fk;
+                r.begin_object();
+                while (r.next_key(fk)) {
+                    if (fk == "name")
+                        f->name = Ident(r.get_string());
+                    else if (fk == "frame_size")
+                        a.stackframe_size = r.get_uint();
+                    else if (stage == Stage::TAC)
+                        read_tac(r, fk, a);
+                    else
+                        read_rtl(r, fk, a);
+                }
+                if (stage == Stage::TAC)
+                    check_tac(r, a, strings);
+            }
+        } else
+            r.skip();
+    }
+    r.end();
+    if (!stage_seen)
+        sclp_error(0, name + " is not a JSON dump of the stage asked for");
+}
@@ -0,0 +1,50 @@
+#ifndef JSON_DUMP_H
+#define JSON_DUMP_H
+
+#include <ast.h>
+#include <io.h>
+#include <json.h>
+#include <opt.h>
+#include <rtl.h>
+#include <snapshot.h>
+#include <sym.h>
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The AST, TAC or RTL of a file as one JSON object, for tools to take apart
+// and for --read-json-* to compile on from:
+//
+//   {"sclp": "ast" | "tac" | "rtl", "version": 1,
+//    "strings": [the string literals, numbered as the scanner met them],
+//    "globals": [{"name", "type", ...}],
+//    "functions": [one object per function, one per line]}
+//
+// Functions are written as they are handed over and read one at a time off
+// the mapped file, so a dump of any size goes through with no memory to
+// spare besides the IR of the functions held. The TAC and RTL are taken after labels are numbered
+// program-wide.
+namespace JsonDump {
+    class Writer {
+        std::ostream& out;
+        Json::Writer w;
+        Stage stage;
+
+    public:
+        // starts the document, stage being that of the IR handed over;
+        // globals with an AST are global_vars, else globals
+        Writer(std::ostream& out, Stage stage, RTL::Context const& strings, std::vector<Symbol const*> const& global_vars, std::vector<Snapshot::Global> const& globals);
+
+        void add_func(AST::FuncDefn const& a);
+        void finish();
+    };
+
+    // Reads the dump of stage held in in into b.funcs and strings, and its
+    // globals into global_vars for the AST, else into globals. name is that
+    // of the file, for errors.
+    void load(IO::Input const& in, std::string const& name, Stage stage, AST::Builder& b, RTL::Context& strings, std::vector<Symbol const*>& global_vars, std::vector<Snapshot::Global>& globals);
+}
+
+#endif // JSON_DUMP_H
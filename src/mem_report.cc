@@ -0,0 +1,130 @@
+#include <mem_report.h>
+#include <timing.h>
+#include <types.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <malloc.h>
+#include <new>
+#include <sys/resource.h>
+
+namespace {
+    bool counting = false;
+
+    // per phase, and for Phase::Nr outside any; bytes are as malloc has
+    // them, rounded up
+    struct PhaseStats {
+        std::atomic<uint64_t> allocs, frees, bytes, freed;
+        // of the live bytes of the process, while a thread was in the phase
+        std::atomic<int64_t> peak;
+    };
+    PhaseStats stats[(size_t)Timing::Phase::Nr + 1];
+    std::atomic<int64_t> live, peak_live;
+    std::atomic<uint64_t> objects[(size_t)MemReport::Object::Nr];
+
+    void raise(std::atomic<int64_t>& peak, int64_t v)
+    {
+        int64_t p = peak.load(std::memory_order_relaxed);
+        while (v > p && !peak.compare_exchange_weak(p, v, std::memory_order_relaxed));
+    }
+
+    void note_alloc(void* p)
+    {
+        PhaseStats& s = stats[(size_t)Timing::current];
+        uint64_t n = malloc_usable_size(p);
+        s.allocs.fetch_add(1, std::memory_order_relaxed);
+        s.bytes.fetch_add(n, std::memory_order_relaxed);
+        int64_t l = live.fetch_add(n, std::memory_order_relaxed) + n;
+        raise(s.peak, l);
+        raise(peak_live, l);
+    }
+    void note_free(void* p)
+    {
+        PhaseStats& s = stats[(size_t)Timing::current];
+        uint64_t n = malloc_usable_size(p);
+        s.frees.fetch_add(1, std::memory_order_relaxed);
+        s.freed.fetch_add(n, std::memory_order_relaxed);
+        live.fetch_sub(n, std::memory_order_relaxed);
+    }
+
+    double mib(double bytes)
+    {
+        return bytes / (1 << 20);
+    }
+}
+
+void* operator new(size_t n)
+{
+    for (;;) {
+        void* p = std::malloc(n > 0 ? n : 1);
+        if (p != nullptr) {
+            if (counting)
+                note_alloc(p);
+            return p;
+        }
+        std::new_handler h = std::get_new_handler();
+        if (h == nullptr)
+            throw std::bad_alloc();
+        h();
+    }
+}
+void operator delete(void* p) noexcept
+{
+    if (p != nullptr && counting)
+        note_free(p);
+    std::free(p);
+}
+void operator delete(void* p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+void MemReport::start()
+{
+    counting = true;
+    Timing::tracking = true;
+}
+bool MemReport::started()
+{
+    return counting;
+}
+
+void MemReport::count(Object o, size_t n)
+{
+    objects[(size_t)o].fetch_add(n, std::memory_order_relaxed);
+}
+
+void MemReport::report(std::ostream& o)
+{
+    static char const* const object_names[] = { "AST arena objects", "AST arena bytes", "TAC instructions", "RTL statements", "ASM instructions", "string literals" };
+    static_assert(sizeof(object_names) / sizeof(object_names[0]) == (size_t)Object::Nr, "a name for each object");
+
+    std::ios::fmtflags flags = o.flags();
+    std::streamsize precision = o.precision();
+    o << std::fixed << std::setprecision(3);
+
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    o << "Memory report: peak heap " << mib(peak_live.load()) << " MiB, peak RSS " << ru.ru_maxrss / 1024.0 << " MiB\n";
+    o << "  " << std::left << std::setw(8) << "phase" << std::right << std::setw(12) << "allocs" << std::setw(12) << "frees" << std::setw(12) << "alloc MiB" << std::setw(12) << "freed MiB" << std::setw(12) << "peak MiB" << "\n";
+    for (size_t p = 0; p <= (size_t)Timing::Phase::Nr; ++p) {
+        PhaseStats const& s = stats[p];
+        if (s.allocs == 0 && s.frees == 0)
+            continue;
+        o << "  " << std::left << std::setw(8) << (p == (size_t)Timing::Phase::Nr ? "other" : Timing::name(Timing::Phase(p))) << std::right;
+        o << std::setw(12) << s.allocs.load() << std::setw(12) << s.frees.load() << std::setw(12) << mib(s.bytes.load()) << std::setw(12) << mib(s.freed.load()) << std::setw(12) << mib(s.peak.load()) << "\n";
+    }
+
+    size_t ptrs, arrays, funcs;
+    SemType::count_derived(ptrs, arrays, funcs);
+    o << "  made over the run:\n";
+    for (size_t k = 0; k < (size_t)Object::Nr; ++k)
+        o << "  " << std::left << std::setw(20) << object_names[k] << std::right << std::setw(12) << objects[k].load() << "\n";
+    o << "  " << std::left << std::setw(20) << "pointer types" << std::right << std::setw(12) << ptrs << "\n";
+    o << "  " << std::left << std::setw(20) << "array types" << std::right << std::setw(12) << arrays << "\n";
+    o << "  " << std::left << std::setw(20) << "function types" << std::right << std::setw(12) << funcs << "\n";
+    o.flags(flags);
+    o.precision(precision);
+}
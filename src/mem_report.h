@@ -0,0 +1,27 @@
+#ifndef MEM_REPORT_H
+#define MEM_REPORT_H
+
+#include <cstddef>
+#include <iostream>
+
+// Where the heap goes, for --mem-report. Once started, the global operator
+// new and delete count every allocation against the phase the thread making
+// it is in, as Timing::Scope marks it, and follow the bytes live in the
+// whole process. The driver adds up the IR it builds. Before start() the
+// operators cost a test of a flag.
+namespace MemReport {
+    // IR made over the run, summed over files
+    enum class Object {
+        AST_OBJECTS, AST_ARENA_BYTES, TAC_INSTRS, RTL_STMTS, ASM_INSTRS, STRINGS, Nr
+    };
+
+    // before any thread is started; blocks allocated before are counted
+    // when freed all the same, which puts the live bytes off by as much
+    void start();
+    bool started();
+    void count(Object o, size_t n);
+    // by phase, then the IR, the types made and the peaks of the process
+    void report(std::ostream& o);
+}
+
+#endif // MEM_REPORT_H
@@ -0,0 +1,72 @@
+#ifndef NAMES_H
+#define NAMES_H
+
+#include <cstdint>
+#include <ident.h>
+#include <iostream>
+
+// Name of a variable slot in TAC and RTL: a source symbol, or a temporary
+// numbered within its function. Temporaries are only spelled out when printed.
+struct VarName {
+    enum class Kind : uint8_t {
+        SYM, TEMP, STEMP
+    } kind;
+    uint32_t num;
+    Ident sym;
+
+    static constexpr char const* temp_prefix = "temp";
+    static constexpr char const* stemp_prefix = "stemp";
+
+    static VarName of_sym(Ident sym)
+    {
+        return VarName{ Kind::SYM, 0, sym };
+    }
+    static VarName temp(uint32_t num)
+    {
+        return VarName{ Kind::TEMP, num, Ident::none() };
+    }
+    static VarName stemp(uint32_t num)
+    {
+        return VarName{ Kind::STEMP, num, Ident::none() };
+    }
+};
+inline std::ostream& operator<<(std::ostream& o, VarName n)
+{
+    switch (n.kind) {
+    case VarName::Kind::TEMP:
+        return o << VarName::temp_prefix << n.num;
+    case VarName::Kind::STEMP:
+        return o << VarName::stemp_prefix << n.num;
+    default:
+        return o << n.sym;
+    }
+}
+
+// Jump target, numbered across the whole program
+struct LabelId {
+    uint32_t num;
+};
+inline std::ostream& operator<<(std::ostream& o, LabelId l)
+{
+    return o << "Label" << l.num;
+}
+
+// Labels are numbered within their function while it is lowered, so that
+// functions can be lowered in any order, and mapped to their program-wide
+// numbers before being written out. The parser numbers the return label of
+// a void function up front; that one is local label 0 and keeps its number.
+// The rest follow those of the functions before.
+struct LabelMap {
+    uint32_t base;
+    bool has_parse_label;
+    uint32_t parse_label;
+
+    LabelId operator()(LabelId l) const
+    {
+        if (has_parse_label)
+            return LabelId{ l.num == 0 ? parse_label : base + l.num - 1 };
+        return LabelId{ base + l.num };
+    }
+};
+
+#endif // NAMES_H
@@ -1,10 +1,11 @@
 #include <argp.h>
 #include <cstdio>
+#include <cstdlib>
 #include <error.h>
 #include <opt.h>
 #include <iomanip>
 #include <iostream>
-#include <fstream>
+#include <algorithm>
 
 /*
       --sa-scan              Stop after scanning
@@ -28,10 +29,37 @@
                              suppressed only if a valid `sa-...' option is
                              given to stop the compilation after some earlier
                              phase.
-      --show-json-ast        Show the Abstract Syntax Tree in JSON format
-      --show-json-tac        Show the Three Address Code in JSON format
+      --emit=FORMAT          Emit the program as asm, the SPIM assembly in
+                             FILE.spim (default), or as bin, a MIPS32 ELF
+                             executable in FILE.bin
+      --stream               Lower, write out and free one function at a time,
+                             emitting .data at the end of FILE.spim
+  -j, --jobs=N               Compile on N threads, lowering the functions of a
+                             single FILE or several FILEs side by side; the
+                             output does not depend on N
+      --pipeline             Lower each function while the rest of FILE is
+                             still being parsed; the output is written once
+                             parsing ends
+      --cache-dir=DIR        Keep compiled files in DIR by a hash of their
+                             source, the options and the compiler, and copy
+                             the outputs from there when they come up again;
+                             likewise the assembly of each function
+      --server=SOCKET        Serve compile requests from --client on the
+                             Unix-domain socket SOCKET, keeping warm state
+                             between them, until killed
+      --client=SOCKET        Have the server on SOCKET compile FILE..., as if
+                             this process had
+      --dump-ir=STAGE        Write a binary snapshot of the IR of STAGE, tac or
+                             rtl, to FILE.ir
+      --load-ir=STAGE        Take each FILE to be a snapshot of the IR of
+                             STAGE, written by --dump-ir, and compile on from
+                             there
+      --show-json-ast        Show the Abstract Syntax Tree in JSON format in
+                             FILE.ast.json (or out.ast.json)
+      --show-json-tac        Show the Three Address Code in JSON format in
+                             FILE.tac.json (or out.tac.json)
       --show-json-rtl        Show the Register Transfer Language code in JSON
-                             format
+                             format in FILE.rtl.json (or out.rtl.json)
       --read-json-ast        Use the input file (in JSON format) to generate
                              the AST and skip all the phases from scanning to
                              parsing
@@ -41,6 +69,14 @@
       --read-json-rtl        Use the input file (in JSON format) to generate
                              the RTL code and skip all the phases from scanning
                              to RTL generation
+      --stats                Write counters of the code generated for each
+                             function to FILE.stats (or out.stats)
+      --time-report          Report on stderr the time each phase took for each
+                             FILE, and for its slowest functions
+      --time-trace=TRACE     Write the time of each phase of each FILE and
+                             function to TRACE as Chrome trace events
+      --mem-report           Report on stderr the heap allocated in each
+                             phase, the IR made and the peak memory of the run
   -d, --demo                 Demo version. Use stdout for the output instead of
                              files
       --gen-temp-symb-table  Populate Symbol Table For Temporaries
@@ -51,7 +87,7 @@
 */
 static char const* doc = "Sclp - A language processor for C-like language";
 char const* argp_program_version = "Sclp Version: A1";
-static char const* args_doc = "FILE";
+static char const* args_doc = "FILE...";
 static struct argp_option options[] = {
     { "sa-scan", 1, NULL, 0, "Stop after scanning" },
     { "sa-parse", 2, NULL, 0, "Stop after parsing" },
@@ -64,12 +100,25 @@ static struct argp_option options[] = {
     { "show-rtl", 9, NULL, 0, "Show the Register Transfer Language code in FILE.rtl (or out.rtl)" },
     { "show-symtab", 10, NULL, 0, "Show the symbol table after RTL construction (when offsets are allocated) in FILE.sym, (or out.sym)" },
     { "show-asm", 11, NULL, 0, "Generate the assembly program in FILE.spim (or out.spim). This is the default action and is suppressed only if a valid `sa-...' option is given to stop the compilation after some earlier phase." },
-    { "show-json-ast", 12, NULL, 0, "Show the Abstract Syntax Tree in JSON format" },
-    { "show-json-tac", 13, NULL, 0, "Show the Three Address Code in JSON format" },
-    { "show-json-rtl", 14, NULL, 0, "Show the Register Transfer Language code in JSON format" },
+    { "emit", 19, "FORMAT", 0, "Emit the program as asm, the SPIM assembly in FILE.spim (default), or as bin, a MIPS32 ELF executable in FILE.bin" },
+    { "stream", 20, NULL, 0, "Lower, write out and free one function at a time, emitting .data at the end of FILE.spim" },
+    { "jobs", 'j', "N", 0, "Compile on N threads, lowering the functions of a single FILE or several FILEs side by side; the output does not depend on N" },
+    { "pipeline", 21, NULL, 0, "Lower each function while the rest of FILE is still being parsed; the output is written once parsing ends" },
+    { "cache-dir", 24, "DIR", 0, "Keep compiled files in DIR by a hash of their source, the options and the compiler, and copy the outputs from there when they come up again; likewise the assembly of each function" },
+    { "server", 22, "SOCKET", 0, "Serve compile requests from --client on the Unix-domain socket SOCKET, keeping warm state between them, until killed" },
+    { "client", 23, "SOCKET", 0, "Have the server on SOCKET compile FILE..., as if this process had" },
+    { "dump-ir", 25, "STAGE", 0, "Write a binary snapshot of the IR of STAGE, tac or rtl, to FILE.ir" },
+    { "load-ir", 26, "STAGE", 0, "Take each FILE to be a snapshot of the IR of STAGE, written by --dump-ir, and compile on from there" },
+    { "show-json-ast", 12, NULL, 0, "Show the Abstract Syntax Tree in JSON format in FILE.ast.json (or out.ast.json)" },
+    { "show-json-tac", 13, NULL, 0, "Show the Three Address Code in JSON format in FILE.tac.json (or out.tac.json)" },
+    { "show-json-rtl", 14, NULL, 0, "Show the Register Transfer Language code in JSON format in FILE.rtl.json (or out.rtl.json)" },
     { "read-json-ast", 15, NULL, 0, "Use the input file (in JSON format) to generate the AST and skip all the phases from scanning to parsing" },
     { "read-json-tac", 16, NULL, 0, "Use the input file (in JSON format) to generate the TAC and skip all the phases from scanning to TAC generation" },
     { "read-json-rtl", 17, NULL, 0, "Use the input file (in JSON format) to generate the RTL code and skip all the phases from scanning to RTL generation" },
+    { "stats", 30, NULL, 0, "Write counters of the code generated for each function to FILE.stats (or out.stats)" },
+    { "time-report", 27, NULL, 0, "Report on stderr the time each phase took for each FILE, and for its slowest functions" },
+    { "time-trace", 28, "TRACE", 0, "Write the time of each phase of each FILE and function to TRACE as Chrome trace events" },
+    { "mem-report", 29, NULL, 0, "Report on stderr the heap allocated in each phase, the IR made and the peak memory of the run" },
     { "demo", 'd', NULL, 0, "Demo version. Use stdout for the output instead of files" },
     { "gen-temp-symb-table", 18, NULL, 0, "Populate Symbol Table For Temporaries" },
     { "single-stmt-bb", 'e', NULL, 0, "Flag to construct single statement basic blocks" },
@@ -77,12 +126,37 @@ static struct argp_option options[] = {
 };
 
 struct Args {
-    std::string input_filename;
+    std::vector<std::string> input_filenames;
     Stage stage = Stage::ASM;
     bool show_tokens = false, show_ast = false, show_tac = false, show_rtl = false, show_asm = true;
+    bool show_json_ast = false, show_json_tac = false, show_json_rtl = false;
+    bool emit_bin = false;
+    bool stream = false;
+    size_t jobs = 1;
+    bool pipeline = false;
     bool demo = false;
+    std::string cache_dir;
+    std::string server_socket, client_socket;
+    std::optional<Stage> dump_ir, load_ir, read_json;
+    bool stats = false;
+    bool time_report = false;
+    std::string time_trace;
+    bool mem_report = false;
+    // reported once the command line has been read
+    std::string unsupported;
 };
 
+// the stages whose IR can be snapshot
+static Stage ir_stage(char const* arg, struct argp_state* state)
+{
+    if (std::string(arg) == "tac")
+        return Stage::TAC;
+    if (std::string(arg) == "rtl")
+        return Stage::RTL;
+    argp_error(state, "unknown IR stage '%s'", arg);
+    return Stage::TAC;
+}
+
 static error_t parse_opt(int key, char* arg, struct argp_state* state)
 {
     Args* args = static_cast<Args*>(state->input);
@@ -107,15 +181,29 @@ static error_t parse_opt(int key, char* arg, struct argp_state* state)
                 args->stage = Stage::RTL;
             break;
         case 12:
+            args->show_json_ast = true;
+            break;
         case 13:
+            args->show_json_tac = true;
+            break;
         case 14:
+            args->show_json_rtl = true;
+            break;
         case 15:
         case 16:
         case 17:
-            sclp_error(0, "The JSON related options are not supported.");
+            {
+                Stage s = (key == 15 ? Stage::AST : key == 16 ? Stage::TAC : Stage::RTL);
+                if (args->read_json && *args->read_json != s)
+                    argp_error(state, "only one --read-json-* option can be given");
+                args->read_json = s;
+            }
+            break;
         case 10:
         case 18:
-            sclp_error(0, "The symtab related options are not supported.");
+            if (args->unsupported.empty())
+                args->unsupported = "The symtab related options are not supported.";
+            break;
         case 6:
             args->show_tokens = true;
             break;
@@ -131,16 +219,92 @@ static error_t parse_opt(int key, char* arg, struct argp_state* state)
         case 11:
             args->show_asm = true;
             break;
+        case 19:
+            if (std::string(arg) == "bin")
+                args->emit_bin = true;
+            else if (std::string(arg) == "asm")
+                args->emit_bin = false;
+            else
+                argp_error(state, "unknown output format '%s'", arg);
+            break;
+        case 20:
+            args->stream = true;
+            break;
+        case 'j':
+            {
+                char* end;
+                unsigned long n = strtoul(arg, &end, 10);
+                if (*arg == '\0' || *end != '\0' || n == 0)
+                    argp_error(state, "bad number of jobs '%s'", arg);
+                args->jobs = n;
+            }
+            break;
+        case 21:
+            args->pipeline = true;
+            break;
+        case 24:
+            args->cache_dir = arg;
+            break;
+        case 22:
+            args->server_socket = arg;
+            break;
+        case 23:
+            args->client_socket = arg;
+            break;
+        case 25:
+            args->dump_ir = ir_stage(arg, state);
+            break;
+        case 26:
+            args->load_ir = ir_stage(arg, state);
+            break;
+        case 30:
+            args->stats = true;
+            break;
+        case 27:
+            args->time_report = true;
+            break;
+        case 28:
+            args->time_trace = arg;
+            break;
+        case 29:
+            args->mem_report = true;
+            break;
         case 'd':
             args->demo = true;
             break;
         case ARGP_KEY_ARG:
-            if (state->arg_num >= 2)
-                argp_usage(state);
-            args->input_filename = std::string(arg);
+            args->input_filenames.push_back(std::string(arg));
             break;
         case ARGP_KEY_END:
-            if (state->arg_num < 1)
+            if (!args->server_socket.empty() && !args->client_socket.empty())
+                argp_error(state, "--server and --client do not go together");
+            if (args->mem_report && (!args->server_socket.empty() || !args->client_socket.empty()))
+                argp_error(state, "--mem-report is for a one-shot run, not a server or client");
+            {
+                size_t nr_stdin = std::count(args->input_filenames.begin(), args->input_filenames.end(), "-");
+                if (nr_stdin > 1)
+                    argp_error(state, "stdin can only be read once");
+                if (nr_stdin > 0 && !args->client_socket.empty())
+                    argp_error(state, "stdin cannot be sent to a server");
+            }
+            if (args->dump_ir && args->stage < *args->dump_ir)
+                argp_error(state, "--dump-ir asks for a stage the compilation stops before");
+            if (args->load_ir && args->read_json)
+                argp_error(state, "--load-ir and --read-json-* do not go together");
+            if (args->load_ir || args->read_json) {
+                Stage input = (args->load_ir ? *args->load_ir : *args->read_json);
+                char const* opt = (args->load_ir ? "--load-ir" : "--read-json-*");
+                if (args->stage < input)
+                    argp_error(state, "%s asks for a stage the compilation stops before", opt);
+                if (args->dump_ir && *args->dump_ir < input)
+                    argp_error(state, "--dump-ir asks for a stage before the one loaded");
+                if (args->show_tokens || ((args->show_ast || args->show_json_ast) && input > Stage::AST) || ((args->show_tac || args->show_json_tac) && input > Stage::TAC))
+                    argp_error(state, "%s leaves nothing to show for stages before the one loaded", opt);
+                // there is no parsing to overlap with
+                args->pipeline = false;
+            }
+            // a server takes its files from its clients
+            if (state->arg_num < 1 && args->server_socket.empty())
                 argp_usage(state);
             break;
         default:
@@ -149,77 +313,160 @@ static error_t parse_opt(int key, char* arg, struct argp_state* state)
     return 0;
 }
 
-// see https://stackoverflow.com/a/11826666/18230146
-class NullBuffer : public std::streambuf {
-    static NullBuffer singleton;
-
-public:
-    static NullBuffer* get()
-    {
-        return &singleton;
-    }
-    int overflow(int c) override
-    {
-        return c;
-    }
-};
-NullBuffer NullBuffer::singleton;
-
 Options::Options(int argc, char** argv)
 {
     Args args;
     struct argp a = { options, parse_opt, args_doc, doc };
     argp_parse(&a, argc, argv, 0, 0, &args);
 
-    input_filename = args.input_filename;
+    if (!args.unsupported.empty())
+        sclp_error(0, args.unsupported);
+
+    input_filenames = args.input_filenames;
     stage = args.stage;
-    input = fopen(args.input_filename.c_str(), "r");
+    stream = args.stream;
+    jobs = args.jobs;
+    pipeline = args.pipeline;
+    show_tokens = args.show_tokens;
+    show_ast = args.show_ast;
+    show_tac = args.show_tac;
+    show_rtl = args.show_rtl;
+    show_asm = args.show_asm;
+    show_json_ast = args.show_json_ast;
+    show_json_tac = args.show_json_tac;
+    show_json_rtl = args.show_json_rtl;
+    emit_bin = args.emit_bin;
+    demo = args.demo;
+    cache_dir = args.cache_dir;
+    server_socket = args.server_socket;
+    client_socket = args.client_socket;
+    dump_ir = args.dump_ir;
+    load_ir = args.load_ir;
+    read_json = args.read_json;
+    stats = args.stats;
+    time_report = args.time_report;
+    time_trace = args.time_trace;
+    mem_report = args.mem_report;
+}
 
-    if (input == NULL)
+Files::Files(Options const& options, std::string const& input_filename, std::string const& dir, std::ostream& demo_output)
+    : input_filename(input_filename), path(resolve(input_filename, dir)), demo_output(&demo_output)
+{
+    if (!input.open(path))
         sclp_error(0, std::string("Unable to open file ") + input_filename);
+    bool demo = (options.demo || input_filename == "-");
+
+    if (options.show_tokens && options.stage >= Stage::TOKEN) {
+        if (demo)
+            token_output = &demo_output;
+        else {
+            token_output = new IO::Output(path + ".toks");
+            written.push_back("toks");
+        }
+    } else
+        token_output = nullptr;
+
+    if (options.show_ast && options.stage >= Stage::AST) {
+        if (demo)
+            ast_output = &demo_output;
+        else {
+            ast_output = new IO::Output(path + ".ast");
+            written.push_back("ast");
+        }
+    } else
+        ast_output = nullptr;
+
+    if (options.show_tac && options.stage >= Stage::TAC) {
+        if (demo)
+            tac_output = &demo_output;
+        else {
+            tac_output = new IO::Output(path + ".tac");
+            written.push_back("tac");
+        }
+    } else
+        tac_output = nullptr;
+
+    if (options.show_rtl && options.stage >= Stage::RTL) {
+        if (demo)
+            rtl_output = &demo_output;
+        else {
+            rtl_output = new IO::Output(path + ".rtl");
+            written.push_back("rtl");
+        }
+    } else
+        rtl_output = nullptr;
+
+    if (options.emit_bin && options.stage == Stage::ASM) {
+        if (demo)
+            bin_output = &demo_output;
+        else {
+            bin_output = new IO::Output(path + ".bin");
+            written.push_back("bin");
+        }
+    } else
+        bin_output = nullptr;
+
+    if (options.show_asm && !options.emit_bin && options.stage == Stage::ASM) {
+        if (demo)
+            asm_output = &demo_output;
+        else {
+            asm_output = new IO::Output(path + ".spim");
+            written.push_back("spim");
+        }
+    } else
+        asm_output = nullptr;
 
-    if (args.show_tokens && stage >= Stage::TOKEN) {
-        if (args.demo)
-            token_output = &std::cout;
-        else
-            token_output = new std::ofstream((args.input_filename + ".toks").c_str());
+    if (options.dump_ir) {
+        if (demo)
+            ir_output = &demo_output;
+        else {
+            ir_output = new IO::Output(path + ".ir");
+            written.push_back("ir");
+        }
     } else
-        token_output = new std::ostream(NullBuffer::get());
+        ir_output = nullptr;
 
-    if (args.show_ast && stage >= Stage::AST) {
-        if (args.demo)
-            ast_output = &std::cout;
-        else
-            ast_output = new std::ofstream((args.input_filename + ".ast").c_str());
+    if (options.show_json_ast && options.stage >= Stage::AST) {
+        if (demo)
+            json_ast_output = &demo_output;
+        else {
+            json_ast_output = new IO::Output(path + ".ast.json");
+            written.push_back("ast.json");
+        }
     } else
-        ast_output = new std::ostream(NullBuffer::get());
+        json_ast_output = nullptr;
 
-    if (args.show_tac && stage >= Stage::TAC) {
-        if (args.demo)
-            tac_output = &std::cout;
-        else
-            tac_output = new std::ofstream((args.input_filename + ".tac").c_str());
+    if (options.show_json_tac && options.stage >= Stage::TAC) {
+        if (demo)
+            json_tac_output = &demo_output;
+        else {
+            json_tac_output = new IO::Output(path + ".tac.json");
+            written.push_back("tac.json");
+        }
     } else
-        tac_output = new std::ostream(NullBuffer::get());
+        json_tac_output = nullptr;
 
-    if (args.show_rtl && stage >= Stage::RTL) {
-        if (args.demo)
-            rtl_output = &std::cout;
-        else
-            rtl_output = new std::ofstream((args.input_filename + ".rtl").c_str());
+    if (options.show_json_rtl && options.stage >= Stage::RTL) {
+        if (demo)
+            json_rtl_output = &demo_output;
+        else {
+            json_rtl_output = new IO::Output(path + ".rtl.json");
+            written.push_back("rtl.json");
+        }
     } else
-        rtl_output = new std::ostream(NullBuffer::get());
+        json_rtl_output = nullptr;
 
-    if (args.show_asm && stage == Stage::ASM) {
-        if (args.demo)
-            asm_output = &std::cout;
-        else
-            asm_output = new std::ofstream((args.input_filename + ".spim").c_str());
+    if (options.stats && options.stage >= Stage::TAC) {
+        if (demo)
+            stats_output = &demo_output;
+        else {
+            stats_output = new IO::Output(path + ".stats");
+            written.push_back("stats");
+        }
     } else
-        asm_output = new std::ostream(NullBuffer::get());
+        stats_output = nullptr;
 
-    (*ast_output) << std::fixed << std::showpoint << std::setprecision(2);
-    (*tac_output) << std::fixed << std::showpoint << std::setprecision(2);
-    (*rtl_output) << std::fixed << std::showpoint << std::setprecision(2);
-    (*asm_output) << std::fixed << std::showpoint << std::setprecision(2);
+    for (std::ostream* o : { ast_output, tac_output, rtl_output, asm_output })
+        if (o != nullptr)
+            (*o) << std::fixed << std::showpoint << std::setprecision(2);
 }
@@ -1,80 +1,200 @@
 #ifndef OPT_H
 #define OPT_H
 
+#include <io.h>
+
 #include <string>
-#include <cstdio>
 #include <iostream>
+#include <optional>
+#include <vector>
 
 enum class Stage {
     TOKEN, PARSE, AST, TAC, RTL, ASM
 };
+// The command line; applies to every input file
 struct Options {
-    FILE* input;
-    std::string input_filename;
+    std::vector<std::string> input_filenames;
 
     Stage stage;
+    // lower, write out and free one function at a time
+    bool stream;
+    // threads running the back end
+    size_t jobs;
+    // lower functions while the parser is still going
+    bool pipeline;
+    bool show_tokens, show_ast, show_tac, show_rtl, show_asm;
+    bool show_json_ast, show_json_tac, show_json_rtl;
+    bool emit_bin;
+    // everything goes to stdout
+    bool demo;
+    // where compiled files are kept by the hash of their inputs; empty for
+    // no cache
+    std::string cache_dir;
+    // the Unix-domain socket to serve compile requests on, or to send this
+    // one to; empty to compile in this process
+    std::string server_socket;
+    std::string client_socket;
+    // the stage whose IR is written to FILE.ir, if any, and the one whose IR
+    // each FILE is a snapshot of, if any (TAC or RTL)
+    std::optional<Stage> dump_ir, load_ir;
+    // the stage whose JSON dump each FILE is, if any (AST, TAC or RTL)
+    std::optional<Stage> read_json;
+    // counters of the code generated for each function, in FILE.stats
+    bool stats;
+    // time the phases of each file and of its functions, and report that on
+    // stderr, and write it as a Chrome trace to time_trace unless empty
+    bool time_report;
+    std::string time_trace;
+    // report the heap used in each phase, the IR made and the peak memory of
+    // the run on stderr; the counting is process-wide, so not for a server
+    bool mem_report;
+
+    Options()
+        : stage(Stage::AST), stream(false), jobs(1), pipeline(false), show_tokens(false), show_ast(false), show_tac(false), show_rtl(false), show_asm(false), show_json_ast(false), show_json_tac(false), show_json_rtl(false), emit_bin(false), demo(false), cache_dir(""), server_socket(""), client_socket(""), dump_ir(), load_ir(), read_json(), stats(false), time_report(false), time_trace(""), mem_report(false)
+    {
+    }
+    Options(int argc, char** argv);
+
+    // the stage whose IR each FILE holds, if it is not source
+    std::optional<Stage> input_stage() const
+    {
+        return load_ir ? load_ir : read_json;
+    }
+    bool timed() const
+    {
+        return time_report || !time_trace.empty();
+    }
+    // whether the RTL of each function is shown, dumped or counted, so is
+    // built even where the cache has the function's assembly
+    bool needs_rtl() const
+    {
+        return show_rtl || show_json_rtl || dump_ir == Stage::RTL || stats;
+    }
+};
+
+// The input of one compilation and the outputs written for it. An output
+// not asked for is nullptr, so that nothing is formatted for it; FILE "-"
+// is read from stdin and its outputs go where -d sends them.
+struct Files {
+    IO::Input input;
+    std::string input_filename;
+    // input_filename as opened; outputs are named after it
+    std::string path;
+    // the extensions of the outputs written to files, in a fixed order
+    std::vector<std::string> written;
+    // where -d sends everything; not owned
+    std::ostream* demo_output;
+
     std::ostream* token_output;
     std::ostream* ast_output;
     std::ostream* tac_output;
     std::ostream* rtl_output;
     std::ostream* asm_output;
+    // the assembled executable, only with --emit=bin
+    std::ostream* bin_output;
+    // the IR snapshot, only with --dump-ir
+    std::ostream* ir_output;
+    // the JSON dumps, only with --show-json-*
+    std::ostream* json_ast_output;
+    std::ostream* json_tac_output;
+    std::ostream* json_rtl_output;
+    // the counters of --stats
+    std::ostream* stats_output;
 
-    Options()
-        : input(NULL), input_filename(""), stage(Stage::AST), token_output(nullptr), ast_output(nullptr), tac_output(nullptr), rtl_output(nullptr), asm_output(nullptr)
+    Files()
+        : input(), input_filename(""), path(""), demo_output(&std::cout), token_output(nullptr), ast_output(nullptr), tac_output(nullptr), rtl_output(nullptr), asm_output(nullptr), bin_output(nullptr), ir_output(nullptr), json_ast_output(nullptr), json_tac_output(nullptr), json_rtl_output(nullptr), stats_output(nullptr)
     {
     }
-    Options(int argc, char** argv);
+    // name, looked up under dir if relative and dir is given
+    static std::string resolve(std::string const& name, std::string const& dir)
+    {
+        if (dir.empty() || name.empty() || name[0] == '/')
+            return name;
+        return dir + "/" + name;
+    }
+
+    // a relative input_filename is looked up, and its outputs written,
+    // under dir if one is given
+    Files(Options const& options, std::string const& input_filename, std::string const& dir = "", std::ostream& demo_output = std::cout);
 
-    Options(Options const&) = delete;
-    Options(Options&& o)
-        : input(o.input), input_filename(o.input_filename), stage(o.stage), token_output(o.token_output), ast_output(o.ast_output), tac_output(o.tac_output), rtl_output(o.rtl_output), asm_output(o.asm_output)
+    Files(Files const&) = delete;
+    Files(Files&& o)
+        : input(std::move(o.input)), input_filename(o.input_filename), path(o.path), written(o.written), demo_output(o.demo_output), token_output(o.token_output), ast_output(o.ast_output), tac_output(o.tac_output), rtl_output(o.rtl_output), asm_output(o.asm_output), bin_output(o.bin_output), ir_output(o.ir_output), json_ast_output(o.json_ast_output), json_tac_output(o.json_tac_output), json_rtl_output(o.json_rtl_output), stats_output(o.stats_output)
     {
-        o.input = NULL;
-        o.token_output = o.ast_output = o.tac_output = o.rtl_output = o.asm_output = nullptr;
+        o.token_output = o.ast_output = o.tac_output = o.rtl_output = o.asm_output = o.bin_output = o.ir_output = nullptr;
+        o.json_ast_output = o.json_tac_output = o.json_rtl_output = o.stats_output = nullptr;
     }
-    Options& operator=(Options const&) = delete;
-    Options& operator=(Options&& o)
+    Files& operator=(Files const&) = delete;
+    Files& operator=(Files&& o)
     {
-        this->~Options();
-        input = o.input;
+        this->~Files();
+        input = std::move(o.input);
         input_filename = o.input_filename;
-        stage = o.stage;
+        path = o.path;
+        written = o.written;
+        demo_output = o.demo_output;
         token_output = o.token_output;
         ast_output = o.ast_output;
         tac_output = o.tac_output;
         rtl_output = o.rtl_output;
         asm_output = o.asm_output;
+        bin_output = o.bin_output;
+        ir_output = o.ir_output;
+        json_ast_output = o.json_ast_output;
+        json_tac_output = o.json_tac_output;
+        json_rtl_output = o.json_rtl_output;
+        stats_output = o.stats_output;
 
-        o.input = NULL;
-        o.token_output = o.ast_output = o.tac_output = o.rtl_output = o.asm_output = nullptr;
+        o.token_output = o.ast_output = o.tac_output = o.rtl_output = o.asm_output = o.bin_output = o.ir_output = nullptr;
+        o.json_ast_output = o.json_tac_output = o.json_rtl_output = o.stats_output = nullptr;
         return *this;
     }
-    ~Options()
+    ~Files()
     {
-        if (input != NULL) {
-            fclose(input);
-            input = NULL;
-        }
-        if (token_output != nullptr && token_output != &std::cout) {
+        if (token_output != nullptr && token_output != demo_output) {
             delete token_output;
             token_output = nullptr;
         }
-        if (ast_output != nullptr && ast_output != &std::cout) {
+        if (ast_output != nullptr && ast_output != demo_output) {
             delete ast_output;
             ast_output = nullptr;
         }
-        if (tac_output != nullptr && tac_output != &std::cout) {
+        if (tac_output != nullptr && tac_output != demo_output) {
             delete tac_output;
             tac_output = nullptr;
         }
-        if (rtl_output != nullptr && rtl_output != &std::cout) {
+        if (rtl_output != nullptr && rtl_output != demo_output) {
             delete rtl_output;
             rtl_output = nullptr;
         }
-        if (asm_output != nullptr && asm_output != &std::cout) {
+        if (asm_output != nullptr && asm_output != demo_output) {
             delete asm_output;
             asm_output = nullptr;
         }
+        if (bin_output != nullptr && bin_output != demo_output) {
+            delete bin_output;
+            bin_output = nullptr;
+        }
+        if (ir_output != nullptr && ir_output != demo_output) {
+            delete ir_output;
+            ir_output = nullptr;
+        }
+        if (json_ast_output != nullptr && json_ast_output != demo_output) {
+            delete json_ast_output;
+            json_ast_output = nullptr;
+        }
+        if (json_tac_output != nullptr && json_tac_output != demo_output) {
+            delete json_tac_output;
+            json_tac_output = nullptr;
+        }
+        if (json_rtl_output != nullptr && json_rtl_output != demo_output) {
+            delete json_rtl_output;
+            json_rtl_output = nullptr;
+        }
+        if (stats_output != nullptr && stats_output != demo_output) {
+            delete stats_output;
+            stats_output = nullptr;
+        }
     }
 };
 
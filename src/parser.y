@@ -1,32 +1,51 @@
-%{
+%code requires {
+#include <ast.h>
+
+typedef void* yyscan_t;
+}
+
+%code {
 #include <error.h>
-#include <parse.h>
 #include <stddef.h>
 #include <stdio.h>
 
-extern int yylineno;
-int yylex();
-void yyerror(struct ParseNode**, char const*);
-
-#define construct_ParseNode_int(X, Y) construct_ParseNode_int(yylineno, X, Y)
-#define construct_ParseNode_float(X, Y) construct_ParseNode_float(yylineno, X, Y)
-#define construct_ParseNode_str(X, Y) construct_ParseNode_str(yylineno, X, Y)
-#define GET_MACRO(_0, _1, _2, _3, _4, NAME, ...) NAME
-#define construct_ParseNode(...) GET_MACRO(__VA_ARGS__, construct_ParseNode_4c, construct_ParseNode_3c, construct_ParseNode_2c, construct_ParseNode_1c, construct_ParseNode_0c)(yylineno, __VA_ARGS__)
-
-static int nr_func_decl = 0;
-
-%}
+int yylex(YYSTYPE*, yyscan_t);
+int yyget_lineno(yyscan_t);
+void yyerror(yyscan_t, AST::Builder*, char const*);
+}
 
 %debug
 %define parse.error verbose
 %define parse.lac full
+%define api.pure full
 
+// the lists, Declarators and Decls below are made in the builder's arena, as
+// the AST is: sclp_error throws out of yyparse, which would skip %destructor
 %union {
     char* strval;
+    Ident ident;
     size_t intval;
     double floatval;
-    struct ParseNode* n;
+    struct {
+        Ident id;
+        size_t line;
+    } name;
+
+    SemType const* semtype;
+    AST::Declarator* declarator;
+    std::vector<AST::Declarator*>* declarator_list;
+    std::vector<bool>* asterisk_list;
+    std::vector<size_t>* array_list;
+    AST::Decl* decl;
+    std::vector<AST::Decl>* param_list;
+
+    AST::Stmt* stmt;
+    std::vector<AST::Stmt*>* stmt_list;
+    AST::AssignStmt* assign_stmt;
+    AST::Expr* expr;
+    AST::LValExpr* lval_expr;
+    AST::CallExpr* call_expr;
+    std::vector<AST::Expr*>* expr_list;
 };
 
 %token LEFT_ROUND_BRACKET RIGHT_ROUND_BRACKET LEFT_CURLY_BRACKET RIGHT_CURLY_BRACKET LEFT_SQUARE_BRACKET RIGHT_SQUARE_BRACKET SEMICOLON COMMA AMP
@@ -35,7 +54,8 @@ static int nr_func_decl = 0;
 %token ASSIGN_OP
 %token<intval> INT_NUM
 %token<floatval> FLOAT_NUM
-%token<strval> NAME STR_CONST
+%token<ident> NAME
+%token<strval> STR_CONST
 
 %right QUESTION_MARK COLON
 %left OR
@@ -51,45 +71,47 @@ static int nr_func_decl = 0;
 %precedence ELSE
 
 %start Program
-%parse-param {struct ParseNode** ret}
-
-%type<n> PrimType TypeMod ArrayMod FuncMod
-%type<n> ConstAsteriskList ArrayNEList TypeModNEList
+%lex-param {yyscan_t scanner}
+%parse-param {yyscan_t scanner} {AST::Builder* builder}
 
-%type<n> GlobalDeclDefnList FuncDef MultiDecl SingleDecl ConstOptName OptName ParamList ParamNEList
+%type<semtype> PrimType
+%type<declarator> TypeMod ArrayMod FuncMod ConstOptName
+%type<declarator_list> TypeModNEList
+%type<asterisk_list> ConstAsteriskList
+%type<array_list> ArrayNEList
+%type<decl> SingleDecl
+%type<param_list> ParamList ParamNEList
+%type<name> Name OptName
 
-%type<n> StmtList Stmt DeclStmt PrintStmt ReadStmt AssignStmt CompoundStmt IfStmt WhileStmt DoWhileStmt ForStmt BreakStmt ContinueStmt CallStmt ReturnStmt OptionalExpr OptionalAssignStmtKern
+%type<stmt_list> StmtList
+%type<stmt> Stmt PrintStmt ReadStmt CompoundStmt IfStmt WhileStmt DoWhileStmt ForStmt BreakStmt ContinueStmt CallStmt ReturnStmt
+%type<assign_stmt> AssignStmt OptionalAssignStmtKern
 
-%type<n> LValExpr DerefExpr ArrayExpr RValExpr Expr ExprList ExprNEList
+%type<expr> Expr RValExpr OptionalExpr
+%type<lval_expr> LValExpr DerefExpr ArrayExpr
+%type<call_expr> FuncCall
+%type<expr_list> ExprList ExprNEList
 
-%type<n> Name IntLit FloatLit StrLit FuncCall
+%type<intval> IntLit
+%type<floatval> FloatLit
+%type<strval> StrLit
 
 %%
 
 Program:
-    GlobalDeclDefnList YYEOF {
-        *ret = construct_ParseNode(Program, $1);
-    }
+    GlobalDeclDefnList YYEOF
 ;
 GlobalDeclDefnList:
-    GlobalDeclDefnList DeclStmt {
-        $$ = $1;
-        ParseNode_add_child($$, $2);
-    }
-|   GlobalDeclDefnList FuncDef {
-        $$ = $1;
-        ParseNode_add_child($$, $2);
-    }
-|   DeclStmt {
-        $$ = construct_ParseNode(GlobalDeclDefnList, $1);
-    }
-|   FuncDef {
-        $$ = construct_ParseNode(GlobalDeclDefnList, $1);
-    }
+    GlobalDeclDefnList DeclStmt
+|   GlobalDeclDefnList FuncDef
+|   DeclStmt
+|   FuncDef
 ;
 FuncDef:
-    SingleDecl CompoundStmt {
-        $$ = construct_ParseNode(FuncDef, $1, $2);
+    SingleDecl {
+        builder->begin_func($1);
+    } LEFT_CURLY_BRACKET StmtList RIGHT_CURLY_BRACKET {
+        builder->end_func(yyget_lineno(scanner), *$4);
     }
 ;
 
@@ -98,146 +120,161 @@ FuncDef:
 ////////////////////////////////////////////////////////////////////////////////
 MultiDecl:
     PrimType TypeModNEList {
-        $$ = construct_ParseNode(MultiDecl, $1, $2);
+        builder->multi_decl($1, *$2);
     }
 ;
 SingleDecl:
     PrimType TypeMod {
-        $$ = construct_ParseNode(SingleDecl, $1, $2);
+        $$ = builder->single_decl(yyget_lineno(scanner), $1, $2);
     }
 TypeModNEList:
     TypeModNEList COMMA TypeMod {
         $$ = $1;
-        ParseNode_add_child($$, $3);
+        $$->push_back($3);
     }
 |   TypeMod {
-        $$ = construct_ParseNode(TypeModNEList);
-        ParseNode_add_child($$, $1);
+        $$ = builder->make<std::vector<AST::Declarator*>>(1, $1);
     }
 ;
 TypeMod:
     ArrayMod {
-        $$ = construct_ParseNode(TypeMod, $1);
+        $$ = $1;
+        $$->line = yyget_lineno(scanner);
     }
 |   FuncMod {
-        $$ = construct_ParseNode(TypeMod, $1);
+        $$ = $1;
+        $$->line = yyget_lineno(scanner);
     }
 |   ConstAsteriskList LEFT_ROUND_BRACKET TypeMod RIGHT_ROUND_BRACKET {
-        $$ = construct_ParseNode(TypeMod, $1, $3);
+        $$ = $3;
+        $$->add_ptrs(*$1);
+        $$->line = yyget_lineno(scanner);
     }
 |   ConstAsteriskList ConstOptName {
-        $$ = construct_ParseNode(TypeMod, $1, $2);
+        $$ = $2;
+        $$->add_ptrs(*$1);
+        $$->line = yyget_lineno(scanner);
     }
 |   ConstOptName {
-        $$ = construct_ParseNode(TypeMod, $1);
+        $$ = $1;
+        $$->line = yyget_lineno(scanner);
     }
 ;
 ArrayMod:
     ConstAsteriskList LEFT_ROUND_BRACKET TypeMod RIGHT_ROUND_BRACKET ArrayNEList {
-        $$ = construct_ParseNode(ArrayMod, $1, $3, $5);
+        $$ = $3;
+        $$->add_dims(*$5, yyget_lineno(scanner));
+        $$->add_ptrs(*$1);
     }
 |   LEFT_ROUND_BRACKET TypeMod RIGHT_ROUND_BRACKET ArrayNEList {
-        $$ = construct_ParseNode(ArrayMod, $2, $4);
+        $$ = $2;
+        $$->add_dims(*$4, yyget_lineno(scanner));
     }
 |   ConstAsteriskList ConstOptName ArrayNEList {
-        $$ = construct_ParseNode(ArrayMod, $1, $2, $3);
+        $$ = $2;
+        $$->add_dims(*$3, yyget_lineno(scanner));
+        $$->add_ptrs(*$1);
     }
 |   ConstOptName ArrayNEList {
-        $$ = construct_ParseNode(ArrayMod, $1, $2);
+        $$ = $1;
+        $$->add_dims(*$2, yyget_lineno(scanner));
     }
 ;
 FuncMod:
     ConstAsteriskList LEFT_ROUND_BRACKET TypeMod RIGHT_ROUND_BRACKET LEFT_ROUND_BRACKET ParamList RIGHT_ROUND_BRACKET {
-        $$ = construct_ParseNode(FuncMod, $1, $3, $6);
+        $$ = $3;
+        $$->add_func($6, yyget_lineno(scanner));
+        $$->add_ptrs(*$1);
     }
 |   LEFT_ROUND_BRACKET TypeMod RIGHT_ROUND_BRACKET LEFT_ROUND_BRACKET ParamList RIGHT_ROUND_BRACKET {
-        $$ = construct_ParseNode(FuncMod, $2, $5);
+        $$ = $2;
+        $$->add_func($5, yyget_lineno(scanner));
     }
 |   ConstAsteriskList Name LEFT_ROUND_BRACKET ParamList RIGHT_ROUND_BRACKET {
-        $$ = construct_ParseNode(FuncMod, $1, $2, $4);
+        $$ = builder->make<AST::Declarator>($2.id, false, yyget_lineno(scanner));
+        $$->add_func($4, yyget_lineno(scanner));
+        $$->add_ptrs(*$1);
     }
 |   Name LEFT_ROUND_BRACKET ParamList RIGHT_ROUND_BRACKET {
-        $$ = construct_ParseNode(FuncMod, $1, $3);
+        $$ = builder->make<AST::Declarator>($1.id, false, yyget_lineno(scanner));
+        $$->add_func($3, yyget_lineno(scanner));
     }
 ;
 ConstAsteriskList:
     ConstAsteriskList CONST MULT {
         $$ = $1;
-        ParseNode_add_child($$, construct_ParseNode(Asterisk));
-        ParseNode_add_child($$, construct_ParseNode(Const));
+        $$->push_back(true);
     }
 |   ConstAsteriskList MULT {
         $$ = $1;
-        ParseNode_add_child($$, construct_ParseNode(Asterisk));
+        $$->push_back(false);
     }
 |   MULT {
-        $$ = construct_ParseNode(ConstAsteriskList);
-        ParseNode_add_child($$, construct_ParseNode(Asterisk));
+        $$ = builder->make<std::vector<bool>>(1, false);
     }
 ;
 ArrayNEList:
     LEFT_SQUARE_BRACKET IntLit RIGHT_SQUARE_BRACKET ArrayNEList {
         $$ = $4;
-        ParseNode_add_child($$, $2);
+        $$->push_back($2);
     }
 |   LEFT_SQUARE_BRACKET IntLit RIGHT_SQUARE_BRACKET {
-        $$ = construct_ParseNode(ArrayNEList);
-        ParseNode_add_child($$, $2);
+        $$ = builder->make<std::vector<size_t>>(1, $2);
     }
 ;
 
 PrimType:
     VOID {
-        $$ = construct_ParseNode(PrimType, construct_ParseNode(Void));
+        $$ = SemType::make_void();
     }
 |   BOOL {
-        $$ = construct_ParseNode(PrimType, construct_ParseNode(Bool));
+        $$ = SemType::make_bool();
     }
 |   INTEGER {
-        $$ = construct_ParseNode(PrimType, construct_ParseNode(Int));
+        $$ = SemType::make_int();
     }
 |   FLOAT {
-        $$ = construct_ParseNode(PrimType, construct_ParseNode(Float));
+        $$ = SemType::make_float();
     }
 |   STRING {
-        $$ = construct_ParseNode(PrimType, construct_ParseNode(String));
+        $$ = SemType::make_string();
     }
 ;
 
 ParamList:
     ParamNEList {
-        $$ = $1;
+        $$ = builder->param_list($1);
     }
 |   %empty {
-        $$ = construct_ParseNode(ParamList);
+        $$ = builder->make<std::vector<AST::Decl>>();
     }
 ;
 ParamNEList:
     ParamNEList COMMA SingleDecl {
         $$ = $1;
-        ParseNode_add_child($$, $3);
+        $$->push_back(*$3);
     }
 |   SingleDecl {
-        $$ = construct_ParseNode(ParamList);
-        ParseNode_add_child($$, $1);
+        $$ = builder->make<std::vector<AST::Decl>>(1, *$1);
     }
 ;
 
 ConstOptName:
     OptName {
-        $$ = construct_ParseNode(ConstOptName, construct_ParseNode(NotConst, $1));
+        $$ = builder->make<AST::Declarator>($1.id, false, yyget_lineno(scanner));
     }
 |   CONST OptName {
-        $$ = construct_ParseNode(ConstOptName, construct_ParseNode(Const, $2));
+        $$ = builder->make<AST::Declarator>($2.id, true, yyget_lineno(scanner));
     }
 ;
 
 OptName:
     Name {
-        $$ = construct_ParseNode(OptName, $1);
+        $$ = $1;
     }
 |   %empty {
-        $$ = construct_ParseNode(OptName);
+        $$.id = Ident::none();
+        $$.line = yyget_lineno(scanner);
     }
 ;
 
@@ -246,134 +283,114 @@ OptName:
 ////////////////////////////////////////////////////////////////////////////////
 Stmt:
     DeclStmt {
-        $$ = construct_ParseNode(Stmt, $1);
-    }
-|   PrintStmt {
-        $$ = construct_ParseNode(Stmt, $1);
-    }
-|   ReadStmt {
-        $$ = construct_ParseNode(Stmt, $1);
+        $$ = NULL;
     }
+|   PrintStmt
+|   ReadStmt
 |   AssignStmt {
-        $$ = construct_ParseNode(Stmt, $1);
-    }
-|   CompoundStmt {
-        $$ = construct_ParseNode(Stmt, $1);
-    }
-|   IfStmt {
-        $$ = construct_ParseNode(Stmt, $1);
-    }
-|   WhileStmt {
-        $$ = construct_ParseNode(Stmt, $1);
-    }
-|   DoWhileStmt {
-        $$ = construct_ParseNode(Stmt, $1);
-    }
-|   ForStmt {
-        $$ = construct_ParseNode(Stmt, $1);
-    }
-|   BreakStmt {
-        $$ = construct_ParseNode(Stmt, $1);
-    }
-|   ContinueStmt {
-        $$ = construct_ParseNode(Stmt, $1);
-    }
-|   CallStmt {
-        $$ = construct_ParseNode(Stmt, $1);
-    }
-|   ReturnStmt {
-        $$ = construct_ParseNode(Stmt, $1);
+        $$ = $1;
     }
+|   CompoundStmt
+|   IfStmt
+|   WhileStmt
+|   DoWhileStmt
+|   ForStmt
+|   BreakStmt
+|   ContinueStmt
+|   CallStmt
+|   ReturnStmt
 ;
 
 DeclStmt:
-    MultiDecl SEMICOLON {
-        $$ = construct_ParseNode(DeclStmt, $1);
-    }
+    MultiDecl SEMICOLON
 ;
 PrintStmt:
     WRITE Expr SEMICOLON {
-        $$ = construct_ParseNode(PrintStmt, $2);
+        $$ = builder->make<AST::PrintStmt>(yyget_lineno(scanner), $2);
     }
 ;
 ReadStmt:
     READ LValExpr SEMICOLON {
-        $$ = construct_ParseNode(ReadStmt, $2);
+        $$ = builder->make_read(yyget_lineno(scanner), $2);
     }
 ;
 AssignStmt:
     LValExpr ASSIGN_OP Expr SEMICOLON {
-        $$ = construct_ParseNode(AssignStmt, $1, $3);
+        $$ = builder->make_assign(yyget_lineno(scanner), $1, $3);
     }
 |   LValExpr ASSIGN_OP FuncCall SEMICOLON {
-        $$ = construct_ParseNode(AssignStmt, $1, construct_ParseNode(Expr, $3));
+        $$ = builder->make_assign(yyget_lineno(scanner), $1, $3);
     }
 ;
 CompoundStmt:
-    LEFT_CURLY_BRACKET StmtList RIGHT_CURLY_BRACKET {
-        $$ = construct_ParseNode(CompoundStmt, $2);
+    LEFT_CURLY_BRACKET {
+        builder->begin_scope();
+    } StmtList RIGHT_CURLY_BRACKET {
+        builder->end_scope();
+        $$ = builder->make<AST::CompoundStmt>(builder->make_list(*$3));
     }
 ;
 IfStmt:
     IF LEFT_ROUND_BRACKET Expr RIGHT_ROUND_BRACKET Stmt %prec THEN {
-        $$ = construct_ParseNode(IfStmt, $3, $5);
+        $$ = builder->make<AST::IfStmt>(yyget_lineno(scanner), $3, $5);
     }
 |   IF LEFT_ROUND_BRACKET Expr RIGHT_ROUND_BRACKET Stmt ELSE Stmt {
-        $$ = construct_ParseNode(IfElseStmt, $3, $5, $7);
+        $$ = builder->make<AST::IfElseStmt>(yyget_lineno(scanner), $3, $5, $7);
     }
 ;
 WhileStmt:
     WHILE LEFT_ROUND_BRACKET Expr RIGHT_ROUND_BRACKET Stmt {
-        $$ = construct_ParseNode(WhileStmt, $3, $5);
+        $$ = builder->make<AST::WhileStmt>(yyget_lineno(scanner), $3, $5);
     }
 |   WHILE LEFT_ROUND_BRACKET Expr RIGHT_ROUND_BRACKET SEMICOLON {
-        $$ = construct_ParseNode(WhileStmt, $3, NULL);
+        $$ = builder->make<AST::WhileStmt>(yyget_lineno(scanner), $3, nullptr);
     }
 ;
 DoWhileStmt:
     DO Stmt WHILE LEFT_ROUND_BRACKET Expr RIGHT_ROUND_BRACKET SEMICOLON {
-        $$ = construct_ParseNode(DoWhileStmt, $2, $5);
+        $$ = builder->make<AST::DoWhileStmt>(yyget_lineno(scanner), $2, $5);
     }
 ;
 ForStmt:
     FOR LEFT_ROUND_BRACKET OptionalAssignStmtKern SEMICOLON OptionalExpr SEMICOLON OptionalAssignStmtKern RIGHT_ROUND_BRACKET Stmt {
-        $$ = construct_ParseNode(ForStmt, $3, $5, $7, $9);
+        $$ = builder->make<AST::ForStmt>(yyget_lineno(scanner), $3, $5, $7, $9);
     }
 |   FOR LEFT_ROUND_BRACKET OptionalAssignStmtKern SEMICOLON OptionalExpr SEMICOLON OptionalAssignStmtKern RIGHT_ROUND_BRACKET SEMICOLON {
-        $$ = construct_ParseNode(ForStmt, $3, $5, $7, NULL);
+        $$ = builder->make<AST::ForStmt>(yyget_lineno(scanner), $3, $5, $7, nullptr);
     }
 ;
 BreakStmt:
     BREAK SEMICOLON {
-        $$ = construct_ParseNode(BreakStmt);
+        $$ = builder->make<AST::BreakStmt>(yyget_lineno(scanner));
     }
 ;
 ContinueStmt:
     CONTINUE SEMICOLON {
-        $$ = construct_ParseNode(ContinueStmt);
+        $$ = builder->make<AST::ContinueStmt>(yyget_lineno(scanner));
     }
 ;
 CallStmt:
     FuncCall SEMICOLON {
-        $$ = construct_ParseNode(CallStmt, $1);
+        $$ = builder->make<AST::CallStmt>(yyget_lineno(scanner), $1);
     }
 ;
 ReturnStmt:
     RETURN Expr SEMICOLON {
-        $$ = construct_ParseNode(ReturnStmt, $2);
+        $$ = builder->make_return(yyget_lineno(scanner), $2);
     }
 |   RETURN SEMICOLON {
-        $$ = construct_ParseNode(ReturnStmt);
+        $$ = builder->make_return(yyget_lineno(scanner), nullptr);
     }
 ;
 
 StmtList:
     StmtList Stmt {
         $$ = $1;
-        ParseNode_add_child($$, $2);
+        if ($2 != NULL)
+            $$->push_back($2);
     }
 |   %empty {
-        $$ = construct_ParseNode(StmtList);
+        $$ = builder->make<std::vector<AST::Stmt*>>();
     }
 ;
 OptionalExpr:
@@ -386,10 +403,10 @@ OptionalExpr:
 ;
 OptionalAssignStmtKern:
     LValExpr ASSIGN_OP Expr {
-        $$ = construct_ParseNode(AssignStmt, $1, $3);
+        $$ = builder->make_assign(yyget_lineno(scanner), $1, $3);
     }
 |   LValExpr ASSIGN_OP FuncCall {
-        $$ = construct_ParseNode(AssignStmt, $1, construct_ParseNode(Expr, $3));
+        $$ = builder->make_assign(yyget_lineno(scanner), $1, $3);
     }
 |   %empty {
         $$ = NULL;
@@ -409,114 +426,115 @@ Expr:
 ;
 LValExpr: // L Value expressions
     Name {
-        $$ = construct_ParseNode(Expr, $1);
+        $$ = builder->make_sym($1.id, $1.line);
     }
 |   LEFT_ROUND_BRACKET LValExpr RIGHT_ROUND_BRACKET {
         $$ = $2;
     }
 |   DerefExpr {
-        $$ = construct_ParseNode(Expr, $1);
+        $$ = $1;
     }
 |   ArrayExpr {
-        $$ = construct_ParseNode(Expr, $1);
+        $$ = $1;
     }
 ;
 DerefExpr:
     MULT Expr {
-        $$ = construct_ParseNode(Expr_DEREF, $2);
+        $$ = builder->make<AST::DerefExpr>(yyget_lineno(scanner), $2);
     }
 ;
 ArrayExpr:
     Name LEFT_SQUARE_BRACKET Expr RIGHT_SQUARE_BRACKET {
-        $$ = construct_ParseNode(Expr_ARRAY, construct_ParseNode(Expr, $1), $3);
+        $$ = builder->make<AST::ArrayExpr>(yyget_lineno(scanner), builder->make_sym($1.id, $1.line), $3);
     }
 |   LEFT_ROUND_BRACKET LValExpr RIGHT_ROUND_BRACKET LEFT_SQUARE_BRACKET Expr RIGHT_SQUARE_BRACKET {
-        $$ = construct_ParseNode(Expr_ARRAY, $2, $5);
+        $$ = builder->make<AST::ArrayExpr>(yyget_lineno(scanner), $2, $5);
     }
 |   LEFT_ROUND_BRACKET RValExpr RIGHT_ROUND_BRACKET LEFT_SQUARE_BRACKET Expr RIGHT_SQUARE_BRACKET {
-        $$ = construct_ParseNode(Expr_ARRAY, $2, $5);
+        $$ = builder->make<AST::ArrayExpr>(yyget_lineno(scanner), $2, $5);
     }
 |   ArrayExpr LEFT_SQUARE_BRACKET Expr RIGHT_SQUARE_BRACKET {
-        $$ = construct_ParseNode(Expr_ARRAY, construct_ParseNode(Expr, $1), $3);
+        $$ = builder->make<AST::ArrayExpr>(yyget_lineno(scanner), $1, $3);
     }
 ;
 RValExpr: // R Value expressions
     IntLit {
-        $$ = construct_ParseNode(Expr, $1);
+        $$ = builder->make<AST::IntLit>($1);
     }
 |   FloatLit {
-        $$ = construct_ParseNode(Expr, $1);
+        $$ = builder->make<AST::FloatLit>($1);
     }
 |   StrLit {
-        $$ = construct_ParseNode(Expr, $1);
+        $$ = builder->make<AST::StrLit>($1);
+        free($1);
     }
 |   Expr QUESTION_MARK Expr COLON Expr {
-        $$ = construct_ParseNode(Expr, construct_ParseNode(Expr_TERNARY, $1, $3, $5));
+        $$ = builder->make<AST::TernaryExpr>(yyget_lineno(scanner), $1, $3, $5);
     }
 |   Expr OR Expr {
-        $$ = construct_ParseNode(Expr, construct_ParseNode(Expr_OR, $1, $3));
+        $$ = builder->make<AST::OrExpr>(yyget_lineno(scanner), $1, $3);
     }
 |   Expr AND Expr {
-        $$ = construct_ParseNode(Expr, construct_ParseNode(Expr_AND, $1, $3));
+        $$ = builder->make<AST::AndExpr>(yyget_lineno(scanner), $1, $3);
     }
 |   NOT Expr {
-        $$ = construct_ParseNode(Expr, construct_ParseNode(Expr_NOT, $2));
+        $$ = builder->make<AST::NotExpr>(yyget_lineno(scanner), $2);
     }
 |   Expr NOT_EQUAL Expr {
-        $$ = construct_ParseNode(Expr, construct_ParseNode(Expr_NOT_EQUAL, $1, $3));
+        $$ = builder->make<AST::NotEqualExpr>(yyget_lineno(scanner), $1, $3);
     }
 |   Expr EQUAL Expr {
-        $$ = construct_ParseNode(Expr, construct_ParseNode(Expr_EQUAL, $1, $3));
+        $$ = builder->make<AST::EqualExpr>(yyget_lineno(scanner), $1, $3);
     }
 |   Expr LESS_THAN Expr {
-        $$ = construct_ParseNode(Expr, construct_ParseNode(Expr_LESS_THAN, $1, $3));
+        $$ = builder->make<AST::LessExpr>(yyget_lineno(scanner), $1, $3);
     }
 |   Expr LESS_THAN_EQUAL Expr {
-        $$ = construct_ParseNode(Expr, construct_ParseNode(Expr_LESS_THAN_EQUAL, $1, $3));
+        $$ = builder->make<AST::LessEqualExpr>(yyget_lineno(scanner), $1, $3);
     }
 |   Expr GREATER_THAN Expr {
-        $$ = construct_ParseNode(Expr, construct_ParseNode(Expr_GREATER_THAN, $1, $3));
+        $$ = builder->make<AST::GreaterExpr>(yyget_lineno(scanner), $1, $3);
     }
 |   Expr GREATER_THAN_EQUAL Expr {
-        $$ = construct_ParseNode(Expr, construct_ParseNode(Expr_GREATER_THAN_EQUAL, $1, $3));
+        $$ = builder->make<AST::GreaterEqualExpr>(yyget_lineno(scanner), $1, $3);
     }
 |   Expr PLUS Expr {
-        $$ = construct_ParseNode(Expr, construct_ParseNode(Expr_PLUS, $1, $3));
+        $$ = builder->make<AST::AddExpr>(yyget_lineno(scanner), $1, $3);
     }
 |   Expr MINUS Expr {
-        $$ = construct_ParseNode(Expr, construct_ParseNode(Expr_MINUS, $1, $3));
+        $$ = builder->make<AST::SubExpr>(yyget_lineno(scanner), $1, $3);
     }
 |   Expr MULT Expr {
-        $$ = construct_ParseNode(Expr, construct_ParseNode(Expr_MULT, $1, $3));
+        $$ = builder->make<AST::MulExpr>(yyget_lineno(scanner), $1, $3);
     }
 |   Expr DIV Expr {
-        $$ = construct_ParseNode(Expr, construct_ParseNode(Expr_DIV, $1, $3));
+        $$ = builder->make<AST::DivExpr>(yyget_lineno(scanner), $1, $3);
     }
 |   MINUS Expr %prec UMINUS {
-        $$ = construct_ParseNode(Expr, construct_ParseNode(Expr_UMINUS, $2));
+        $$ = builder->make<AST::NegExpr>(yyget_lineno(scanner), $2);
     }
 |   LEFT_ROUND_BRACKET RValExpr RIGHT_ROUND_BRACKET {
         $$ = $2;
     }
 |   AMP LValExpr {
-        $$ = construct_ParseNode(Expr, construct_ParseNode(Expr_ADDR, $2));
+        $$ = builder->make<AST::AddrExpr>($2);
     }
 // |   FuncCall {  // fuck sclp
-//         $$ = construct_ParseNode(Expr, $1);
+//         $$ = $1;
 //     }
 ;
 FuncCall:
     Name LEFT_ROUND_BRACKET ExprList RIGHT_ROUND_BRACKET {
-        $$ = construct_ParseNode(Expr_FUNC_CALL, $1, $3);
+        $$ = builder->make_call(yyget_lineno(scanner), $1.id, $1.line, *$3);
     }
 |   LEFT_ROUND_BRACKET LValExpr RIGHT_ROUND_BRACKET LEFT_ROUND_BRACKET ExprList RIGHT_ROUND_BRACKET {
-        $$ = construct_ParseNode(Expr_FUNC_CALL, $2, $5);
+        $$ = builder->make_call(yyget_lineno(scanner), $2, *$5);
     }
 ;
 
 ExprList:
     %empty {
-        $$ = construct_ParseNode(ExprList);
+        $$ = builder->make<std::vector<AST::Expr*>>();
     }
 |   ExprNEList {
         $$ = $1;
@@ -524,11 +542,11 @@ ExprList:
 ;
 ExprNEList:
     Expr {
-        $$ = construct_ParseNode(ExprList, $1);
+        $$ = builder->make<std::vector<AST::Expr*>>(1, $1);
     }
 |   ExprNEList COMMA Expr {
         $$ = $1;
-        ParseNode_add_child($$, $3);
+        $$->push_back($3);
     }
 ;
 
@@ -537,30 +555,29 @@ ExprNEList:
 ////////////////////////////////////////////////////////////////////////////////
 Name:
     NAME {
-        $$ = construct_ParseNode_str(Name, $1);
-        free($1);
+        $$.id = $1;
+        $$.line = yyget_lineno(scanner);
     }
 ;
 IntLit:
     INT_NUM {
-        $$ = construct_ParseNode_int(IntLit, $1);
+        $$ = $1;
     }
 ;
 FloatLit:
     FLOAT_NUM {
-        $$ = construct_ParseNode_float(FloatLit, $1);
+        $$ = $1;
     }
 ;
 StrLit:
     STR_CONST {
-        $$ = construct_ParseNode_str(StrLit, $1);
-        free($1);
+        $$ = $1;
     }
 ;
 
 %%
 
-void yyerror(struct ParseNode**, char const* msg)
+void yyerror(yyscan_t scanner, AST::Builder*, char const* msg)
 {
-    sclp_error(yylineno, msg);
+    sclp_error(yyget_lineno(scanner), msg);
 }
@@ -0,0 +1,116 @@
+#include <pool.h>
+#include <cassert>
+
+Pool::Pool(size_t nr_threads)
+    : task(nullptr), generation(0), pending(0), busy(0), stopping(false), error_task(0)
+{
+    assert(nr_threads > 0);
+    for (size_t k = 0; k < nr_threads; ++k)
+        workers.push_back(std::make_unique<Worker>());
+    for (size_t k = 1; k < nr_threads; ++k)
+        threads.emplace_back(&Pool::loop, this, k);
+}
+
+Pool::~Pool()
+{
+    {
+        std::lock_guard<std::mutex> l(m);
+        stopping = true;
+    }
+    start.notify_all();
+    for (std::thread& t : threads)
+        t.join();
+}
+
+bool Pool::take(size_t k, size_t& i)
+{
+    {
+        Worker& w = *workers[k];
+        std::lock_guard<std::mutex> l(w.m);
+        if (!w.tasks.empty()) {
+            i = w.tasks.front();
+            w.tasks.pop_front();
+            return true;
+        }
+    }
+    for (size_t d = 1; d < workers.size(); ++d) {
+        Worker& v = *workers[(k + d) % workers.size()];
+        std::lock_guard<std::mutex> l(v.m);
+        if (!v.tasks.empty()) {
+            i = v.tasks.back();
+            v.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void Pool::work(size_t k, std::function<void(size_t)> const& f)
+{
+    size_t i;
+    size_t finished = 0;
+    while (take(k, i)) {
+        try {
+            f(i);
+        } catch (...) {
+            std::lock_guard<std::mutex> l(m);
+            if (!error || i < error_task) {
+                error = std::current_exception();
+                error_task = i;
+            }
+        }
+        ++finished;
+    }
+    std::lock_guard<std::mutex> l(m);
+    pending -= finished;
+    --busy;
+    if (pending == 0 && busy == 0)
+        done.notify_all();
+}
+
+void Pool::loop(size_t k)
+{
+    size_t seen = 0;
+    while (true) {
+        std::function<void(size_t)> const* f;
+        {
+            std::unique_lock<std::mutex> l(m);
+            start.wait(l, [&] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+            f = task;
+            ++busy;
+        }
+        work(k, *f);
+    }
+}
+
+void Pool::run(size_t n, std::function<void(size_t)> const& f)
+{
+    {
+        std::unique_lock<std::mutex> l(m);
+        // a worker late for the last batch must not pick up this one
+        done.wait(l, [&] { return busy == 0; });
+        size_t nw = workers.size();
+        for (size_t k = 0; k < nw; ++k) {
+            std::lock_guard<std::mutex> wl(workers[k]->m);
+            for (size_t i = n * k / nw; i < n * (k + 1) / nw; ++i)
+                workers[k]->tasks.push_back(i);
+        }
+        task = &f;
+        pending = n;
+        ++generation;
+        ++busy;
+    }
+    start.notify_all();
+    work(0, f);
+
+    std::unique_lock<std::mutex> l(m);
+    done.wait(l, [&] { return pending == 0 && busy == 0; });
+    if (error) {
+        std::exception_ptr e = error;
+        error = nullptr;
+        std::rethrow_exception(e);
+    }
+}
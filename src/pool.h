@@ -0,0 +1,58 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running batches of indexed tasks. Each worker
+// owns a deque of task indices, dealt out in contiguous runs; it takes from
+// the front of its own and, once that is empty, steals from the back of the
+// others'. The thread calling run() works as worker 0.
+class Pool {
+    struct Worker {
+        std::mutex m;
+        std::deque<size_t> tasks;
+    };
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    // guards everything below
+    std::mutex m;
+    std::condition_variable start, done;
+    std::function<void(size_t)> const* task;
+    size_t generation;
+    // tasks not yet finished, and workers inside work()
+    size_t pending, busy;
+    bool stopping;
+    // what the lowest-numbered failed task of the batch threw
+    std::exception_ptr error;
+    size_t error_task;
+
+    bool take(size_t k, size_t& i);
+    void work(size_t k, std::function<void(size_t)> const& f);
+    void loop(size_t k);
+
+public:
+    explicit Pool(size_t nr_threads);
+    ~Pool();
+    Pool(Pool const&) = delete;
+    Pool& operator=(Pool const&) = delete;
+
+    size_t size() const
+    {
+        return workers.size();
+    }
+    // calls f(i) for every i < n, returning once all calls have; if any
+    // threw, rethrows what the one with the lowest i did, as a serial loop
+    // would have
+    void run(size_t n, std::function<void(size_t)> const& f);
+};
+
+#endif // POOL_H
@@ -0,0 +1,53 @@
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+// Fixed-capacity FIFO handing work from one thread to others. push blocks
+// while the queue is full, pop while it is empty and not yet closed.
+template <typename T>
+class BoundedQueue {
+    std::mutex m;
+    std::condition_variable not_full, not_empty;
+    std::deque<T> items;
+    size_t capacity;
+    bool closed;
+
+public:
+    explicit BoundedQueue(size_t capacity)
+        : capacity(capacity), closed(false)
+    {
+    }
+
+    void push(T v)
+    {
+        std::unique_lock<std::mutex> l(m);
+        not_full.wait(l, [&] { return items.size() < capacity; });
+        items.push_back(std::move(v));
+        not_empty.notify_one();
+    }
+    // false once the queue is closed and drained
+    bool pop(T& v)
+    {
+        std::unique_lock<std::mutex> l(m);
+        not_empty.wait(l, [&] { return closed || !items.empty(); });
+        if (items.empty())
+            return false;
+        v = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+    // no more pushes; wakes every waiting pop
+    void close()
+    {
+        std::lock_guard<std::mutex> l(m);
+        closed = true;
+        not_empty.notify_all();
+    }
+};
+
+#endif // QUEUE_H
@@ -0,0 +1,126 @@
+#ifndef REG_H
+#define REG_H
+
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+
+// The MIPS registers sclp generates code for, numbered densely. The
+// allocatable ones come first, each class in allocation order, so that a
+// register's bit in its class's free-set is its offset from the first.
+enum class RegId : uint8_t {
+    V0, T0, T1, T2, T3, T4, T5, T6, T7, T8, T9,
+    S0, S1, S2, S3, S4, S5, S6, S7,
+    F2, F4, F6, F8, F10, F12, F14, F16, F18, F20, F22, F24, F26, F28, F30,
+    ZERO, V1, A0, SP, FP, RA, F0,
+    NONE
+};
+
+constexpr char const* reg_names[(size_t)RegId::NONE] = {
+    "v0", "t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7", "t8", "t9",
+    "s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7",
+    "f2", "f4", "f6", "f8", "f10", "f12", "f14", "f16", "f18", "f20", "f22", "f24", "f26", "f28", "f30",
+    "zero", "v1", "a0", "sp", "fp", "ra", "f0"
+};
+// hardware numbers, in the integer or the coprocessor 1 file
+constexpr uint8_t reg_nums[(size_t)RegId::NONE] = {
+    2, 8, 9, 10, 11, 12, 13, 14, 15, 24, 25,
+    16, 17, 18, 19, 20, 21, 22, 23,
+    2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30,
+    0, 3, 4, 29, 30, 31, 0
+};
+inline std::ostream& operator<<(std::ostream& o, RegId r)
+{
+    assert(r != RegId::NONE);
+    return o << reg_names[(size_t)r];
+}
+
+// Free-sets of the allocatable int and float registers, lowest register
+// handed out first. Also the most of each class held at once since the
+// last reset, for --stats to tell how close a function came to running out.
+class RegFile {
+    static constexpr unsigned INT_FIRST = (unsigned)RegId::V0;
+    static constexpr unsigned NUM_INT = (unsigned)RegId::S7 - INT_FIRST + 1;
+    static constexpr unsigned FLOAT_FIRST = (unsigned)RegId::F2;
+    static constexpr unsigned NUM_FLOAT = (unsigned)RegId::F30 - FLOAT_FIRST + 1;
+
+    uint32_t int_free;
+    uint32_t float_free;
+    unsigned int_peak;
+    unsigned float_peak;
+
+    static RegId take(uint32_t& free, unsigned first, unsigned n, unsigned& peak)
+    {
+        assert(free != 0);
+        unsigned i = __builtin_ctz(free);
+        free &= free - 1;
+        unsigned held = n - __builtin_popcount(free);
+        if (held > peak)
+            peak = held;
+        return RegId(first + i);
+    }
+    // registers outside the class (or none) are not tracked
+    static void give(uint32_t& free, unsigned first, unsigned n, RegId r)
+    {
+        unsigned i = (unsigned)r - first;
+        if (i < n)
+            free |= 1u << i;
+    }
+
+public:
+    RegFile()
+    {
+        reset();
+    }
+    void reset()
+    {
+        int_free = (1u << NUM_INT) - 1;
+        float_free = (1u << NUM_FLOAT) - 1;
+        int_peak = float_peak = 0;
+    }
+
+    RegId alloc_int()
+    {
+        return take(int_free, INT_FIRST, NUM_INT, int_peak);
+    }
+    RegId alloc_float()
+    {
+        return take(float_free, FLOAT_FIRST, NUM_FLOAT, float_peak);
+    }
+    unsigned get_int_peak() const
+    {
+        return int_peak;
+    }
+    unsigned get_float_peak() const
+    {
+        return float_peak;
+    }
+    static constexpr unsigned nr_int()
+    {
+        return NUM_INT;
+    }
+    static constexpr unsigned nr_float()
+    {
+        return NUM_FLOAT;
+    }
+    void free_int(RegId r)
+    {
+        give(int_free, INT_FIRST, NUM_INT, r);
+    }
+    void free_float(RegId r)
+    {
+        give(float_free, FLOAT_FIRST, NUM_FLOAT, r);
+    }
+    bool is_allocated(RegId r) const
+    {
+        unsigned i = (unsigned)r - INT_FIRST;
+        if (i < NUM_INT)
+            return (int_free & (1u << i)) == 0;
+        i = (unsigned)r - FLOAT_FIRST;
+        if (i < NUM_FLOAT)
+            return (float_free & (1u << i)) == 0;
+        return false;
+    }
+};
+
+#endif // REG_H
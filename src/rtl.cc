@@ -0,0 +1,55 @@
+#include <rtl.h>
+#include <cassert>
+#include <iostream>
+
+using namespace RTL;
+
+void Code::print(std::ostream& o, Stmt const& s) const
+{
+    OpDesc const& d = desc(s.op);
+    if (s.op == Op::LABEL) {
+        o << d.cmd << s.x.label << ":      \n";
+        return;
+    }
+
+    Operand const* ops[3] = { &s.x, &s.y, &s.z };
+    o << d.cmd;
+    for (size_t k = 0; k < 3 && d.kinds[k] != Kind::NONE; ++k) {
+        if (k > 0)
+            o << ' ' << d.sep[k - 1] << ' ';
+        Operand const& v = *ops[k];
+        switch (d.kinds[k]) {
+        case Kind::REG:
+            o << v.reg;
+            break;
+        case Kind::MEM:
+            o << mems[v.mem].name;
+            break;
+        case Kind::INT:
+            o << v.int_val;
+            break;
+        case Kind::FLOAT:
+            o << v.float_val;
+            break;
+        case Kind::LABEL:
+            o << v.label;
+            break;
+        case Kind::FUNC:
+            o << v.func;
+            break;
+        default:
+            assert(false);
+        }
+    }
+    o << '\n';
+}
+
+void Code::renumber_labels(LabelMap const& map)
+{
+    for (Stmt& s : stmts) {
+        if (s.op == Op::LABEL || s.op == Op::GOTO)
+            s.x.label = map(s.x.label);
+        else if (s.op == Op::BGTZ)
+            s.y.label = map(s.y.label);
+    }
+}
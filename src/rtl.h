@@ -1,424 +1,193 @@
 #ifndef RTL_H
 #define RTL_H
 
+#include <cstdint>
 #include <iostream>
 #include <string>
 #include <memory>
+#include <mutex>
 #include <vector>
 #include <asm.h>
+#include <ident.h>
+#include <names.h>
+#include <reg.h>
+#include <unordered_map>
 
 void print_string_escapes(std::string, std::ostream&);
 
 namespace RTL {
+    // The string literals of the program, numbered as the scanner meets
+    // them. With --pipeline the back end looks them up while the scanner
+    // is still adding more, hence the lock.
     class Context {
+        mutable std::mutex m;
+
     public:
         std::vector<std::string> string_store;
-        std::string get_string_id(std::string val);
-    };
-
-    void reset();
-
-    struct Base {
-        virtual void print(std::ostream&) const = 0;
-    };
-
-    struct Val: public Base {
-    };
-    struct Register: public Val {
-        std::string name;
-        Register(std::string n) : name(n) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << name;
-        }
+        std::unordered_map<std::string, Ident> string_ids;
+        Ident add_string(std::string const& val);
+        Ident string_id(std::string const& val) const;
     };
 
-
-    struct Mem: public Val {
-        std::string name;
+    struct Mem {
+        VarName name;
         bool is_global;
         ssize_t fp_offset;
-        Mem(std::string n, bool is_global, ssize_t fp_offset) : name(n), is_global(is_global), fp_offset(fp_offset) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << name;
-        }
-    };
-    struct IntLit: public Val {
-        size_t val;
-        IntLit(size_t v) : val(v) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << val;
-        }
-    };
-    struct FloatLit: public Val {
-        double val;
-        FloatLit(double v) : val(v) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << val;
-        }
-    };
-    struct StrLit: public Val {
-        std::string val;
-        StrLit(std::string v) : val(v) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << '"';
-            print_string_escapes(val, o);
-            o << '"';
-        }
-    };
-
-    struct Stmt : public Base {
-        virtual void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) = 0;
-    };
-    struct Label: public Stmt {
-        std::string name;
-        Label(std::string n) : name(n) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\n  " << name << ":      \n";
-        }
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct GotoStmt: public Stmt {
-        std::shared_ptr<Label> label;
-        GotoStmt(std::shared_ptr<Label> l) : label(l) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tgoto:        " << label->name << "\n";
-        }
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct BGTZStmt: public Stmt {
-        std::shared_ptr<Register> reg;
-        std::shared_ptr<Label> label;
-        BGTZStmt(std::shared_ptr<Register> reg, std::shared_ptr<Label> l) : reg(reg), label(l) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tbgtz:        ";
-            reg->print(o);
-            o << " , " << label->name << "\n";
-        }
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-
-    struct WriteStmt: public Stmt {
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\twrite        \n";
-        }
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct ReadStmt: public Stmt {
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tread         \n";
-        }
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
     };
 
-    struct CallStmt: public Stmt{
-    private:
-        std::string func_name;
-    public:
-        CallStmt(std::string func_name) : func_name(func_name) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tcall " << func_name << "\n";
-        }
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct AssignCallStmt: public Stmt{
-    private:
-        std::shared_ptr<Register> reg;
-        std::string func_name;
-    public:
-        AssignCallStmt(std::shared_ptr<Register> reg, std::string func_name) : reg(reg), func_name(func_name) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << '\t';
-            reg->print(o);
-            o << " = call " << func_name << "\n";
-        }
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-
-    struct CallPtrStmt: public Stmt{
-    private:
-        std::shared_ptr<Register> func_ptr;
-    public:
-        CallPtrStmt(std::shared_ptr<Register> func_ptr) : func_ptr(func_ptr) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tcallptr ";
-            func_ptr->print(o);
-            o << "\n";
-        }
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct AssignCallPtrStmt: public Stmt{
-    private:
-        std::shared_ptr<Register> reg;
-        std::shared_ptr<Register> func_ptr;
-    public:
-        AssignCallPtrStmt(std::shared_ptr<Register> reg, std::shared_ptr<Register> func_ptr) : reg(reg), func_ptr(func_ptr) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << '\t';
-            reg->print(o);
-            o << " = callptr ";
-            func_ptr->print(o);
-            o << "\n";
-        }
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    
-    struct ReturnStmt: public Stmt{
-    private:
-        std::shared_ptr<Register> return_reg;
-    public:
-        ReturnStmt(std::shared_ptr<Register> reg) : return_reg(reg) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\treturn      ";
-            return_reg->print(o);
-            o << '\n';
-        }
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-
-    struct PopStmt: public Stmt{
-    private:
-        bool is_float;
-    public:
-        PopStmt(bool is_float) : is_float(is_float) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tpop\n";
-        }
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct PushStmt: public Stmt{
-    private:
-        std::shared_ptr<Register> reg;
-        bool is_float;
+    enum class Op : uint8_t {
+        LABEL, GOTO, BGTZ,
+        WRITE, READ,
+        CALL, ASSIGN_CALL, CALL_PTR, ASSIGN_CALL_PTR, RETURN,
+        PUSH, PUSH_D, POP, POP_D,
+        MOVE, MOVE_D,
+        LOAD, LOAD_D, ILOAD, ILOAD_D, LOAD_ADDR, STORE, STORE_D,
+        UMINUS, UMINUS_D, NOT,
+        ADD, ADD_D, SUB, SUB_D, MUL, MUL_D, DIV, DIV_D,
+        SLT, SLT_D, SLE, SLE_D, SGT, SGE, SEQ, SEQ_D, SNE,
+        OR, AND,
+        MOVT, MOVF,
+        GET_ADDR, DEREF, DEREF_D, ADDR_ASSIGN, ADDR_ASSIGN_D,
+        Nr
+    };
+
+    // what an operand slot of an opcode holds
+    enum class Kind : uint8_t {
+        NONE, REG, MEM, INT, FLOAT, LABEL, FUNC
+    };
+
+    struct OpDesc {
+        // printed before the operands, padded to the operand column
+        char const* cmd;
+        // printed, space separated, between the operands
+        char const* sep[2];
+        Kind kinds[3];
+        // the same operation on doubles (itself if there is none)
+        Op float_variant;
+        // rough cycles to the result on an R3000-class pipeline, counting
+        // every machine instruction the opcode expands to
+        uint8_t latency;
+    };
+
+    constexpr OpDesc op_descs[(size_t)Op::Nr] = {
+        { "\n  ",            { "", "" },          { Kind::LABEL, Kind::NONE, Kind::NONE },   Op::LABEL,            0 },
+        { "\tgoto:        ", { "", "" },          { Kind::LABEL, Kind::NONE, Kind::NONE },   Op::GOTO,             1 },
+        { "\tbgtz:        ", { ",", "" },         { Kind::REG, Kind::LABEL, Kind::NONE },    Op::BGTZ,             1 },
+        { "\twrite        ", { "", "" },          { Kind::NONE, Kind::NONE, Kind::NONE },    Op::WRITE,            1 },
+        { "\tread         ", { "", "" },          { Kind::NONE, Kind::NONE, Kind::NONE },    Op::READ,             1 },
+        { "\tcall ",         { "", "" },          { Kind::FUNC, Kind::NONE, Kind::NONE },    Op::CALL,             1 },
+        { "\t",              { "= call", "" },    { Kind::REG, Kind::FUNC, Kind::NONE },     Op::ASSIGN_CALL,      1 },
+        { "\tcallptr ",      { "", "" },          { Kind::REG, Kind::NONE, Kind::NONE },     Op::CALL_PTR,         1 },
+        { "\t",              { "= callptr", "" }, { Kind::REG, Kind::REG, Kind::NONE },      Op::ASSIGN_CALL_PTR,  1 },
+        { "\treturn      ",  { "", "" },          { Kind::REG, Kind::NONE, Kind::NONE },     Op::RETURN,           1 },
+        { "\tpush:        ", { "", "" },          { Kind::REG, Kind::NONE, Kind::NONE },     Op::PUSH_D,           2 },
+        { "\tpush:        ", { "", "" },          { Kind::REG, Kind::NONE, Kind::NONE },     Op::PUSH_D,           2 },
+        { "\tpop",           { "", "" },          { Kind::NONE, Kind::NONE, Kind::NONE },    Op::POP_D,            1 },
+        { "\tpop",           { "", "" },          { Kind::NONE, Kind::NONE, Kind::NONE },    Op::POP_D,            1 },
+        { "\tmove:        ", { "<-", "" },        { Kind::REG, Kind::REG, Kind::NONE },      Op::MOVE_D,           1 },
+        { "\tmove.d:      ", { "<-", "" },        { Kind::REG, Kind::REG, Kind::NONE },      Op::MOVE_D,           2 },
+        { "\tload:        ", { "<-", "" },        { Kind::REG, Kind::MEM, Kind::NONE },      Op::LOAD_D,           2 },
+        { "\tload.d:      ", { "<-", "" },        { Kind::REG, Kind::MEM, Kind::NONE },      Op::LOAD_D,           3 },
+        { "\tiLoad:       ", { "<-", "" },        { Kind::REG, Kind::INT, Kind::NONE },      Op::ILOAD_D,          1 },
+        { "\tiLoad.d:     ", { "<-", "" },        { Kind::REG, Kind::FLOAT, Kind::NONE },    Op::ILOAD_D,          3 },
+        { "\tload_addr:   ", { "<-", "" },        { Kind::REG, Kind::MEM, Kind::NONE },      Op::LOAD_ADDR,        1 },
+        { "\tstore:       ", { "<-", "" },        { Kind::MEM, Kind::REG, Kind::NONE },      Op::STORE_D,          1 },
+        { "\tstore.d:     ", { "<-", "" },        { Kind::MEM, Kind::REG, Kind::NONE },      Op::STORE_D,          2 },
+        { "\tuminus:      ", { "<-", "" },        { Kind::REG, Kind::REG, Kind::NONE },      Op::UMINUS_D,         1 },
+        { "\tuminus.d:    ", { "<-", "" },        { Kind::REG, Kind::REG, Kind::NONE },      Op::UMINUS_D,         2 },
+        { "\tnot:         ", { "<-", "" },        { Kind::REG, Kind::REG, Kind::NONE },      Op::NOT,              1 },
+        { "\tadd:         ", { "<-", "," },       { Kind::REG, Kind::REG, Kind::REG },       Op::ADD_D,            1 },
+        { "\tadd.d:       ", { "<-", "," },       { Kind::REG, Kind::REG, Kind::REG },       Op::ADD_D,            2 },
+        { "\tsub:         ", { "<-", "," },       { Kind::REG, Kind::REG, Kind::REG },       Op::SUB_D,            1 },
+        { "\tsub.d:       ", { "<-", "," },       { Kind::REG, Kind::REG, Kind::REG },       Op::SUB_D,            2 },
+        { "\tmul:         ", { "<-", "," },       { Kind::REG, Kind::REG, Kind::REG },       Op::MUL_D,           12 },
+        { "\tmul.d:       ", { "<-", "," },       { Kind::REG, Kind::REG, Kind::REG },       Op::MUL_D,            5 },
+        { "\tdiv:         ", { "<-", "," },       { Kind::REG, Kind::REG, Kind::REG },       Op::DIV_D,           35 },
+        { "\tdiv.d:       ", { "<-", "," },       { Kind::REG, Kind::REG, Kind::REG },       Op::DIV_D,           19 },
+        { "\tslt:         ", { "<-", "," },       { Kind::REG, Kind::REG, Kind::REG },       Op::SLT_D,            1 },
+        { "\tslt.d:       ", { ",", "" },         { Kind::REG, Kind::REG, Kind::NONE },      Op::SLT_D,            2 },
+        { "\tsle:         ", { "<-", "," },       { Kind::REG, Kind::REG, Kind::REG },       Op::SLE_D,            2 },
+        { "\tsle.d:       ", { ",", "" },         { Kind::REG, Kind::REG, Kind::NONE },      Op::SLE_D,            2 },
+        { "\tsgt:         ", { "<-", "," },       { Kind::REG, Kind::REG, Kind::REG },       Op::SGT,              1 },
+        { "\tsge:         ", { "<-", "," },       { Kind::REG, Kind::REG, Kind::REG },       Op::SGE,              2 },
+        { "\tseq:         ", { "<-", "," },       { Kind::REG, Kind::REG, Kind::REG },       Op::SEQ_D,            2 },
+        { "\tseq.d:       ", { ",", "" },         { Kind::REG, Kind::REG, Kind::NONE },      Op::SEQ_D,            2 },
+        { "\tsne:         ", { "<-", "," },       { Kind::REG, Kind::REG, Kind::REG },       Op::SNE,              2 },
+        { "\tor:          ", { "<-", "," },       { Kind::REG, Kind::REG, Kind::REG },       Op::OR,               1 },
+        { "\tand:         ", { "<-", "," },       { Kind::REG, Kind::REG, Kind::REG },       Op::AND,              1 },
+        { "\tmovt:        ", { "<-", "," },       { Kind::REG, Kind::REG, Kind::INT },       Op::MOVT,             1 },
+        { "\tmovf:        ", { "<-", "," },       { Kind::REG, Kind::REG, Kind::INT },       Op::MOVF,             1 },
+        { "\tget_addr:    ", { "<-", "" },        { Kind::REG, Kind::MEM, Kind::NONE },      Op::GET_ADDR,         1 },
+        { "\tderef:       ", { "<-", "" },        { Kind::REG, Kind::REG, Kind::NONE },      Op::DEREF_D,          2 },
+        { "\tderef.d:     ", { "<-", "" },        { Kind::REG, Kind::REG, Kind::NONE },      Op::DEREF_D,          3 },
+        { "\tdrfs:        ", { "*<-", "" },       { Kind::REG, Kind::REG, Kind::NONE },      Op::ADDR_ASSIGN_D,    1 },
+        { "\tdrfs.d:      ", { "*<-", "" },       { Kind::REG, Kind::REG, Kind::NONE },      Op::ADDR_ASSIGN_D,    2 },
+    };
+    constexpr OpDesc const& desc(Op op)
+    {
+        return op_descs[(size_t)op];
+    }
+
+    // Which member is live is given by the kind of the slot in op_descs.
+    union Operand {
+        RegId reg;
+        uint32_t mem;   // index into Code::mems
+        size_t int_val;
+        double float_val;
+        LabelId label;
+        Ident func;
+
+        Operand() : int_val(0) {}
+        Operand(RegId r) : reg(r) {}
+        Operand(LabelId l) : label(l) {}
+        Operand(Ident f) : func(f) {}
+        static Operand of_int(size_t v)
+        {
+            Operand o;
+            o.int_val = v;
+            return o;
+        }
+        static Operand of_float(double v)
+        {
+            Operand o;
+            o.float_val = v;
+            return o;
+        }
+    };
+
+    struct Stmt {
+        Op op;
+        Operand x, y, z;
+    };
+    static_assert(sizeof(Stmt) == 32, "Stmt should stay four words");
+
+    // The RTL of one function: a flat array of Stmts, whose memory operands
+    // index into mems.
+    class Code {
     public:
-        PushStmt(std::shared_ptr<Register> reg, bool is_float) : reg(reg), is_float(is_float) {}
-        virtual void print(std::ostream& o) const override
-        {
-            o << "\tpush:        ";
-            reg->print(o);
-            o << '\n';
-        }
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
+        std::vector<Stmt> stmts;
+        std::vector<Mem> mems;
+        // the most int and float registers held at once while lowering to
+        // it; not kept in snapshots or dumps, so 0 for RTL loaded from one
+        unsigned int_regs_peak = 0, float_regs_peak = 0;
 
-    struct BinaryStmt: public Stmt {
-    private:
-        std::string const cmd;
-        std::string const print_op;
-    public:
-        std::shared_ptr<Val> lhs, rhs;
-        BinaryStmt(std::string const cmd, std::shared_ptr<Val> l, std::shared_ptr<Val> r, std::string print_op) : cmd(cmd), print_op(print_op), lhs(l), rhs(r) {}
-        virtual void print(std::ostream& o) const override
+        void emit(Op op, Operand x = Operand(), Operand y = Operand(), Operand z = Operand())
         {
-            o << cmd;
-            lhs->print(o);
-            o << " " << print_op << " ";
-            rhs->print(o);
-            o << "\n";
+            stmts.push_back(Stmt{ op, x, y, z });
         }
-    };
-
-    struct MoveStmt: public BinaryStmt {
-        MoveStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r) : BinaryStmt("\tmove:        ", l, r, "<-") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct MoveDStmt: public BinaryStmt {
-        MoveDStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r) : BinaryStmt("\tmove.d:      ", l, r, "<-") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-
-    struct LoadStmt: public BinaryStmt {
-        LoadStmt(std::shared_ptr<Register> l, std::shared_ptr<Mem> r) : BinaryStmt("\tload:        ", l, r, "<-") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct ILoadStmt: public BinaryStmt {
-        ILoadStmt(std::shared_ptr<Register> l, std::shared_ptr<IntLit> r) : BinaryStmt("\tiLoad:       " ,l, r, "<-") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct LoadDStmt: public BinaryStmt {
-        LoadDStmt(std::shared_ptr<Register> l, std::shared_ptr<Mem> r) : BinaryStmt("\tload.d:      ", l, r, "<-") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct ILoadDStmt: public BinaryStmt {
-        ILoadDStmt(std::shared_ptr<Register> l, std::shared_ptr<FloatLit> r) : BinaryStmt("\tiLoad.d:     ", l, r, "<-") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct LoadAddrStmt: public BinaryStmt {
-        LoadAddrStmt(std::shared_ptr<Register> l, std::shared_ptr<Mem> r) : BinaryStmt("\tload_addr:   ", l, r, "<-") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-
-    struct StoreStmt: public BinaryStmt {
-        StoreStmt(std::shared_ptr<Mem> l, std::shared_ptr<Register> r) : BinaryStmt("\tstore:       ", l, r, "<-") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct StoreDStmt: public BinaryStmt {
-        StoreDStmt(std::shared_ptr<Mem> l, std::shared_ptr<Register> r) : BinaryStmt("\tstore.d:     ", l, r, "<-") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-
-    struct UMinusStmt: public BinaryStmt {
-        UMinusStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r) : BinaryStmt("\tuminus:      ", l, r, "<-") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct UMinusDStmt: public BinaryStmt {
-        UMinusDStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r) : BinaryStmt("\tuminus.d:    ", l, r, "<-") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-
-    struct NotStmt: public BinaryStmt {
-        NotStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r) : BinaryStmt("\tnot:         ", l, r, "<-") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-
-    struct SLTDStmt: public BinaryStmt {
-        SLTDStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r) : BinaryStmt("\tslt.d:       ", l, r, ",") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct SLEDStmt: public BinaryStmt {
-        SLEDStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r) : BinaryStmt("\tsle.d:       ", l, r, ",") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct SEQDStmt: public BinaryStmt {
-        SEQDStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r) : BinaryStmt("\tseq.d:       ", l, r, ",") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-
-
-    struct TernaryStmt: public Stmt {
-    private:
-        std::string const cmd;
-        std::string const print_op_1;
-        std::string const print_op_2;
-    public:
-        std::shared_ptr<Val> lhs, rhs, rrhs;
-        TernaryStmt(std::string const cmd, std::shared_ptr<Val> l, std::shared_ptr<Val> r, std::shared_ptr<Val> rr, std::string print_op_1, std::string print_op_2) : cmd(cmd), print_op_1(print_op_1), print_op_2(print_op_2), lhs(l), rhs(r), rrhs(rr) {}
-        virtual void print(std::ostream& o) const override
+        Operand mem(VarName name, bool is_global, ssize_t fp_offset)
         {
-            o << cmd;
-            lhs->print(o);
-            o << " " << print_op_1 << " ";
-            rhs->print(o);
-            o << " " << print_op_2 << " ";
-            rrhs->print(o);
-            o << "\n";
+            Operand o;
+            o.mem = mems.size();
+            mems.push_back(Mem{ name, is_global, fp_offset });
+            return o;
         }
-    };
-
-    struct AddStmt: public TernaryStmt {
-        AddStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r, std::shared_ptr<Register> rr) : TernaryStmt("\tadd:         ", l, r, rr, "<-", ",") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct SubStmt: public TernaryStmt {
-        SubStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r, std::shared_ptr<Register> rr) : TernaryStmt("\tsub:         ", l, r, rr, "<-", ",") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct MulStmt: public TernaryStmt {
-        MulStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r, std::shared_ptr<Register> rr) : TernaryStmt("\tmul:         ", l, r, rr, "<-", ",") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct DivStmt: public TernaryStmt {
-        DivStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r, std::shared_ptr<Register> rr) : TernaryStmt("\tdiv:         ", l, r, rr, "<-", ",") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-
-    struct AddDStmt: public TernaryStmt {
-        AddDStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r, std::shared_ptr<Register> rr) : TernaryStmt("\tadd.d:       ", l, r, rr, "<-", ",") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct SubDStmt: public TernaryStmt {
-        SubDStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r, std::shared_ptr<Register> rr) : TernaryStmt("\tsub.d:       ", l, r, rr, "<-", ",") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct MulDStmt: public TernaryStmt {
-        MulDStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r, std::shared_ptr<Register> rr) : TernaryStmt("\tmul.d:       ", l, r, rr, "<-", ",") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct DivDStmt: public TernaryStmt {
-        DivDStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r, std::shared_ptr<Register> rr) : TernaryStmt("\tdiv.d:       ", l, r, rr, "<-", ",") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
 
-    struct SLTStmt: public TernaryStmt {
-        SLTStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r, std::shared_ptr<Register> rr) : TernaryStmt("\tslt:         ", l, r, rr, "<-", ",") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct SLEStmt: public TernaryStmt {
-        SLEStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r, std::shared_ptr<Register> rr) : TernaryStmt("\tsle:         ", l, r, rr, "<-", ",") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct SGTStmt: public TernaryStmt {
-        SGTStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r, std::shared_ptr<Register> rr) : TernaryStmt("\tsgt:         ", l, r, rr, "<-", ",") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct SGEStmt: public TernaryStmt {
-        SGEStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r, std::shared_ptr<Register> rr) : TernaryStmt("\tsge:         ", l, r, rr, "<-", ",") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct SEQStmt: public TernaryStmt {
-        SEQStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r, std::shared_ptr<Register> rr) : TernaryStmt("\tseq:         ", l, r, rr, "<-", ",") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
+        void print(std::ostream&, Stmt const&) const;
+        void renumber_labels(LabelMap const& map);
+        // the whole function, prologue and epilogue included
+        void gen_asm(Ident func_name, size_t frame_size, ASM::Code& out) const;
     };
-    struct SNEStmt: public TernaryStmt {
-        SNEStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r, std::shared_ptr<Register> rr) : TernaryStmt("\tsne:         ", l, r, rr, "<-", ",") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-
-    struct OrStmt: public TernaryStmt {
-        OrStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r, std::shared_ptr<Register> rr) : TernaryStmt("\tor:          ", l, r, rr, "<-", ",") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-
-    struct AndStmt: public TernaryStmt {
-        AndStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r, std::shared_ptr<Register> rr) : TernaryStmt("\tand:         ", l, r, rr, "<-", ",") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-
-    struct MovTStmt: public TernaryStmt {
-        MovTStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r, std::shared_ptr<IntLit> rr) : TernaryStmt("\tmovt:        ", l, r, rr, "<-", ",") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct MovFStmt: public TernaryStmt {
-        MovFStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r, std::shared_ptr<IntLit> rr) : TernaryStmt("\tmovf:        ", l, r, rr, "<-", ",") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-
-    struct GetAddrStmt: public BinaryStmt {
-        GetAddrStmt(std::shared_ptr<Register> l, std::shared_ptr<Mem> r) : BinaryStmt("\tget_addr:    ", l, r, "<-") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct DerefStmt: public BinaryStmt {
-        DerefStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r): BinaryStmt("\tderef:       ", l, r, "<-") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct DerefDStmt: public BinaryStmt {
-        DerefDStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r): BinaryStmt("\tderef.d:     ", l, r, "<-") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct AddrAssignStmt: public BinaryStmt {
-        AddrAssignStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r): BinaryStmt("\tdrfs:        ", l, r, "*<-") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-    struct AddrAssignDStmt: public BinaryStmt {
-        AddrAssignDStmt(std::shared_ptr<Register> l, std::shared_ptr<Register> r): BinaryStmt("\tdrfs.d:      ", l, r, "*<-") {}
-        void gen_asm(std::vector<std::shared_ptr<ASM::Stmt>>& stmts) override;
-    };
-
 }
 
 #endif // RTL_H
@@ -1,343 +1,219 @@
 #include <rtl.h>
 #include <asm.h>
-#include <vector>
 #include <cassert>
 
-using Register = ASM::Register;
-using ASMStmtList = std::vector<std::shared_ptr<ASM::Stmt>>;
+namespace {
+    using RTL::Op;
+    using RTL::Operand;
+    using AOp = ASM::Op;
 
-extern std::string func_under_processing_name;
-
-std::shared_ptr<Register> rtlreg2asmreg(std::shared_ptr<RTL::Register> rtl_reg){
-    return std::make_shared<Register>(rtl_reg->name);
-}
-
-
-void RTL::Label::gen_asm(ASMStmtList& stmts){
-    stmts.push_back(std::make_shared<ASM::LabelStmt>(name));
-}
-void RTL::GotoStmt::gen_asm(ASMStmtList& stmts){
-    stmts.push_back(std::make_shared<ASM::JStmt>(label->name));
-}
-void RTL::BGTZStmt::gen_asm(ASMStmtList& stmts){
-    stmts.push_back(std::make_shared<ASM::BGTZStmt>(rtlreg2asmreg(reg), label->name));
-}
-
-void RTL::WriteStmt::gen_asm(ASMStmtList& stmts){
-    stmts.push_back(std::make_shared<ASM::SyscallStmt>());
-}
-void RTL::ReadStmt::gen_asm(ASMStmtList& stmts){
-    stmts.push_back(std::make_shared<ASM::SyscallStmt>());
-}
-
-void RTL::CallStmt::gen_asm(ASMStmtList& stmts){
-    stmts.push_back(std::make_shared<ASM::JalStmt>(func_name));
-}
-void RTL::AssignCallStmt::gen_asm(ASMStmtList& stmts){
-    stmts.push_back(std::make_shared<ASM::JalStmt>(func_name));
-}
-void RTL::CallPtrStmt::gen_asm(ASMStmtList& stmts){
-    stmts.push_back(std::make_shared<ASM::JalrStmt>(rtlreg2asmreg(func_ptr)));
-}
-void RTL::AssignCallPtrStmt::gen_asm(ASMStmtList& stmts){
-    stmts.push_back(std::make_shared<ASM::JalrStmt>(rtlreg2asmreg(func_ptr)));
-}
-void RTL::ReturnStmt::gen_asm(ASMStmtList& stmts){
-    stmts.push_back(std::make_shared<ASM::JStmt>("epilogue_"+func_under_processing_name));
-}
-
-void RTL::PopStmt::gen_asm(ASMStmtList& stmts){
-    if(is_float)
-        stmts.push_back(std::make_shared<ASM::AddStmt>(std::make_shared<ASM::Register>("sp"), std::make_shared<ASM::Register>("sp"), std::make_shared<ASM::IntLit>(8)));
-    else
-        stmts.push_back(std::make_shared<ASM::AddStmt>(std::make_shared<ASM::Register>("sp"), std::make_shared<ASM::Register>("sp"), std::make_shared<ASM::IntLit>(4)));
-}
-void RTL::PushStmt::gen_asm(ASMStmtList& stmts){
-    if(is_float) {
-        stmts.push_back(std::make_shared<ASM::SDStmt>(rtlreg2asmreg(reg), std::make_shared<ASM::Register>("sp"), -4));
-        stmts.push_back(std::make_shared<ASM::SubStmt>(std::make_shared<ASM::Register>("sp"), std::make_shared<ASM::Register>("sp"), std::make_shared<ASM::IntLit>(8)));
-    } else {
-        stmts.push_back(std::make_shared<ASM::SWStmt>(rtlreg2asmreg(reg), std::make_shared<ASM::Register>("sp"), 0));
-        stmts.push_back(std::make_shared<ASM::SubStmt>(std::make_shared<ASM::Register>("sp"), std::make_shared<ASM::Register>("sp"), std::make_shared<ASM::IntLit>(4)));
+    // One helper per operand shape; each opcode passes the ASM opcode it
+    // becomes.
+    void gen_rr(ASM::Code& out, AOp op, RTL::Stmt const& s)
+    {
+        out.emit(op, s.x.reg, s.y.reg);
     }
-}
-
-void RTL::MoveStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    assert((l != nullptr) && (r != nullptr));
-    stmts.push_back(std::make_shared<ASM::MovStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r)));
-}
-void RTL::MoveDStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    assert((l != nullptr) && (r != nullptr));
-    stmts.push_back(std::make_shared<ASM::MovDStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r)));
-}
-
-void RTL::LoadStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Mem> r = std::dynamic_pointer_cast<RTL::Mem>(rhs);
-    assert((l != nullptr) && (r != nullptr));
-    if(r->is_global){
-        stmts.push_back(std::make_shared<ASM::LWStmt>(rtlreg2asmreg(l), std::make_shared<ASM::Mem>(r->name), -1));
-    } else{
-        stmts.push_back(std::make_shared<ASM::LWStmt>(rtlreg2asmreg(l), std::make_shared<ASM::Register>("fp"), r->fp_offset));
+    void gen_rrr(ASM::Code& out, AOp op, RTL::Stmt const& s)
+    {
+        out.emit(op, s.x.reg, s.y.reg, s.z.reg);
     }
-}
-void RTL::ILoadStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::IntLit> r = std::dynamic_pointer_cast<RTL::IntLit>(rhs);
-    assert((l != nullptr) && (r != nullptr));
-    stmts.push_back(std::make_shared<ASM::LIStmt>(rtlreg2asmreg(l), r->val));
-}
-void RTL::LoadDStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Mem> r = std::dynamic_pointer_cast<RTL::Mem>(rhs);
-    assert((l != nullptr) && (r != nullptr));
-    if(r->is_global){
-        stmts.push_back(std::make_shared<ASM::LDStmt>(rtlreg2asmreg(l), std::make_shared<ASM::Mem>(r->name), -1));
-    } else{
-        stmts.push_back(std::make_shared<ASM::LDStmt>(rtlreg2asmreg(l), std::make_shared<ASM::Register>("fp"), r->fp_offset));
+    void gen_rri(ASM::Code& out, AOp op, RTL::Stmt const& s)
+    {
+        out.emit(op, s.x.reg, s.y.reg, RegId::NONE, (int32_t)s.z.int_val);
     }
-}
-void RTL::ILoadDStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::FloatLit> r = std::dynamic_pointer_cast<RTL::FloatLit>(rhs);
-    assert((l != nullptr) && (r != nullptr));
-    stmts.push_back(std::make_shared<ASM::LIDStmt>(rtlreg2asmreg(l), r->val));
-}
-void RTL::LoadAddrStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Mem> r = std::dynamic_pointer_cast<RTL::Mem>(rhs);
-    assert((l != nullptr) && (r != nullptr));
-    stmts.push_back(std::make_shared<ASM::LAStmt>(rtlreg2asmreg(l), std::make_shared<ASM::Mem>(r->name)));
-}
-
-void RTL::StoreStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Mem> l = std::dynamic_pointer_cast<RTL::Mem>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    // std::cout << l->is_global << std::endl;
-    assert(l != nullptr && r != nullptr);
-    if(l->is_global){
-        stmts.push_back(std::make_shared<ASM::SWStmt>(rtlreg2asmreg(r), std::make_shared<ASM::Mem>(l->name), -1));
-    } else{
-        // std::cout << l->fp_offset << std::endl;
-        stmts.push_back(std::make_shared<ASM::SWStmt>(rtlreg2asmreg(r), std::make_shared<ASM::Register>("fp"), l->fp_offset));
+    // globals are addressed by name, locals off the frame pointer
+    void gen_mem(ASM::Code& out, AOp op, RegId reg, RTL::Mem const& m)
+    {
+        if (m.is_global)
+            out.emit_sym(op, m.name.sym, reg);
+        else
+            out.emit_mem(op, reg, RegId::FP, m.fp_offset);
     }
-}
-void RTL::StoreDStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Mem> l = std::dynamic_pointer_cast<RTL::Mem>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    // std::cout << l->is_global << std::endl;
-    assert(l != nullptr && r != nullptr);
-    if(l->is_global){
-        stmts.push_back(std::make_shared<ASM::SDStmt>(rtlreg2asmreg(r), std::make_shared<ASM::Mem>(l->name), -1));
-    } else{
-        // std::cout << l->fp_offset << std::endl;
-        stmts.push_back(std::make_shared<ASM::SDStmt>(rtlreg2asmreg(r), std::make_shared<ASM::Register>("fp"), l->fp_offset));
+    void gen_sp_adjust(ASM::Code& out, bool grow, size_t by)
+    {
+        out.emit(grow ? AOp::SUBI : AOp::ADDI, RegId::SP, RegId::SP, RegId::NONE, (int32_t)by);
     }
 }
 
-void RTL::UMinusStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    assert(l != nullptr && r != nullptr);
-    stmts.push_back(std::make_shared<ASM::NegStmt>(rtlreg2asmreg(l),rtlreg2asmreg(r)));
-}
-void RTL::UMinusDStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    assert(l != nullptr && r != nullptr);
-    stmts.push_back(std::make_shared<ASM::NegDStmt>(rtlreg2asmreg(l),rtlreg2asmreg(r)));
-}
-
-void RTL::NotStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    assert((l != nullptr) && (r != nullptr));
-    stmts.push_back(std::make_shared<ASM::XorIStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r), std::make_shared<ASM::IntLit>(1)));
-}
-
-void RTL::SLTDStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    assert((l != nullptr) && (r != nullptr));
-    stmts.push_back(std::make_shared<ASM::CLTDStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r)));
-}
-void RTL::SLEDStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    assert((l != nullptr) && (r != nullptr));
-    stmts.push_back(std::make_shared<ASM::CLEDStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r)));
-}
-void RTL::SEQDStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    assert((l != nullptr) && (r != nullptr));
-    stmts.push_back(std::make_shared<ASM::CEQDStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r)));
-}
-
-void RTL::AddStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    std::shared_ptr<RTL::Register> rr = std::dynamic_pointer_cast<RTL::Register>(rrhs);
-    assert((l != nullptr) && (r != nullptr) && (rr != nullptr));
-    stmts.push_back(std::make_shared<ASM::AddStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r), rtlreg2asmreg(rr)));
-}
-void RTL::SubStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    std::shared_ptr<RTL::Register> rr = std::dynamic_pointer_cast<RTL::Register>(rrhs);
-    assert((l != nullptr) && (r != nullptr) && (rr != nullptr));
-    stmts.push_back(std::make_shared<ASM::SubStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r), rtlreg2asmreg(rr)));
-}
-void RTL::MulStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    std::shared_ptr<RTL::Register> rr = std::dynamic_pointer_cast<RTL::Register>(rrhs);
-    assert((l != nullptr) && (r != nullptr) && (rr != nullptr));
-    stmts.push_back(std::make_shared<ASM::MulStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r), rtlreg2asmreg(rr)));
-}
-void RTL::DivStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    std::shared_ptr<RTL::Register> rr = std::dynamic_pointer_cast<RTL::Register>(rrhs);
-    assert((l != nullptr) && (r != nullptr) && (rr != nullptr));
-    stmts.push_back(std::make_shared<ASM::DivStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r), rtlreg2asmreg(rr)));
-}
-
-void RTL::AddDStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    std::shared_ptr<RTL::Register> rr = std::dynamic_pointer_cast<RTL::Register>(rrhs);
-    assert((l != nullptr) && (r != nullptr) && (rr != nullptr));
-    stmts.push_back(std::make_shared<ASM::AddDStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r), rtlreg2asmreg(rr)));
-}
-void RTL::SubDStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    std::shared_ptr<RTL::Register> rr = std::dynamic_pointer_cast<RTL::Register>(rrhs);
-    assert((l != nullptr) && (r != nullptr) && (rr != nullptr));
-    stmts.push_back(std::make_shared<ASM::SubDStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r), rtlreg2asmreg(rr)));
-}
-void RTL::MulDStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    std::shared_ptr<RTL::Register> rr = std::dynamic_pointer_cast<RTL::Register>(rrhs);
-    assert((l != nullptr) && (r != nullptr) && (rr != nullptr));
-    stmts.push_back(std::make_shared<ASM::MulDStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r), rtlreg2asmreg(rr)));
-}
-void RTL::DivDStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    std::shared_ptr<RTL::Register> rr = std::dynamic_pointer_cast<RTL::Register>(rrhs);
-    assert((l != nullptr) && (r != nullptr) && (rr != nullptr));
-    stmts.push_back(std::make_shared<ASM::DivDStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r), rtlreg2asmreg(rr)));
-}
-
-void RTL::SLTStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    std::shared_ptr<RTL::Register> rr = std::dynamic_pointer_cast<RTL::Register>(rrhs);
-    assert((l != nullptr) && (r != nullptr) && (rr != nullptr));
-    stmts.push_back(std::make_shared<ASM::SLTStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r), rtlreg2asmreg(rr)));
-}
-void RTL::SLEStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    std::shared_ptr<RTL::Register> rr = std::dynamic_pointer_cast<RTL::Register>(rrhs);
-    assert((l != nullptr) && (r != nullptr) && (rr != nullptr));
-    stmts.push_back(std::make_shared<ASM::SLEStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r), rtlreg2asmreg(rr)));
-}
-void RTL::SGTStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    std::shared_ptr<RTL::Register> rr = std::dynamic_pointer_cast<RTL::Register>(rrhs);
-    assert((l != nullptr) && (r != nullptr) && (rr != nullptr));
-    stmts.push_back(std::make_shared<ASM::SGTStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r), rtlreg2asmreg(rr)));
-}
-void RTL::SGEStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    std::shared_ptr<RTL::Register> rr = std::dynamic_pointer_cast<RTL::Register>(rrhs);
-    assert((l != nullptr) && (r != nullptr) && (rr != nullptr));
-    stmts.push_back(std::make_shared<ASM::SGEStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r), rtlreg2asmreg(rr)));
-}
-void RTL::SEQStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    std::shared_ptr<RTL::Register> rr = std::dynamic_pointer_cast<RTL::Register>(rrhs);
-    assert((l != nullptr) && (r != nullptr) && (rr != nullptr));
-    stmts.push_back(std::make_shared<ASM::SEQStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r), rtlreg2asmreg(rr)));
-}
-void RTL::SNEStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    std::shared_ptr<RTL::Register> rr = std::dynamic_pointer_cast<RTL::Register>(rrhs);
-    assert((l != nullptr) && (r != nullptr) && (rr != nullptr));
-    stmts.push_back(std::make_shared<ASM::SNEStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r), rtlreg2asmreg(rr)));
-}
-
-void RTL::OrStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    std::shared_ptr<RTL::Register> rr = std::dynamic_pointer_cast<RTL::Register>(rrhs);
-    assert((l != nullptr) && (r != nullptr) && (rr != nullptr));
-    stmts.push_back(std::make_shared<ASM::OrStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r), rtlreg2asmreg(rr)));
-}
-void RTL::AndStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    std::shared_ptr<RTL::Register> rr = std::dynamic_pointer_cast<RTL::Register>(rrhs);
-    assert((l != nullptr) && (r != nullptr) && (rr != nullptr));
-    stmts.push_back(std::make_shared<ASM::AndStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r), rtlreg2asmreg(rr)));
-}
-
-void RTL::MovTStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    std::shared_ptr<RTL::IntLit> rr = std::dynamic_pointer_cast<RTL::IntLit>(rrhs);
-    assert((l != nullptr) && (r != nullptr) && (rr != nullptr));
-    stmts.push_back(std::make_shared<ASM::MovTStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r), std::make_shared<ASM::IntLit>(rr->val)));
-}
-void RTL::MovFStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    std::shared_ptr<RTL::IntLit> rr = std::dynamic_pointer_cast<RTL::IntLit>(rrhs);
-    assert((l != nullptr) && (r != nullptr) && (rr != nullptr));
-    stmts.push_back(std::make_shared<ASM::MovFStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r), std::make_shared<ASM::IntLit>(rr->val)));
-}
-
-
-void RTL::GetAddrStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Mem> r = std::dynamic_pointer_cast<RTL::Mem>(rhs);
-    assert((l != nullptr) && (r != nullptr));
-    stmts.push_back(std::make_shared<ASM::LAAddrStmt>(rtlreg2asmreg(l), std::make_shared<ASM::Mem>(r->name), r->fp_offset));
-}
+void RTL::Code::gen_asm(Ident func_name, size_t frame_size, ASM::Code& out) const
+{
+    // the frame also holds the saved frame pointer
+    size_t sps = frame_size + 4;
+
+    out.emit(AOp::TEXT);
+    out.emit_sym(AOp::GLOBL, func_name);
+    out.emit_sym(AOp::FUNC_LABEL, func_name);
+    out.emit_mem(AOp::SW, RegId::RA, RegId::SP, 0);
+    out.emit_mem(AOp::SW, RegId::FP, RegId::SP, -4);
+    out.emit(AOp::SUBI, RegId::FP, RegId::SP, RegId::NONE, 4);
+    gen_sp_adjust(out, true, sps);
+
+    for (Stmt const& s : stmts) {
+        switch (s.op) {
+        case Op::LABEL:
+            out.emit_label(AOp::LABEL, s.x.label);
+            break;
+        case Op::GOTO:
+            out.emit_label(AOp::J, s.x.label);
+            break;
+        case Op::BGTZ:
+            out.emit_label(AOp::BGTZ, s.y.label, s.x.reg);
+            break;
+        case Op::WRITE:
+        case Op::READ:
+            out.emit(AOp::SYSCALL);
+            break;
+        case Op::CALL:
+            out.emit_sym(AOp::JAL, s.x.func);
+            break;
+        case Op::ASSIGN_CALL:
+            out.emit_sym(AOp::JAL, s.y.func);
+            break;
+        case Op::CALL_PTR:
+            out.emit(AOp::JALR, s.x.reg);
+            break;
+        case Op::ASSIGN_CALL_PTR:
+            out.emit(AOp::JALR, s.y.reg);
+            break;
+        case Op::RETURN:
+            out.emit_sym(AOp::J_EPILOGUE, func_name);
+            break;
+        case Op::PUSH:
+            out.emit_mem(AOp::SW, s.x.reg, RegId::SP, 0);
+            gen_sp_adjust(out, true, 4);
+            break;
+        case Op::PUSH_D:
+            out.emit_mem(AOp::S_D, s.x.reg, RegId::SP, -4);
+            gen_sp_adjust(out, true, 8);
+            break;
+        case Op::POP:
+            gen_sp_adjust(out, false, 4);
+            break;
+        case Op::POP_D:
+            gen_sp_adjust(out, false, 8);
+            break;
+        case Op::MOVE:
+            gen_rr(out, AOp::MOVE, s);
+            break;
+        case Op::MOVE_D:
+            gen_rr(out, AOp::MOV_D, s);
+            break;
+        case Op::LOAD:
+            gen_mem(out, AOp::LW, s.x.reg, mems[s.y.mem]);
+            break;
+        case Op::LOAD_D:
+            gen_mem(out, AOp::L_D, s.x.reg, mems[s.y.mem]);
+            break;
+        case Op::ILOAD:
+            out.emit_li(s.x.reg, s.y.int_val);
+            break;
+        case Op::ILOAD_D:
+            out.emit_li_d(s.x.reg, s.y.float_val);
+            break;
+        case Op::LOAD_ADDR:
+            out.emit_sym(AOp::LA, mems[s.y.mem].name.sym, s.x.reg);
+            break;
+        case Op::STORE:
+            gen_mem(out, AOp::SW, s.y.reg, mems[s.x.mem]);
+            break;
+        case Op::STORE_D:
+            gen_mem(out, AOp::S_D, s.y.reg, mems[s.x.mem]);
+            break;
+        case Op::UMINUS:
+            gen_rr(out, AOp::NEG, s);
+            break;
+        case Op::UMINUS_D:
+            gen_rr(out, AOp::NEG_D, s);
+            break;
+        case Op::NOT:
+            out.emit(AOp::XORI, s.x.reg, s.y.reg, RegId::NONE, 1);
+            break;
+        case Op::ADD:
+            gen_rrr(out, AOp::ADD, s);
+            break;
+        case Op::ADD_D:
+            gen_rrr(out, AOp::ADD_D, s);
+            break;
+        case Op::SUB:
+            gen_rrr(out, AOp::SUB, s);
+            break;
+        case Op::SUB_D:
+            gen_rrr(out, AOp::SUB_D, s);
+            break;
+        case Op::MUL:
+            gen_rrr(out, AOp::MUL, s);
+            break;
+        case Op::MUL_D:
+            gen_rrr(out, AOp::MUL_D, s);
+            break;
+        case Op::DIV:
+            gen_rrr(out, AOp::DIV, s);
+            break;
+        case Op::DIV_D:
+            gen_rrr(out, AOp::DIV_D, s);
+            break;
+        case Op::SLT:
+            gen_rrr(out, AOp::SLT, s);
+            break;
+        case Op::SLT_D:
+            gen_rr(out, AOp::C_LT_D, s);
+            break;
+        case Op::SLE:
+            gen_rrr(out, AOp::SLE, s);
+            break;
+        case Op::SLE_D:
+            gen_rr(out, AOp::C_LE_D, s);
+            break;
+        case Op::SGT:
+            gen_rrr(out, AOp::SGT, s);
+            break;
+        case Op::SGE:
+            gen_rrr(out, AOp::SGE, s);
+            break;
+        case Op::SEQ:
+            gen_rrr(out, AOp::SEQ, s);
+            break;
+        case Op::SEQ_D:
+            gen_rr(out, AOp::C_EQ_D, s);
+            break;
+        case Op::SNE:
+            gen_rrr(out, AOp::SNE, s);
+            break;
+        case Op::OR:
+            gen_rrr(out, AOp::OR, s);
+            break;
+        case Op::AND:
+            gen_rrr(out, AOp::AND, s);
+            break;
+        case Op::MOVT:
+            gen_rri(out, AOp::MOVT, s);
+            break;
+        case Op::MOVF:
+            gen_rri(out, AOp::MOVF, s);
+            break;
+        case Op::GET_ADDR:
+            gen_mem(out, AOp::LA, s.x.reg, mems[s.y.mem]);
+            break;
+        case Op::DEREF:
+            out.emit_mem(AOp::LW, s.x.reg, s.y.reg, 0);
+            break;
+        case Op::DEREF_D:
+            out.emit_mem(AOp::L_D, s.x.reg, s.y.reg, 0);
+            break;
+        case Op::ADDR_ASSIGN:
+            out.emit_mem(AOp::SW, s.y.reg, s.x.reg, 0);
+            break;
+        case Op::ADDR_ASSIGN_D:
+            out.emit_mem(AOp::S_D, s.y.reg, s.x.reg, 0);
+            break;
+        default:
+            assert(false);
+        }
+    }
 
-void RTL::DerefStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    assert((l != nullptr) && (r != nullptr));
-    stmts.push_back(std::make_shared<ASM::DerefStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r)));
-}
-void RTL::DerefDStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    assert((l != nullptr) && (r != nullptr));
-    stmts.push_back(std::make_shared<ASM::DerefDStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r)));
-}
-void RTL::AddrAssignStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    assert((l != nullptr) && (r != nullptr));
-    stmts.push_back(std::make_shared<ASM::DRFSStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r)));
+    out.emit_sym(AOp::EPILOGUE_LABEL, func_name);
+    gen_sp_adjust(out, false, sps);
+    out.emit_mem(AOp::LW, RegId::FP, RegId::SP, -4);
+    out.emit_mem(AOp::LW, RegId::RA, RegId::SP, 0);
+    out.emit(AOp::JR, RegId::RA);
 }
-void RTL::AddrAssignDStmt::gen_asm(ASMStmtList& stmts){
-    std::shared_ptr<RTL::Register> l = std::dynamic_pointer_cast<RTL::Register>(lhs);
-    std::shared_ptr<RTL::Register> r = std::dynamic_pointer_cast<RTL::Register>(rhs);
-    assert((l != nullptr) && (r != nullptr));
-    stmts.push_back(std::make_shared<ASM::DRFSDStmt>(rtlreg2asmreg(l), rtlreg2asmreg(r)));
-}
\ No newline at end of file
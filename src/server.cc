@@ -0,0 +1,284 @@
+#include <driver.h>
+#include <error.h>
+#include <server.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+    // A request is the client's directory and parsed command line; the
+    // reply is -d output, errors and exit status. Both go as one message:
+    // a length, then fields in host byte order, strings length-prefixed.
+    constexpr uint32_t MAGIC = 0x53434c50; // "SCLP"
+    constexpr uint32_t VERSION = 6;
+    // anything longer is not from a client
+    constexpr uint32_t MAX_MESSAGE = 1u << 30;
+
+    class Message {
+        std::string bytes;
+        size_t pos = 0;
+
+    public:
+        std::string& data()
+        {
+            return bytes;
+        }
+
+        void put_u32(uint32_t v)
+        {
+            bytes.append(reinterpret_cast<char const*>(&v), sizeof(v));
+        }
+        void put_str(std::string const& s)
+        {
+            put_u32(s.size());
+            bytes += s;
+        }
+        bool get_u32(uint32_t& v)
+        {
+            if (bytes.size() - pos < sizeof(v))
+                return false;
+            memcpy(&v, bytes.data() + pos, sizeof(v));
+            pos += sizeof(v);
+            return true;
+        }
+        bool get_str(std::string& s)
+        {
+            uint32_t n;
+            if (!get_u32(n) || bytes.size() - pos < n)
+                return false;
+            s.assign(bytes, pos, n);
+            pos += n;
+            return true;
+        }
+    };
+
+    bool read_all(int fd, char* p, size_t n)
+    {
+        while (n > 0) {
+            ssize_t r = read(fd, p, n);
+            if (r < 0 && errno == EINTR)
+                continue;
+            if (r <= 0)
+                return false;
+            p += r;
+            n -= r;
+        }
+        return true;
+    }
+    bool write_all(int fd, char const* p, size_t n)
+    {
+        while (n > 0) {
+            ssize_t r = write(fd, p, n);
+            if (r < 0 && errno == EINTR)
+                continue;
+            if (r <= 0)
+                return false;
+            p += r;
+            n -= r;
+        }
+        return true;
+    }
+
+    bool send_message(int fd, Message& m)
+    {
+        uint32_t n = m.data().size();
+        return write_all(fd, reinterpret_cast<char const*>(&n), sizeof(n)) && write_all(fd, m.data().data(), n);
+    }
+    bool recv_message(int fd, Message& m)
+    {
+        uint32_t n;
+        if (!read_all(fd, reinterpret_cast<char*>(&n), sizeof(n)) || n > MAX_MESSAGE)
+            return false;
+        m.data().resize(n);
+        return read_all(fd, &m.data()[0], n);
+    }
+
+    // the flags of Options a request carries, in bit order
+    bool Options::* const flags[] = {
+        &Options::stream, &Options::pipeline,
+        &Options::show_tokens, &Options::show_ast, &Options::show_tac, &Options::show_rtl, &Options::show_asm,
+        &Options::show_json_ast, &Options::show_json_tac, &Options::show_json_rtl,
+        &Options::emit_bin, &Options::demo, &Options::time_report, &Options::stats
+    };
+
+    void put_request(Message& m, std::string const& dir, Options const& options)
+    {
+        m.put_u32(MAGIC);
+        m.put_u32(VERSION);
+        m.put_str(dir);
+        m.put_u32((uint32_t)options.stage);
+        uint32_t bits = 0;
+        for (size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); ++i)
+            if (options.*flags[i])
+                bits |= 1u << i;
+        m.put_u32(bits);
+        m.put_str(options.cache_dir);
+        m.put_str(options.time_trace);
+        for (std::optional<Stage> s : { options.dump_ir, options.load_ir, options.read_json })
+            m.put_u32(s ? (uint32_t)*s + 1 : 0);
+        m.put_u32(options.input_filenames.size());
+        for (std::string const& f : options.input_filenames)
+            m.put_str(f);
+    }
+    bool get_request(Message& m, std::string& dir, Options& options)
+    {
+        uint32_t magic, version, stage, bits, dump_ir, load_ir, read_json, nr_files;
+        if (!m.get_u32(magic) || !m.get_u32(version) || magic != MAGIC || version != VERSION)
+            return false;
+        if (!m.get_str(dir) || !m.get_u32(stage) || !m.get_u32(bits) || !m.get_str(options.cache_dir) || !m.get_str(options.time_trace) || !m.get_u32(dump_ir) || !m.get_u32(load_ir) || !m.get_u32(read_json) || !m.get_u32(nr_files))
+            return false;
+        // the IR stages travel off by one, 0 being none
+        if (stage > (uint32_t)Stage::ASM || dump_ir > (uint32_t)Stage::ASM + 1 || load_ir > (uint32_t)Stage::ASM + 1 || read_json > (uint32_t)Stage::ASM + 1)
+            return false;
+        options.stage = Stage(stage);
+        if (dump_ir != 0)
+            options.dump_ir = Stage(dump_ir - 1);
+        if (load_ir != 0)
+            options.load_ir = Stage(load_ir - 1);
+        if (read_json != 0)
+            options.read_json = Stage(read_json - 1);
+        for (size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); ++i)
+            options.*flags[i] = (bits >> i) & 1;
+        // one at a time, so that a bad count runs out of message rather
+        // than asking for memory it never fills
+        for (uint32_t k = 0; k < nr_files; ++k) {
+            std::string f;
+            if (!m.get_str(f))
+                return false;
+            options.input_filenames.push_back(std::move(f));
+        }
+        return true;
+    }
+
+    // path is known to fit
+    sockaddr_un socket_addr(std::string const& path)
+    {
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, path.c_str());
+        return addr;
+    }
+    bool try_connect(int fd, std::string const& path)
+    {
+        sockaddr_un addr = socket_addr(path);
+        return connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+    }
+
+    // removed by the server on SIGINT or SIGTERM
+    char socket_path[sizeof(sockaddr_un::sun_path)];
+    void stop(int)
+    {
+        unlink(socket_path);
+        _exit(0);
+    }
+
+    void serve_one(Driver& driver, int fd)
+    {
+        Message req;
+        std::string dir;
+        Options options;
+        std::ostringstream out, err;
+        bool ok = false;
+        // whatever a request does, the server lives on to take the next
+        try {
+            if (!recv_message(fd, req))
+                return;
+            if (get_request(req, dir, options))
+                ok = driver.run(options, dir, out, err);
+            else
+                err << format_error("", CompileError{ 0, "Bad request; is the client the same version as the server?" });
+        } catch (std::exception const& e) {
+            ok = false;
+            err << format_error("", CompileError{ 0, std::string("Server failed on the request: ") + e.what() });
+        }
+
+        Message reply;
+        reply.put_str(out.str());
+        reply.put_str(err.str());
+        reply.put_u32(ok ? 0 : 1);
+        send_message(fd, reply);
+    }
+}
+
+int serve(Options const& options)
+{
+    std::string const& path = options.server_socket;
+    if (path.size() >= sizeof(socket_path))
+        sclp_error(0, "Socket path too long: " + path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        sclp_error(0, std::string("Unable to create socket: ") + strerror(errno));
+
+    // a socket left behind by a server that died; a live one keeps it
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        bool live = try_connect(probe, path);
+        close(probe);
+        if (live)
+            sclp_error(0, "A server is already running at " + path);
+        unlink(path.c_str());
+    }
+
+    sockaddr_un addr = socket_addr(path);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0)
+        sclp_error(0, "Unable to listen on " + path + ": " + strerror(errno));
+
+    strcpy(socket_path, path.c_str());
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    // a client going away mid-reply is its own problem
+    signal(SIGPIPE, SIG_IGN);
+
+    Driver driver(options.jobs);
+    while (true) {
+        int c = accept(fd, nullptr, nullptr);
+        if (c < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            sclp_error(0, std::string("Unable to accept a client: ") + strerror(errno));
+        }
+        serve_one(driver, c);
+        close(c);
+    }
+}
+
+int run_client(Options const& options)
+{
+    std::string const& path = options.client_socket;
+    if (path.size() >= sizeof(sockaddr_un::sun_path))
+        sclp_error(0, "Socket path too long: " + path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        sclp_error(0, std::string("Unable to create socket: ") + strerror(errno));
+    if (!try_connect(fd, path))
+        sclp_error(0, "Unable to connect to server at " + path);
+
+    char* cwd = getcwd(nullptr, 0);
+    if (cwd == nullptr)
+        sclp_error(0, std::string("Unable to get the working directory: ") + strerror(errno));
+    Message req;
+    put_request(req, cwd, options);
+    free(cwd);
+
+    Message reply;
+    std::string out, err;
+    uint32_t status;
+    if (!send_message(fd, req) || !recv_message(fd, reply) || !reply.get_str(out) || !reply.get_str(err) || !reply.get_u32(status))
+        sclp_error(0, "Lost the connection to the server at " + path);
+    close(fd);
+
+    std::cout.write(out.data(), out.size());
+    std::cerr << err;
+    return status;
+}
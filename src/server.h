@@ -0,0 +1,16 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <opt.h>
+
+// Serves compile requests on options.server_socket, with options.jobs
+// threads, until killed. Requests are taken one at a time; each is a
+// client's command line, compiled as if run in the client's directory.
+// Output files are written by the server, -d output and errors sent back.
+int serve(Options const& options);
+// Sends the compilation of options.input_filenames to the server on
+// options.client_socket, passes on what it sends back to stdout and stderr,
+// and returns its exit status
+int run_client(Options const& options);
+
+#endif // SERVER_H
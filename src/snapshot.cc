@@ -0,0 +1,357 @@
+#include <error.h>
+#include <snapshot.h>
+#include <sym.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+using namespace Snapshot;
+
+namespace {
+    // "SCLP-IR\0" read as a host word, so that one written on a machine of
+    // the other byte order does not match
+    constexpr uint64_t MAGIC = 0x0052492d504c4353;
+    // bump when the layout of snapshots changes
+    constexpr uint32_t VERSION = 1;
+
+    struct Header {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t stage;
+    };
+    struct Trailer {
+        Span names, strings, globals, funcs, chars;
+        uint64_t magic;
+    };
+
+    // Records of the TAC and RTL arrays have the layout of what they hold,
+    // padding zeroed, so that they are loaded by copying; the rest have
+    // names in place of Idents, as indices into the names of the snapshot
+    struct InstrRec {
+        TAC::Op op;
+        TAC::Type type;
+        uint8_t pad[2];
+        TAC::Val dst, a, b;
+    };
+    static_assert(sizeof(InstrRec) == sizeof(TAC::Instr) && offsetof(InstrRec, dst) == offsetof(TAC::Instr, dst) && offsetof(InstrRec, b) == offsetof(TAC::Instr, b), "InstrRec should be laid out as TAC::Instr");
+
+    // a FUNC operand holds the index of its name in int_val
+    struct StmtRec {
+        RTL::Op op;
+        uint8_t pad[7];
+        RTL::Operand x, y, z;
+    };
+    static_assert(sizeof(StmtRec) == sizeof(RTL::Stmt) && offsetof(StmtRec, x) == offsetof(RTL::Stmt, x) && offsetof(StmtRec, z) == offsetof(RTL::Stmt, z), "StmtRec should be laid out as RTL::Stmt");
+
+    struct SymRec {
+        uint8_t kind;
+        TAC::Type type;
+        uint8_t in_mem;
+        uint8_t is_global;
+        uint32_t num;
+        uint32_t name;
+        uint32_t pad;
+        int64_t fp_offset;
+    };
+    struct MemRec {
+        uint8_t kind;
+        uint8_t is_global;
+        uint8_t pad[2];
+        uint32_t num;
+        uint32_t name;
+        uint32_t pad2;
+        int64_t fp_offset;
+    };
+    struct CallRec {
+        uint32_t name;
+        uint32_t first_param;
+        uint32_t nr_params;
+    };
+    struct GlobalRec {
+        uint32_t name;
+        TAC::Type type;
+        uint8_t pad[3];
+    };
+
+    // a snapshot as mapped in, checked as it is read
+    class Mapping {
+        std::string path;
+        unsigned char const* data;
+        size_t size;
+
+    public:
+        Mapping(IO::Input const& in, std::string const& path)
+            : path(path), data(reinterpret_cast<unsigned char const*>(in.get_data())), size(in.get_size())
+        {
+            if (size < sizeof(Header) + sizeof(Trailer))
+                bad();
+        }
+
+        size_t get_size() const
+        {
+            return size;
+        }
+        [[noreturn]] void bad() const
+        {
+            sclp_error(0, "Not an IR snapshot, or a damaged one: " + path);
+        }
+
+        template <typename T>
+        T get(uint64_t offset) const
+        {
+            T v;
+            if (offset > size || size - offset < sizeof(T))
+                bad();
+            memcpy(&v, data + offset, sizeof(T));
+            return v;
+        }
+        // the array s locates, copied out
+        template <typename T>
+        std::vector<T> get(Span s) const
+        {
+            if (s.offset % alignof(T) != 0 || s.offset > size || s.count > (size - s.offset) / sizeof(T))
+                bad();
+            std::vector<T> v(s.count);
+            memcpy(static_cast<void*>(v.data()), data + s.offset, s.count * sizeof(T));
+            return v;
+        }
+    };
+}
+
+Writer::Writer(std::ostream& out, Stage stage)
+    : out(out), stage(stage), size(0)
+{
+    Header h{ MAGIC, VERSION, (uint32_t)stage };
+    write(&h, 1, sizeof(h));
+}
+
+uint32_t Writer::name(Ident n)
+{
+    auto it = name_index.emplace(n, names.size()).first;
+    if (it->second == names.size())
+        names.push_back(add_chars(n.str()));
+    return it->second;
+}
+
+Span Writer::add_chars(std::string const& s)
+{
+    Span sp{ chars.size(), s.size() };
+    chars += s;
+    return sp;
+}
+
+// every array starts on a multiple of eight
+Span Writer::write(void const* data, size_t n, size_t elem_size)
+{
+    static char const zeros[8] = {};
+    out.write(zeros, -size & 7);
+    size += -size & 7;
+    Span s{ size, n };
+    out.write(static_cast<char const*>(data), n * elem_size);
+    size += n * elem_size;
+    return s;
+}
+
+void Writer::add_func(AST::FuncDefn const& a)
+{
+    FuncRec f{};
+    f.name = name(a.func->name);
+    f.frame_size = a.stackframe_size;
+
+    if (stage == Stage::TAC) {
+        TAC::Values const& vals = a.ctx.vals;
+        std::vector<InstrRec> tac(a.tac.size());
+        for (size_t n = 0; n < tac.size(); ++n) {
+            TAC::Instr const& i = a.tac[n];
+            tac[n] = InstrRec{ i.op, i.type, {}, i.dst, i.a, i.b };
+        }
+        f.tac = write(tac);
+
+        std::vector<SymRec> syms(vals.syms.size());
+        for (size_t n = 0; n < syms.size(); ++n) {
+            TAC::SymInfo const& s = vals.syms[n];
+            syms[n] = SymRec{ (uint8_t)s.name.kind, s.type, s.in_mem, s.is_global, s.name.num, name(s.name.sym), 0, s.fp_offset };
+        }
+        f.syms = write(syms);
+        f.ints = write(vals.ints);
+        f.floats = write(vals.floats);
+
+        std::vector<Span> strs;
+        for (std::string const& v : vals.strs)
+            strs.push_back(add_chars(v));
+        f.strs = write(strs);
+
+        std::vector<CallRec> calls;
+        for (TAC::Call const& c : vals.calls)
+            calls.push_back(CallRec{ name(c.func_name), c.first_param, c.nr_params });
+        f.calls = write(calls);
+        f.params = write(vals.params);
+    } else {
+        // an operand with nothing but the member its kind makes live
+        auto clean = [this](RTL::Operand const& o, RTL::Kind k) {
+            RTL::Operand c;
+            switch (k) {
+            case RTL::Kind::NONE:
+                break;
+            case RTL::Kind::REG:
+                c.reg = o.reg;
+                break;
+            case RTL::Kind::MEM:
+                c.mem = o.mem;
+                break;
+            case RTL::Kind::INT:
+                c.int_val = o.int_val;
+                break;
+            case RTL::Kind::FLOAT:
+                c.float_val = o.float_val;
+                break;
+            case RTL::Kind::LABEL:
+                c.label = o.label;
+                break;
+            case RTL::Kind::FUNC:
+                c.int_val = name(o.func);
+                break;
+            }
+            return c;
+        };
+        std::vector<StmtRec> stmts(a.rtl.stmts.size());
+        for (size_t n = 0; n < stmts.size(); ++n) {
+            RTL::Stmt const& s = a.rtl.stmts[n];
+            RTL::Kind const* k = RTL::desc(s.op).kinds;
+            stmts[n] = StmtRec{ s.op, {}, clean(s.x, k[0]), clean(s.y, k[1]), clean(s.z, k[2]) };
+        }
+        f.stmts = write(stmts);
+
+        std::vector<MemRec> mems;
+        for (RTL::Mem const& m : a.rtl.mems)
+            mems.push_back(MemRec{ (uint8_t)m.name.kind, m.is_global, {}, m.name.num, name(m.name.sym), 0, m.fp_offset });
+        f.mems = write(mems);
+    }
+    funcs.push_back(f);
+}
+
+void Writer::finish(RTL::Context const& strings, std::vector<Global> const& globals)
+{
+    Trailer t;
+    std::vector<Span> strs;
+    for (std::string const& v : strings.string_store)
+        strs.push_back(add_chars(v));
+    t.strings = write(strs);
+
+    std::vector<GlobalRec> globs;
+    for (Global const& g : globals)
+        globs.push_back(GlobalRec{ name(g.name), g.type, {} });
+    t.globals = write(globs);
+
+    t.funcs = write(funcs);
+    t.names = write(names);
+    t.chars = write(chars.data(), chars.size(), 1);
+    t.magic = MAGIC;
+    write(&t, 1, sizeof(t));
+    out.flush();
+}
+
+void Snapshot::load(IO::Input const& in, std::string const& path, Stage stage, AST::Builder& b, RTL::Context& strings, std::vector<Global>& globals)
+{
+    Mapping m(in, path);
+    Header h = m.get<Header>(0);
+    if (h.magic != MAGIC)
+        m.bad();
+    if (h.version != VERSION)
+        sclp_error(0, "IR snapshot " + path + " is of version " + std::to_string(h.version) + "; this sclp reads version " + std::to_string(VERSION));
+    if (h.stage != (uint32_t)stage)
+        sclp_error(0, "IR snapshot " + path + " is not of the stage asked for");
+    Trailer t = m.get<Trailer>(m.get_size() - sizeof(Trailer));
+    if (t.magic != MAGIC)
+        m.bad();
+
+    std::vector<char> chars = m.get<char>(t.chars);
+    auto text = [&](Span s) {
+        if (s.offset > chars.size() || s.count > chars.size() - s.offset)
+            m.bad();
+        return std::string(chars.data() + s.offset, s.count);
+    };
+
+    std::vector<Ident> names;
+    for (Span s : m.get<Span>(t.names)) {
+        std::string n = text(s);
+        names.push_back(n.empty() ? Ident::none() : Ident(n));
+    }
+    auto name = [&](uint32_t k) {
+        if (k >= names.size())
+            m.bad();
+        return names[k];
+    };
+
+    auto tac_type = [&](TAC::Type t) {
+        if (t > TAC::Type::PTR)
+            m.bad();
+        return t;
+    };
+    auto var_kind = [&](uint8_t k) {
+        if (k > (uint8_t)VarName::Kind::STEMP)
+            m.bad();
+        return VarName::Kind(k);
+    };
+
+    for (Span s : m.get<Span>(t.strings))
+        strings.add_string(text(s));
+    for (GlobalRec const& g : m.get<GlobalRec>(t.globals))
+        globals.push_back(Global{ name(g.name), tac_type(g.type) });
+
+    for (FuncRec const& f : m.get<FuncRec>(t.funcs)) {
+        AST::FuncDefn& a = b.funcs.emplace_back(b.make<Symbol>(name(f.name), nullptr));
+        a.stackframe_size = f.frame_size;
+
+        if (stage == Stage::TAC) {
+            TAC::Values& vals = a.ctx.vals;
+            a.tac = m.get<TAC::Instr>(f.tac);
+            for (SymRec const& s : m.get<SymRec>(f.syms)) {
+                if (s.is_global && name(s.name).empty())
+                    m.bad();
+                vals.syms.push_back(TAC::SymInfo{ VarName{ var_kind(s.kind), s.num, name(s.name) }, tac_type(s.type), bool(s.in_mem), bool(s.is_global), s.fp_offset });
+            }
+            vals.ints = m.get<size_t>(f.ints);
+            vals.floats = m.get<double>(f.floats);
+            for (Span s : m.get<Span>(f.strs))
+                vals.strs.push_back(text(s));
+            for (CallRec const& c : m.get<CallRec>(f.calls))
+                vals.calls.push_back(TAC::Call{ name(c.name), c.first_param, c.nr_params });
+            vals.params = m.get<TAC::Val>(f.params);
+
+            if (!TAC::well_formed(a.tac, vals, strings))
+                m.bad();
+        } else {
+            for (MemRec const& r : m.get<MemRec>(f.mems)) {
+                // a global is addressed by its name
+                if (r.is_global && name(r.name).empty())
+                    m.bad();
+                a.rtl.mems.push_back(RTL::Mem{ VarName{ var_kind(r.kind), r.num, name(r.name) }, bool(r.is_global), r.fp_offset });
+            }
+            a.rtl.stmts = m.get<RTL::Stmt>(f.stmts);
+            for (RTL::Stmt& s : a.rtl.stmts) {
+                if (s.op >= RTL::Op::Nr)
+                    m.bad();
+                RTL::Operand* ops[] = { &s.x, &s.y, &s.z };
+                for (size_t k = 0; k < 3; ++k) {
+                    switch (RTL::desc(s.op).kinds[k]) {
+                    case RTL::Kind::REG:
+                        if (ops[k]->reg >= RegId::NONE)
+                            m.bad();
+                        break;
+                    case RTL::Kind::MEM:
+                        if (ops[k]->mem >= a.rtl.mems.size())
+                            m.bad();
+                        break;
+                    case RTL::Kind::FUNC:
+                        ops[k]->func = name(ops[k]->int_val);
+                        break;
+                    default:
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <ast.h>
+#include <io.h>
+#include <opt.h>
+#include <rtl.h>
+#include <tac.h>
+
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A file compiled up to its TAC or its RTL, kept so that another run can
+// take it from there without scanning and parsing it again. The IR of a
+// function goes in as the flat arrays it is kept in, so loading one is
+// mostly copying them out of the mapped file; only the names in it, which
+// are interned per process, need to be looked up again. Labels are
+// numbered program-wide already. Snapshots are in host byte order and
+// carry a version; a run only loads its own.
+namespace Snapshot {
+    // a global variable, as the data section needs it
+    struct Global {
+        Ident name;
+        TAC::Type type;
+    };
+
+    struct Span {
+        uint64_t offset;
+        uint64_t count;
+    };
+
+    struct FuncRec {
+        uint32_t name;
+        uint32_t pad;
+        uint64_t frame_size;
+        // TAC
+        Span tac, syms, ints, floats, strs, calls, params;
+        // RTL
+        Span stmts, mems;
+    };
+
+    // Writes the functions as they are handed over, in one pass, so that
+    // a snapshot can go to a pipe and the IR be dropped as it is written;
+    // what locates everything goes at the end
+    class Writer {
+        std::ostream& out;
+        Stage stage;
+        uint64_t size;
+
+        std::unordered_map<Ident, uint32_t> name_index;
+        std::vector<Span> names;
+        // the spelling of every name and string
+        std::string chars;
+        std::vector<FuncRec> funcs;
+
+        uint32_t name(Ident n);
+        Span add_chars(std::string const& s);
+        Span write(void const* data, size_t n, size_t elem_size);
+        template <typename T>
+        Span write(std::vector<T> const& v)
+        {
+            return write(v.data(), v.size(), sizeof(T));
+        }
+
+    public:
+        // stage is that of the IR handed over, TAC or RTL
+        Writer(std::ostream& out, Stage stage);
+
+        void add_func(AST::FuncDefn const& a);
+        // the string literals and the globals, once every function is in
+        void finish(RTL::Context const& strings, std::vector<Global> const& globals);
+    };
+
+    // Reads the snapshot of stage held in in into the funcs of b, strings
+    // and globals; path is that of its file, for errors
+    void load(IO::Input const& in, std::string const& path, Stage stage, AST::Builder& b, RTL::Context& strings, std::vector<Global>& globals);
+}
+
+#endif // SNAPSHOT_H
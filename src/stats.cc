@@ -0,0 +1,119 @@
+#include <stats.h>
+
+#include <algorithm>
+
+using namespace Stats;
+
+Counts::Counts(AST::FuncDefn const& a)
+    : Counts()
+{
+    tac = a.tac.size();
+    for (TAC::SymInfo const& s : a.ctx.vals.syms)
+        if (s.name.kind == VarName::Kind::TEMP)
+            ++temps;
+        else if (s.name.kind == VarName::Kind::STEMP)
+            ++stemps;
+    frame = a.stackframe_size;
+
+    int_regs = a.rtl.int_regs_peak;
+    float_regs = a.rtl.float_regs_peak;
+    for (RTL::Stmt const& s : a.rtl.stmts) {
+        if (s.op == RTL::Op::PUSH || s.op == RTL::Op::PUSH_D)
+            ++pushes;
+        else if (s.op == RTL::Op::POP || s.op == RTL::Op::POP_D)
+            ++pops;
+        cycles += RTL::desc(s.op).latency;
+    }
+
+    for (ASM::Instr const& i : a.mips_asm.instrs) {
+        if (!ASM::is_machine(i))
+            continue;
+        ++asm_instrs;
+        if (ASM::is_pseudo(i))
+            ++pseudo;
+        switch (i.op) {
+        case ASM::Op::LW:
+        case ASM::Op::L_D:
+            ++loads;
+            break;
+        case ASM::Op::SW:
+        case ASM::Op::S_D:
+            ++stores;
+            break;
+        case ASM::Op::JAL:
+        case ASM::Op::JALR:
+            ++calls;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void Counts::add(Counts const& c)
+{
+    tac += c.tac;
+    temps += c.temps;
+    stemps += c.stemps;
+    frame += c.frame;
+    int_regs = std::max(int_regs, c.int_regs);
+    float_regs = std::max(float_regs, c.float_regs);
+    loads += c.loads;
+    stores += c.stores;
+    calls += c.calls;
+    pushes += c.pushes;
+    pops += c.pops;
+    cycles += c.cycles;
+    asm_instrs += c.asm_instrs;
+    pseudo += c.pseudo;
+}
+
+Table::Table(std::ostream& out, Options const& options)
+    : out(out)
+{
+    Stage input = options.input_stage().value_or(Stage::AST);
+    has_tac = (options.stage >= Stage::TAC && input <= Stage::TAC);
+    has_regs = (options.stage >= Stage::RTL && input < Stage::RTL);
+    has_rtl = (options.stage >= Stage::RTL);
+    has_asm = (options.stage >= Stage::ASM);
+    out << "function\ttac\ttemps\tstemps\tframe\tint_regs\tfloat_regs\tloads\tstores\tcalls\tpushes\tpops\tcycles\tasm\tpseudo\n";
+}
+
+void Table::row(std::string const& name, Counts const& c)
+{
+    auto col = [&](bool has, size_t v) {
+        out << '\t';
+        if (has)
+            out << v;
+        else
+            out << '-';
+    };
+    out << name;
+    col(has_tac, c.tac);
+    col(has_tac, c.temps);
+    col(has_tac, c.stemps);
+    col(true, c.frame);
+    col(has_regs, c.int_regs);
+    col(has_regs, c.float_regs);
+    col(has_asm, c.loads);
+    col(has_asm, c.stores);
+    col(has_asm, c.calls);
+    col(has_rtl, c.pushes);
+    col(has_rtl, c.pops);
+    col(has_rtl, c.cycles);
+    col(has_asm, c.asm_instrs);
+    col(has_asm, c.pseudo);
+    out << '\n';
+}
+
+void Table::add_func(AST::FuncDefn const& a)
+{
+    Counts c(a);
+    row(a.func->name.str(), c);
+    total.add(c);
+}
+
+void Table::finish()
+{
+    row("total", total);
+}
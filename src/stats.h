@@ -0,0 +1,57 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <ast.h>
+#include <opt.h>
+
+#include <cstddef>
+#include <iostream>
+
+// Counters of the code generated for each function, for --stats, written
+// as a table of tab-separated columns under a header line:
+//
+//   function tac temps stemps frame int_regs float_regs loads stores calls
+//   pushes pops cycles asm pseudo
+//
+// tac is the TAC instructions, temps and stemps the temporaries among its
+// symbols, frame the stack frame size in bytes; int_regs and float_regs
+// the most registers of each class held at once, out of the 19 and 15 the
+// RegFile hands out; pushes and pops the RTL's, cycles the sum of the
+// latencies of its statements, a rough cost; loads, stores, calls and
+// asm the machine instructions of the assembly, and pseudo those of them
+// the assembler expands. The last row, "total", sums the rest but for the
+// registers, where it has the largest. A column of a stage this run did
+// not build is "-".
+namespace Stats {
+    struct Counts {
+        size_t tac, temps, stemps, frame;
+        unsigned int_regs, float_regs;
+        size_t loads, stores, calls, pushes, pops, cycles, asm_instrs, pseudo;
+
+        Counts()
+            : tac(0), temps(0), stemps(0), frame(0), int_regs(0), float_regs(0), loads(0), stores(0), calls(0), pushes(0), pops(0), cycles(0), asm_instrs(0), pseudo(0)
+        {
+        }
+        explicit Counts(AST::FuncDefn const& a);
+        void add(Counts const& c);
+    };
+
+    class Table {
+        std::ostream& out;
+        // which columns this run has
+        bool has_tac, has_regs, has_rtl, has_asm;
+        Counts total;
+
+        void row(std::string const& name, Counts const& c);
+
+    public:
+        // starts the table, for a file compiled with options
+        Table(std::ostream& out, Options const& options);
+
+        // before the function's IR is released or its assembly handed over
+        void add_func(AST::FuncDefn const& a);
+        void finish();
+    };
+}
+
+#endif // STATS_H
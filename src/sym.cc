@@ -1,102 +1,81 @@
 #include <algorithm>
 #include <cassert>
-#include <memory>
 #include <sym.h>
 #include <tac.h>
-#include <unordered_map>
 
-struct ScopeNode {
-    std::shared_ptr<ScopeNode> parent;
-
-    std::unordered_map<std::string, size_t> var_map;
-    std::vector<std::shared_ptr<Symbol>> var_list;
-
-    std::unordered_map<std::string, size_t> func_map;
-    std::vector<std::shared_ptr<Symbol>> func_list;
-
-    ScopeNode(std::shared_ptr<ScopeNode> parent)
-        : parent(parent)
-    {
-    }
-    bool is_global() const
-    {
-        return parent == nullptr;
-    }
-};
-
-SymbolTable::SymbolTable()
+SymbolTable::SymbolTable(Arena& arena)
+    : arena(arena)
 {
-    root = std::make_shared<ScopeNode>(nullptr);
-    curr = root;
 }
 
 void SymbolTable::begin_scope()
 {
-    std::shared_ptr<ScopeNode> child = std::make_shared<ScopeNode>(curr);
-    curr = child;
+    scope_start.push_back(undo_log.size());
 }
 void SymbolTable::end_scope()
 {
-    assert(curr->parent != nullptr);
-    curr = curr->parent;
+    assert(!scope_start.empty());
+    size_t start = scope_start.back();
+    scope_start.pop_back();
+    // undo the declarations made in this scope, uncovering what they shadowed
+    while (undo_log.size() > start) {
+        table[undo_log.back()].pop_back();
+        undo_log.pop_back();
+    }
 }
 
-std::shared_ptr<Symbol> SymbolTable::get_symbol(std::string name)
+SymbolTable::Entry const* SymbolTable::lookup(Ident name) const
 {
-    std::shared_ptr<ScopeNode> traversing = curr;
-    while (traversing != nullptr) {
-        auto it = traversing->var_map.find(name);
-        if (it != traversing->var_map.end())
-            return traversing->var_list[it->second];
-        it = traversing->func_map.find(name);
-        if (it != traversing->func_map.end())
-            return traversing->func_list[it->second];
-        traversing = traversing->parent;
-    }
-    return nullptr;
+    auto it = table.find(name);
+    if (it == table.end() || it->second.empty())
+        return nullptr;
+    return &it->second.back();
+}
+Symbol const* SymbolTable::insert(Symbol const& s)
+{
+    Symbol const* new_entry = arena.make<Symbol>(s);
+    table[s.name].push_back(Entry{ new_entry, depth() });
+    if (depth() > 0)
+        undo_log.push_back(s.name);
+    return new_entry;
 }
 
-std::shared_ptr<Symbol> SymbolTable::put_symbol(Symbol s)
+Symbol const* SymbolTable::get_symbol(Ident name)
 {
-    if (s.semtype->is_func()) {
-        // functions can't be declared with same name as vars in current scope
-        auto it1 = curr->var_map.find(s.name);
-        if (it1 != curr->var_map.end())
-            return nullptr;
+    Entry const* e = lookup(name);
+    return e == nullptr ? nullptr : e->sym;
+}
 
-        // same function can be declared multiple times in the same scope
+Symbol const* SymbolTable::put_symbol(Symbol s)
+{
+    Entry const* hit = lookup(s.name);
+    if (s.semtype->is_func()) {
+        // same function can be declared multiple times in any scope
         // provided type is same
         // each corresponds to the same function
-        auto hit = get_symbol(s.name);
+        // (this also rejects vars of the same name, in this scope or any outer one)
         if (hit != nullptr) {
-            if (hit->semtype != s.semtype)
+            if (hit->sym->semtype != s.semtype)
                 return nullptr;
             else
-                return hit;
+                return hit->sym;
         }
 
         s.is_global = true;
-        curr->func_map[s.name] = curr->func_list.size();
-
-        std::shared_ptr<Symbol> new_entry = std::make_shared<Symbol>(s);
-        curr->func_list.push_back(new_entry);
-        return new_entry;
+        return insert(s);
     } else {
-        auto it1 = curr->var_map.find(s.name);
-        if (it1 != curr->var_map.end())
-            return nullptr;
-        auto it2 = curr->func_map.find(s.name);
-        if (it2 != curr->func_map.end())
+        // vars can't redeclare anything from the current scope
+        if (hit != nullptr && hit->depth == depth())
             return nullptr;
-        s.is_global = (curr->is_global());
-        curr->var_map[s.name] = curr->var_list.size();
-        std::shared_ptr<Symbol> new_entry = std::make_shared<Symbol>(s);
-        curr->var_list.push_back(new_entry);
+        s.is_global = (depth() == 0);
+        Symbol const* new_entry = insert(s);
+        if (s.is_global)
+            global_vars.push_back(new_entry);
         return new_entry;
     }
 }
 
-std::vector<std::shared_ptr<Symbol>> const& SymbolTable::get_global_vars() const
+std::vector<Symbol const*> const& SymbolTable::get_global_vars() const
 {
-    return root->var_list;
+    return global_vars;
 }
@@ -1,41 +1,64 @@
 #ifndef SYM_H
 #define SYM_H
 
+#include <arena.h>
+#include <ident.h>
 #include <types.h>
 #include <string>
-#include <memory>
+#include <unordered_map>
+#include <vector>
 
 struct Symbol {
-    std::string name;
+    Ident name;
     SemType const* semtype;
 
     // only for vars
     bool is_const;
     bool is_global;
 
-    Symbol(std::string name, SemType const* st, bool is_const = false)
+    Symbol(Ident name, SemType const* st, bool is_const = false)
         : name(name), semtype(st), is_const(is_const)
     {
     }
 };
 
-struct ScopeNode;
-
+// Symbols are made in the arena the AST of their unit is, which outlives
+// the table; handles to them are plain pointers
 class SymbolTable {
 private:
-    std::shared_ptr<ScopeNode> root;
-    std::shared_ptr<ScopeNode> curr;
+    Arena& arena;
+
+    struct Entry {
+        Symbol const* sym;
+        size_t depth;
+    };
+    // every visible declaration of a name, innermost at the back
+    std::unordered_map<Ident, std::vector<Entry>> table;
+
+    // names declared in the open scopes, in order; scope_start holds the
+    // position in undo_log at which each non-global scope begins
+    std::vector<Ident> undo_log;
+    std::vector<size_t> scope_start;
+
+    std::vector<Symbol const*> global_vars;
+
+    size_t depth() const
+    {
+        return scope_start.size();
+    }
+    Entry const* lookup(Ident name) const;
+    Symbol const* insert(Symbol const& s);
 
 public:
-    SymbolTable();
+    SymbolTable(Arena& arena);
 
     void begin_scope();
     void end_scope();
 
-    std::shared_ptr<Symbol> get_symbol(std::string name);
-    std::shared_ptr<Symbol> put_symbol(Symbol s);
+    Symbol const* get_symbol(Ident name);
+    Symbol const* put_symbol(Symbol s);
 
-    std::vector<std::shared_ptr<Symbol>> const& get_global_vars() const;
+    std::vector<Symbol const*> const& get_global_vars() const;
 };
 
 #endif // SYM_H
@@ -2,96 +2,446 @@
 #include <tac.h>
 #include <types.h>
 #include <sym.h>
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 
 using namespace TAC;
 
-size_t Context::next_label = 0;
 Context::Context()
-    : next_temp(0), next_stemp(0),
+    : next_temp(0), next_stemp(0), next_label(0),
         stackframe_size(4), // TODO @nilabha justify these
         paramframe_size(8)
 {
 }
 
-std::string const Context::temp_prefix = "temp", Context::stemp_prefix = "stemp";
-std::string const Context::label_prefix = "Label";
+// whether s is prefix followed by the decimal spelling of some n
+static bool spells_numbered(std::string const& s, char const* prefix, uint32_t& n)
+{
+    size_t l = std::strlen(prefix);
+    if (s.size() <= l || s.size() > l + 9 || s.compare(0, l, prefix) != 0)
+        return false;
+    if (s[l] == '0' && s.size() > l + 1)
+        return false;
+    n = 0;
+    for (size_t i = l; i < s.size(); ++i) {
+        if (s[i] < '0' || s[i] > '9')
+            return false;
+        n = n * 10 + (s[i] - '0');
+    }
+    return true;
+}
 
-std::shared_ptr<Sym> Context::get_temp(Type t)
+// Temporaries and source symbols print in the same namespace, so a symbol
+// spelt like a temporary either takes that temporary's number out of
+// circulation or, if it has already been handed out, loses its own name.
+bool Context::claim_name(Ident name)
 {
-    std::string name = temp_prefix + std::to_string(next_temp);
-    next_temp++;
-    while (names_used.count(name) > 0) {
-        name = temp_prefix + std::to_string(next_temp);
-        next_temp++;
+    if (names_used.count(name) > 0)
+        return false;
+    uint32_t n;
+    if (spells_numbered(name.str(), VarName::temp_prefix, n)) {
+        if (n < next_temp)
+            return false;
+        temps_reserved.insert(n);
+    } else if (spells_numbered(name.str(), VarName::stemp_prefix, n)) {
+        if (n < next_stemp)
+            return false;
+        stemps_reserved.insert(n);
     }
     names_used.insert(name);
-    return std::make_shared<Sym>(name, t, false);
+    return true;
+}
+
+Val Context::get_temp(Type t)
+{
+    while (temps_reserved.count(next_temp) > 0)
+        next_temp++;
+    return vals.add_sym(VarName::temp(next_temp++), t, false);
 }
-std::shared_ptr<Sym> Context::get_stemp(Type t)
+Val Context::get_stemp(Type t)
 {
-    std::string name = stemp_prefix + std::to_string(next_stemp);
-    next_stemp++;
-    while (names_used.count(name) > 0) {
-        name = stemp_prefix + std::to_string(next_stemp);
+    while (stemps_reserved.count(next_stemp) > 0)
         next_stemp++;
-    }
-    names_used.insert(name);
 
-    std::shared_ptr<Sym> ret = std::make_shared<Sym>(name, t, true);
+    Val ret = vals.add_sym(VarName::stemp(next_stemp++), t, true);
     size_t sz = TAC::get_type_size(t);
-    ret->fp_offset = -(stackframe_size + sz - 4);
+    vals.sym(ret).fp_offset = -(stackframe_size + sz - 4);
     stackframe_size += sz;
     return ret;
 }
 
-std::shared_ptr<Sym> Context::get_symbol(std::shared_ptr<Symbol> s)
+Val Context::get_symbol(Symbol const* s)
 {
     auto it = table.find(s);
     if (it != table.end())
         return it->second;
 
-    std::shared_ptr<Sym> tacsym;
-    if (names_used.count(s->name) > 0)
+    Val tacsym;
+    if (!claim_name(s->name))
         tacsym = get_temp(s->semtype->to_tactype());
-    else {
-        names_used.insert(s->name);
-        tacsym = std::make_shared<Sym>(s->name, s->semtype->to_tactype(), true);
-    }
+    else
+        tacsym = vals.add_sym(VarName::of_sym(s->name), s->semtype->to_tactype(), true);
 
+    SymInfo& info = vals.sym(tacsym);
     if (!s->is_global) {
         size_t sz = s->semtype->size();
-        tacsym->fp_offset = -(stackframe_size + sz - 4);
+        info.fp_offset = -(stackframe_size + sz - 4);
         stackframe_size += sz;
     } else{
-        tacsym->is_global = true;
-        tacsym->fp_offset = -1;
+        info.is_global = true;
+        info.fp_offset = -1;
     }
     table[s] = tacsym;
     return tacsym;
 }
-std::shared_ptr<Sym> Context::add_param_symbol(std::shared_ptr<Symbol> s)
+Val Context::add_param_symbol(Symbol const* s)
 {
     auto it = table.find(s);
     assert(it == table.end());
 
-    std::shared_ptr<Sym> tacsym;
-    assert(names_used.count(s->name) == 0);
-    names_used.insert(s->name);
-    tacsym = std::make_shared<Sym>(s->name, s->semtype->to_tactype(), true);
+    bool claimed = claim_name(s->name);
+    assert(claimed);
+    Val tacsym = vals.add_sym(VarName::of_sym(s->name), s->semtype->to_tactype(), true);
 
     assert(!s->is_global);
-    tacsym->fp_offset = paramframe_size;
+    vals.sym(tacsym).fp_offset = paramframe_size;
     paramframe_size += s->semtype->size();
     table[s] = tacsym;
     return tacsym;
 }
-std::shared_ptr<Label> Context::get_label()
+std::vector<Symbol const*> Context::get_symbols() const
+{
+    std::vector<std::pair<uint32_t, Symbol const*>> v;
+    for (auto const& e : table)
+        v.emplace_back(e.second.index(), e.first);
+    std::sort(v.begin(), v.end(), [](auto const& x, auto const& y) { return x.first < y.first; });
+    std::vector<Symbol const*> syms;
+    for (auto const& e : v)
+        syms.push_back(e.second);
+    return syms;
+}
+LabelId Context::get_label()
+{
+    return LabelId{ next_label++ };
+}
+
+void TAC::renumber_labels(std::vector<Instr>& code, LabelMap const& map)
+{
+    for (Instr& i : code)
+        if (i.op == Op::LABEL || i.op == Op::GOTO || i.op == Op::IF_GOTO)
+            i.dst = Val::of_label(map(i.dst.label()));
+}
+
+namespace {
+    // the kinds of value each operand slot of a TAC op takes, as masks of
+    // 1 << Val::Kind
+    constexpr unsigned NONE = 1u << (unsigned)Val::Kind::NONE;
+    constexpr unsigned SYM = 1u << (unsigned)Val::Kind::SYM;
+    constexpr unsigned VALUE = SYM | 1u << (unsigned)Val::Kind::INT | 1u << (unsigned)Val::Kind::FLOAT | 1u << (unsigned)Val::Kind::STR;
+    constexpr unsigned LABEL = 1u << (unsigned)Val::Kind::LABEL;
+    constexpr unsigned CALL = 1u << (unsigned)Val::Kind::CALL;
+    struct Slots {
+        unsigned dst, a, b;
+    };
+    Slots slots(Op op)
+    {
+        switch (op) {
+        case Op::COPY:
+        case Op::NEG:
+        case Op::NOT:
+            return Slots{ SYM, VALUE, NONE };
+        case Op::ADDR:
+        case Op::DEREF:
+            return Slots{ SYM, SYM, NONE };
+        case Op::CALL:
+            return Slots{ SYM | NONE, NONE, CALL };
+        case Op::CALL_PTR:
+            return Slots{ SYM | NONE, VALUE, CALL };
+        case Op::ADDR_ASSIGN:
+            return Slots{ NONE, SYM, VALUE };
+        case Op::PRINT:
+        case Op::READ_INT:
+        case Op::READ_FLOAT:
+            return Slots{ NONE, VALUE, NONE };
+        case Op::LABEL:
+        case Op::GOTO:
+            return Slots{ LABEL, NONE, NONE };
+        case Op::IF_GOTO:
+            return Slots{ LABEL, VALUE, NONE };
+        case Op::RETURN:
+            return Slots{ NONE, SYM, NONE };
+        default:
+            // the binary operators
+            return Slots{ SYM, VALUE, VALUE };
+        }
+    }
+}
+
+bool TAC::well_formed(std::vector<Instr> const& code, Values const& vals, RTL::Context const& strings)
 {
-    std::string name = label_prefix + std::to_string(next_label);
-    next_label++;
-    return std::make_shared<Label>(name);
+    auto val = [&](Val v, unsigned kinds) {
+        size_t n;
+        switch (v.kind()) {
+        case Val::Kind::NONE:
+            n = 1;
+            break;
+        case Val::Kind::SYM:
+            n = vals.syms.size();
+            break;
+        case Val::Kind::INT:
+            n = vals.ints.size();
+            break;
+        case Val::Kind::FLOAT:
+            n = vals.floats.size();
+            break;
+        case Val::Kind::STR:
+            n = vals.strs.size();
+            break;
+        case Val::Kind::LABEL:
+            n = SIZE_MAX;
+            break;
+        case Val::Kind::CALL:
+            n = vals.calls.size();
+            break;
+        default:
+            return false;
+        }
+        return (kinds & 1u << (unsigned)v.kind()) != 0 && v.index() < n;
+    };
+    for (Instr const& i : code) {
+        if (i.op > Op::RETURN || i.type > Type::PTR)
+            return false;
+        Slots k = slots(i.op);
+        if (!val(i.dst, k.dst) || !val(i.a, k.a) || !val(i.b, k.b))
+            return false;
+    }
+    for (Call const& c : vals.calls)
+        if (c.first_param > vals.params.size() || c.nr_params > vals.params.size() - c.first_param)
+            return false;
+    for (Val v : vals.params)
+        if (!val(v, VALUE))
+            return false;
+    for (std::string const& s : vals.strs)
+        if (strings.string_ids.count(s) == 0)
+            return false;
+    return true;
+}
+
+Instr Context::expr(Op op, Val dst, Val a, Val b) const
+{
+    Type t;
+    switch (op) {
+    case Op::COPY:
+    case Op::ADD:
+    case Op::SUB:
+    case Op::MUL:
+    case Op::DIV:
+    case Op::NEG:
+        t = vals.type_of(a);
+        break;
+    case Op::ADDR:
+        t = Type::PTR;
+        break;
+    default:
+        // comparisons and logic
+        t = Type::BOOL;
+    }
+    return Instr{ op, t, dst, a, b };
+}
+Instr Context::deref(Type t, Val dst, Val a) const
+{
+    return Instr{ Op::DEREF, t, dst, a, Val() };
+}
+Instr Context::stmt(Op op, Val a, Val b) const
+{
+    return Instr{ op, vals.type_of(b.is_none() ? a : b), Val(), a, b };
+}
+Instr Context::call(Val dst, Type t, Ident func_name, std::vector<Val> const& params)
+{
+    return Instr{ Op::CALL, t, dst, Val(), vals.add_call(func_name, params) };
+}
+Instr Context::call_ptr(Val dst, Type t, Val func_ptr, std::vector<Val> const& params)
+{
+    return Instr{ Op::CALL_PTR, t, dst, func_ptr, vals.add_call(Ident::none(), params) };
+}
+
+Val Values::add_sym(VarName name, Type t, bool in_mem)
+{
+    syms.push_back(SymInfo{ name, t, in_mem, false, 0 });
+    return Val(Val::Kind::SYM, syms.size() - 1);
+}
+Val Values::int_lit(size_t v)
+{
+    ints.push_back(v);
+    return Val(Val::Kind::INT, ints.size() - 1);
+}
+Val Values::float_lit(double v)
+{
+    floats.push_back(v);
+    return Val(Val::Kind::FLOAT, floats.size() - 1);
+}
+Val Values::str_lit(std::string const& v)
+{
+    strs.push_back(v);
+    return Val(Val::Kind::STR, strs.size() - 1);
+}
+Val Values::add_call(Ident func_name, std::vector<Val> const& p)
+{
+    calls.push_back(Call{ func_name, (uint32_t)params.size(), (uint32_t)p.size() });
+    params.insert(params.end(), p.begin(), p.end());
+    return Val(Val::Kind::CALL, calls.size() - 1);
+}
+
+Type Values::type_of(Val v) const
+{
+    switch (v.kind()) {
+    case Val::Kind::SYM:
+        return syms[v.index()].type;
+    case Val::Kind::INT:
+        return Type::INT;
+    case Val::Kind::FLOAT:
+        return Type::FLOAT;
+    case Val::Kind::STR:
+        return Type::STRING;
+    default:
+        assert(false);
+    }
+}
+
+void Values::print(std::ostream& o, Val v) const
+{
+    switch (v.kind()) {
+    case Val::Kind::SYM:
+        o << syms[v.index()].name;
+        break;
+    case Val::Kind::INT:
+        o << ints[v.index()];
+        break;
+    case Val::Kind::FLOAT:
+        o << floats[v.index()];
+        break;
+    case Val::Kind::STR:
+        o << '"';
+        print_string_escapes(strs[v.index()], o);
+        o << '"';
+        break;
+    default:
+        assert(false);
+    }
+}
+
+void Values::print(std::ostream& o, Instr const& i) const
+{
+    static char const* const op_text[] = {
+        "", "+", "-", "*", "/", "-",
+        "==", "!=", ">", "<", ">=", "<=",
+        "!", "&&", "||"
+    };
+
+    switch (i.op) {
+    case Op::COPY:
+        o << '\t' << sym(i.dst).name << " = ";
+        print(o, i.a);
+        o << '\n';
+        break;
+    case Op::NEG:
+    case Op::NOT:
+        o << '\t' << sym(i.dst).name << " = " << op_text[(size_t)i.op] << ' ';
+        print(o, i.a);
+        o << '\n';
+        break;
+    case Op::ADD:
+    case Op::SUB:
+    case Op::MUL:
+    case Op::DIV:
+    case Op::EQ:
+    case Op::NE:
+    case Op::GT:
+    case Op::LT:
+    case Op::GE:
+    case Op::LE:
+    case Op::AND:
+    case Op::OR:
+        o << '\t' << sym(i.dst).name << " = ";
+        print(o, i.a);
+        o << " " << op_text[(size_t)i.op] << " ";
+        print(o, i.b);
+        o << '\n';
+        break;
+    case Op::ADDR:
+        o << '\t' << sym(i.dst).name << " = &";
+        print(o, i.a);
+        o << '\n';
+        break;
+    case Op::DEREF:
+        o << '\t' << sym(i.dst).name << " = *";
+        print(o, i.a);
+        o << '\n';
+        break;
+    case Op::CALL:
+    case Op::CALL_PTR:
+        {
+            o << '\t';
+            if (!i.dst.is_none())
+                o << sym(i.dst).name << " = ";
+            Call const& c = call(i.b);
+            if (i.op == Op::CALL)
+                o << c.func_name << '(';
+            else {
+                o << "(*";
+                print(o, i.a);
+                o << ")(";
+            }
+            for (uint32_t k = 0; k < c.nr_params; ++k) {
+                if (k > 0)
+                    o << ", ";
+                print(o, params[c.first_param + k]);
+            }
+            o << ")\n";
+        }
+        break;
+    case Op::ADDR_ASSIGN:
+        o << '\t' << "*";
+        print(o, i.a);
+        o << " = ";
+        print(o, i.b);
+        o << '\n';
+        break;
+    case Op::PRINT:
+        o << "\twrite  ";
+        print(o, i.a);
+        o << '\n';
+        break;
+    case Op::READ_INT:
+        o << "\treadi  ";
+        print(o, i.a);
+        o << '\n';
+        break;
+    case Op::READ_FLOAT:
+        o << "\treadf  ";
+        print(o, i.a);
+        o << '\n';
+        break;
+    case Op::LABEL:
+        o << i.dst.label() << ":\n";
+        break;
+    case Op::GOTO:
+        o << "\tgoto " << i.dst.label() << '\n';
+        break;
+    case Op::IF_GOTO:
+        o << "\tif(";
+        print(o, i.a);
+        o << ") goto " << i.dst.label() << '\n';
+        break;
+    case Op::RETURN:
+        o << "\t return ";
+        print(o, i.a);
+        o << "\n";
+        break;
+    }
 }
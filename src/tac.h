@@ -2,10 +2,13 @@
 #define TAC_H
 
 #include <cassert>
+#include <cstdint>
 #include <iostream>
 #include <memory>
+#include <names.h>
+#include <optional>
 #include <rtl.h>
-#include <stack>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -13,8 +16,12 @@
 struct Symbol;
 void print_string_escapes(std::string, std::ostream&);
 
+// A function's TAC is a flat array of fixed-size Instrs. Operands are small
+// tagged indices into the value tables of the function (Values), so an
+// instruction owns no memory of its own and the array can be walked,
+// copied or spliced without touching the heap per statement.
 namespace TAC {
-    enum class Type {
+    enum class Type : uint8_t {
         BOOL, INT, FLOAT, STRING, PTR
     };
     static inline size_t get_type_size(Type t)
@@ -23,384 +30,199 @@ namespace TAC {
         return s[(size_t)t];
     }
 
-    struct Base {
-        virtual void print(std::ostream&) const = 0;
-    };
-
-    struct Stmt : public Base {
-        virtual void gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) = 0;
-    };
-    struct Expr : public Base {
-        Type const type;
-        std::shared_ptr<RTL::Register> reg = nullptr;
-        Expr(Type t)
-            : type(t)
-        {
-        }
-        virtual std::shared_ptr<RTL::Register> gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) = 0;
-    };
-
-    struct Val : public Expr {
-        Val(Type t)
-            : Expr(t)
-        {
-        }
-        virtual void gen_print_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) = 0;
-        virtual void gen_push_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) = 0;
-    };
-    struct UnExpr : public Expr {
-        std::shared_ptr<Val> const lhs;
-        UnExpr(Type t, std::shared_ptr<Val> l, std::string const print_op) : Expr(t), lhs(l), print_op(print_op) {}
-        void print(std::ostream& o) const override
-        {
-            o << print_op << ' ';
-            lhs->print(o);
-        }
-
-    private:
-        std::string const print_op;
-    };
-    struct BinExpr : public Expr {
-        std::shared_ptr<Val> const lhs, rhs;
-        BinExpr(Type t, std::shared_ptr<Val> l, std::shared_ptr<Val> r, std::string const print_op) : Expr(t), lhs(l), rhs(r), print_op(print_op) {}
-        void print(std::ostream& o) const override
-        {
-            lhs->print(o);
-            o << " " << print_op << " ";
-            rhs->print(o);
-        }
+    enum class Op : uint8_t {
+        // dst = a, dst = a op b, dst = op a
+        COPY, ADD, SUB, MUL, DIV, NEG,
+        EQ, NE, GT, LT, GE, LE,
+        NOT, AND, OR,
+        // dst = &a, dst = *a
+        ADDR, DEREF,
+        // [dst =] call, b being the call site and a the callee of CALL_PTR;
+        // dst is none for calls whose value is ignored
+        CALL, CALL_PTR,
+        // *a = b
+        ADDR_ASSIGN,
+        PRINT, READ_INT, READ_FLOAT,
+        // labels travel in dst
+        LABEL, GOTO, IF_GOTO,
+        RETURN
+    };
+
+    // operand slot: an index into one of the value tables, tagged in its top
+    // bits with which one
+    class Val {
+    public:
+        enum class Kind : uint32_t {
+            NONE, SYM, INT, FLOAT, STR, LABEL, CALL
+        };
 
     private:
-        std::string const print_op;
-    };
-
-    struct Sym : public Val {
-        std::string name;
-
-        bool in_mem;
-        bool is_global;
-        ssize_t fp_offset;
+        static constexpr unsigned KIND_SHIFT = 29;
+        uint32_t bits;
 
-        Sym(std::string n, Type t, bool in_mem)
-            : Val(t), name(n), in_mem(in_mem), is_global(false)
+    public:
+        Val() : bits(0) {}
+        Val(Kind k, uint32_t index)
+            : bits((uint32_t)k << KIND_SHIFT | index)
         {
+            assert(index < (1u << KIND_SHIFT));
         }
-        void print(std::ostream& o) const override
+        static Val of_label(LabelId l)
         {
-            o << name;
+            return Val(Kind::LABEL, l.num);
         }
-        std::shared_ptr<RTL::Register> gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-        void gen_print_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-        void gen_push_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
 
-    struct IntLit : public Val {
-        size_t val;
-        IntLit(size_t v) : Val(Type::INT), val(v) {}
-        void print(std::ostream& o) const override
+        Kind kind() const
         {
-            o << val;
+            return Kind(bits >> KIND_SHIFT);
         }
-        std::shared_ptr<RTL::Register> gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-        void gen_print_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-        void gen_push_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct FloatLit : public Val {
-        double val;
-        FloatLit(double v) : Val(Type::FLOAT), val(v) {}
-        void print(std::ostream& o) const override
+        uint32_t index() const
         {
-            o << val;
+            return bits & ((1u << KIND_SHIFT) - 1);
         }
-        std::shared_ptr<RTL::Register> gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-        void gen_print_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-        void gen_push_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct StrLit : public Val {
-        std::string val;
-        StrLit(std::string v) : Val(Type::STRING), val(v) {}
-        void print(std::ostream& o) const override
+        bool is_none() const
         {
-            o << '"';
-            print_string_escapes(val, o);
-            o << '"';
+            return bits == 0;
         }
-        std::shared_ptr<RTL::Register> gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-        void gen_print_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-        void gen_push_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-
-    struct AddExpr : public BinExpr {
-        AddExpr(std::shared_ptr<Val> l, std::shared_ptr<Val> r) : BinExpr(l->type, l, r, "+") {}
-        std::shared_ptr<RTL::Register> gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct SubExpr : public BinExpr {
-        SubExpr(std::shared_ptr<Val> l, std::shared_ptr<Val> r) : BinExpr(l->type, l, r, "-") {}
-        std::shared_ptr<RTL::Register> gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct NegExpr : public UnExpr {
-        NegExpr(std::shared_ptr<Val> l) : UnExpr(l->type, l, "-") {}
-        std::shared_ptr<RTL::Register> gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct MulExpr : public BinExpr {
-        MulExpr(std::shared_ptr<Val> l, std::shared_ptr<Val> r) : BinExpr(l->type, l, r, "*") {}
-        std::shared_ptr<RTL::Register> gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct DivExpr : public BinExpr {
-        DivExpr(std::shared_ptr<Val> l, std::shared_ptr<Val> r) : BinExpr(l->type, l, r, "/") {}
-        std::shared_ptr<RTL::Register> gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct EqualExpr : public BinExpr {
-        EqualExpr(std::shared_ptr<Val> l, std::shared_ptr<Val> r) : BinExpr(Type::BOOL, l, r, "==") {}
-        std::shared_ptr<RTL::Register> gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct NotEqualExpr : public BinExpr {
-        NotEqualExpr(std::shared_ptr<Val> l, std::shared_ptr<Val> r) : BinExpr(Type::BOOL, l, r, "!=") {}
-        std::shared_ptr<RTL::Register> gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct GreaterExpr : public BinExpr {
-        GreaterExpr(std::shared_ptr<Val> l, std::shared_ptr<Val> r) : BinExpr(Type::BOOL, l, r, ">") {}
-        std::shared_ptr<RTL::Register> gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct LessExpr : public BinExpr {
-        LessExpr(std::shared_ptr<Val> l, std::shared_ptr<Val> r) : BinExpr(Type::BOOL, l, r, "<") {}
-        std::shared_ptr<RTL::Register> gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct GreaterEqualExpr : public BinExpr {
-        GreaterEqualExpr(std::shared_ptr<Val> l, std::shared_ptr<Val> r) : BinExpr(Type::BOOL, l, r, ">=") {}
-        std::shared_ptr<RTL::Register> gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct LessEqualExpr : public BinExpr {
-        LessEqualExpr(std::shared_ptr<Val> l, std::shared_ptr<Val> r) : BinExpr(Type::BOOL, l, r, "<=") {}
-        std::shared_ptr<RTL::Register> gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct NotExpr : public UnExpr {
-        NotExpr(std::shared_ptr<Val> l) : UnExpr(Type::BOOL, l, "!") {}
-        std::shared_ptr<RTL::Register> gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct AndExpr : public BinExpr {
-        AndExpr(std::shared_ptr<Val> l, std::shared_ptr<Val> r) : BinExpr(Type::BOOL, l, r, "&&") {}
-        std::shared_ptr<RTL::Register> gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct OrExpr : public BinExpr {
-        OrExpr(std::shared_ptr<Val> l, std::shared_ptr<Val> r) : BinExpr(Type::BOOL, l, r, "||") {}
-        std::shared_ptr<RTL::Register> gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct CallExpr : public Expr {
-        std::vector<std::shared_ptr<Val>> params;
-        CallExpr(Type t, std::vector<std::shared_ptr<Val>> params) : Expr(t), params(params) {}
-    };
-    struct FuncCallExpr : public CallExpr {
-        std::string func_name;
-        FuncCallExpr(Type t, std::string func_name, std::vector<std::shared_ptr<Val>> const& params) : CallExpr(t, params), func_name(func_name) {}
-        void print(std::ostream& o) const override
-        {
-            o << func_name << '(';
-            if (params.size() > 0) {
-                auto it = params.begin(), ite = params.end();
-                (*it)->print(o);
-                ++it;
-                while (it != ite) {
-                    o << ", ";
-                    (*it)->print(o);
-                    ++it;
-                }
-            }
-            o << ')';
-        }
-        std::shared_ptr<RTL::Register> gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct FuncPtrCallExpr : public CallExpr {
-        std::shared_ptr<Val> func_ptr;
-        FuncPtrCallExpr(Type t, std::shared_ptr<Val> func_ptr, std::vector<std::shared_ptr<Val>> const& params) : CallExpr(t, params), func_ptr(func_ptr) {}
-        void print(std::ostream& o) const override
+        LabelId label() const
         {
-            o << "(*";
-            func_ptr->print(o);
-            o << ")(";
-            if (params.size() > 0) {
-                auto it = params.begin(), ite = params.end();
-                (*it)->print(o);
-                ++it;
-                while (it != ite) {
-                    o << ", ";
-                    (*it)->print(o);
-                    ++it;
-                }
-            }
-            o << ')';
+            assert(kind() == Kind::LABEL);
+            return LabelId{ index() };
         }
-        std::shared_ptr<RTL::Register> gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct DerefExpr : public Expr {
-        std::shared_ptr<Val> const arg;
-        DerefExpr(Type t, std::shared_ptr<Val> a) : Expr(t), arg(a) {}
-        void print(std::ostream& o) const override
-        {
-            o << "*";
-            arg->print(o);
-        }
-        std::shared_ptr<RTL::Register> gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct AddrExpr : public Expr {
-        std::shared_ptr<Sym> const arg;
-        AddrExpr(std::shared_ptr<Sym> a) : Expr(Type::PTR), arg(a) {}
-        void print(std::ostream& o) const override
-        {
-            o << "&";
-            arg->print(o);
-        }
-        std::shared_ptr<RTL::Register> gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
     };
 
-    struct PrintStmt : public Stmt {
-        std::shared_ptr<Val> const arg;
-        PrintStmt(std::shared_ptr<Val> a) : arg(a) {}
-        void print(std::ostream& o) const override
-        {
-            o << "\twrite  ";
-            arg->print(o);
-            o << '\n';
-        }
-        void gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct ReadIntStmt : public Stmt {
-        std::shared_ptr<Val> const loc;
-        ReadIntStmt(std::shared_ptr<Val> l) : loc(l) {}
-        void print(std::ostream& o) const override
-        {
-            o << "\treadi  ";
-            loc->print(o);
-            o << '\n';
-        }
-        void gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct ReadFloatStmt : public Stmt {
-        std::shared_ptr<Val> const loc;
-        ReadFloatStmt(std::shared_ptr<Val> l) : loc(l) {}
-        void print(std::ostream& o) const override
+    struct Instr {
+        Op op;
+        // of the value computed; for ADDR_ASSIGN, of the value stored
+        Type type;
+        Val dst;
+        Val a, b;
+
+        static Instr label(LabelId l)
         {
-            o << "\treadf  ";
-            loc->print(o);
-            o << '\n';
+            return Instr{ Op::LABEL, Type::INT, Val::of_label(l), Val(), Val() };
         }
-        void gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct AssignStmt : public Stmt {
-        std::shared_ptr<Sym> const lhs;
-        std::shared_ptr<Expr> const rhs;
-        AssignStmt(std::shared_ptr<Sym> l, std::shared_ptr<Expr> r) : lhs(l), rhs(r) {}
-        void print(std::ostream& o) const override
+        static Instr goto_(LabelId l)
         {
-            o << '\t' << lhs->name << " = ";
-            rhs->print(o);
-            o << '\n';
+            return Instr{ Op::GOTO, Type::INT, Val::of_label(l), Val(), Val() };
         }
-        void gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct AddrAssignStmt : public Stmt {
-        std::shared_ptr<Val> const lhs;
-        std::shared_ptr<Expr> const rhs;
-        AddrAssignStmt(std::shared_ptr<Val> l, std::shared_ptr<Expr> r) : lhs(l), rhs(r) {}
-        void print(std::ostream& o) const override
+        static Instr if_goto(Val cond, LabelId l)
         {
-            o << '\t' << "*";
-            lhs->print(o);
-            o << " = ";
-            rhs->print(o);
-            o << '\n';
+            return Instr{ Op::IF_GOTO, Type::BOOL, Val::of_label(l), cond, Val() };
         }
-        void gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
     };
-    struct Label : public Stmt {
-        std::string name;
-        Label(std::string n) : name(n) {}
-        void print(std::ostream& o) const override
-        {
-            o << name << ":\n";
-        }
-        void gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
+    static_assert(sizeof(Instr) == 16, "Instr should stay four words");
+
+    // a symbol or temporary of the function
+    struct SymInfo {
+        VarName name;
+        Type type;
+        bool in_mem;
+        bool is_global;
+        ssize_t fp_offset;
     };
-    struct GotoStmt : public Stmt {
-        std::shared_ptr<Label> const label;
-        GotoStmt(std::shared_ptr<Label> l) : label(l) {}
-        void print(std::ostream& o) const override
-        {
-            o << "\tgoto " << label->name << '\n';
-        }
-        void gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
+    // a call site; its params are a run of Values::params
+    struct Call {
+        Ident func_name;    // none for calls through a pointer
+        uint32_t first_param;
+        uint32_t nr_params;
     };
-    struct IfGotoStmt : public Stmt {
-        std::shared_ptr<Val> const cond;
-        std::shared_ptr<Label> const label;
-        IfGotoStmt(std::shared_ptr<Val> c, std::shared_ptr<Label> l) : cond(c), label(l) {}
-        void print(std::ostream& o) const override
+
+    struct Values {
+        std::vector<SymInfo> syms;
+        std::vector<size_t> ints;
+        std::vector<double> floats;
+        std::vector<std::string> strs;
+        std::vector<Call> calls;
+        std::vector<Val> params;
+
+        Val add_sym(VarName name, Type t, bool in_mem);
+        Val int_lit(size_t v);
+        Val float_lit(double v);
+        Val str_lit(std::string const& v);
+        Val add_call(Ident func_name, std::vector<Val> const& params);
+
+        SymInfo& sym(Val v)
         {
-            o << "\tif(";
-            cond->print(o);
-            o << ") goto " << label->name << '\n';
+            assert(v.kind() == Val::Kind::SYM);
+            return syms[v.index()];
         }
-        void gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct CallStmt : public Stmt {
-        std::shared_ptr<CallExpr> const e;
-        CallStmt(std::shared_ptr<CallExpr> e) : e(e) {}
-        void print(std::ostream& o) const override
+        SymInfo const& sym(Val v) const
         {
-            o << "\t";
-            e->print(o);
-            o << "\n";
+            assert(v.kind() == Val::Kind::SYM);
+            return syms[v.index()];
         }
-        void gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
-    };
-    struct ReturnStmt : public Stmt {
-        std::shared_ptr<Sym> const ret;
-        ReturnStmt(std::shared_ptr<Sym> ret) : ret(ret) {};
-        void print(std::ostream& o) const override
+        Call const& call(Val v) const
         {
-            o << "\t return ";
-            ret->print(o);
-            o << "\n";
+            assert(v.kind() == Val::Kind::CALL);
+            return calls[v.index()];
         }
-        void gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts) override;
+        Type type_of(Val v) const;
+
+        void print(std::ostream&, Val) const;
+        void print(std::ostream&, Instr const&) const;
     };
 
     class Context {
-        static std::string const temp_prefix, stemp_prefix;
-        static std::string const symbol_suffix;
-        static std::string const label_prefix;
-
         // variables
-        size_t next_temp;
-        size_t next_stemp;
-        std::unordered_set<std::string> names_used;
-        std::unordered_map<std::shared_ptr<Symbol>, std::shared_ptr<TAC::Sym>> table;
+        uint32_t next_temp;
+        uint32_t next_stemp;
+        std::unordered_set<Ident> names_used;
+        // numbers of temporaries whose spelling a source symbol has taken
+        std::unordered_set<uint32_t> temps_reserved, stemps_reserved;
+        std::unordered_map<Symbol const*, Val> table;
 
-        // labels
-        static size_t next_label;   // shared across contexts, hence static
+        // labels, numbered within the function; see LabelMap
+        uint32_t next_label;
+
+        bool claim_name(Ident name);
 
         // for assembly generation
         size_t stackframe_size;
         size_t paramframe_size;
 
     public:
+        Values vals;
+
         Context();
         size_t get_stackframe_size() const
         {
             return stackframe_size;
         }
 
-        std::shared_ptr<Sym> get_temp(Type t);
-        std::shared_ptr<Sym> get_stemp(Type t);
-        std::shared_ptr<Sym> get_symbol(std::shared_ptr<Symbol>);
-        std::shared_ptr<Sym> add_param_symbol(std::shared_ptr<Symbol>);
-        static std::shared_ptr<Label> get_label();
+        Val get_temp(Type t);
+        Val get_stemp(Type t);
+        Val get_symbol(Symbol const*);
+        Val add_param_symbol(Symbol const*);
+        // the symbols given slots so far, in the order they were
+        std::vector<Symbol const*> get_symbols() const;
+        LabelId get_label();
+        uint32_t get_nr_labels() const
+        {
+            return next_label;
+        }
+
+        // dst = a op b (or op a, or &a), typed after its operands
+        Instr expr(Op op, Val dst, Val a, Val b = Val()) const;
+        Instr deref(Type t, Val dst, Val a) const;
+        // PRINT, READ_*, RETURN and ADDR_ASSIGN, typed after the value moved
+        Instr stmt(Op op, Val a, Val b = Val()) const;
+        // dst is none, and t unused, for calls whose value is ignored
+        Instr call(Val dst, Type t, Ident func_name, std::vector<Val> const& params);
+        Instr call_ptr(Val dst, Type t, Val func_ptr, std::vector<Val> const& params);
 
-        std::shared_ptr<Label> return_label;
-        std::shared_ptr<Sym> return_sym;
-        std::shared_ptr<Label> break_label, continue_label;
+        std::optional<LabelId> return_label;
+        Val return_sym;
+        std::optional<LabelId> break_label, continue_label;
     };
 
+    void renumber_labels(std::vector<Instr>& code, LabelMap const& map);
+    // Whether code fits vals, as TAC read back from a snapshot or dump must
+    // before it is lowered: each op and type is one there is, each operand
+    // is of a kind its slot takes and indexes a value there is, each call's
+    // params lie within vals.params, and each string is one of strings.
+    bool well_formed(std::vector<Instr> const& code, Values const& vals, RTL::Context const& strings);
+    void gen_rtl(std::vector<Instr> const& code, Values const& vals, RTL::Context const& strings, RTL::Code& rtl);
 }
 
 #endif // TAC_H
@@ -5,847 +5,509 @@
 #include <error.h>
 #include <cassert>
 
-using Register = RTL::Register;
-using RTLStmtList = std::vector<std::shared_ptr<RTL::Stmt>>;
-
-std::string RTL::Context::get_string_id(std::string val)
-{
-    auto const itb = string_store.begin(), ite = string_store.end();
-    size_t s;
-    std::vector<std::string>::iterator it;
-    if ((it = std::find(itb, ite, val)) != ite)
-        s = it - itb;
-    else {
-        s = string_store.size();
-        string_store.push_back(val);
+Ident RTL::Context::add_string(std::string const& val)
+{
+    std::lock_guard<std::mutex> l(m);
+    auto it = string_ids.find(val);
+    if (it != string_ids.end())
+        return it->second;
+
+    Ident id("_str_" + std::to_string(string_store.size()));
+    string_store.push_back(val);
+    string_ids.emplace(val, id);
+    return id;
+}
+Ident RTL::Context::string_id(std::string const& val) const
+{
+    std::lock_guard<std::mutex> l(m);
+    auto it = string_ids.find(val);
+    assert(it != string_ids.end());
+    return it->second;
+}
+
+namespace {
+    using TAC::Op;
+    using TAC::Type;
+
+    // the RTL opcode computing a TAC op, by TAC::Op order; the double
+    // variant comes from the descriptor table
+    RTL::Op arith_op(Op op, bool is_float)
+    {
+        static RTL::Op const int_ops[] = {
+            RTL::Op::MOVE, RTL::Op::ADD, RTL::Op::SUB, RTL::Op::MUL, RTL::Op::DIV, RTL::Op::UMINUS,
+            RTL::Op::SEQ, RTL::Op::SNE, RTL::Op::SGT, RTL::Op::SLT, RTL::Op::SGE, RTL::Op::SLE,
+            RTL::Op::NOT, RTL::Op::AND, RTL::Op::OR
+        };
+        assert((size_t)op < sizeof(int_ops) / sizeof(int_ops[0]));
+        RTL::Op r = int_ops[(size_t)op];
+        return is_float ? RTL::desc(r).float_variant : r;
     }
 
-    return "_str_" + std::to_string(s);
-}
-
-RTL::Context ctx;
-
-size_t constexpr NUM_INT_REGISTERS = 19;
-std::shared_ptr<Register> int_register_list[NUM_INT_REGISTERS] = {
-    std::make_shared<Register>("v0"),
-    std::make_shared<Register>("t0"),
-    std::make_shared<Register>("t1"),
-    std::make_shared<Register>("t2"),
-    std::make_shared<Register>("t3"),
-    std::make_shared<Register>("t4"),
-    std::make_shared<Register>("t5"),
-    std::make_shared<Register>("t6"),
-    std::make_shared<Register>("t7"),
-    std::make_shared<Register>("t8"),
-    std::make_shared<Register>("t9"),
-    std::make_shared<Register>("s0"),
-    std::make_shared<Register>("s1"),
-    std::make_shared<Register>("s2"),
-    std::make_shared<Register>("s3"),
-    std::make_shared<Register>("s4"),
-    std::make_shared<Register>("s5"),
-    std::make_shared<Register>("s6"),
-    std::make_shared<Register>("s7")
-};
-bool int_register_allocated[NUM_INT_REGISTERS] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-
-size_t constexpr NUM_FLOAT_REGISTERS = 15;
-std::shared_ptr<Register> float_register_list[NUM_FLOAT_REGISTERS] = {
-    std::make_shared<Register>("f2"),
-    std::make_shared<Register>("f4"),
-    std::make_shared<Register>("f6"),
-    std::make_shared<Register>("f8"),
-    std::make_shared<Register>("f10"),
-    std::make_shared<Register>("f12"),
-    std::make_shared<Register>("f14"),
-    std::make_shared<Register>("f16"),
-    std::make_shared<Register>("f18"),
-    std::make_shared<Register>("f20"),
-    std::make_shared<Register>("f22"),
-    std::make_shared<Register>("f24"),
-    std::make_shared<Register>("f26"),
-    std::make_shared<Register>("f28"),
-    std::make_shared<Register>("f30")
-};
-bool float_register_allocated[NUM_FLOAT_REGISTERS] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-
-std::shared_ptr<Register> REG_v0 = int_register_list[0];
-std::shared_ptr<Register> REG_v1 = std::make_shared<Register>("v1");
-std::shared_ptr<Register> REG_f12 = float_register_list[5];
-std::shared_ptr<Register> REG_a0 = std::make_shared<Register>("a0");
-std::shared_ptr<Register> REG_zero = std::make_shared<Register>("zero");
-std::shared_ptr<Register> REG_f0 = std::make_shared<Register>("f0");
-
-std::shared_ptr<Register> allocate_int_register()
-{
-    for (size_t i = 0; i < NUM_INT_REGISTERS; i++) {
-        if (!int_register_allocated[i]) {
-            int_register_allocated[i] = true;
-            return int_register_list[i];
+    // Lowers the TAC of one function. regs tracks the register each symbol
+    // was last loaded into or assigned to. All state is per function, so
+    // functions can be lowered concurrently.
+    class Lowering {
+        TAC::Values const& vals;
+        RTL::Context const& strings;
+        RTL::Code& rtl;
+        std::vector<RegId> regs;
+        RegFile reg_file;
+
+    public:
+        Lowering(TAC::Values const& vals, RTL::Context const& strings, RTL::Code& rtl)
+            : vals(vals), strings(strings), rtl(rtl), regs(vals.syms.size(), RegId::NONE)
+        {
         }
-    }
-    assert(false);
-}
 
-void deallocate_int_register(std::shared_ptr<Register> reg)
-{
-    for (size_t i = 0; i < NUM_INT_REGISTERS; i++) {
-        if (reg == int_register_list[i]) {
-            int_register_allocated[i] = false;
-            return;
+        RTL::Operand mem_of(TAC::SymInfo const& s)
+        {
+            return rtl.mem(s.name, s.is_global, s.fp_offset);
+        }
+        RTL::Operand mem_of_string(std::string const& val)
+        {
+            return rtl.mem(VarName::of_sym(strings.string_id(val)), true, 0);
         }
-    }
-    // assert(false);
-}
 
-void RTL::reset(){
-    for(size_t i = 0; i < NUM_INT_REGISTERS; i++)
-        int_register_allocated[i] = false;
-    for(size_t i = 0; i < NUM_FLOAT_REGISTERS; i++)
-        float_register_allocated[i] = false;
-}
+        RegId reg_of(TAC::Val v) const
+        {
+            if (v.kind() != TAC::Val::Kind::SYM)
+                return RegId::NONE;
+            return regs[v.index()];
+        }
 
-std::shared_ptr<Register> allocate_float_register()
-{
-    for (size_t i = 0; i < NUM_FLOAT_REGISTERS; i++) {
-        if (!float_register_allocated[i]) {
-            float_register_allocated[i] = true;
-            return float_register_list[i];
+        RegId gen_val(TAC::Val v);
+        void gen_print(TAC::Val v);
+        void gen_push(TAC::Val v);
+        void gen_pops(TAC::Call const& c);
+
+        RegId gen_arith(TAC::Instr const& i);
+        RegId gen_float_compare(TAC::Instr const& i);
+        RegId gen_call(TAC::Instr const& i);
+        RegId gen_expr(TAC::Instr const& i);
+
+        void gen(TAC::Instr const& i);
+        void finish()
+        {
+            rtl.int_regs_peak = reg_file.get_int_peak();
+            rtl.float_regs_peak = reg_file.get_float_peak();
+        }
+    };
+}
+
+RegId Lowering::gen_val(TAC::Val v)
+{
+    RegId reg;
+    switch (v.kind()) {
+    case TAC::Val::Kind::SYM:
+        {
+            TAC::SymInfo const& s = vals.syms[v.index()];
+            if (s.in_mem) {
+                if (s.type != Type::FLOAT) {
+                    regs[v.index()] = reg_file.alloc_int();
+                    rtl.emit(RTL::Op::LOAD, regs[v.index()], mem_of(s));
+                } else {
+                    regs[v.index()] = reg_file.alloc_float();
+                    rtl.emit(RTL::Op::LOAD_D, regs[v.index()], mem_of(s));
+                }
+            }
+            return regs[v.index()];
         }
+    case TAC::Val::Kind::INT:
+        reg = reg_file.alloc_int();
+        rtl.emit(RTL::Op::ILOAD, reg, RTL::Operand::of_int(vals.ints[v.index()]));
+        return reg;
+    case TAC::Val::Kind::FLOAT:
+        reg = reg_file.alloc_float();
+        rtl.emit(RTL::Op::ILOAD_D, reg, RTL::Operand::of_float(vals.floats[v.index()]));
+        return reg;
+    case TAC::Val::Kind::STR:
+        reg = reg_file.alloc_int();
+        rtl.emit(RTL::Op::LOAD_ADDR, reg, mem_of_string(vals.strs[v.index()]));
+        return reg;
+    default:
+        assert(false);
     }
-    assert(false);
 }
 
-void deallocate_float_register(std::shared_ptr<Register> reg)
-{
-    for (size_t i = 0; i < NUM_FLOAT_REGISTERS; i++) {
-        if (reg == float_register_list[i]) {
-            float_register_allocated[i] = false;
-            return;
+void Lowering::gen_print(TAC::Val v)
+{
+    switch (v.kind()) {
+    case TAC::Val::Kind::INT:
+        rtl.emit(RTL::Op::ILOAD, RegId::V0, RTL::Operand::of_int(1));
+        rtl.emit(RTL::Op::ILOAD, RegId::A0, RTL::Operand::of_int(vals.ints[v.index()]));
+        rtl.emit(RTL::Op::WRITE);
+        return;
+    case TAC::Val::Kind::FLOAT:
+        rtl.emit(RTL::Op::ILOAD, RegId::V0, RTL::Operand::of_int(3));
+        rtl.emit(RTL::Op::ILOAD_D, RegId::F12, RTL::Operand::of_float(vals.floats[v.index()]));
+        rtl.emit(RTL::Op::WRITE);
+        return;
+    case TAC::Val::Kind::STR:
+        {
+            RTL::Operand str = mem_of_string(vals.strs[v.index()]);
+            rtl.emit(RTL::Op::ILOAD, RegId::V0, RTL::Operand::of_int(4));
+            rtl.emit(RTL::Op::LOAD_ADDR, RegId::A0, str);
+            rtl.emit(RTL::Op::WRITE);
         }
+        return;
+    default:
+        break;
     }
-    // assert(false);
-}
-
-
-void TAC::PrintStmt::gen_rtl(RTLStmtList& stmts)
-{
-    arg->gen_print_rtl(stmts);
-}
-
-void TAC::IntLit::gen_print_rtl(RTLStmtList& stmts)
-{
-    stmts.push_back(std::make_shared<RTL::ILoadStmt>(REG_v0, std::make_shared<RTL::IntLit>(1)));
-    stmts.push_back(std::make_shared<RTL::ILoadStmt>(REG_a0, std::make_shared<RTL::IntLit>(val)));
-    stmts.push_back(std::make_shared<RTL::WriteStmt>());
-}
-
-void TAC::FloatLit::gen_print_rtl(RTLStmtList& stmts)
-{
-    stmts.push_back(std::make_shared<RTL::ILoadStmt>(REG_v0, std::make_shared<RTL::IntLit>(3)));
-    stmts.push_back(std::make_shared<RTL::ILoadDStmt>(REG_f12, std::make_shared<RTL::FloatLit>(val)));
-    stmts.push_back(std::make_shared<RTL::WriteStmt>());
-}
-
-void TAC::StrLit::gen_print_rtl(RTLStmtList& stmts)
-{
-    std::string str_id = ctx.get_string_id(val);
-
-    stmts.push_back(std::make_shared<RTL::ILoadStmt>(REG_v0, std::make_shared<RTL::IntLit>(4)));
-    stmts.push_back(std::make_shared<RTL::LoadAddrStmt>(REG_a0, std::make_shared<RTL::Mem>(str_id, true, 0)));
-    stmts.push_back(std::make_shared<RTL::WriteStmt>());
-}
 
-void TAC::Sym::gen_print_rtl(RTLStmtList& stmts)
-{
-    if (type == Type::STRING) {
+    TAC::SymInfo const& s = vals.sym(v);
+    RegId& reg = regs[v.index()];
+    if (s.type == Type::STRING) {
         // ASSUMPTION: in_mem is always true in this case
-        stmts.push_back(std::make_shared<RTL::ILoadStmt>(REG_v0, std::make_shared<RTL::IntLit>(4)));
-        stmts.push_back(std::make_shared<RTL::LoadStmt>(REG_a0, std::make_shared<RTL::Mem>(name, is_global, fp_offset)));
-        stmts.push_back(std::make_shared<RTL::WriteStmt>());
-    } else if (type != Type::FLOAT) {
-        if (in_mem) {
-            stmts.push_back(std::make_shared<RTL::ILoadStmt>(REG_v0, std::make_shared<RTL::IntLit>(1)));
-            stmts.push_back(std::make_shared<RTL::LoadStmt>(REG_a0, std::make_shared<RTL::Mem>(name, is_global, fp_offset)));
-            stmts.push_back(std::make_shared<RTL::WriteStmt>());
+        rtl.emit(RTL::Op::ILOAD, RegId::V0, RTL::Operand::of_int(4));
+        rtl.emit(RTL::Op::LOAD, RegId::A0, mem_of(s));
+        rtl.emit(RTL::Op::WRITE);
+    } else if (s.type != Type::FLOAT) {
+        if (s.in_mem) {
+            rtl.emit(RTL::Op::ILOAD, RegId::V0, RTL::Operand::of_int(1));
+            rtl.emit(RTL::Op::LOAD, RegId::A0, mem_of(s));
+            rtl.emit(RTL::Op::WRITE);
         } else {
-            if (int_register_allocated[0]) { // v0 is at index 0
-                std::shared_ptr<RTL::Register> new_reg = allocate_int_register();
-                stmts.push_back(std::make_shared<RTL::MoveStmt>(new_reg, reg));
+            if (reg_file.is_allocated(RegId::V0)) {
+                RegId new_reg = reg_file.alloc_int();
+                rtl.emit(RTL::Op::MOVE, new_reg, reg);
 
-                deallocate_int_register(reg);
+                reg_file.free_int(reg);
 
                 reg = new_reg;
             }
-            stmts.push_back(std::make_shared<RTL::ILoadStmt>(REG_v0, std::make_shared<RTL::IntLit>(1)));
-            stmts.push_back(std::make_shared<RTL::MoveStmt>(REG_a0, reg));
-            stmts.push_back(std::make_shared<RTL::WriteStmt>());
+            rtl.emit(RTL::Op::ILOAD, RegId::V0, RTL::Operand::of_int(1));
+            rtl.emit(RTL::Op::MOVE, RegId::A0, reg);
+            rtl.emit(RTL::Op::WRITE);
 
-            deallocate_int_register(reg);
+            reg_file.free_int(reg);
         }
     } else {
-        if (in_mem) {
-            stmts.push_back(std::make_shared<RTL::ILoadStmt>(REG_v0, std::make_shared<RTL::IntLit>(3)));
-            stmts.push_back(std::make_shared<RTL::LoadDStmt>(REG_f12, std::make_shared<RTL::Mem>(name, is_global, fp_offset)));
-            stmts.push_back(std::make_shared<RTL::WriteStmt>());
+        if (s.in_mem) {
+            rtl.emit(RTL::Op::ILOAD, RegId::V0, RTL::Operand::of_int(3));
+            rtl.emit(RTL::Op::LOAD_D, RegId::F12, mem_of(s));
+            rtl.emit(RTL::Op::WRITE);
         } else {
-            stmts.push_back(std::make_shared<RTL::ILoadStmt>(REG_v0, std::make_shared<RTL::IntLit>(3)));
-            stmts.push_back(std::make_shared<RTL::MoveDStmt>(REG_f12, reg));
-            stmts.push_back(std::make_shared<RTL::WriteStmt>());
+            rtl.emit(RTL::Op::ILOAD, RegId::V0, RTL::Operand::of_int(3));
+            rtl.emit(RTL::Op::MOVE_D, RegId::F12, reg);
+            rtl.emit(RTL::Op::WRITE);
         }
     }
 }
 
-void TAC::ReadIntStmt::gen_rtl(RTLStmtList& stmts)
-{
-    std::shared_ptr<Register> loc_reg = loc->gen_rtl(stmts);
-    stmts.push_back(std::make_shared<RTL::ILoadStmt>(REG_v0, std::make_shared<RTL::IntLit>(5)));
-    stmts.push_back(std::make_shared<RTL::ReadStmt>());
-    stmts.push_back(std::make_shared<RTL::AddrAssignStmt>(loc_reg, REG_v0));
-}
-void TAC::ReadFloatStmt::gen_rtl(RTLStmtList& stmts)
-{
-    std::shared_ptr<Register> loc_reg = loc->gen_rtl(stmts);
-    stmts.push_back(std::make_shared<RTL::ILoadStmt>(REG_v0, std::make_shared<RTL::IntLit>(7)));
-    stmts.push_back(std::make_shared<RTL::ReadStmt>());
-    stmts.push_back(std::make_shared<RTL::AddrAssignDStmt>(loc_reg, REG_f0));
-}
-
-
-void TAC::Label::gen_rtl(RTLStmtList& stmts)
-{
-    stmts.push_back(std::make_shared<RTL::Label>(name));
-}
-
+void Lowering::gen_push(TAC::Val v)
+{
+    RegId reg;
+    switch (v.kind()) {
+    case TAC::Val::Kind::INT:
+        reg = reg_file.alloc_int();
+        rtl.emit(RTL::Op::ILOAD, reg, RTL::Operand::of_int(vals.ints[v.index()]));
+        rtl.emit(RTL::Op::PUSH, reg);
+        reg_file.free_int(reg);
+        return;
+    case TAC::Val::Kind::FLOAT:
+        reg = reg_file.alloc_float();
+        rtl.emit(RTL::Op::ILOAD_D, reg, RTL::Operand::of_float(vals.floats[v.index()]));
+        rtl.emit(RTL::Op::PUSH_D, reg);
+        reg_file.free_float(reg);
+        return;
+    case TAC::Val::Kind::STR:
+        reg = reg_file.alloc_int();
+        rtl.emit(RTL::Op::LOAD_ADDR, reg, mem_of_string(vals.strs[v.index()]));
+        rtl.emit(RTL::Op::PUSH, reg);
+        reg_file.free_int(reg);
+        return;
+    default:
+        break;
+    }
 
-std::shared_ptr<RTL::Register> TAC::Sym::gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts)
-{
-    if (in_mem) {
-        if (type != Type::FLOAT) {
-            reg = allocate_int_register();
-            stmts.push_back(std::make_shared<RTL::LoadStmt>(reg, std::make_shared<RTL::Mem>(name, is_global, fp_offset)));
+    TAC::SymInfo const& s = vals.sym(v);
+    if (s.type != Type::FLOAT) {
+        if (s.in_mem) {
+            RegId reg_new = reg_file.alloc_int();
+            rtl.emit(RTL::Op::LOAD, reg_new, mem_of(s));
+            rtl.emit(RTL::Op::PUSH, reg_new);
+            reg_file.free_int(reg_new);
         } else {
-            reg = allocate_float_register();
-            stmts.push_back(std::make_shared<RTL::LoadDStmt>(reg, std::make_shared<RTL::Mem>(name, is_global, fp_offset)));
+            rtl.emit(RTL::Op::PUSH, regs[v.index()]);
+            reg_file.free_int(regs[v.index()]);
         }
-    }
-    return reg;
-}
-
-
-void TAC::GotoStmt::gen_rtl(RTLStmtList& stmts)
-{
-    stmts.push_back(std::make_shared<RTL::GotoStmt>(std::make_shared<RTL::Label>(label->name)));
-}
-
-void TAC::IfGotoStmt::gen_rtl(RTLStmtList& stmts)
-{
-    std::shared_ptr<Register> cond_reg = cond->gen_rtl(stmts);
-    stmts.push_back(std::make_shared<RTL::BGTZStmt>(cond_reg, std::make_shared<RTL::Label>(label->name)));
-    deallocate_int_register(cond_reg);
-}
-
-
-void TAC::AssignStmt::gen_rtl(RTLStmtList& stmts)
-{
-    if (rhs->type != TAC::Type::FLOAT) {
-        // ASSUMPTION: If LHS is in_mem, then RHS is either immediate or a temp
-        std::shared_ptr<Register> rhs_reg = rhs->gen_rtl(stmts);
-        if (lhs->in_mem) {
-            stmts.push_back(std::make_shared<RTL::StoreStmt>(std::make_shared<RTL::Mem>(lhs->name, lhs->is_global, lhs->fp_offset), rhs_reg));
-            deallocate_int_register(rhs_reg);
-        } else
-            lhs->reg = rhs_reg;
     } else {
-        // ASSUMPTION: If LHS is in_mem, then RHS is either immediate or a temp
-        std::shared_ptr<Register> rhs_reg = rhs->gen_rtl(stmts);
-        if (lhs->in_mem) {
-            stmts.push_back(std::make_shared<RTL::StoreDStmt>(std::make_shared<RTL::Mem>(lhs->name, lhs->is_global, lhs->fp_offset), rhs_reg));
-            deallocate_float_register(rhs_reg);
-        } else
-            lhs->reg = rhs_reg;
-    }
-}
-
-std::shared_ptr<Register> TAC::IntLit::gen_rtl(RTLStmtList& stmts)
-{
-    std::shared_ptr<Register> reg = allocate_int_register();
-    stmts.push_back(std::make_shared<RTL::ILoadStmt>(reg, std::make_shared<RTL::IntLit>(val)));
-    return reg;
-}
-
-std::shared_ptr<Register> TAC::FloatLit::gen_rtl(RTLStmtList& stmts)
-{
-    std::shared_ptr<Register> reg = allocate_float_register();
-    stmts.push_back(std::make_shared<RTL::ILoadDStmt>(reg, std::make_shared<RTL::FloatLit>(val)));
-    return reg;
-}
-
-std::shared_ptr<Register> TAC::StrLit::gen_rtl(RTLStmtList& stmts)
-{
-    std::string str_id = ctx.get_string_id(val);
-
-    std::shared_ptr<Register> reg = allocate_int_register();
-    stmts.push_back(std::make_shared<RTL::LoadAddrStmt>(reg, std::make_shared<RTL::Mem>(str_id, true, 0)));
-    return reg;
-}
-
-std::shared_ptr<Register> TAC::AddExpr::gen_rtl(RTLStmtList& stmts)
-{
-    if (type != Type::FLOAT) {
-        std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-        std::shared_ptr<Register> reg_res = allocate_int_register();
-        std::shared_ptr<Register> reg_right = rhs->gen_rtl(stmts);
-
-        stmts.push_back(std::make_shared<RTL::AddStmt>(reg_res, reg_left, reg_right));
-
-        deallocate_int_register(reg_left);
-        deallocate_int_register(reg_right);
-
-        return reg_res;
-    } else {
-        std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-        std::shared_ptr<Register> reg_res = allocate_float_register();
-        std::shared_ptr<Register> reg_right = rhs->gen_rtl(stmts);
-
-        stmts.push_back(std::make_shared<RTL::AddDStmt>(reg_res, reg_left, reg_right));
-
-        deallocate_float_register(reg_left);
-        deallocate_float_register(reg_right);
-
-        return reg_res;
-    }
-}
-
-std::shared_ptr<Register> TAC::SubExpr::gen_rtl(RTLStmtList& stmts)
-{
-    if (type != Type::FLOAT) {
-        std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-        std::shared_ptr<Register> reg_res = allocate_int_register();
-        std::shared_ptr<Register> reg_right = rhs->gen_rtl(stmts);
-
-        stmts.push_back(std::make_shared<RTL::SubStmt>(reg_res, reg_left, reg_right));
-
-        deallocate_int_register(reg_left);
-        deallocate_int_register(reg_right);
-
-        return reg_res;
-    } else {
-        std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-        std::shared_ptr<Register> reg_res = allocate_float_register();
-        std::shared_ptr<Register> reg_right = rhs->gen_rtl(stmts);
-
-        stmts.push_back(std::make_shared<RTL::SubDStmt>(reg_res, reg_left, reg_right));
-
-        deallocate_float_register(reg_left);
-        deallocate_float_register(reg_right);
-
-        return reg_res;
-    }
-}
-
-std::shared_ptr<Register> TAC::MulExpr::gen_rtl(RTLStmtList& stmts)
-{
-    if (type != Type::FLOAT) {
-        std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-        std::shared_ptr<Register> reg_res = allocate_int_register();
-        std::shared_ptr<Register> reg_right = rhs->gen_rtl(stmts);
-
-        stmts.push_back(std::make_shared<RTL::MulStmt>(reg_res, reg_left, reg_right));
-
-        deallocate_int_register(reg_left);
-        deallocate_int_register(reg_right);
-
-        return reg_res;
-    } else {
-        std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-        std::shared_ptr<Register> reg_res = allocate_float_register();
-        std::shared_ptr<Register> reg_right = rhs->gen_rtl(stmts);
-
-        stmts.push_back(std::make_shared<RTL::MulDStmt>(reg_res, reg_left, reg_right));
-
-        deallocate_float_register(reg_left);
-        deallocate_float_register(reg_right);
-
-        return reg_res;
+        if (s.in_mem) {
+            RegId reg_new = reg_file.alloc_float();
+            rtl.emit(RTL::Op::LOAD_D, reg_new, mem_of(s));
+            rtl.emit(RTL::Op::PUSH_D, reg_new);
+            reg_file.free_float(reg_new);
+        } else {
+            rtl.emit(RTL::Op::PUSH_D, regs[v.index()]);
+            reg_file.free_float(regs[v.index()]);
+        }
     }
 }
 
-std::shared_ptr<Register> TAC::DivExpr::gen_rtl(RTLStmtList& stmts)
+void Lowering::gen_pops(TAC::Call const& c)
 {
-    if (type != Type::FLOAT) {
-        std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-        std::shared_ptr<Register> reg_res = allocate_int_register();
-        std::shared_ptr<Register> reg_right = rhs->gen_rtl(stmts);
-
-        stmts.push_back(std::make_shared<RTL::DivStmt>(reg_res, reg_left, reg_right));
-
-        deallocate_int_register(reg_left);
-        deallocate_int_register(reg_right);
-
-        return reg_res;
-    } else {
-        std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-        std::shared_ptr<Register> reg_res = allocate_float_register();
-        std::shared_ptr<Register> reg_right = rhs->gen_rtl(stmts);
-
-        stmts.push_back(std::make_shared<RTL::DivDStmt>(reg_res, reg_left, reg_right));
-
-        deallocate_float_register(reg_left);
-        deallocate_float_register(reg_right);
-
-        return reg_res;
-    }
+    for (uint32_t k = 0; k < c.nr_params; ++k)
+        rtl.emit(vals.type_of(vals.params[c.first_param + k]) == Type::FLOAT ? RTL::Op::POP_D : RTL::Op::POP);
 }
 
-
-std::shared_ptr<Register> TAC::NegExpr::gen_rtl(RTLStmtList& stmts)
+RegId Lowering::gen_arith(TAC::Instr const& i)
 {
-    if (lhs->type != Type::FLOAT) {
-        std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-        std::shared_ptr<Register> reg_res = allocate_int_register();
+    // comparisons pick int or float by their operands, the others by their result
+    bool is_float = (i.type == Type::BOOL ? vals.type_of(i.b) : i.type) == Type::FLOAT;
 
-        stmts.push_back(std::make_shared<RTL::UMinusStmt>(reg_res, reg_left));
+    RegId reg_left = gen_val(i.a);
+    RegId reg_res = is_float ? reg_file.alloc_float() : reg_file.alloc_int();
+    RegId reg_right = gen_val(i.b);
 
-        deallocate_int_register(reg_left);
+    rtl.emit(arith_op(i.op, is_float), reg_res, reg_left, reg_right);
 
-        return reg_res;
+    if (is_float) {
+        reg_file.free_float(reg_left);
+        reg_file.free_float(reg_right);
     } else {
-        std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-        std::shared_ptr<Register> reg_res = allocate_float_register();
-
-        stmts.push_back(std::make_shared<RTL::UMinusDStmt>(reg_res, reg_left));
-
-        deallocate_float_register(reg_left);
-
-        return reg_res;
+        reg_file.free_int(reg_left);
+        reg_file.free_int(reg_right);
     }
-}
-
-
-std::shared_ptr<Register> TAC::EqualExpr::gen_rtl(RTLStmtList& stmts)
-{
-    if (rhs->type != Type::FLOAT) {
-        std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-        std::shared_ptr<Register> reg_res = allocate_int_register();
-        std::shared_ptr<Register> reg_right = rhs->gen_rtl(stmts);
 
-        stmts.push_back(std::make_shared<RTL::SEQStmt>(reg_res, reg_left, reg_right));
-
-        deallocate_int_register(reg_left);
-        deallocate_int_register(reg_right);
-
-        return reg_res;
-    } else {
-        std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-        std::shared_ptr<Register> reg_right = rhs->gen_rtl(stmts);
-
-        stmts.push_back(std::make_shared<RTL::SEQDStmt>(reg_left, reg_right));
-
-        deallocate_float_register(reg_left);
-        deallocate_float_register(reg_right);
-
-        std::shared_ptr<Register> reg1 = allocate_int_register();
-        std::shared_ptr<Register> reg2 = allocate_int_register();
-
-        stmts.push_back(std::make_shared<RTL::ILoadStmt>(reg1, std::make_shared<RTL::IntLit>(1)));
-        stmts.push_back(std::make_shared<RTL::MoveStmt>(reg2, REG_zero));
-        stmts.push_back(std::make_shared<RTL::MovTStmt>(reg2, reg1, std::make_shared<RTL::IntLit>(0)));
-
-        deallocate_int_register(reg1);
-
-        return reg2;
-    }
+    return reg_res;
 }
 
-std::shared_ptr<Register> TAC::NotEqualExpr::gen_rtl(RTLStmtList& stmts)
-{
-    if (rhs->type != Type::FLOAT) {
-        std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-        std::shared_ptr<Register> reg_res = allocate_int_register();
-        std::shared_ptr<Register> reg_right = rhs->gen_rtl(stmts);
-
-        stmts.push_back(std::make_shared<RTL::SNEStmt>(reg_res, reg_left, reg_right));
-
-        deallocate_int_register(reg_left);
-        deallocate_int_register(reg_right);
-
-        return reg_res;
-    } else {
-        std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-        std::shared_ptr<Register> reg_right = rhs->gen_rtl(stmts);
-
-        stmts.push_back(std::make_shared<RTL::SEQDStmt>(reg_left, reg_right));
-
-        deallocate_float_register(reg_left);
-        deallocate_float_register(reg_right);
-
-        std::shared_ptr<Register> reg1 = allocate_int_register();
-        std::shared_ptr<Register> reg2 = allocate_int_register();
-
-        stmts.push_back(std::make_shared<RTL::ILoadStmt>(reg1, std::make_shared<RTL::IntLit>(1)));
-        stmts.push_back(std::make_shared<RTL::MoveStmt>(reg2, REG_zero));
-        stmts.push_back(std::make_shared<RTL::MovFStmt>(reg2, reg1, std::make_shared<RTL::IntLit>(0)));
-
-        deallocate_int_register(reg1);
-
-        return reg2;
+RegId Lowering::gen_float_compare(TAC::Instr const& i)
+{
+    RegId reg_left = gen_val(i.a);
+    RegId reg_right = gen_val(i.b);
+
+    // only eq, lt and le exist for doubles; the rest test the converse
+    bool on_true;
+    switch (i.op) {
+    case Op::EQ:
+        rtl.emit(RTL::Op::SEQ_D, reg_left, reg_right);
+        on_true = true;
+        break;
+    case Op::NE:
+        rtl.emit(RTL::Op::SEQ_D, reg_left, reg_right);
+        on_true = false;
+        break;
+    case Op::GT:
+        rtl.emit(RTL::Op::SLE_D, reg_left, reg_right);
+        on_true = false;
+        break;
+    case Op::LT:
+        rtl.emit(RTL::Op::SLT_D, reg_left, reg_right);
+        on_true = true;
+        break;
+    case Op::GE:
+        rtl.emit(RTL::Op::SLT_D, reg_left, reg_right);
+        on_true = false;
+        break;
+    case Op::LE:
+        rtl.emit(RTL::Op::SLE_D, reg_left, reg_right);
+        on_true = true;
+        break;
+    default:
+        assert(false);
     }
-}
-
-std::shared_ptr<Register> TAC::GreaterExpr::gen_rtl(RTLStmtList& stmts)
-{
-    if (rhs->type != Type::FLOAT) {
-        std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-        std::shared_ptr<Register> reg_res = allocate_int_register();
-        std::shared_ptr<Register> reg_right = rhs->gen_rtl(stmts);
-
-        stmts.push_back(std::make_shared<RTL::SGTStmt>(reg_res, reg_left, reg_right));
-
-        deallocate_int_register(reg_left);
-        deallocate_int_register(reg_right);
-
-        return reg_res;
-    } else {
-        std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-        std::shared_ptr<Register> reg_right = rhs->gen_rtl(stmts);
 
-        stmts.push_back(std::make_shared<RTL::SLEDStmt>(reg_left, reg_right));
+    reg_file.free_float(reg_left);
+    reg_file.free_float(reg_right);
 
-        deallocate_float_register(reg_left);
-        deallocate_float_register(reg_right);
+    RegId reg1 = reg_file.alloc_int();
+    RegId reg2 = reg_file.alloc_int();
 
-        std::shared_ptr<Register> reg1 = allocate_int_register();
-        std::shared_ptr<Register> reg2 = allocate_int_register();
+    rtl.emit(RTL::Op::ILOAD, reg1, RTL::Operand::of_int(1));
+    rtl.emit(RTL::Op::MOVE, reg2, RegId::ZERO);
+    if (on_true)
+        rtl.emit(RTL::Op::MOVT, reg2, reg1, RTL::Operand::of_int(0));
+    else
+        rtl.emit(RTL::Op::MOVF, reg2, reg1, RTL::Operand::of_int(0));
 
-        stmts.push_back(std::make_shared<RTL::ILoadStmt>(reg1, std::make_shared<RTL::IntLit>(1)));
-        stmts.push_back(std::make_shared<RTL::MoveStmt>(reg2, REG_zero));
-        stmts.push_back(std::make_shared<RTL::MovFStmt>(reg2, reg1, std::make_shared<RTL::IntLit>(0)));
+    reg_file.free_int(reg1);
 
-        deallocate_int_register(reg1);
-
-        return reg2;
-    }
+    return reg2;
 }
 
-std::shared_ptr<Register> TAC::GreaterEqualExpr::gen_rtl(RTLStmtList& stmts)
+RegId Lowering::gen_call(TAC::Instr const& i)
 {
-    if (rhs->type != Type::FLOAT) {
-        std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-        std::shared_ptr<Register> reg_res = allocate_int_register();
-        std::shared_ptr<Register> reg_right = rhs->gen_rtl(stmts);
-
-        stmts.push_back(std::make_shared<RTL::SGEStmt>(reg_res, reg_left, reg_right));
-
-        deallocate_int_register(reg_left);
-        deallocate_int_register(reg_right);
-
-        return reg_res;
-    } else {
-        std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-        std::shared_ptr<Register> reg_right = rhs->gen_rtl(stmts);
-
-        stmts.push_back(std::make_shared<RTL::SLTDStmt>(reg_left, reg_right));
+    TAC::Call const& c = vals.call(i.b);
+    for (uint32_t k = c.nr_params; k > 0; --k)
+        gen_push(vals.params[c.first_param + k - 1]);
 
-        deallocate_float_register(reg_left);
-        deallocate_float_register(reg_right);
+    RegId func_ptr_reg;
+    if (i.op == Op::CALL_PTR)
+        func_ptr_reg = gen_val(i.a);
 
-        std::shared_ptr<Register> reg1 = allocate_int_register();
-        std::shared_ptr<Register> reg2 = allocate_int_register();
-
-        stmts.push_back(std::make_shared<RTL::ILoadStmt>(reg1, std::make_shared<RTL::IntLit>(1)));
-        stmts.push_back(std::make_shared<RTL::MoveStmt>(reg2, REG_zero));
-        stmts.push_back(std::make_shared<RTL::MovFStmt>(reg2, reg1, std::make_shared<RTL::IntLit>(0)));
-
-        deallocate_int_register(reg1);
-
-        return reg2;
+    if (i.dst.is_none()) {
+        if (i.op == Op::CALL)
+            rtl.emit(RTL::Op::CALL, c.func_name);
+        else
+            rtl.emit(RTL::Op::CALL_PTR, func_ptr_reg);
+        gen_pops(c);
+        return RegId::NONE;
     }
-}
-
-std::shared_ptr<Register> TAC::LessExpr::gen_rtl(RTLStmtList& stmts)
-{
-    if (rhs->type != Type::FLOAT) {
-        std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-        std::shared_ptr<Register> reg_res = allocate_int_register();
-        std::shared_ptr<Register> reg_right = rhs->gen_rtl(stmts);
-
-        stmts.push_back(std::make_shared<RTL::SLTStmt>(reg_res, reg_left, reg_right));
-
-        deallocate_int_register(reg_left);
-        deallocate_int_register(reg_right);
-
-        return reg_res;
-    } else {
-        std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-        std::shared_ptr<Register> reg_right = rhs->gen_rtl(stmts);
-
-        stmts.push_back(std::make_shared<RTL::SLTDStmt>(reg_left, reg_right));
-
-        deallocate_float_register(reg_left);
-        deallocate_float_register(reg_right);
-
-        std::shared_ptr<Register> reg1 = allocate_int_register();
-        std::shared_ptr<Register> reg2 = allocate_int_register();
-
-        stmts.push_back(std::make_shared<RTL::ILoadStmt>(reg1, std::make_shared<RTL::IntLit>(1)));
-        stmts.push_back(std::make_shared<RTL::MoveStmt>(reg2, REG_zero));
-        stmts.push_back(std::make_shared<RTL::MovTStmt>(reg2, reg1, std::make_shared<RTL::IntLit>(0)));
-
-        deallocate_int_register(reg1);
-
-        return reg2;
-    }
-}
-
-std::shared_ptr<Register> TAC::LessEqualExpr::gen_rtl(RTLStmtList& stmts)
-{
-    if (rhs->type != Type::FLOAT) {
-        std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-        std::shared_ptr<Register> reg_res = allocate_int_register();
-        std::shared_ptr<Register> reg_right = rhs->gen_rtl(stmts);
-
-        stmts.push_back(std::make_shared<RTL::SLEStmt>(reg_res, reg_left, reg_right));
-
-        deallocate_int_register(reg_left);
-        deallocate_int_register(reg_right);
 
-        return reg_res;
+    RegId ret_reg = i.type != Type::FLOAT ? RegId::V1 : RegId::F0;
+    if (i.op == Op::CALL)
+        rtl.emit(RTL::Op::ASSIGN_CALL, ret_reg, c.func_name);
+    else
+        rtl.emit(RTL::Op::ASSIGN_CALL_PTR, ret_reg, func_ptr_reg);
+    gen_pops(c);
+
+    RegId reg_res;
+    if (i.type != Type::FLOAT) {
+        reg_res = reg_file.alloc_int();
+        rtl.emit(RTL::Op::MOVE, reg_res, RegId::V1);
     } else {
-        std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-        std::shared_ptr<Register> reg_right = rhs->gen_rtl(stmts);
-
-        stmts.push_back(std::make_shared<RTL::SLEDStmt>(reg_left, reg_right));
-
-        deallocate_float_register(reg_left);
-        deallocate_float_register(reg_right);
-
-        std::shared_ptr<Register> reg1 = allocate_int_register();
-        std::shared_ptr<Register> reg2 = allocate_int_register();
-
-        stmts.push_back(std::make_shared<RTL::ILoadStmt>(reg1, std::make_shared<RTL::IntLit>(1)));
-        stmts.push_back(std::make_shared<RTL::MoveStmt>(reg2, REG_zero));
-        stmts.push_back(std::make_shared<RTL::MovTStmt>(reg2, reg1, std::make_shared<RTL::IntLit>(0)));
-
-        deallocate_int_register(reg1);
-
-        return reg2;
+        reg_res = reg_file.alloc_float();
+        rtl.emit(RTL::Op::MOVE_D, reg_res, RegId::F0);
     }
-}
-
-
-std::shared_ptr<Register> TAC::NotExpr::gen_rtl(RTLStmtList& stmts)
-{
-    assert(lhs->type != Type::FLOAT);
-
-    std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-    std::shared_ptr<Register> reg_res = allocate_int_register();
-
-    stmts.push_back(std::make_shared<RTL::NotStmt>(reg_res, reg_left));
-
-    deallocate_int_register(reg_left);
-
-    return reg_res;
-}
-
-std::shared_ptr<Register> TAC::AndExpr::gen_rtl(RTLStmtList& stmts)
-{
-    assert(rhs->type != Type::FLOAT);
-
-    std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-    std::shared_ptr<Register> reg_res = allocate_int_register();
-    std::shared_ptr<Register> reg_right = rhs->gen_rtl(stmts);
-
-    stmts.push_back(std::make_shared<RTL::AndStmt>(reg_res, reg_left, reg_right));
-
-    deallocate_int_register(reg_left);
-    deallocate_int_register(reg_right);
-
-    return reg_res;
-}
-
-std::shared_ptr<Register> TAC::OrExpr::gen_rtl(RTLStmtList& stmts)
-{
-    assert(rhs->type != Type::FLOAT);
-
-    std::shared_ptr<Register> reg_left = lhs->gen_rtl(stmts);
-    std::shared_ptr<Register> reg_res = allocate_int_register();
-    std::shared_ptr<Register> reg_right = rhs->gen_rtl(stmts);
-
-    stmts.push_back(std::make_shared<RTL::OrStmt>(reg_res, reg_left, reg_right));
-
-    deallocate_int_register(reg_left);
-    deallocate_int_register(reg_right);
-
     return reg_res;
 }
 
-
-void TAC::IntLit::gen_push_rtl(RTLStmtList& stmts)
-{
-    std::shared_ptr<Register> reg = allocate_int_register();
-    stmts.push_back(std::make_shared<RTL::ILoadStmt>(reg, std::make_shared<RTL::IntLit>(val)));
-    stmts.push_back(std::make_shared<RTL::PushStmt>(reg, false));
-    deallocate_int_register(reg);
-}
-void TAC::FloatLit::gen_push_rtl(RTLStmtList& stmts)
-{
-    std::shared_ptr<Register> reg = allocate_float_register();
-    stmts.push_back(std::make_shared<RTL::ILoadDStmt>(reg, std::make_shared<RTL::FloatLit>(val)));
-    stmts.push_back(std::make_shared<RTL::PushStmt>(reg, true));
-    deallocate_float_register(reg);
-}
-void TAC::StrLit::gen_push_rtl(RTLStmtList& stmts)
-{
-    std::shared_ptr<Register> reg = allocate_int_register();
-    std::string str_id = ctx.get_string_id(val);
-    stmts.push_back(std::make_shared<RTL::LoadAddrStmt>(reg, std::make_shared<RTL::Mem>(str_id, true, 0)));
-    stmts.push_back(std::make_shared<RTL::PushStmt>(reg, false));
-    deallocate_int_register(reg);
-}
-void TAC::Sym::gen_push_rtl(RTLStmtList& stmts)
-{
-    if(type != Type::FLOAT) {
-        if(in_mem){
-            std::shared_ptr<Register> reg_new = allocate_int_register();
-            stmts.push_back(std::make_shared<RTL::LoadStmt>(reg_new, std::make_shared<RTL::Mem>(name, is_global, fp_offset)));
-            stmts.push_back(std::make_shared<RTL::PushStmt>(reg_new, false));
-            deallocate_int_register(reg_new);
-        } else{
-            stmts.push_back(std::make_shared<RTL::PushStmt>(reg, false));
-            deallocate_int_register(reg);
-        }
-    } else {
-        if(in_mem){
-            std::shared_ptr<Register> reg_new = allocate_float_register();
-            stmts.push_back(std::make_shared<RTL::LoadDStmt>(reg_new, std::make_shared<RTL::Mem>(name, is_global, fp_offset)));
-            stmts.push_back(std::make_shared<RTL::PushStmt>(reg_new, true));
-            deallocate_float_register(reg_new);
-        } else{
-            stmts.push_back(std::make_shared<RTL::PushStmt>(reg, true));
-            deallocate_float_register(reg);
+// the register holding the value of the right-hand side of i
+RegId Lowering::gen_expr(TAC::Instr const& i)
+{
+    RegId reg_left;
+    RegId reg_res;
+    switch (i.op) {
+    case Op::COPY:
+        return gen_val(i.a);
+    case Op::ADD:
+    case Op::SUB:
+    case Op::MUL:
+    case Op::DIV:
+        return gen_arith(i);
+    case Op::EQ:
+    case Op::NE:
+    case Op::GT:
+    case Op::LT:
+    case Op::GE:
+    case Op::LE:
+        if (vals.type_of(i.b) == Type::FLOAT)
+            return gen_float_compare(i);
+        return gen_arith(i);
+    case Op::AND:
+    case Op::OR:
+        assert(vals.type_of(i.b) != Type::FLOAT);
+        return gen_arith(i);
+    case Op::NEG:
+        if (vals.type_of(i.a) != Type::FLOAT) {
+            reg_left = gen_val(i.a);
+            reg_res = reg_file.alloc_int();
+            rtl.emit(RTL::Op::UMINUS, reg_res, reg_left);
+            reg_file.free_int(reg_left);
+        } else {
+            reg_left = gen_val(i.a);
+            reg_res = reg_file.alloc_float();
+            rtl.emit(RTL::Op::UMINUS_D, reg_res, reg_left);
+            reg_file.free_float(reg_left);
         }
-    }
-}
-
-void TAC::CallStmt::gen_rtl(RTLStmtList& stmts)
-{
-    e->gen_rtl(stmts);
-}
-std::shared_ptr<Register> TAC::FuncCallExpr::gen_rtl(RTLStmtList& stmts)
-{
-    if((int)type == -1){
-        for(auto it = params.rbegin(); it != params.rend(); it++)
-            (*it)->gen_push_rtl(stmts);
-        stmts.push_back(std::make_shared<RTL::CallStmt>(func_name));
-        for(size_t i = 0; i < params.size(); i++)
-            if(params[i]->type != Type::FLOAT)
-                stmts.push_back(std::make_shared<RTL::PopStmt>(false));
-            else
-                stmts.push_back(std::make_shared<RTL::PopStmt>(true));
-        return nullptr;
-    } else if(type != Type::FLOAT){
-        for(auto it = params.rbegin(); it != params.rend(); it++)
-            (*it)->gen_push_rtl(stmts);
-        stmts.push_back(std::make_shared<RTL::AssignCallStmt>(REG_v1, func_name));
-        for(size_t i = 0; i < params.size(); i++)
-            if(params[i]->type != Type::FLOAT)
-                stmts.push_back(std::make_shared<RTL::PopStmt>(false));
-            else
-                stmts.push_back(std::make_shared<RTL::PopStmt>(true));
-        std::shared_ptr<Register> reg_res = allocate_int_register();
-        stmts.push_back(std::make_shared<RTL::MoveStmt>(reg_res, REG_v1));
         return reg_res;
-    } else{
-        for(auto it = params.rbegin(); it != params.rend(); it++)
-            (*it)->gen_push_rtl(stmts);
-        stmts.push_back(std::make_shared<RTL::AssignCallStmt>(REG_f0, func_name));
-        for(size_t i = 0; i < params.size(); i++)
-            if(params[i]->type != Type::FLOAT)
-                stmts.push_back(std::make_shared<RTL::PopStmt>(false));
-            else
-                stmts.push_back(std::make_shared<RTL::PopStmt>(true));
-        std::shared_ptr<Register> reg_res = allocate_float_register();
-        stmts.push_back(std::make_shared<RTL::MoveDStmt>(reg_res, REG_f0));
+    case Op::NOT:
+        assert(vals.type_of(i.a) != Type::FLOAT);
+        reg_left = gen_val(i.a);
+        reg_res = reg_file.alloc_int();
+        rtl.emit(RTL::Op::NOT, reg_res, reg_left);
+        reg_file.free_int(reg_left);
         return reg_res;
-    }
-}
-std::shared_ptr<Register> TAC::FuncPtrCallExpr::gen_rtl(RTLStmtList& stmts)
-{
-    for(auto it = params.rbegin(); it != params.rend(); it++)
-        (*it)->gen_push_rtl(stmts);
-    std::shared_ptr<Register> func_ptr_reg = func_ptr->gen_rtl(stmts);
-    if((int)type == -1){
-        stmts.push_back(std::make_shared<RTL::CallPtrStmt>(func_ptr_reg));
-        for(size_t i = 0; i < params.size(); i++)
-            if(params[i]->type != Type::FLOAT)
-                stmts.push_back(std::make_shared<RTL::PopStmt>(false));
-            else
-                stmts.push_back(std::make_shared<RTL::PopStmt>(true));
-        return nullptr;
-    } else if(type != Type::FLOAT){
-        stmts.push_back(std::make_shared<RTL::AssignCallPtrStmt>(REG_v1, func_ptr_reg));
-        for(size_t i = 0; i < params.size(); i++)
-            if(params[i]->type != Type::FLOAT)
-                stmts.push_back(std::make_shared<RTL::PopStmt>(false));
-            else
-                stmts.push_back(std::make_shared<RTL::PopStmt>(true));
-        std::shared_ptr<Register> reg_res = allocate_int_register();
-        stmts.push_back(std::make_shared<RTL::MoveStmt>(reg_res, REG_v1));
+    case Op::ADDR:
+        // TODO @nilabha
+        reg_res = reg_file.alloc_int();
+        rtl.emit(RTL::Op::GET_ADDR, reg_res, mem_of(vals.sym(i.a)));
         return reg_res;
-    } else{
-        stmts.push_back(std::make_shared<RTL::AssignCallPtrStmt>(REG_f0, func_ptr_reg));
-        for(size_t i = 0; i < params.size(); i++)
-            if(params[i]->type != Type::FLOAT)
-                stmts.push_back(std::make_shared<RTL::PopStmt>(false));
-            else
-                stmts.push_back(std::make_shared<RTL::PopStmt>(true));
-        std::shared_ptr<Register> reg_res = allocate_float_register();
-        stmts.push_back(std::make_shared<RTL::MoveDStmt>(reg_res, REG_f0));
+    case Op::DEREF:
+        // TODO @nilabha
+        if (vals.type_of(i.a) != Type::FLOAT) {
+            reg_res = reg_file.alloc_int();
+            rtl.emit(RTL::Op::DEREF, reg_res, reg_of(i.a));
+            reg_file.free_int(reg_of(i.a));
+        } else {
+            reg_res = reg_file.alloc_float();
+            rtl.emit(RTL::Op::DEREF_D, reg_res, reg_of(i.a));
+            reg_file.free_float(reg_of(i.a));
+        }
         return reg_res;
+    case Op::CALL:
+    case Op::CALL_PTR:
+        return gen_call(i);
+    default:
+        assert(false);
     }
 }
 
-void TAC::ReturnStmt::gen_rtl(RTLStmtList& stmts)
-{
-    if(ret->type != Type::FLOAT){
-        stmts.push_back(std::make_shared<RTL::LoadStmt>(REG_v1, std::make_shared<RTL::Mem>(ret->name, ret->is_global, ret->fp_offset)));
-        stmts.push_back(std::make_shared<RTL::ReturnStmt>(REG_v1));
-    } else{
-        stmts.push_back(std::make_shared<RTL::LoadDStmt>(REG_f0, std::make_shared<RTL::Mem>(ret->name, ret->is_global, ret->fp_offset)));
-        stmts.push_back(std::make_shared<RTL::ReturnStmt>(REG_f0));
+void Lowering::gen(TAC::Instr const& i)
+{
+    RegId reg;
+    switch (i.op) {
+    case Op::PRINT:
+        gen_print(i.a);
+        break;
+    case Op::READ_INT:
+        reg = gen_val(i.a);
+        rtl.emit(RTL::Op::ILOAD, RegId::V0, RTL::Operand::of_int(5));
+        rtl.emit(RTL::Op::READ);
+        rtl.emit(RTL::Op::ADDR_ASSIGN, reg, RegId::V0);
+        break;
+    case Op::READ_FLOAT:
+        reg = gen_val(i.a);
+        rtl.emit(RTL::Op::ILOAD, RegId::V0, RTL::Operand::of_int(7));
+        rtl.emit(RTL::Op::READ);
+        rtl.emit(RTL::Op::ADDR_ASSIGN_D, reg, RegId::F0);
+        break;
+    case Op::LABEL:
+        rtl.emit(RTL::Op::LABEL, i.dst.label());
+        break;
+    case Op::GOTO:
+        rtl.emit(RTL::Op::GOTO, i.dst.label());
+        break;
+    case Op::IF_GOTO:
+        reg = gen_val(i.a);
+        rtl.emit(RTL::Op::BGTZ, reg, i.dst.label());
+        reg_file.free_int(reg);
+        break;
+    case Op::ADDR_ASSIGN:
+        reg = gen_val(i.b);
+        if (i.type != Type::FLOAT)
+            rtl.emit(RTL::Op::ADDR_ASSIGN, reg_of(i.a), reg);
+        else
+            rtl.emit(RTL::Op::ADDR_ASSIGN_D, reg_of(i.a), reg);
+        break;
+    case Op::RETURN:
+        {
+            TAC::SymInfo const& ret = vals.sym(i.a);
+            if (ret.type != Type::FLOAT) {
+                rtl.emit(RTL::Op::LOAD, RegId::V1, mem_of(ret));
+                rtl.emit(RTL::Op::RETURN, RegId::V1);
+            } else {
+                rtl.emit(RTL::Op::LOAD_D, RegId::F0, mem_of(ret));
+                rtl.emit(RTL::Op::RETURN, RegId::F0);
+            }
+        }
+        break;
+    default:
+        // an assignment, or a call whose value is ignored
+        reg = gen_expr(i);
+        if (i.dst.is_none())
+            break;
+        {
+            // ASSUMPTION: If LHS is in_mem, then RHS is either immediate or a temp
+            TAC::SymInfo const& lhs = vals.sym(i.dst);
+            if (!lhs.in_mem)
+                regs[i.dst.index()] = reg;
+            else if (i.type != Type::FLOAT) {
+                rtl.emit(RTL::Op::STORE, mem_of(lhs), reg);
+                reg_file.free_int(reg);
+            } else {
+                rtl.emit(RTL::Op::STORE_D, mem_of(lhs), reg);
+                reg_file.free_float(reg);
+            }
+        }
     }
 }
 
-std::shared_ptr<RTL::Register> TAC::DerefExpr::gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts)
+void TAC::gen_rtl(std::vector<Instr> const& code, Values const& vals, RTL::Context const& strings, RTL::Code& rtl)
 {
-    // TODO @nilabha
-    if(arg->type != Type::FLOAT){
-        std::shared_ptr<Register> reg_new = allocate_int_register();
-        stmts.push_back(std::make_shared<RTL::DerefStmt>(reg_new, arg->reg));
-        deallocate_int_register(arg->reg);
-        return reg_new;
-    } else{
-        std::shared_ptr<Register> reg_new = allocate_float_register();
-        stmts.push_back(std::make_shared<RTL::DerefDStmt>(reg_new, arg->reg));
-        deallocate_float_register(arg->reg);
-        return reg_new;
-    }
-}
-std::shared_ptr<RTL::Register> TAC::AddrExpr::gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts)
-{
-    // TODO @nilabha
-    std::shared_ptr<Register> reg_new = allocate_int_register();
-    // int fp_offset = arg->is_global ? -1 : arg->fp_offset;
-    stmts.push_back(std::make_shared<RTL::GetAddrStmt>(reg_new, std::make_shared<RTL::Mem>(arg->name, arg->is_global, arg->fp_offset)));
-    return reg_new;
-}
-void TAC::AddrAssignStmt::gen_rtl(std::vector<std::shared_ptr<RTL::Stmt>>& stmts){
-    if(rhs->type != Type::FLOAT){
-        std::shared_ptr<Register> rhs_reg = rhs->gen_rtl(stmts);
-        stmts.push_back(std::make_shared<RTL::AddrAssignStmt>(lhs->reg, rhs_reg));
-    } else{
-        std::shared_ptr<Register> rhs_reg = rhs->gen_rtl(stmts);
-        stmts.push_back(std::make_shared<RTL::AddrAssignDStmt>(lhs->reg, rhs_reg));
-    }
+    Lowering l(vals, strings, rtl);
+    for (Instr const& i : code)
+        l.gen(i);
+    l.finish();
 }
@@ -0,0 +1,171 @@
+#include <json.h>
+#include <timing.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <iomanip>
+#include <unordered_map>
+
+using namespace Timing;
+
+namespace {
+    char const* const phase_names[] = { "compile", "scan", "parse", "load", "tac", "rtl", "asm", "emit" };
+    static_assert(sizeof(phase_names) / sizeof(phase_names[0]) == (size_t)Phase::Nr, "a name for each phase");
+
+    // how many functions the report lists
+    constexpr size_t NR_SHOWN = 20;
+
+    uint32_t this_thread()
+    {
+        static std::atomic<uint32_t> next(0);
+        thread_local uint32_t n = next++;
+        return n;
+    }
+
+    double ms(uint64_t ns)
+    {
+        return ns / 1e6;
+    }
+}
+
+bool Timing::tracking = false;
+thread_local Phase Timing::current = Phase::Nr;
+
+char const* Timing::name(Phase p)
+{
+    return phase_names[(size_t)p];
+}
+
+Recorder::Recorder()
+    : scan_time(0)
+{
+}
+
+void Recorder::add(Phase phase, Ident func, uint64_t start, uint64_t end)
+{
+    Span s{ phase, this_thread(), func, start, end };
+    std::lock_guard<std::mutex> l(m);
+    spans.push_back(s);
+}
+
+// Times are summed over the spans of a phase, whichever threads ran them,
+// so with -j they add up to more than the wall time of the file
+void Recorder::report(std::ostream& o, std::string const& file) const
+{
+    using Times = std::array<uint64_t, (size_t)Phase::Nr>;
+    Times total{};
+    std::vector<Ident> funcs;
+    std::unordered_map<Ident, Times> by_func;
+    for (Span const& s : spans) {
+        total[(size_t)s.phase] += s.end - s.start;
+        if (s.func.empty())
+            continue;
+        auto it = by_func.find(s.func);
+        if (it == by_func.end()) {
+            funcs.push_back(s.func);
+            it = by_func.emplace(s.func, Times{}).first;
+        }
+        it->second[(size_t)s.phase] += s.end - s.start;
+    }
+    total[(size_t)Phase::SCAN] = scan_time;
+    total[(size_t)Phase::PARSE] -= std::min(scan_time, total[(size_t)Phase::PARSE]);
+
+    uint64_t sum = 0;
+    for (size_t p = (size_t)Phase::SCAN; p < (size_t)Phase::Nr; ++p)
+        sum += total[p];
+
+    std::ios::fmtflags flags = o.flags();
+    std::streamsize precision = o.precision();
+    o << std::fixed << std::setprecision(3);
+    o << "Time report for " << file << ": " << ms(total[(size_t)Phase::COMPILE]) << " ms\n";
+    o << "  " << std::left << std::setw(8) << "phase" << std::right << std::setw(12) << "ms" << std::setw(8) << "%" << "\n";
+    for (size_t p = (size_t)Phase::SCAN; p < (size_t)Phase::Nr; ++p)
+        if (total[p] > 0)
+            o << "  " << std::left << std::setw(8) << phase_names[p] << std::right << std::setw(12) << ms(total[p]) << std::setw(8) << std::setprecision(1) << 100.0 * total[p] / sum << std::setprecision(3) << "\n";
+
+    auto func_total = [&](Ident f) {
+        uint64_t t = 0;
+        for (uint64_t v : by_func.at(f))
+            t += v;
+        return t;
+    };
+    std::stable_sort(funcs.begin(), funcs.end(), [&](Ident a, Ident b) { return func_total(a) > func_total(b); });
+    if (funcs.size() > NR_SHOWN)
+        funcs.resize(NR_SHOWN);
+    if (!funcs.empty()) {
+        size_t width = 8;
+        for (Ident f : funcs)
+            width = std::max(width, f.str().size());
+        o << "  slowest functions, " << funcs.size() << " of " << by_func.size() << ":\n";
+        o << "  " << std::left << std::setw(width) << "function" << std::right;
+        Phase const cols[] = { Phase::TAC, Phase::RTL, Phase::ASM, Phase::EMIT };
+        for (Phase p : cols)
+            o << std::setw(12) << name(p);
+        o << std::setw(12) << "total" << "\n";
+        for (Ident f : funcs) {
+            o << "  " << std::left << std::setw(width) << f << std::right;
+            for (Phase p : cols)
+                o << std::setw(12) << ms(by_func.at(f)[(size_t)p]);
+            o << std::setw(12) << ms(func_total(f)) << "\n";
+        }
+    }
+    o.flags(flags);
+    o.precision(precision);
+}
+
+// One complete event ("ph": "X") per span, with times in microseconds from
+// the first span of the run, and names for the threads
+void Recorder::trace(std::ostream& o, std::vector<std::string> const& files, std::vector<Recorder> const& recs)
+{
+    uint64_t origin = UINT64_MAX;
+    uint32_t nr_threads = 0;
+    for (Recorder const& r : recs)
+        for (Span const& s : r.spans) {
+            origin = std::min(origin, s.start);
+            nr_threads = std::max(nr_threads, s.thread + 1);
+        }
+
+    Json::Writer w(o);
+    w.begin_object();
+    w.key("traceEvents");
+    w.begin_array();
+    for (uint32_t t = 0; t < nr_threads; ++t) {
+        w.newline();
+        w.begin_object();
+        w.member("name", "thread_name");
+        w.member("ph", "M");
+        w.member("pid", (uint64_t)1);
+        w.member("tid", (uint64_t)t);
+        w.key("args");
+        w.begin_object();
+        w.member("name", "sclp " + std::to_string(t));
+        w.end_object();
+        w.end_object();
+    }
+    for (size_t i = 0; i < recs.size(); ++i)
+        for (Span const& s : recs[i].spans) {
+            w.newline();
+            w.begin_object();
+            w.member("name", s.func.empty() ? std::string(name(s.phase)) : std::string(name(s.phase)) + " " + s.func.str());
+            w.member("cat", s.func.empty() ? "file" : "function");
+            w.member("ph", "X");
+            w.member("pid", (uint64_t)1);
+            w.member("tid", (uint64_t)s.thread);
+            w.member("ts", (s.start - origin) / 1e3);
+            w.member("dur", (s.end - s.start) / 1e3);
+            w.key("args");
+            w.begin_object();
+            w.member("file", files[i]);
+            if (!s.func.empty())
+                w.member("function", s.func.str());
+            if (s.phase == Phase::COMPILE)
+                w.member("scan_ms", ms(recs[i].scan_time));
+            w.end_object();
+            w.end_object();
+        }
+    w.end_array();
+    w.member("displayTimeUnit", "ms");
+    w.end_object();
+    o.put('\n');
+}
@@ -0,0 +1,102 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <ident.h>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Where the time of a compilation goes, for --time-report and --time-trace:
+// spans of each phase, for the whole file and for each function, taken on
+// whichever thread ran them. Nothing is timed without a Recorder, and
+// without one a Scope costs a test of a null pointer, and of tracking.
+namespace Timing {
+    // COMPILE spans the whole file; SCAN is summed up token by token and
+    // has no spans of its own, so the spans of PARSE take it in
+    enum class Phase {
+        COMPILE, SCAN, PARSE, LOAD, TAC, RTL, ASM, EMIT, Nr
+    };
+    char const* name(Phase p);
+
+    // Once tracking is on, which is before any thread is started, each
+    // thread's Scopes keep current as the phase it is in, for --mem-report
+    // to charge allocations to; Phase::Nr outside any
+    extern bool tracking;
+    extern thread_local Phase current;
+
+    // nanoseconds on a clock that does not jump
+    inline uint64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    struct Span {
+        Phase phase;
+        // small numbers, in the order threads first recorded a span
+        uint32_t thread;
+        // none for the file as a whole
+        Ident func;
+        uint64_t start, end;
+    };
+
+    // The spans of one file, added from any thread
+    class Recorder {
+        std::mutex m;
+        std::vector<Span> spans;
+        uint64_t scan_time;
+
+    public:
+        Recorder();
+
+        void add(Phase phase, Ident func, uint64_t start, uint64_t end);
+        // scanning done on one thread, while parsing
+        void add_scan_time(uint64_t t)
+        {
+            scan_time += t;
+        }
+        bool empty() const
+        {
+            return spans.empty();
+        }
+
+        // time by phase for the file, then by function, slowest first
+        void report(std::ostream& o, std::string const& file) const;
+        // the Chrome trace events of recs[i], the recorder of files[i]
+        static void trace(std::ostream& o, std::vector<std::string> const& files, std::vector<Recorder> const& recs);
+    };
+
+    // Records a span of phase from its construction to its end, if given a
+    // recorder, and marks this thread as in phase meanwhile, if tracking
+    class Scope {
+        Recorder* rec;
+        Phase phase;
+        Ident func;
+        uint64_t start;
+        Phase outer;
+
+    public:
+        Scope(Recorder* rec, Phase phase, Ident func = Ident::none())
+            : rec(rec), phase(phase), func(func), start(rec != nullptr ? now() : 0), outer(Phase::Nr)
+        {
+            if (tracking) {
+                outer = current;
+                current = phase;
+            }
+        }
+        ~Scope()
+        {
+            if (rec != nullptr)
+                rec->add(phase, func, start, now());
+            if (tracking)
+                current = outer;
+        }
+        Scope(Scope const&) = delete;
+        Scope& operator=(Scope const&) = delete;
+    };
+}
+
+#endif // TIMING_H
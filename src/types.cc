@@ -1,8 +1,11 @@
 #include <error.h>
+#include <json.h>
 #include <types.h>
 #include <cassert>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 
 void SemType::print(std::ostream& o) const
 {
@@ -50,6 +53,117 @@ void SemType::print(std::ostream& o) const
         assert(false);
     }
 }
+static char const* const prim_names[] = { "void", "bool", "int", "float", "string" };
+
+void SemType::json(Json::Writer& w) const
+{
+    switch (category) {
+    case Category::PTR:
+        w.begin_object();
+        w.key("ptr");
+        u.p.points_to->json(w);
+        w.member("const", u.p.points_to_const);
+        w.end_object();
+        break;
+    case Category::ARRAY:
+        w.begin_object();
+        w.key("array");
+        u.a.element_type->json(w);
+        w.member("size", (uint64_t)u.a.size);
+        w.end_object();
+        break;
+    case Category::FUNC:
+        w.begin_object();
+        w.key("func");
+        u.f.ret->json(w);
+        w.key("params");
+        w.begin_array();
+        for (SemType const* p : u.f.params)
+            p->json(w);
+        w.end_array();
+        w.end_object();
+        break;
+    default:
+        w.value(prim_names[(size_t)category]);
+    }
+}
+
+SemType const* SemType::from_json(Json::Reader& r)
+{
+    return from_json(r, "type");
+}
+
+// path names the value read, for errors, as keys and indices from the
+// member holding the type
+SemType const* SemType::from_json(Json::Reader& r, std::string const& path)
+{
+    Json::Reader::Type kind = r.next_type();
+    if (kind == Json::Reader::Type::STRING) {
+        std::string n = r.get_string();
+        SemType const* (*const makers[])() = { make_void, make_bool, make_int, make_float, make_string };
+        for (size_t i = 0; i < sizeof(makers) / sizeof(makers[0]); ++i)
+            if (n == prim_names[i])
+                return makers[i]();
+        r.fail(path + ": unknown type " + n);
+    }
+    if (kind != Json::Reader::Type::OBJECT)
+        r.fail(path + ": expected a type name or an object of its parts");
+
+    SemType const* base = nullptr;
+    Category c = Category::Nr;
+    bool points_to_const = false, has_const = false;
+    size_t size = 0;
+    bool has_size = false;
+    std::vector<SemType const*> params;
+    bool has_params = false;
+    std::string k;
+    r.begin_object();
+    while (r.next_key(k)) {
+        if (k == "ptr" || k == "array" || k == "func") {
+            if (c != Category::Nr)
+                r.fail(path + ": more than one of ptr, array and func");
+            c = (k == "ptr" ? Category::PTR : k == "array" ? Category::ARRAY : Category::FUNC);
+            base = from_json(r, path + "." + k);
+        } else if (k == "const") {
+            points_to_const = r.get_bool();
+            has_const = true;
+        } else if (k == "size") {
+            size = r.get_uint();
+            has_size = true;
+        } else if (k == "params") {
+            if (r.next_type() != Json::Reader::Type::ARRAY)
+                r.fail(path + ".params: expected an array");
+            r.begin_array();
+            while (r.next_elem())
+                params.push_back(from_json(r, path + ".params[" + std::to_string(params.size()) + "]"));
+            has_params = true;
+        } else
+            r.skip();
+    }
+
+    if (c == Category::Nr)
+        r.fail(path + ": none of ptr, array and func");
+    if (has_const && c != Category::PTR)
+        r.fail(path + ": const is for ptr");
+    if (has_size != (c == Category::ARRAY))
+        r.fail(path + (has_size ? ": size is for array" : ": array without a size"));
+    if (has_params != (c == Category::FUNC))
+        r.fail(path + (has_params ? ": params are for func" : ": func without params"));
+
+    SemType const* t;
+    if (c == Category::PTR)
+        t = make_ptr(base, points_to_const);
+    else if (c == Category::ARRAY)
+        t = make_array(base, size);
+    else
+        t = make_func(base, params);
+    // the maker has said what is wrong in aux_error_msg, which the error
+    // takes up
+    if (t == nullptr)
+        r.fail(path + ": bad type");
+    return t;
+}
+
 TAC::Type SemType::to_tactype() const
 {
     switch (category) {
@@ -96,21 +210,74 @@ SemType const* SemType::make_string()
     return &singleton;
 }
 
+namespace {
+    size_t hash_combine(size_t seed, size_t v)
+    {
+        return seed ^ (v + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2));
+    }
+    size_t hash_type(SemType const* t)
+    {
+        return std::hash<SemType const*>()(t);
+    }
+
+    // derived types are hash-consed: each structure is built exactly once, so
+    // type equality stays pointer equality; entries are bucketed by a hash of
+    // their structure and compared field by field only within a bucket;
+    // files parsed side by side share the tables, hence the lock
+    struct TypeTable {
+        std::mutex m;
+        std::unordered_multimap<size_t, std::unique_ptr<SemType>> types;
+
+        size_t size()
+        {
+            std::lock_guard<std::mutex> l(m);
+            return types.size();
+        }
+    };
+    TypeTable& ptr_types()
+    {
+        static TypeTable t;
+        return t;
+    }
+    TypeTable& array_types()
+    {
+        static TypeTable t;
+        return t;
+    }
+    TypeTable& func_types()
+    {
+        static TypeTable t;
+        return t;
+    }
+}
+
+void SemType::count_derived(size_t& ptrs, size_t& arrays, size_t& funcs)
+{
+    ptrs = ptr_types().size();
+    arrays = array_types().size();
+    funcs = func_types().size();
+}
+
 SemType const* SemType::make_ptr(SemType const* points_to, bool points_to_const)
 {
-    static std::vector<std::shared_ptr<SemType>> cache;
+    TypeTable& cache = ptr_types();
 
-    for (auto const& p : cache)
+    size_t h = hash_combine(hash_type(points_to), points_to_const);
+    std::lock_guard<std::mutex> l(cache.m);
+    auto range = cache.types.equal_range(h);
+    for (auto it = range.first; it != range.second; ++it) {
+        SemType const* p = it->second.get();
         if (p->u.p.points_to == points_to && p->u.p.points_to_const == points_to_const)
-            return p.get();
-    std::shared_ptr<SemType> p(new SemType(points_to, points_to_const));
-    cache.push_back(p);
-    return p.get();
+            return p;
+    }
+    SemType* p = new SemType(points_to, points_to_const);
+    cache.types.emplace(h, std::unique_ptr<SemType>(p));
+    return p;
 }
 
 SemType const* SemType::make_array(SemType const* element_type, size_t size)
 {
-    static std::vector<std::shared_ptr<SemType>> cache;
+    TypeTable& cache = array_types();
 
     if (element_type->category == SemType::Category::VOID) {
         aux_error_msg = "Array declared as void type";
@@ -123,17 +290,22 @@ SemType const* SemType::make_array(SemType const* element_type, size_t size)
         aux_error_msg = "Array declared with zero size";
         return nullptr;
     }
-    for (auto const& a : cache)
+    size_t h = hash_combine(hash_type(element_type), size);
+    std::lock_guard<std::mutex> l(cache.m);
+    auto range = cache.types.equal_range(h);
+    for (auto it = range.first; it != range.second; ++it) {
+        SemType const* a = it->second.get();
         if (a->u.a.element_type == element_type && a->u.a.size == size)
-            return a.get();
-    std::shared_ptr<SemType> a(new SemType(element_type, size));
-    cache.push_back(a);
-    return a.get();
+            return a;
+    }
+    SemType* a = new SemType(element_type, size);
+    cache.types.emplace(h, std::unique_ptr<SemType>(a));
+    return a;
 }
 
 SemType const* SemType::make_func(SemType const* ret, std::vector<SemType const*> const& params)
 {
-    static std::vector<std::shared_ptr<SemType>> cache;
+    TypeTable& cache = func_types();
 
     if (ret->is_func()) {
         aux_error_msg = "Function returning function";
@@ -149,22 +321,19 @@ SemType const* SemType::make_func(SemType const* ret, std::vector<SemType const*
             return nullptr;
         }
     }
-    size_t l = params.size();
-    for (auto const& f : cache) {
-        if (f->u.f.ret != ret || f->u.f.params.size() != l)
-            continue;
-        bool match = true;
-        for(size_t i = 0; i < l; ++i)
-            if (params[i] != f->u.f.params[i]) {
-                match = false;
-                break;
-            }
-        if (match)
-            return f.get();
+    size_t h = hash_combine(hash_type(ret), params.size());
+    for (SemType const* param_type : params)
+        h = hash_combine(h, hash_type(param_type));
+    std::lock_guard<std::mutex> l(cache.m);
+    auto range = cache.types.equal_range(h);
+    for (auto it = range.first; it != range.second; ++it) {
+        SemType const* f = it->second.get();
+        if (f->u.f.ret == ret && f->u.f.params == params)
+            return f;
     }
-    std::shared_ptr<SemType> f(new SemType(ret, params));
-    cache.push_back(f);
-    return f.get();
+    SemType* f = new SemType(ret, params);
+    cache.types.emplace(h, std::unique_ptr<SemType>(f));
+    return f;
 }
 
 bool SemType::check_assign(SemType const* s1, SemType const* s2)
@@ -4,8 +4,14 @@
 #include <cassert>
 #include <vector>
 #include <iostream>
+#include <string>
 #include <tac.h>
 
+namespace Json {
+    class Writer;
+    class Reader;
+}
+
 class SemType {
 private:
     enum class Category {
@@ -52,6 +58,7 @@ private:
         : category(Category::ARRAY), u(x, y) {}
     SemType(SemType const* x, std::vector<SemType const*> const& y)
         : category(Category::FUNC), u(x, y) {}
+    static SemType const* from_json(Json::Reader&, std::string const& path);
 
 public:
     ~SemType()
@@ -65,6 +72,11 @@ public:
     }
     void print(std::ostream&) const;
     TAC::Type to_tactype() const;
+    // "int" and the like, or an object of the parts of a derived type
+    void json(Json::Writer&) const;
+    // reports anything but a type as written by json() through
+    // Json::Reader::fail, naming where in the type it is
+    static SemType const* from_json(Json::Reader&);
 
     static SemType const* make_void();
     static SemType const* make_bool();
@@ -74,6 +86,8 @@ public:
     static SemType const* make_ptr(SemType const* points_to, bool points_to_const);
     static SemType const* make_array(SemType const* element_type, size_t size);
     static SemType const* make_func(SemType const* ret, std::vector<SemType const*> const& params);
+    // how many pointer, array and function types have been made
+    static void count_derived(size_t& ptrs, size_t& arrays, size_t& funcs);
 
     bool is_void() const
     {
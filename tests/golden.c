@@ -0,0 +1,34 @@
+int g;
+float d;
+
+float scale(float x, int k)
+{
+    float y;
+    y = x * 2.5 - x / 4.0 + -x;
+    if (y < x || k >= 3)
+        y = y + 1.0;
+    return y;
+}
+
+void main()
+{
+    int i, j;
+    float f;
+    i = 0;
+    j = 100000;
+    g = j * 3 / 7;
+    while (i <= 2 && i != 5) {
+        i = i + 1;
+        g = -g;
+    }
+    if (i == 3 && !(g > 1))
+        g = 70000;
+    d = scale(1.5, i);
+    f = d;
+    if (f <= d)
+        print f;
+    if (f != d || f > d)
+        print "differ";
+    g = 40000;
+    print g;
+}
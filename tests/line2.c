@@ -0,0 +1,2 @@
+void main()
+{ int x; x = ; }
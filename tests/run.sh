@@ -0,0 +1,207 @@
+#!/bin/bash
+# usage: run.sh SCLP DIR -- runs the tests of sclp SCLP, working in DIR
+SCLP=$(realpath "$1")
+TESTS=$(dirname "$(realpath "$0")")
+DIR=$2
+mkdir -p "$DIR"
+cd "$DIR" || exit 1
+
+failed=0
+fail()
+{
+    echo "FAIL: $*"
+    failed=1
+}
+
+# an error in FILE is reported at LINE of it
+expect_error_line()
+{
+    cp "$TESTS/$1" "$1"
+    "$SCLP" "$1" 2> err.txt
+    status=$?
+    if [ $status -ne 1 ]; then
+        fail "$1: exit status $status, not 1"
+    elif ! head -1 err.txt | grep -qx "sclp error: $1:$2"; then
+        fail "$1: error not reported at line $2: $(head -1 err.txt)"
+    fi
+}
+
+# a snapshot of STAGE cut short is refused, and one with any byte changed
+# is refused or compiled, never crashes on
+expect_damaged_snapshot()
+{
+    cp "$TESTS/snapshot.c" snapshot.c
+    "$SCLP" --dump-ir="$1" snapshot.c || { fail "snapshot.c: --dump-ir=$1 failed"; return; }
+    size=$(stat -c %s snapshot.c.ir)
+    head -c $((size / 2)) snapshot.c.ir > cut.ir
+    "$SCLP" --load-ir="$1" cut.ir 2> err.txt
+    status=$?
+    if [ $status -ne 1 ] || ! grep -q "damaged" err.txt; then
+        fail "snapshot of $1 cut short: exit status $status, $(head -2 err.txt)"
+    fi
+    for ((off = 0; off < size; ++off)); do
+        cp snapshot.c.ir bad.ir
+        printf '\377' | dd of=bad.ir bs=1 seek=$off conv=notrunc status=none
+        "$SCLP" --load-ir="$1" bad.ir > /dev/null 2>&1
+        status=$?
+        if [ $status -gt 1 ]; then
+            fail "snapshot of $1 with byte $off changed: exit status $status"
+            return
+        fi
+    done
+}
+
+# a server sent a request claiming 2^30 files answers it, and the next
+expect_server_survives()
+{
+    rm -f sock
+    "$SCLP" --server=sock &
+    server=$!
+    for ((k = 0; k < 50; ++k)); do
+        [ -S sock ] && break
+        sleep 0.1
+    done
+    perl -MIO::Socket::UNIX -e '
+        my $s = IO::Socket::UNIX->new(Type => SOCK_STREAM, Peer => "sock") or exit 1;
+        # magic, version, directory, stage, flags, cache and trace
+        # directories, IR stages, then the count of files and none of them
+        my $req = pack("LLL/a*LLL/a*L/a*LLLL", 0x53434c50, 6, "/", 4, 0, "", "", 0, 0, 0, 1 << 30);
+        print $s pack("L/a*", $req);
+        local $/;
+        exit(defined(<$s>) ? 0 : 1);
+    ' || fail "server: no reply to a request claiming 2^30 files"
+    cp "$TESTS/golden.c" served.c
+    "$SCLP" --client=sock served.c 2> err.txt || fail "server: request after a bad one failed: $(head -2 err.txt)"
+    kill $server
+    wait $server 2> /dev/null
+}
+
+# a function cache entry whose registers are damaged is compiled afresh
+expect_damaged_cache_recompiled()
+{
+    rm -rf cache
+    cp "$TESTS/golden.c" cached.c
+    "$SCLP" cached.c && mv cached.c.spim fresh.spim
+    "$SCLP" --cache-dir=cache cached.c || { fail "cached.c: compile with a cache failed"; return; }
+    # only the function entries, under fn, are left; in each, the first
+    # register of every 16-byte record after the two counts is set past the
+    # last there is
+    find cache -mindepth 1 -maxdepth 1 ! -name fn -exec rm -rf {} +
+    for e in cache/fn/*/*; do
+        nr=$(od -An -tu8 -N8 "$e")
+        for ((k = 0; k < nr; ++k)); do
+            printf '\377' | dd of="$e" bs=1 seek=$((16 + 16 * k + 1)) conv=notrunc status=none
+        done
+    done
+    "$SCLP" --cache-dir=cache cached.c 2> err.txt
+    status=$?
+    if [ $status -ne 0 ]; then
+        fail "cached.c: damaged cache: exit status $status, $(head -2 err.txt)"
+    elif ! cmp -s fresh.spim cached.c.spim; then
+        fail "cached.c: damaged cache: output differs from a fresh compile"
+    fi
+}
+
+# the RTL of golden.c dumped by OPTION, which writes SUFFIX, with its
+# functions' assembly in a cache already, is that dumped without a cache
+expect_cached_rtl_dumped()
+{
+    rm -rf cache
+    cp "$TESTS/golden.c" dumped.c
+    "$SCLP" $1 dumped.c && mv "dumped.c$2" fresh"$2"
+    "$SCLP" --cache-dir=cache dumped.c || { fail "dumped.c: compile with a cache failed"; return; }
+    "$SCLP" --cache-dir=cache $1 dumped.c 2> err.txt || { fail "dumped.c: $1 with a cache failed: $(head -2 err.txt)"; return; }
+    if ! cmp -s fresh"$2" "dumped.c$2"; then
+        fail "dumped.c: $1 with a cache differs from one without"
+    fi
+}
+
+# the AST of types.c, dumped as JSON and edited by the sed script EDIT,
+# is refused with an error saying MESSAGE
+expect_bad_json_type()
+{
+    cp "$TESTS/types.c" types.c
+    "$SCLP" --show-json-ast types.c || { fail "types.c: --show-json-ast failed"; return; }
+    sed "$1" types.c.ast.json > bad.json
+    "$SCLP" --read-json-ast bad.json 2> err.txt
+    status=$?
+    if [ $status -ne 1 ]; then
+        fail "types.c: JSON edited by $1: exit status $status, not 1"
+    elif ! grep -qF "$2" err.txt; then
+        fail "types.c: JSON edited by $1: error not \"$2\": $(head -2 err.txt)"
+    fi
+}
+
+# the STAGE of snapshot.c, dumped as JSON and edited by the sed script
+# EDIT, is refused with an error saying MESSAGE
+expect_bad_json_ir()
+{
+    cp "$TESTS/snapshot.c" snapshot.c
+    "$SCLP" --show-json-"$1" snapshot.c || { fail "snapshot.c: --show-json-$1 failed"; return; }
+    sed "$2" snapshot.c."$1".json > bad.json
+    "$SCLP" --read-json-"$1" bad.json 2> err.txt
+    status=$?
+    if [ $status -ne 1 ]; then
+        fail "snapshot.c: $1 JSON edited by $2: exit status $status, not 1"
+    elif ! grep -qF "$3" err.txt; then
+        fail "snapshot.c: $1 JSON edited by $2: error not \"$3\": $(head -2 err.txt)"
+    fi
+}
+
+# JSON nested 100000 deep in a member skipped, and 20000 deep in the AST
+# of an expression of 20000 terms, is refused, not run out of stack on
+expect_deep_json_refused()
+{
+    { printf '{"sclp":"ast","version":1,"skipped":'; printf '%100000s' '' | tr ' ' '['; printf '%100000s' '' | tr ' ' ']'; printf '}\n'; } > deep.json
+    "$SCLP" --read-json-ast deep.json 2> err.txt
+    status=$?
+    if [ $status -ne 1 ] || ! grep -q "nested more than" err.txt; then
+        fail "deep.json: exit status $status, $(head -2 err.txt)"
+    fi
+    { printf 'int main()\n{\n    int a;\n    a = 1'; printf '%20000s' '' | sed 's/ / + a/g'; printf ';\n    return a;\n}\n'; } > long.c
+    "$SCLP" --show-json-ast long.c || { fail "long.c: --show-json-ast failed"; return; }
+    "$SCLP" --read-json-ast long.c.ast.json 2> err.txt
+    status=$?
+    if [ $status -ne 1 ] || ! grep -q "nested more than" err.txt; then
+        fail "long.c.ast.json: exit status $status, $(head -2 err.txt)"
+    fi
+}
+
+# the text segment of golden.c assembled by --emit=bin is that in
+# golden.words, one little-endian word a line: the SPIM output of golden.c,
+# its pseudo-instructions expanded as SPIM does and its symbols placed as
+# in the executable, as assembled by llvm-mc -triple=mipsel -mcpu=mips32r2
+expect_golden_text()
+{
+    cp "$TESTS/golden.c" golden.c
+    "$SCLP" --emit=bin golden.c || { fail "golden.c: --emit=bin failed"; return; }
+    # the size of the text segment is in the first program header
+    size=$(od -An -tu4 -j 68 -N 4 golden.c.bin | tr -d ' ')
+    od -An -tx4 -v -j 4096 -N "$size" golden.c.bin | tr -s ' ' '\n' | sed '/^$/d' > golden.txt
+    if ! cmp -s "$TESTS/golden.words" golden.txt; then
+        fail "golden.c: text segment differs from golden.words: $(diff "$TESTS/golden.words" golden.txt | head -4 | tr '\n' ' ')"
+    fi
+}
+
+expect_error_line line2.c 2
+expect_golden_text
+expect_bad_json_type '1s/"size":3/"size":0/' 'type: bad type: Array declared with zero size'
+expect_bad_json_type '1s/,"size":3//' 'type: array without a size'
+expect_bad_json_type '1s/"array":"int"/"array":7/' 'type.array: expected a type name'
+expect_bad_json_type '2s/"params":\[\]/"params":[{"ptr":"int","size":1}]/' 'type.params[0]: size is for array'
+expect_bad_json_ir tac '1s/"strings":\["big"\]/"strings":[]/' 'function main has an operand of a kind its slot does not take, or a var, call or string it has not'
+expect_bad_json_ir tac '3s/"b":{"float":2}/"b":{"call":{"func":"half","args":[]}}/' 'function half has an operand'
+expect_bad_json_ir tac '7s/"a":{"var":0}/"a":{"int":0}/' 'function half has an operand'
+expect_bad_json_ir rtl '0,/\["return","f0"\]/s//["return",null]/' 'expected a register, not null'
+expect_deep_json_refused
+expect_damaged_cache_recompiled
+expect_cached_rtl_dumped --dump-ir=rtl .ir
+expect_cached_rtl_dumped --show-json-rtl .rtl.json
+expect_server_survives
+expect_damaged_snapshot tac
+expect_damaged_snapshot rtl
+
+if [ $failed -eq 0 ]; then
+    echo "All tests passed"
+fi
+exit $failed
@@ -0,0 +1,28 @@
+int g;
+float h;
+
+float half(float x)
+{
+    return x / 2.0;
+}
+
+int add(int a, int b)
+{
+    return a + b;
+}
+
+void main()
+{
+    int i;
+    float f;
+    i = 0;
+    while (i < 3) {
+        g = add(g, i);
+        i = i + 1;
+    }
+    f = half(1.5);
+    if (f > 0.5 && g != 2)
+        print "big";
+    print g;
+    print f;
+}
@@ -0,0 +1,6 @@
+int a[3];
+void main()
+{
+    a[0] = 1;
+    print a[0];
+}